@@ -0,0 +1,146 @@
+#include "output_service.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+
+OutputService
+:: OutputService (int maxQueueSize)
+    : m_maxQueueSize (std::max(0, maxQueueSize))
+{
+    if (isAsynchronous()) {
+        m_writer = std::thread(&OutputService::runWriter, this);
+    }
+}
+
+OutputService
+:: ~OutputService ()
+{
+    if (!isAsynchronous()) {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvIdle.wait(lock, [this]() {
+            return m_queue.empty() && !m_isBusy;
+        });
+        m_stop = true;
+    }
+    m_cvNotEmpty.notify_all();
+    m_writer.join();
+
+    // a destructor must not throw; an error not seen
+    // by a flush is reported instead of being dropped
+    if (m_error) {
+        try {
+            std::rethrow_exception(m_error);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Unhandled output error: " << e.what()
+                      << std::endl;
+        }
+        catch (...) {
+            std::cerr << "Unhandled output error" << std::endl;
+        }
+    }
+}
+
+void OutputService
+:: submit (std::function<void()> job)
+{
+    if (!isAsynchronous()) {
+        job();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvNotFull.wait(lock, [this]() {
+            return static_cast<int>(m_queue.size()) < m_maxQueueSize;
+        });
+        m_queue.push_back(std::move(job));
+    }
+    m_cvNotEmpty.notify_one();
+}
+
+void OutputService
+:: writeFile (const std::string& fileName,
+              std::function<void(std::ostream&)> writer)
+{
+    submit([fileName, writer = std::move(writer)]() {
+        std::ofstream file(fileName);
+        if (!file.good()) {
+            throw std::runtime_error("Unable to open file: "+fileName);
+        }
+        writer(file);
+
+        // a failed write, e.g. to a full disk, shows in the stream
+        // state, at the latest when the buffer is flushed by close
+        if (!file.good()) {
+            throw std::runtime_error("Unable to write file: "+fileName);
+        }
+        file.close();
+        if (file.fail()) {
+            throw std::runtime_error("Unable to close file: "+fileName);
+        }
+    });
+}
+
+void OutputService
+:: flush ()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cvIdle.wait(lock, [this]() {
+        return m_queue.empty() && !m_isBusy;
+    });
+
+    if (m_error) {
+        auto error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void OutputService
+:: runWriter ()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvNotEmpty.wait(lock, [this]() {
+                return m_stop || !m_queue.empty();
+            });
+            if (m_queue.empty()) {
+                return;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_isBusy = true;
+        }
+        m_cvNotFull.notify_one();
+
+        std::exception_ptr error;
+        try {
+            job();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (error && !m_error) {
+                m_error = error;
+            }
+            m_isBusy = false;
+        }
+        m_cvIdle.notify_all();
+    }
+}
+
+// End of file
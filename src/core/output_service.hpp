@@ -0,0 +1,78 @@
+#ifndef CORE_OUTPUT_SERVICE_HPP
+#define CORE_OUTPUT_SERVICE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+
+/**
+ * @brief Runs output jobs on a background writer thread.
+ *
+ * Jobs are queued in submission order and run one at a time.
+ * The queue is bounded; submit blocks while it is full, so that
+ * the producers cannot run arbitrarily far ahead of the disk.
+ * Jobs must only capture immutable snapshots or reference-counted
+ * data, as they run after submit returns. With a queue size
+ * of zero, jobs run synchronously in submit.
+ * The first exception thrown by a job is rethrown by flush;
+ * an exception still pending at destruction is reported to std::cerr.
+ */
+class OutputService
+{
+public:
+    //! Constructor with the maximum number of queued jobs
+    explicit OutputService (int maxQueueSize=4);
+
+    //! Flushes the queue and stops the writer thread;
+    //! call flush before to handle the pending errors
+    ~OutputService ();
+
+    OutputService (const OutputService&) = delete;
+    OutputService& operator= (const OutputService&) = delete;
+
+    //! Queues a job; blocks while the queue is full
+    void submit (std::function<void()> job);
+
+    //! Queues a job that writes a file with the given writer;
+    //! the job throws if the file cannot be opened, written or closed
+    void writeFile (const std::string& fileName,
+                    std::function<void(std::ostream&)> writer);
+
+    //! Waits until all queued jobs are finished
+    void flush ();
+
+    bool isAsynchronous() const {
+        return m_maxQueueSize > 0;
+    }
+
+    int getMaxQueueSize() const {
+        return m_maxQueueSize;
+    }
+
+private:
+    //! Runs the queued jobs until stopped
+    void runWriter ();
+
+private:
+    int m_maxQueueSize;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cvNotEmpty;
+    std::condition_variable m_cvNotFull;
+    std::condition_variable m_cvIdle;
+
+    std::deque<std::function<void()>> m_queue;
+    bool m_isBusy = false;
+    bool m_stop = false;
+    std::exception_ptr m_error;
+
+    std::thread m_writer;
+};
+
+#endif // CORE_OUTPUT_SERVICE_HPP
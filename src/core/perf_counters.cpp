@@ -0,0 +1,189 @@
+#include "perf_counters.hpp"
+
+#include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+const char* PerfCounters
+:: getEventName (int event)
+{
+    static const char* names[numEvents]
+            = {"cycles", "instructions", "cache_references", "cache_misses"};
+    assert(event >= 0 && event < numEvents);
+    return names[event];
+}
+
+#ifdef __linux__
+
+namespace {
+
+int openCounter (std::uint64_t config, pid_t tid)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return static_cast<int>
+            (syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0));
+}
+
+}
+
+PerfCounters
+:: PerfCounters ()
+{
+    const std::uint64_t configs[numEvents]
+            = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+               PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+
+    // the calling thread first; its counters decide the availability
+    std::vector<pid_t> tids {static_cast<pid_t>(syscall(SYS_gettid))};
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator("/proc/self/task", ec))
+    {
+        pid_t tid = static_cast<pid_t>
+                (std::stol(entry.path().filename().string()));
+        if (tid != tids[0]) { tids.push_back(tid); }
+    }
+
+    for (pid_t tid : tids)
+    {
+        std::array<int, numEvents> fds;
+        bool isOpen = true;
+        for (int k=0; k<numEvents; k++)
+        {
+            fds[k] = isOpen ? openCounter(configs[k], tid) : -1;
+            isOpen = isOpen && fds[k] >= 0;
+        }
+        if (isOpen) {
+            m_fds.push_back(fds);
+            continue;
+        }
+
+        for (int fd : fds) {
+            if (fd >= 0) { close(fd); }
+        }
+        // threads may exit meanwhile
+        if (tid == tids[0])
+        {
+            // reported once per process, not per measured run
+            static std::once_flag isReported;
+            std::call_once(isReported, []() {
+                std::cout << "Hardware performance counters are not "
+                             "available, only timers are used"
+                          << std::endl;
+            });
+            return;
+        }
+    }
+    m_isAvailable = true;
+}
+
+PerfCounters
+:: ~PerfCounters ()
+{
+    for (const auto& fds : m_fds) {
+        for (int fd : fds) { close(fd); }
+    }
+}
+
+PerfCounters::Values PerfCounters
+:: read () const
+{
+    Values values {};
+    for (const auto& fds : m_fds) {
+        for (int k=0; k<numEvents; k++)
+        {
+            // value, time enabled, time running
+            std::uint64_t buf[3];
+            if (::read(fds[k], buf, sizeof(buf)) != sizeof(buf)) {
+                continue;
+            }
+            if (buf[2] > 0) {
+                values[k] += static_cast<double>(buf[0])
+                        *(static_cast<double>(buf[1])/buf[2]);
+            }
+        }
+    }
+    return values;
+}
+
+#else
+
+PerfCounters
+:: PerfCounters ()
+{}
+
+PerfCounters
+:: ~PerfCounters ()
+{}
+
+PerfCounters::Values PerfCounters
+:: read () const
+{
+    return Values {};
+}
+
+#endif
+
+
+void addPhaseMetrics (std::vector<PhaseMetrics>& sum,
+                      const std::vector<PhaseMetrics>& phases)
+{
+    if (sum.empty()) {
+        sum = phases;
+        return;
+    }
+
+    assert(sum.size() == phases.size());
+    for (size_t i=0; i<phases.size(); i++)
+    {
+        assert(sum[i].name == phases[i].name);
+        sum[i].elapsedTime += phases[i].elapsedTime;
+        sum[i].hasCounters = sum[i].hasCounters && phases[i].hasCounters;
+        for (int k=0; k<PerfCounters::numEvents; k++) {
+            sum[i].counters[k] += phases[i].counters[k];
+        }
+    }
+}
+
+void scalePhaseMetrics (std::vector<PhaseMetrics>& phases, double scale)
+{
+    for (auto& phase : phases)
+    {
+        phase.elapsedTime *= scale;
+        for (auto& value : phase.counters) {
+            value *= scale;
+        }
+    }
+}
+
+
+PhaseProfiler
+:: PhaseProfiler (bool useCounters)
+{
+    if (useCounters) {
+        m_counters = std::make_unique<PerfCounters>();
+    }
+}
+
+// End of file
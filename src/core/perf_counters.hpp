@@ -0,0 +1,136 @@
+#ifndef CORE_PERF_COUNTERS_HPP
+#define CORE_PERF_COUNTERS_HPP
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Hardware performance counters of the process,
+ * read with the Linux perf_event_open interface.
+ *
+ * The counters are opened for every thread that exists at construction,
+ * e.g. the OpenMP pool, and are inherited by the threads spawned later.
+ * They run continuously in user space; differences of two reads give
+ * the counts of a phase, so measurements can be nested. Multiplexed
+ * counters are scaled by their enabled and running times.
+ * If the counters are not permitted (see perf_event_paranoid)
+ * or not supported, isAvailable() is false and reads give zeros.
+ */
+class PerfCounters
+{
+public:
+    enum Event {cycles, instructions, cacheReferences, cacheMisses,
+                numEvents};
+
+    using Values = std::array<double, numEvents>;
+
+    //! Returns the name of an event, as written to output files
+    static const char* getEventName(int event);
+
+    PerfCounters ();
+
+    ~PerfCounters ();
+
+    PerfCounters (const PerfCounters&) = delete;
+    PerfCounters& operator= (const PerfCounters&) = delete;
+
+    bool isAvailable() const {
+        return m_isAvailable;
+    }
+
+    //! Returns the counts since construction, summed over the threads
+    Values read () const;
+
+private:
+    bool m_isAvailable = false;
+
+    //! file descriptors, one per event and thread
+    std::vector<std::array<int, numEvents>> m_fds;
+};
+
+
+/**
+ * @brief Wall time and, optionally, hardware counters of a phase
+ */
+struct PhaseMetrics
+{
+    std::string name;
+    double elapsedTime = 0;
+    bool hasCounters = false;
+    PerfCounters::Values counters {};
+};
+
+//! Adds the metrics of phases to the ones of the same phases
+void addPhaseMetrics (std::vector<PhaseMetrics>& sum,
+                      const std::vector<PhaseMetrics>& phases);
+
+//! Scales the metrics of phases, e.g. to average repetitions
+void scalePhaseMetrics (std::vector<PhaseMetrics>& phases, double scale);
+
+
+/**
+ * @brief Measures named phases of a run with timers and,
+ * if requested and permitted, hardware counters
+ */
+class PhaseProfiler
+{
+public:
+    //! Constructor; the counters are only opened if requested
+    explicit PhaseProfiler (bool useCounters=false);
+
+    bool hasCounters() const {
+        return m_counters && m_counters->isAvailable();
+    }
+
+    /**
+     * @brief Runs a phase and records its metrics;
+     * phases may be nested, and are recorded when they end
+     * @param name name of the phase
+     * @param phase callable that runs the phase
+     * @return elapsed wall time in seconds
+     */
+    template <typename Phase>
+    double measure (const std::string& name, Phase&& phase)
+    {
+        PerfCounters::Values begin {};
+        if (hasCounters()) { begin = m_counters->read(); }
+        auto start = std::chrono::high_resolution_clock::now();
+
+        phase();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        PhaseMetrics metrics;
+        metrics.name = name;
+        metrics.elapsedTime
+                = std::chrono::duration<double>(end - start).count();
+        if (hasCounters())
+        {
+            auto values = m_counters->read();
+            metrics.hasCounters = true;
+            for (int k=0; k<PerfCounters::numEvents; k++) {
+                metrics.counters[k] = values[k] - begin[k];
+            }
+        }
+        m_phases.push_back(std::move(metrics));
+
+        return m_phases.back().elapsedTime;
+    }
+
+    const std::vector<PhaseMetrics>& getPhases() const {
+        return m_phases;
+    }
+
+    void clear() {
+        m_phases.clear();
+    }
+
+private:
+    std::unique_ptr<PerfCounters> m_counters;
+    std::vector<PhaseMetrics> m_phases;
+};
+
+#endif // CORE_PERF_COUNTERS_HPP
@@ -0,0 +1,247 @@
+#include "sweep_scheduler.hpp"
+#include "config.hpp"
+#include "task_scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+//! output buffer of the concurrent job run by this thread
+thread_local std::ostringstream *t_jobOutput = nullptr;
+
+//! serializes the printing of the buffered outputs
+std::mutex s_jobOutputMutex;
+
+}
+
+std::ostream& getJobOutput ()
+{
+    if (t_jobOutput) {
+        return *t_jobOutput;
+    }
+    return std::cout;
+}
+
+SweepScheduler
+:: SweepScheduler (int numWorkers, int numThreadsPerWorker,
+                   double memoryBudget, double bytesPerDof)
+    : m_numWorkers (std::max(1, numWorkers)),
+      m_numThreadsPerWorker (std::max(1, numThreadsPerWorker)),
+      m_numThreads (1),
+      m_memoryBudget (memoryBudget),
+      m_bytesPerDof (bytesPerDof)
+{
+#ifdef _OPENMP
+    m_numThreads = omp_get_max_threads();
+#endif
+}
+
+void SweepScheduler
+:: addJob (int level, Job job, bool exclusive)
+{
+    m_jobs.push_back({level, std::move(job), exclusive});
+}
+
+void SweepScheduler
+:: run ()
+{
+    int numJobs = static_cast<int>(m_jobs.size());
+    m_peakMemoryEstimate = 0;
+    if (m_numWorkers == 1) {
+        for (int id=0; id<numJobs; id++) {
+            runJob(id, m_numThreads, true);
+        }
+        return;
+    }
+
+    // the first jobs of the two coarsest levels calibrate the estimates
+    std::vector<int> order(numJobs);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return m_jobs[a].level < m_jobs[b].level;
+    });
+    std::vector<bool> isCalibration(numJobs, false);
+    int numCalibrationLevels = 0;
+    for (int i=0; i<numJobs && numCalibrationLevels < 2; i++) {
+        if (i == 0 || m_jobs[order[i]].level != m_jobs[order[i-1]].level) {
+            isCalibration[order[i]] = true;
+            numCalibrationLevels++;
+        }
+    }
+    for (int id : order) {
+        if (isCalibration[id]) {
+            runJob(id, m_numThreads, true);
+        }
+    }
+
+    MemoryAwareScheduler scheduler(m_numWorkers, m_memoryBudget);
+    for (int id=0; id<numJobs; id++)
+    {
+        if (isCalibration[id]) { continue; }
+
+        int numThreads = m_jobs[id].exclusive ?
+                    m_numThreads : m_numThreadsPerWorker;
+        double memoryEstimate
+                = getBytesPerDof()*predictNumDofs(m_jobs[id].level);
+        scheduler.addTask([this, id, numThreads]() {
+            runJob(id, numThreads, m_jobs[id].exclusive);
+        }, memoryEstimate, m_jobs[id].exclusive);
+    }
+    scheduler.run();
+    m_peakMemoryEstimate = scheduler.getPeakMemoryEstimate();
+}
+
+void SweepScheduler
+:: runJob (int id, int numThreads, bool isAlone)
+{
+    // the OpenMP regions of this thread use the job's threads
+#ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+#else
+    (void) numThreads;
+#endif
+
+    // jobs that do not report their memory usage are measured
+    // by the growth of the peak resident memory, if run alone
+    std::pair<double, double> memoryBefore;
+    if (isAlone) {
+        memoryBefore = getResidentMemory();
+    }
+
+    // concurrent jobs buffer their output,
+    // which is printed in one piece when the job has finished
+    std::ostringstream output;
+    if (!isAlone) {
+        t_jobOutput = &output;
+    }
+    auto printOutput = [&output]() {
+        t_jobOutput = nullptr;
+        std::lock_guard<std::mutex> lock(s_jobOutputMutex);
+        std::cout << output.str() << std::flush;
+    };
+    JobStats stats;
+    try {
+        stats = m_jobs[id].run();
+    }
+    catch (...) {
+        printOutput();
+        throw;
+    }
+    printOutput();
+    if (stats.memoryUsage <= 0 && isAlone)
+    {
+        auto memoryAfter = getResidentMemory();
+        if (memoryAfter.first > memoryBefore.first) {
+            stats.memoryUsage = memoryAfter.first - memoryBefore.second;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (stats.numDofs > 0)
+    {
+        m_numDofs[m_jobs[id].level] = stats.numDofs;
+
+        // the largest ratio keeps the estimates conservative
+        if (stats.memoryUsage > 0) {
+            double bytesPerDof = stats.memoryUsage/stats.numDofs;
+            m_bytesPerDof = m_hasMemoryUsage ?
+                        std::max(m_bytesPerDof, bytesPerDof) : bytesPerDof;
+            m_hasMemoryUsage = true;
+        }
+    }
+}
+
+double SweepScheduler
+:: getBytesPerDof () const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytesPerDof;
+}
+
+double SweepScheduler
+:: predictNumDofs (int level) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_numDofs.empty()) {
+        return 0;
+    }
+
+    auto it = m_numDofs.find(level);
+    if (it != m_numDofs.end()) {
+        return it->second;
+    }
+
+    // geometric growth between the two coarsest recorded levels
+    auto coarse = m_numDofs.begin();
+    if (m_numDofs.size() == 1) {
+        return coarse->second;
+    }
+    auto fine = std::next(coarse);
+    double growth = std::pow(fine->second/coarse->second,
+                             1./(fine->first - coarse->first));
+    return fine->second*std::pow(growth, level - fine->first);
+}
+
+std::pair<double, double> SweepScheduler
+:: getResidentMemory ()
+{
+#ifdef __linux__
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double peak = 1024.*usage.ru_maxrss;
+
+    double size = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> size >> resident;
+    return {peak, resident*sysconf(_SC_PAGESIZE)};
+#else
+    return {0, 0};
+#endif
+}
+
+
+SweepScheduler makeSweepScheduler (const nlohmann::json& config)
+{
+    int numHardwareThreads
+            = std::max(1, static_cast<int>
+                       (std::thread::hardware_concurrency()));
+    int numWorkers, numThreadsPerWorker;
+    double memoryBudgetInMB, bytesPerDof;
+
+    // one worker runs the sweep sequentially
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "sweep_num_workers",
+                                        numWorkers, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (config, "sweep_num_threads_per_worker",
+             numThreadsPerWorker,
+             std::max(1, numHardwareThreads/std::max(1, numWorkers)));
+
+    // memory budget for concurrent jobs; unlimited if zero
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "sweep_memory_budget_mb",
+                                        memoryBudgetInMB, 0);
+
+    // initial estimate, refined by the first jobs
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "sweep_bytes_per_dof",
+                                        bytesPerDof, 4096);
+
+    return SweepScheduler(numWorkers, numThreadsPerWorker,
+                          memoryBudgetInMB*1024*1024, bytesPerDof);
+}
+
+// End of file
@@ -0,0 +1,126 @@
+#ifndef CORE_SWEEP_SCHEDULER_HPP
+#define CORE_SWEEP_SCHEDULER_HPP
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+
+/**
+ * @brief Runs the jobs of a sweep over discretisation levels,
+ * e.g. convergence tests or repeated measurements, concurrently
+ * within a memory budget and a thread budget.
+ *
+ * The memory of a job is estimated from its number of degrees of
+ * freedom times the bytes per dof. The dof counts of the levels are
+ * not known before a job has run, so the first jobs of the two
+ * coarsest levels run alone, with all threads; their dof counts
+ * give the growth per level, and their memory usage refines
+ * the bytes per dof. The remaining jobs run on a MemoryAwareScheduler,
+ * each with its share of the OpenMP threads. An exclusive job,
+ * e.g. a timing-sensitive measurement, runs alone with all threads.
+ * With a single worker, the jobs simply run one after another,
+ * in the order they were added. Jobs print to getJobOutput().
+ */
+class SweepScheduler
+{
+public:
+    //! Number of dofs of a job and, if known, its memory usage in bytes
+    struct JobStats
+    {
+        double numDofs = 0;
+        double memoryUsage = 0;
+    };
+
+    using Job = std::function<JobStats()>;
+
+    /**
+     * @brief Constructor
+     * @param numWorkers number of concurrent jobs
+     * @param numThreadsPerWorker number of OpenMP threads of a job
+     * @param memoryBudget memory budget in bytes;
+     * unlimited if not positive
+     * @param bytesPerDof initial estimate of the memory per dof
+     */
+    SweepScheduler (int numWorkers, int numThreadsPerWorker,
+                    double memoryBudget, double bytesPerDof);
+
+    /**
+     * @brief Adds a job
+     * @param level discretisation level; jobs of a level
+     * are expected to have the same size
+     * @param job callable that runs the job and returns its stats
+     * @param exclusive runs the job alone, with all threads
+     */
+    void addJob (int level, Job job, bool exclusive=false);
+
+    //! Runs all jobs and returns when they are finished;
+    //! the first exception of a job is rethrown
+    void run ();
+
+    int getNumWorkers() const {
+        return m_numWorkers;
+    }
+
+    //! Returns the bytes per dof, refined by the finished jobs
+    double getBytesPerDof() const;
+
+    //! Returns the peak of the estimated memory of concurrent jobs
+    double getPeakMemoryEstimate() const {
+        return m_peakMemoryEstimate;
+    }
+
+private:
+    //! Runs a job with the given number of threads and records its stats
+    void runJob (int id, int numThreads, bool isAlone);
+
+    //! Predicts the number of dofs of a level from the recorded ones
+    double predictNumDofs (int level) const;
+
+    //! Returns the peak and the current resident memory in bytes
+    static std::pair<double, double> getResidentMemory ();
+
+    struct SweepJob
+    {
+        int level;
+        Job run;
+        bool exclusive;
+    };
+
+    int m_numWorkers;
+    int m_numThreadsPerWorker;
+    int m_numThreads;
+    double m_memoryBudget;
+    double m_bytesPerDof;
+    double m_peakMemoryEstimate = 0;
+
+    std::vector<SweepJob> m_jobs;
+
+    //! recorded dof counts of the levels
+    std::map<int, double> m_numDofs;
+    bool m_hasMemoryUsage = false;
+    mutable std::mutex m_mutex;
+};
+
+/**
+ * @brief Returns the output stream of the job run by the calling thread.
+ *
+ * A job that runs concurrently with others writes to its own buffer,
+ * which is printed in one piece when the job has finished,
+ * so that the outputs of the jobs do not interleave;
+ * otherwise this is std::cout.
+ */
+std::ostream& getJobOutput ();
+
+/**
+ * @brief Creates a sweep scheduler from the config keys
+ * sweep_num_workers, sweep_num_threads_per_worker,
+ * sweep_memory_budget_mb and sweep_bytes_per_dof
+ */
+SweepScheduler makeSweepScheduler (const nlohmann::json& config);
+
+#endif // CORE_SWEEP_SCHEDULER_HPP
@@ -0,0 +1,123 @@
+#include "task_scheduler.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+
+MemoryAwareScheduler
+:: MemoryAwareScheduler (int numWorkers, double memoryBudget)
+    : m_numWorkers (std::max(1, numWorkers)),
+      m_memoryBudget (memoryBudget)
+{}
+
+void MemoryAwareScheduler
+:: addTask (std::function<void()> task, double memoryEstimate,
+           bool exclusive)
+{
+    m_tasks.push_back({std::move(task), memoryEstimate, exclusive});
+}
+
+void MemoryAwareScheduler
+:: run ()
+{
+    int numTasks = getNumTasks();
+
+    // largest memory estimates first
+    std::vector<int> order(numTasks);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](int a, int b) {
+        return m_tasks[a].memoryEstimate > m_tasks[b].memoryEstimate;
+    });
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<bool> isStarted(numTasks, false);
+    int numStarted = 0, numRunning = 0;
+    bool isExclusiveRunning = false;
+    double memoryInUse = 0;
+    std::exception_ptr error;
+    m_peakMemoryEstimate = 0;
+
+    // returns the next task that fits in the budget, or -1
+    auto findNextTask = [&]() {
+        if (isExclusiveRunning) { return -1; }
+        for (int k : order) {
+            if (isStarted[k]) { continue; }
+            // the running tasks drain before an exclusive one
+            if (m_tasks[k].exclusive) {
+                return numRunning == 0 ? k : -1;
+            }
+            if (numRunning == 0 || m_memoryBudget <= 0
+                    || memoryInUse + m_tasks[k].memoryEstimate
+                    <= m_memoryBudget) {
+                return k;
+            }
+        }
+        return -1;
+    };
+
+    auto worker = [&]() {
+        while (true)
+        {
+            int k;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() {
+                    return numStarted == numTasks || error
+                            || findNextTask() >= 0;
+                });
+                if (numStarted == numTasks || error) {
+                    return;
+                }
+                k = findNextTask();
+                isStarted[k] = true;
+                numStarted++;
+                numRunning++;
+                isExclusiveRunning = m_tasks[k].exclusive;
+                memoryInUse += m_tasks[k].memoryEstimate;
+                m_peakMemoryEstimate = std::max(m_peakMemoryEstimate,
+                                                memoryInUse);
+            }
+
+            // no further task is started after a failed one
+            std::exception_ptr taskError;
+            try {
+                m_tasks[k].run();
+            }
+            catch (...) {
+                taskError = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (taskError && !error) {
+                    error = taskError;
+                }
+                numRunning--;
+                isExclusiveRunning = false;
+                memoryInUse -= m_tasks[k].memoryEstimate;
+            }
+            cv.notify_all();
+        }
+    };
+
+    int numWorkers = std::min(m_numWorkers, numTasks);
+    std::vector<std::thread> workers;
+    for (int i=0; i<numWorkers; i++) {
+        workers.emplace_back(worker);
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// End of file
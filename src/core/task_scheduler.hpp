@@ -0,0 +1,64 @@
+#ifndef CORE_TASK_SCHEDULER_HPP
+#define CORE_TASK_SCHEDULER_HPP
+
+#include <functional>
+#include <vector>
+
+
+/**
+ * @brief Runs independent tasks on a pool of worker threads.
+ *
+ * Every task carries a memory estimate; a task is started only
+ * if the estimates of the running tasks and its own fit in the
+ * memory budget. Larger tasks are started first; a smaller task
+ * may overtake a larger one that does not fit yet. A task is always
+ * started if nothing else is running, so that no task can starve.
+ * An exclusive task runs alone; once it is next in line,
+ * no other task is started until it has run.
+ */
+class MemoryAwareScheduler
+{
+public:
+    /**
+     * @brief Constructor
+     * @param numWorkers number of worker threads
+     * @param memoryBudget memory budget in bytes;
+     * unlimited if not positive
+     */
+    MemoryAwareScheduler (int numWorkers, double memoryBudget=0);
+
+    //! Adds a task with its memory estimate in bytes
+    void addTask (std::function<void()> task, double memoryEstimate,
+                  bool exclusive=false);
+
+    //! Runs all tasks and returns when they are finished;
+    //! if a task throws, no further task is started, and the first
+    //! exception is rethrown once the running tasks have finished
+    void run ();
+
+    //! Returns the number of tasks
+    int getNumTasks() const {
+        return static_cast<int>(m_tasks.size());
+    }
+
+    //! Returns the peak of the estimated memory of concurrent tasks
+    double getPeakMemoryEstimate() const {
+        return m_peakMemoryEstimate;
+    }
+
+private:
+    struct Task
+    {
+        std::function<void()> run;
+        double memoryEstimate;
+        bool exclusive;
+    };
+
+    int m_numWorkers;
+    double m_memoryBudget;
+    double m_peakMemoryEstimate = 0;
+
+    std::vector<Task> m_tasks;
+};
+
+#endif // CORE_TASK_SCHEDULER_HPP
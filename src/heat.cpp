@@ -1,5 +1,8 @@
 #include "includes.hpp"
 #include "core/config.hpp"
+#include "core/output_service.hpp"
+#include "core/perf_counters.hpp"
+#include "core/sweep_scheduler.hpp"
 #include "heat/solver.hpp"
 #include "heat/observer.hpp"
 
@@ -16,7 +19,8 @@ void writeErrorConvergenceDataToJsonFile
 (const nlohmann::json& config,
  Array<int> &numDofs,
  Array<double> &meshSizes,
- Array<Vector> &solutionError)
+ Array<Vector> &solutionError,
+ OutputService& outputService)
 {
     std::string problemType;
     std::string baseOutDir, subOutDir;
@@ -75,10 +79,11 @@ void writeErrorConvergenceDataToJsonFile
         }
     }
 
-    auto file = std::ofstream(outfile);
-    assert(file.good());
-    file << json.dump(2);
-    file.close();
+    // serialised and written in the background
+    outputService.writeFile(outfile,
+                            [json = std::move(json)](std::ostream& file) {
+        file << json.dump(2);
+    });
 }
 
 void writePerformanceMetricsDataToJsonFile
@@ -86,7 +91,10 @@ void writePerformanceMetricsDataToJsonFile
  Array<int> &numDofs,
  Array<double> &meshSizes,
  Array<Vector> &elapsedTime,
- Array<int> &memoryUsage)
+ Array<int> &memoryUsage,
+ const std::vector<std::vector<PhaseMetrics>> &phaseMetrics,
+ const std::vector<PardisoStats> &pardisoStats,
+ OutputService& outputService)
 {
     assert(numDofs.Size() == meshSizes.Size());
     assert(elapsedTime[0].Size() == 4);
@@ -139,10 +147,47 @@ void writePerformanceMetricsDataToJsonFile
         json["memory_usage"][i] = memoryUsage[i];
     }
 
-    auto file = std::ofstream(outfile);
-    assert(file.good());
-    file << json.dump(2);
-    file.close();
+    // factor memory in KB and, in mixed precision,
+    // the double-precision refinement of the factors
+    for (size_t i=0; i<pardisoStats.size(); i++) {
+        json["factor_memory"][i] = pardisoStats[i].factorMemory;
+        if (pardisoStats[i].isMixedPrecision) {
+            json["refinement_steps"][i] = pardisoStats[i].numRefinementSteps;
+            json["precision_fallback"][i] = pardisoStats[i].hasFallenBack;
+        }
+    }
+
+    // per phase; the memory bandwidth is estimated
+    // from the last-level cache misses, of 64 bytes each
+    for (int i=0; i<numDofs.Size(); i++) {
+        for (const auto& phase : phaseMetrics[i])
+        {
+            auto& phaseJson = json["phases"][phase.name];
+            phaseJson["elapsed_time"][i] = phase.elapsedTime;
+            if (!phase.hasCounters) {
+                continue;
+            }
+
+            const auto& counters = phase.counters;
+            for (int k=0; k<PerfCounters::numEvents; k++) {
+                phaseJson[PerfCounters::getEventName(k)][i] = counters[k];
+            }
+            double numCycles = counters[PerfCounters::cycles];
+            phaseJson["instructions_per_cycle"][i]
+                    = numCycles > 0 ?
+                        counters[PerfCounters::instructions]/numCycles : 0;
+            phaseJson["memory_bandwidth_estimate"][i]
+                    = phase.elapsedTime > 0 ?
+                        64*counters[PerfCounters::cacheMisses]
+                        /phase.elapsedTime : 0;
+        }
+    }
+
+    // serialised and written in the background
+    outputService.writeFile(outfile,
+                            [json = std::move(json)](std::ostream& file) {
+        file << json.dump(2);
+    });
 }
 
 }
@@ -182,9 +227,11 @@ runSolverAndMeasurePerformanceMetrics(heat::Solver& solver)
                 elapsedTime, memoryUsage};
 }
 
-void runOneSimulation (const nlohmann::json config,
-                       std::string baseMeshDir,
-                       bool loadInitMesh=false)
+void runOneSimulation
+(const nlohmann::json config,
+ std::string baseMeshDir,
+ const std::shared_ptr<OutputService>& outputService,
+ bool loadInitMesh=false)
 {
     int temporalLevel, spatialLevel;
     std::string subMeshDir;
@@ -205,6 +252,8 @@ void runOneSimulation (const nlohmann::json config,
 
     heat::Observer observer(config, spatialLevel);
 
+    observer.setOutputService(outputService);
+
     int numDofs;
     double htMax, hxMax;
     Vector solutionError;
@@ -219,9 +268,11 @@ void runOneSimulation (const nlohmann::json config,
     std::cout << "#Dofs: " << numDofs << std::endl;
 }
 
-void runMultipleSimulationsToTestConvergence (const nlohmann::json config,
-                                              std::string baseMeshDir,
-                                              bool loadInitMesh=false)
+void runMultipleSimulationsToTestConvergence
+(const nlohmann::json config,
+ std::string baseMeshDir,
+ const std::shared_ptr<OutputService>& outputService,
+ bool loadInitMesh=false)
 {
     int minTemporalLevel, minSpatialLevel, maxSpatialLevel;
     std::string subMeshDir;
@@ -238,36 +289,49 @@ void runMultipleSimulationsToTestConvergence (const nlohmann::json config,
     Array<double> hMax(numLevels);
     Array<int> numDofs(numLevels);
     Array<Vector> solutionError(numLevels);
+    Array<double> htMax(numLevels), hxMax(numLevels);
 
-    double htMax, hxMax;
-    Vector errSolBuf;
+    // the levels are independent jobs; the results are stored per level
+    auto scheduler = makeSweepScheduler(config);
     for (int k=0; k<numLevels; k++)
     {
-        int temporalLevel = minTemporalLevel+k;
-        int spatialLevel = minSpatialLevel+k;
+        scheduler.addJob(k, [&, k]() {
+            int temporalLevel = minTemporalLevel+k;
+            int spatialLevel = minSpatialLevel+k;
+
+            heat::Solver solver (config,
+                                 testCase,
+                                 meshDir,
+                                 spatialLevel,
+                                 temporalLevel,
+                                 loadInitMesh);
 
-        heat::Solver solver (config,
-                             testCase,
-                             meshDir,
-                             spatialLevel,
-                             temporalLevel,
-                             loadInitMesh);
+            heat::Observer observer (config, spatialLevel);
 
-        heat::Observer observer (config, spatialLevel);
+            observer.setOutputService(outputService);
 
-        std::tie (numDofs[k], htMax, hxMax, solutionError[k])
-                = runSolver(solver, observer);
+            std::tie (numDofs[k], htMax[k], hxMax[k], solutionError[k])
+                    = runSolver(solver, observer);
 
+            SweepScheduler::JobStats stats;
+            stats.numDofs = numDofs[k];
+            return stats;
+        });
+    }
+    scheduler.run();
+
+    for (int k=0; k<numLevels; k++)
+    {
         std::cout << "\nLevels: "
-                  << temporalLevel << ", "
-                  << spatialLevel << std::endl;
-        std::cout << "tMesh size: " << htMax << std::endl;
-        std::cout << "xMesh size: " << hxMax << std::endl;
+                  << minTemporalLevel+k << ", "
+                  << minSpatialLevel+k << std::endl;
+        std::cout << "tMesh size: " << htMax[k] << std::endl;
+        std::cout << "xMesh size: " << hxMax[k] << std::endl;
         std::cout << "#Dofs: " << numDofs[k] << std::endl;
         std::cout << "Error: ";
         solutionError[k].Print();
 
-        hMax[k] = (hxMax >= htMax ? hxMax : htMax);
+        hMax[k] = (hxMax[k] >= htMax[k] ? hxMax[k] : htMax[k]);
     }
     std::cout << "\n\nError:\n";
     for (int i=0; i<numLevels; i++) {
@@ -277,12 +341,14 @@ void runMultipleSimulationsToTestConvergence (const nlohmann::json config,
     numDofs.Print();
 
     heat::writeErrorConvergenceDataToJsonFile(config, numDofs,
-                                              hMax, solutionError);
+                                              hMax, solutionError,
+                                              *outputService);
 }
 
 void runMultipleSimulationsToMeasurePerformanceMetrics
 (const nlohmann::json config,
  std::string baseMeshDir,
+ const std::shared_ptr<OutputService>& outputService,
  bool loadInitMesh=false)
 {
     int minTemporalLevel, minSpatialLevel, maxSpatialLevel;
@@ -299,52 +365,88 @@ void runMultipleSimulationsToMeasurePerformanceMetrics
 
     auto testCase = heat::makeTestCase(config);
 
+    // timing-sensitive repetitions run alone, with all threads
+    bool exclusiveRepetitions;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (config, "sweep_exclusive_measure", exclusiveRepetitions, true);
+
     int numLevels = maxSpatialLevel-minSpatialLevel+1;
     Array<double> hMax(numLevels);
     Array<int> numDofs(numLevels);
     Array<Vector> elapsedTime(numLevels);
     Array<int> memoryUsage(numLevels);
-
-    double htMax=1, hxMax=1;
-    for (int k=0; k<numLevels; k++)
-    {
-        int temporalLevel = minTemporalLevel+k;
-        int spatialLevel = minSpatialLevel+k;
-
-        Vector localElapsedTime;
+    std::vector<std::vector<PhaseMetrics>> phaseMetrics(numLevels);
+    std::vector<PardisoStats> pardisoStats(numLevels);
+    Array<double> htMax(numLevels), hxMax(numLevels);
+
+    // the levels and repetitions are independent jobs;
+    // the results are stored per level and repetition
+    std::vector<std::vector<Vector>> localElapsedTime
+            (numLevels, std::vector<Vector>(numReps));
+    std::vector<std::vector<std::vector<PhaseMetrics>>> localPhaseMetrics
+            (numLevels, std::vector<std::vector<PhaseMetrics>>(numReps));
+
+    auto scheduler = makeSweepScheduler(config);
+    for (int k=0; k<numLevels; k++) {
         for (int i=0; i<numReps; i++)
         {
-            heat::Solver solver (config,
-                                 testCase,
-                                 meshDir,
-                                 spatialLevel,
-                                 temporalLevel,
-                                 loadInitMesh);
+            scheduler.addJob(k, [&, k, i]() {
+                heat::Solver solver (config,
+                                     testCase,
+                                     meshDir,
+                                     minSpatialLevel+k,
+                                     minTemporalLevel+k,
+                                     loadInitMesh);
+
+                int localNumDofs, localMemoryUsage;
+                double localHtMax, localHxMax;
+                std::tie (localNumDofs, localHtMax, localHxMax,
+                          localElapsedTime[k][i], localMemoryUsage)
+                        = runSolverAndMeasurePerformanceMetrics(solver);
+                localPhaseMetrics[k][i] = solver.getPhaseMetrics();
+
+                // the repetitions of a level give the same values
+                if (i == 0) {
+                    numDofs[k] = localNumDofs;
+                    htMax[k] = localHtMax;
+                    hxMax[k] = localHxMax;
+                    memoryUsage[k] = localMemoryUsage;
+                    pardisoStats[k] = solver.getPardisoStats();
+                }
+
+                // the memory usage is reported in KB
+                SweepScheduler::JobStats stats;
+                stats.numDofs = localNumDofs;
+                stats.memoryUsage = 1024.*localMemoryUsage;
+                return stats;
+            }, exclusiveRepetitions);
+        }
+    }
+    scheduler.run();
 
-            std::tie (numDofs[k], htMax, hxMax,
-                      localElapsedTime, memoryUsage[k])
-                    = runSolverAndMeasurePerformanceMetrics(solver);
-            if (i == 0) {
-                elapsedTime[k].SetSize(localElapsedTime.Size());
-                elapsedTime[k] = 0.;
-            }
-            else {
-                elapsedTime[k] += localElapsedTime;
-            }
+    // the first repetition is a warm-up
+    for (int k=0; k<numLevels; k++)
+    {
+        elapsedTime[k].SetSize(localElapsedTime[k][0].Size());
+        elapsedTime[k] = 0.;
+        for (int i=1; i<numReps; i++) {
+            elapsedTime[k] += localElapsedTime[k][i];
+            addPhaseMetrics(phaseMetrics[k], localPhaseMetrics[k][i]);
         }
         elapsedTime[k] /= (numReps-1);
+        scalePhaseMetrics(phaseMetrics[k], 1./(numReps-1));
 
         std::cout << "\nLevels: "
-                  << temporalLevel << ", "
-                  << spatialLevel << std::endl;
-        std::cout << "tMesh size: " << htMax << std::endl;
-        std::cout << "xMesh size: " << hxMax << std::endl;
+                  << minTemporalLevel+k << ", "
+                  << minSpatialLevel+k << std::endl;
+        std::cout << "tMesh size: " << htMax[k] << std::endl;
+        std::cout << "xMesh size: " << hxMax[k] << std::endl;
         std::cout << "#Dofs: " << numDofs[k] << std::endl;
         std::cout << "Elapsed time: ";
         elapsedTime[k].Print();
         std::cout << "Memory usage: " << memoryUsage[k] << std::endl;
 
-        hMax[k] = (hxMax >= htMax ? hxMax : htMax);
+        hMax[k] = (hxMax[k] >= htMax[k] ? hxMax[k] : htMax[k]);
     }
     std::cout << "Elapsed time:\n";
     for (int i=0; i<numLevels; i++) {
@@ -356,7 +458,8 @@ void runMultipleSimulationsToMeasurePerformanceMetrics
     numDofs.Print();
 
     heat::writePerformanceMetricsDataToJsonFile
-            (config, numDofs, hMax, elapsedTime, memoryUsage);
+            (config, numDofs, hMax, elapsedTime, memoryUsage,
+             phaseMetrics, pardisoStats, *outputService);
 }
 
 
@@ -372,6 +475,14 @@ int main(int argc, char *argv[])
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
             (config, "load_init_mesh", loadInitMesh, false);
 
+    // output files are written by a background thread,
+    // with at most output_queue_size pending writes;
+    // a queue size of zero writes synchronously
+    int outputQueueSize;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (config, "output_queue_size", outputQueueSize, 4);
+    auto outputService = std::make_shared<OutputService>(outputQueueSize);
+
     std::string baseMeshDir;
     if (loadInitMesh) {
         baseMeshDir.assign("../meshes/");
@@ -388,18 +499,24 @@ int main(int argc, char *argv[])
     if (run == "simulation") {
         runOneSimulation(std::move(config),
                          std::move(baseMeshDir),
+                         outputService,
                          loadInitMesh);
     }
     else if (run == "convergence") {
         runMultipleSimulationsToTestConvergence(std::move(config),
                                                 std::move(baseMeshDir),
+                                                outputService,
                                                 loadInitMesh);
     }
     else if (run == "measure") {
         runMultipleSimulationsToMeasurePerformanceMetrics
-                (std::move(config), std::move(baseMeshDir), loadInitMesh);
+                (std::move(config), std::move(baseMeshDir),
+                 outputService, loadInitMesh);
     }
 
+    // waits for the pending output
+    outputService->flush();
+
     return 0;
 }
 
@@ -395,4 +395,43 @@ void heat::SpatialVectorDivergenceLFIntegrator
     elvect *= m_coeff;
 }
 
+// Gradient LF Integrator
+void heat::SpatialGradientLFIntegrator
+:: AssembleRHSElementVect (const FiniteElement &fe,
+                           ElementTransformation &Trans,
+                           Vector &elvect)
+{
+    int dim  = fe.GetDim();
+    int ndofs = fe.GetDof();
+#ifdef MFEM_THREAD_SAFE
+    Vector fval(dim);
+    DenseMatrix dshape(ndofs, dim);
+#else
+    fval.SetSize(dim);
+    dshape.SetSize (ndofs, dim);
+#endif
+    elvect.SetSize(ndofs);
+
+    const IntegrationRule *ir = IntRule;
+    if (ir == nullptr)
+    {
+        int order = 2*fe.GetOrder()+2;
+        ir = &IntRules.Get(fe.GetGeomType(), order);
+    }
+
+    elvect = 0.0;
+    for (int i = 0; i < ir->GetNPoints(); i++)
+    {
+        const IntegrationPoint &ip = ir->IntPoint(i);
+        Trans.SetIntPoint(&ip);
+
+        fe.CalcPhysDShape (Trans, dshape);
+        F.Eval(fval, Trans, ip);
+
+        double w = ip.weight*Trans.Weight();
+        dshape.AddMult_a(w, fval, elvect);
+    }
+    elvect *= m_coeff;
+}
+
 // End of file
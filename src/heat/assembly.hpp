@@ -280,6 +280,31 @@ private:
 #endif
 };
 
+/**
+ * @brief Gradient LF Integrator in space; (f, grad(v))
+ */
+class SpatialGradientLFIntegrator
+        : public mfem::LinearFormIntegrator
+{
+public:
+    //! Constructor with a vector coefficient and a scalar passed as arguments
+    SpatialGradientLFIntegrator(mfem::VectorCoefficient& f, double a)
+        : F(f), m_coeff(a) {}
+
+    //! Assembles the gradient linear form integrator on a given spatial mesh element
+    void AssembleRHSElementVect (const mfem::FiniteElement &,
+                                 mfem::ElementTransformation &,
+                                 mfem::Vector &) override;
+
+private:
+    mfem::VectorCoefficient &F;
+    double m_coeff;
+#ifndef MFEM_THREAD_SAFE
+    mfem::Vector fval;
+    mfem::DenseMatrix dshape;
+#endif
+};
+
 }
 
 #endif // HEAT_ASSEMBLY_HPP
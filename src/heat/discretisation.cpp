@@ -2,6 +2,8 @@
 #include "coefficients.hpp"
 #include "assembly.hpp"
 #include "../mymfem/utilities.hpp"
+#include "../mymfem/threaded_assembly.hpp"
+#include "../core/sweep_scheduler.hpp"
 
 #include <fstream>
 
@@ -120,18 +122,10 @@ void heat::LsqXtFem
 void heat::LsqXtFem
 :: resetMediumIndependentSystemSubMatrices()
 {
-    if (m_temporalInitial) {
-        clear(m_temporalInitial);
-    }
-    if (m_temporalMass) {
-        clear(m_temporalMass);
-    }
-    if (m_temporalStiffness) {
-        clear(m_temporalStiffness);
-    }
-    if (m_temporalGradient) {
-        clear(m_temporalGradient);
-    }
+    m_temporalInitial.reset();
+    m_temporalMass.reset();
+    m_temporalStiffness.reset();
+    m_temporalGradient.reset();
 
     if (m_spatialMass1) {
         clear(m_spatialMass1);
@@ -218,8 +212,8 @@ void heat::LsqXtFem
     m_blockOffsets[2] = xFeSpaceSizeForHeatFlux*tFeSpaceSize;
     m_blockOffsets.PartialSum();
 #ifndef NDEBUG
-    std::cout << "\tBlock offsets:" << "\t";
-    m_blockOffsets.Print();
+    getJobOutput() << "\tBlock offsets:" << "\t";
+    m_blockOffsets.Print(getJobOutput());
 #endif
 }
 
@@ -292,60 +286,42 @@ void heat::LsqXtFem
     assembleSpatialGradient();
 }
 
+// The temporal matrices are assembled in banded form
+// from the reference element matrices
 void heat::LsqXtFem
 :: assembleTemporalInitial()
 {
-    Vector tCanonicalBasis(m_temporalFeSpace->GetVSize());
-    tCanonicalBasis = 0.0;
-    tCanonicalBasis(0) = 1;
-    m_temporalInitial = new SparseMatrix(tCanonicalBasis);
+    m_temporalInitial
+            = heat::assembleBandedTemporalInitial(*m_temporalFeSpace);
 }
 
 void heat::LsqXtFem
 :: assembleTemporalMass()
 {
-    BilinearForm *temporalMassForm = new BilinearForm(m_temporalFeSpace);
-    temporalMassForm->AddDomainIntegrator(new MassIntegrator);
-    temporalMassForm->Assemble();
-    temporalMassForm->Finalize();
-    m_temporalMass = temporalMassForm->LoseMat();
-    delete temporalMassForm;
+    m_temporalMass
+            = heat::assembleBandedTemporalMass(*m_temporalFeSpace);
 }
 
 void heat::LsqXtFem
 :: assembleTemporalStiffness()
 {
-    BilinearForm *temporalStiffnessForm = new BilinearForm(m_temporalFeSpace);
-    temporalStiffnessForm->AddDomainIntegrator(new DiffusionIntegrator);
-    temporalStiffnessForm->Assemble();
-    temporalStiffnessForm->Finalize();
-    m_temporalStiffness = temporalStiffnessForm->LoseMat();
-    delete temporalStiffnessForm;
+    m_temporalStiffness
+            = heat::assembleBandedTemporalStiffness(*m_temporalFeSpace);
 }
 
 void heat::LsqXtFem
 :: assembleTemporalGradient()
 {
-    BilinearForm *temporalGradientForm
-            = new BilinearForm(m_temporalFeSpace);
-    temporalGradientForm->AddDomainIntegrator
-            (new heat::TemporalGradientIntegrator);
-    temporalGradientForm->Assemble();
-    temporalGradientForm->Finalize();
-    m_temporalGradient = temporalGradientForm->LoseMat();
-    delete temporalGradientForm;
+    m_temporalGradient
+            = heat::assembleBandedTemporalGradient(*m_temporalFeSpace);
 }
 
 void heat::LsqXtFem
 :: assembleSpatialMassForTemperature()
 {
-    BilinearForm *spatialMassForm
-            = new BilinearForm(m_spatialFeSpaces[0]);
-    spatialMassForm->AddDomainIntegrator(new MassIntegrator);
-    spatialMassForm->Assemble();
-    spatialMassForm->Finalize();
-    m_spatialMass1 = spatialMassForm->LoseMat();
-    delete spatialMassForm;
+    mymfem::ThreadedAssembler spatialMassAssembler(m_spatialFeSpaces[0]);
+    m_spatialMass1 = spatialMassAssembler.assemble
+            ([]() { return new MassIntegrator; });
 }
 
 void heat::LsqXtFem
@@ -353,14 +329,12 @@ void heat::LsqXtFem
 {
     heat::MediumTensorCoeff mediumCoeff(m_testCase);
 
-    BilinearForm *spatialStiffnessForm
-            = new BilinearForm(m_spatialFeSpaces[0]);
-    spatialStiffnessForm->AddDomainIntegrator
-            (new heat::SpatialStiffnessIntegrator(&mediumCoeff));
-    spatialStiffnessForm->Assemble();
-    spatialStiffnessForm->Finalize();
-    m_spatialStiffness1 = spatialStiffnessForm->LoseMat();
-    delete spatialStiffnessForm;
+    mymfem::ThreadedAssembler spatialStiffnessAssembler
+            (m_spatialFeSpaces[0]);
+    m_spatialStiffness1 = spatialStiffnessAssembler.assemble
+            ([&mediumCoeff]() {
+        return new heat::SpatialStiffnessIntegrator(&mediumCoeff);
+    });
 }
 
 // Builds the linear system matrix from the blocks as an MFEM operator
@@ -515,7 +489,7 @@ void heat::LsqXtFem
 :: buildSystemBlock22()
 {
     auto tmp = Add(*m_spatialMass2, *m_spatialStiffness2);
-    m_systemBlock22 = OuterProduct(*m_temporalMass, *tmp);
+    m_systemBlock22 = m_temporalMass->kroneckerProduct(*tmp);
     delete tmp;
 }
 
@@ -538,16 +512,16 @@ void heat::LsqXtFem
 void heat::LsqXtFem
 :: buildMediumIndependentSystemBlock11()
 {
-    auto tmp = Add(*m_temporalInitial, *m_temporalStiffness);
+    heat::BandedTemporalOperator tmp(*m_temporalInitial);
+    tmp.add(*m_temporalStiffness);
     m_materialIndependentSystemBlock11
-            = OuterProduct(*tmp, *m_spatialMass1);
-    delete tmp;
+            = tmp.kroneckerProduct(*m_spatialMass1);
 }
 
 void heat::LsqXtFem
 :: buildMediumDependentSystemBlock11()
 {
-    auto tmp = OuterProduct(*m_temporalMass, *m_spatialStiffness1);
+    auto tmp = m_temporalMass->kroneckerProduct(*m_spatialStiffness1);
     m_systemBlock11 = Add(*m_materialIndependentSystemBlock11, *tmp);
     delete tmp;
 }
@@ -573,17 +547,16 @@ void heat::LsqXtFem
 void heat::LsqXtFem
 :: buildMediumIndependentSystemBlock12()
 {
-    auto tmp = Transpose(*m_temporalGradient);
+    auto tmp = m_temporalGradient->transpose();
     m_materialIndependentSystemBlock12
-            = OuterProduct(*tmp, *m_spatialDivergence);
-    delete tmp;
+            = tmp->kroneckerProduct(*m_spatialDivergence);
 }
 
 void heat::LsqXtFem
 :: buildMediumDependentSystemBlock12()
 {
     auto tmp2 = Transpose(*m_spatialGradient);
-    auto tmp1 = OuterProduct(*m_temporalMass, *tmp2);
+    auto tmp1 = m_temporalMass->kroneckerProduct(*tmp2);
     m_systemBlock12 = Add(-1, *tmp1,
                           -1, *m_materialIndependentSystemBlock12);
     delete tmp1;
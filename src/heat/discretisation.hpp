@@ -7,6 +7,7 @@
 
 #include "../core/config.hpp"
 #include "test_cases.hpp"
+#include "temporal_operators.hpp"
 
 
 namespace heat {
@@ -218,10 +219,10 @@ protected:
     mfem::Array<mfem::FiniteElementSpace*> m_spatialFeSpaces;
     mfem::Array<int> m_blockOffsets;
     
-    mfem::SparseMatrix *m_temporalMass = nullptr;
-    mfem::SparseMatrix *m_temporalStiffness = nullptr;
-    mfem::SparseMatrix *m_temporalGradient = nullptr;
-    mfem::SparseMatrix *m_temporalInitial = nullptr;
+    std::unique_ptr<heat::BandedTemporalOperator> m_temporalMass;
+    std::unique_ptr<heat::BandedTemporalOperator> m_temporalStiffness;
+    std::unique_ptr<heat::BandedTemporalOperator> m_temporalGradient;
+    std::unique_ptr<heat::BandedTemporalOperator> m_temporalInitial;
 
     mfem::SparseMatrix *m_spatialMass1 = nullptr;
     mfem::SparseMatrix *m_spatialMass2 = nullptr;
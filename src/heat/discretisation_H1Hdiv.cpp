@@ -2,6 +2,7 @@
 #include "coefficients.hpp"
 #include "assembly.hpp"
 #include "../mymfem/utilities.hpp"
+#include "../mymfem/threaded_assembly.hpp"
 
 using namespace mfem;
 
@@ -22,27 +23,17 @@ void heat::LsqXtFemH1Hdiv
 void heat::LsqXtFemH1Hdiv
 :: assembleSpatialMassForHeatFlux()
 {
-    BilinearForm *spatialMassForm
-            = new BilinearForm(m_spatialFeSpaces[1]);
-    spatialMassForm->AddDomainIntegrator
-            (new VectorFEMassIntegrator);
-    spatialMassForm->Assemble();
-    spatialMassForm->Finalize();
-    m_spatialMass2 = spatialMassForm->LoseMat();
-    delete spatialMassForm;
+    mymfem::ThreadedAssembler spatialMassAssembler(m_spatialFeSpaces[1]);
+    m_spatialMass2 = spatialMassAssembler.assemble
+            ([]() { return new VectorFEMassIntegrator; });
 }
 
 void heat::LsqXtFemH1Hdiv
 :: assembleSpatialStiffnessForHeatFlux()
 {
-    BilinearForm *spatialStiffnessForm
-            = new BilinearForm(m_spatialFeSpaces[1]);
-    spatialStiffnessForm->AddDomainIntegrator
-            (new heat::SpatialVectorFEStiffnessIntegrator);
-    spatialStiffnessForm->Assemble();
-    spatialStiffnessForm->Finalize();
-    m_spatialStiffness2 = spatialStiffnessForm->LoseMat();
-    delete spatialStiffnessForm;
+    mymfem::ThreadedAssembler spatialStiffnessAssembler(m_spatialFeSpaces[1]);
+    m_spatialStiffness2 = spatialStiffnessAssembler.assemble
+            ([]() { return new heat::SpatialVectorFEStiffnessIntegrator; });
 }
 
 void heat::LsqXtFemH1Hdiv
@@ -50,29 +41,21 @@ void heat::LsqXtFemH1Hdiv
 {
     heat::MediumTensorCoeff mediumCoeff(m_testCase);
 
-    MixedBilinearForm *spatialGradientForm
-            = new MixedBilinearForm(m_spatialFeSpaces[0],
-                                    m_spatialFeSpaces[1]);
-    spatialGradientForm->AddDomainIntegrator
-            (new heat::SpatialVectorFEGradientIntegrator(&mediumCoeff));
-    spatialGradientForm->Assemble();
-    spatialGradientForm->Finalize();
-    m_spatialGradient = spatialGradientForm->LoseMat();
-    delete spatialGradientForm;
+    mymfem::ThreadedAssembler spatialGradientAssembler
+            (m_spatialFeSpaces[0], m_spatialFeSpaces[1]);
+    m_spatialGradient = spatialGradientAssembler.assemble
+            ([&mediumCoeff]() {
+        return new heat::SpatialVectorFEGradientIntegrator(&mediumCoeff);
+    });
 }
 
 void heat::LsqXtFemH1Hdiv
 :: assembleSpatialDivergence()
 {
-    MixedBilinearForm *spatialDivergenceForm
-            = new MixedBilinearForm(m_spatialFeSpaces[1],
-                                    m_spatialFeSpaces[0]);
-    spatialDivergenceForm->AddDomainIntegrator
-            (new VectorFEDivergenceIntegrator);
-    spatialDivergenceForm->Assemble();
-    spatialDivergenceForm->Finalize();
-    m_spatialDivergence = spatialDivergenceForm->LoseMat();
-    delete spatialDivergenceForm;
+    mymfem::ThreadedAssembler spatialDivergenceAssembler
+            (m_spatialFeSpaces[1], m_spatialFeSpaces[0]);
+    m_spatialDivergence = spatialDivergenceAssembler.assemble
+            ([]() { return new VectorFEDivergenceIntegrator; });
 }
 
 void heat::LsqXtFemH1Hdiv
@@ -0,0 +1,392 @@
+#include "kronecker_ordering.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <assert.h>
+
+using namespace mfem;
+
+
+namespace {
+
+//! Returns the offsets of the spatial dofs of the blocks
+Array<int> getSpatialOffsets (const Array<int>& blockOffsets,
+                              int numTemporalDofs)
+{
+    int numBlocks = blockOffsets.Size()-1;
+    Array<int> spatialOffsets(numBlocks+1);
+    spatialOffsets[0] = 0;
+    for (int b=0; b<numBlocks; b++)
+    {
+        int blockSize = blockOffsets[b+1] - blockOffsets[b];
+        assert(blockSize % numTemporalDofs == 0);
+        spatialOffsets[b+1] = spatialOffsets[b]
+                + blockSize/numTemporalDofs;
+    }
+    return spatialOffsets;
+}
+
+
+// recursive bisection of the level structures of a graph
+struct GraphDissector
+{
+    std::vector<std::vector<int>> adjacency;
+    int maxLeafSize;
+    heat::DissectionTree& tree;
+
+    // subgraph[v] is the stamp of the subgraph being split,
+    // visit[v] the one of the last search that reached v
+    std::vector<int> subgraph, visit, level;
+    int numSubgraphs = 0;
+    int numSearches = 0;
+
+    GraphDissector (const SparseMatrix& graph, int maxLeafSize_,
+                    heat::DissectionTree& tree_)
+        : adjacency (graph.Height()), maxLeafSize (maxLeafSize_),
+          tree (tree_), subgraph (graph.Height(), 0),
+          visit (graph.Height(), 0), level (graph.Height(), 0)
+    {
+        const int *I = graph.GetI();
+        const int *J = graph.GetJ();
+        for (int u=0; u<graph.Height(); u++) {
+            for (int k=I[u]; k<I[u+1]; k++) {
+                if (J[k] == u) { continue; }
+                adjacency[u].push_back(J[k]);
+                adjacency[J[k]].push_back(u);
+            }
+        }
+    }
+
+    // breadth-first search within the subgraph;
+    // returns the reached vertices by increasing level
+    std::vector<int> search (int root, int subStamp)
+    {
+        int visitStamp = ++numSearches;
+        std::vector<int> reached{root};
+        visit[root] = visitStamp;
+        level[root] = 0;
+        for (std::size_t k=0; k<reached.size(); k++)
+        {
+            int u = reached[k];
+            for (int v : adjacency[u])
+            {
+                if (subgraph[v] != subStamp || visit[v] == visitStamp) {
+                    continue;
+                }
+                visit[v] = visitStamp;
+                level[v] = level[u]+1;
+                reached.push_back(v);
+            }
+        }
+        return reached;
+    }
+
+    // adds the node of the subgraph, returns its index
+    int dissect (std::vector<int> vertices)
+    {
+        int node = static_cast<int>(tree.nodes.size());
+        tree.nodes.emplace_back();
+        int n = static_cast<int>(vertices.size());
+        if (n <= maxLeafSize) {
+            tree.nodes[node].dofs = std::move(vertices);
+            return node;
+        }
+
+        int subStamp = ++numSubgraphs;
+        for (int v : vertices) {
+            subgraph[v] = subStamp;
+        }
+
+        std::vector<int> left, right, separator;
+        std::vector<int> reached = search(vertices[0], subStamp);
+        if (static_cast<int>(reached.size()) < n)
+        {
+            // the components are distributed to the smaller half
+            for (int v : vertices)
+            {
+                if (subgraph[v] != subStamp) { continue; }
+                std::vector<int> component = search(v, subStamp);
+                auto& half = (left.size() <= right.size()) ? left : right;
+                half.insert(half.end(), component.begin(), component.end());
+                for (int u : component) {
+                    subgraph[u] = 0;
+                }
+            }
+        }
+        else
+        {
+            // restarts from the farthest vertex while the height grows
+            int height = level[reached.back()];
+            for (int k=0; k<4; k++)
+            {
+                reached = search(reached.back(), subStamp);
+                int newHeight = level[reached.back()];
+                if (newHeight <= height) { break; }
+                height = newHeight;
+            }
+            height = level[reached.back()];
+            if (height < 2) {
+                tree.nodes[node].dofs = std::move(vertices);
+                return node;
+            }
+
+            // the middle level best balances the two sides
+            std::vector<int> levelOffsets(height+2, 0);
+            for (int v : reached) {
+                levelOffsets[level[v]+1]++;
+            }
+            for (int l=0; l<=height; l++) {
+                levelOffsets[l+1] += levelOffsets[l];
+            }
+            int mid = 1;
+            for (int l=2; l<height; l++) {
+                if (std::abs(levelOffsets[l] - (n - levelOffsets[l+1]))
+                        < std::abs(levelOffsets[mid]
+                                   - (n - levelOffsets[mid+1]))) {
+                    mid = l;
+                }
+            }
+            left.assign(reached.begin(),
+                        reached.begin() + levelOffsets[mid]);
+            separator.assign(reached.begin() + levelOffsets[mid],
+                             reached.begin() + levelOffsets[mid+1]);
+            right.assign(reached.begin() + levelOffsets[mid+1],
+                         reached.end());
+        }
+
+        int leftNode = dissect(std::move(left));
+        int rightNode = dissect(std::move(right));
+        tree.nodes[node].left = leftNode;
+        tree.nodes[node].right = rightNode;
+        tree.nodes[node].dofs = std::move(separator);
+        return node;
+    }
+};
+
+//! Returns the number of dofs in the subtree of every node
+void countSubtreeDofs (const heat::DissectionTree& tree, int node,
+                       std::vector<long>& sizes)
+{
+    const auto& current = tree.nodes[node];
+    sizes[node] = static_cast<long>(current.dofs.size());
+    if (!current.isLeaf()) {
+        countSubtreeDofs(tree, current.left, sizes);
+        countSubtreeDofs(tree, current.right, sizes);
+        sizes[node] += sizes[current.left] + sizes[current.right];
+    }
+}
+
+// orders the space-time subdomain of the subtrees of a temporal
+// and a spatial node; eliminate(i, u) numbers the dof of the
+// temporal dof i and the stacked spatial dof u
+template <class Eliminate>
+void dissectProduct (const heat::DissectionTree& tTree, int tNode,
+                     const std::vector<long>& tSizes,
+                     const heat::DissectionTree& xTree, int xNode,
+                     const std::vector<long>& xSizes,
+                     Eliminate& eliminate)
+{
+    const auto& t = tTree.nodes[tNode];
+    const auto& x = xTree.nodes[xNode];
+
+    // splits at the smaller of the two separators
+    bool splitTime = !t.isLeaf()
+            && (x.isLeaf()
+                || static_cast<long>(t.dofs.size())*xSizes[xNode]
+                <= tSizes[tNode]*static_cast<long>(x.dofs.size()));
+    bool splitSpace = !splitTime && !x.isLeaf();
+
+    std::vector<int> tDofs, xDofs;
+    if (splitTime)
+    {
+        dissectProduct(tTree, t.left, tSizes,
+                       xTree, xNode, xSizes, eliminate);
+        dissectProduct(tTree, t.right, tSizes,
+                       xTree, xNode, xSizes, eliminate);
+        tDofs = t.dofs;
+        xTree.gatherDofs(xNode, xDofs);
+    }
+    else if (splitSpace)
+    {
+        dissectProduct(tTree, tNode, tSizes,
+                       xTree, x.left, xSizes, eliminate);
+        dissectProduct(tTree, tNode, tSizes,
+                       xTree, x.right, xSizes, eliminate);
+        tTree.gatherDofs(tNode, tDofs);
+        xDofs = x.dofs;
+    }
+    else {
+        tDofs = t.dofs;
+        xDofs = x.dofs;
+    }
+
+    for (int i : tDofs) {
+        for (int u : xDofs) {
+            eliminate(i, u);
+        }
+    }
+}
+
+}
+
+SparseMatrix*
+heat::buildSpatialGraph (const SparseMatrix& mat,
+                         const Array<int>& blockOffsets,
+                         int numTemporalDofs)
+{
+    int numBlocks = blockOffsets.Size()-1;
+    Array<int> spatialOffsets
+            = getSpatialOffsets(blockOffsets, numTemporalDofs);
+    int numSpatialDofs = spatialOffsets[numBlocks];
+
+    // maps a space-time dof to its spatial dof
+    auto toSpatial = [&](int i) {
+        int b = 0;
+        while (i >= blockOffsets[b+1]) { b++; }
+        int xdim = spatialOffsets[b+1] - spatialOffsets[b];
+        return spatialOffsets[b] + (i - blockOffsets[b]) % xdim;
+    };
+
+    // neighbours of the rows of a spatial dof over all time slices;
+    // the marker skips the duplicates
+    const int *I = mat.GetI();
+    const int *J = mat.GetJ();
+    std::vector<std::vector<int>> upper(numSpatialDofs);
+    std::vector<int> marker(numSpatialDofs, -1);
+    for (int b=0; b<numBlocks; b++)
+    {
+        int xdim = spatialOffsets[b+1] - spatialOffsets[b];
+        for (int a=0; a<xdim; a++)
+        {
+            int u = spatialOffsets[b] + a;
+            for (int i=0; i<numTemporalDofs; i++)
+            {
+                int row = blockOffsets[b] + i*xdim + a;
+                for (int k=I[row]; k<I[row+1]; k++)
+                {
+                    int v = toSpatial(J[k]);
+                    if (v == u || marker[v] == u) { continue; }
+                    marker[v] = u;
+                    upper[std::min(u, v)].push_back(std::max(u, v));
+                }
+            }
+        }
+    }
+
+    // an upper triangle may give an edge from both of its dofs
+    std::vector<int> degrees(numSpatialDofs, 0);
+    int nnz = numSpatialDofs;
+    for (int u=0; u<numSpatialDofs; u++)
+    {
+        std::sort(upper[u].begin(), upper[u].end());
+        upper[u].erase(std::unique(upper[u].begin(), upper[u].end()),
+                       upper[u].end());
+        for (int v : upper[u]) {
+            degrees[u]++;
+            degrees[v]++;
+        }
+        nnz += static_cast<int>(upper[u].size());
+    }
+
+    // diagonally dominant, with the diagonal first in every row
+    int *gI = new int[numSpatialDofs+1];
+    int *gJ = new int[nnz];
+    double *gA = new double[nnz];
+    int pos = 0;
+    for (int u=0; u<numSpatialDofs; u++)
+    {
+        gI[u] = pos;
+        gJ[pos] = u;
+        gA[pos++] = degrees[u]+1;
+        for (int v : upper[u]) {
+            gJ[pos] = v;
+            gA[pos++] = -1;
+        }
+    }
+    gI[numSpatialDofs] = pos;
+
+    // the matrix owns the arrays
+    return new SparseMatrix(gI, gJ, gA, numSpatialDofs, numSpatialDofs);
+}
+
+void heat::DissectionTree
+:: gatherDofs (int node, std::vector<int>& dofs) const
+{
+    const Node& current = nodes[node];
+    if (!current.isLeaf()) {
+        gatherDofs(current.left, dofs);
+        gatherDofs(current.right, dofs);
+    }
+    dofs.insert(dofs.end(), current.dofs.begin(), current.dofs.end());
+}
+
+Array<int> heat::DissectionTree
+:: getOrdering() const
+{
+    std::vector<int> dofs;
+    if (!nodes.empty()) {
+        gatherDofs(0, dofs);
+    }
+
+    Array<int> ordering(static_cast<int>(dofs.size()));
+    for (int k=0; k<ordering.Size(); k++) {
+        ordering[k] = dofs[k];
+    }
+    return ordering;
+}
+
+heat::DissectionTree
+heat::dissectGraph (const SparseMatrix& graph, int maxLeafSize)
+{
+    DissectionTree tree;
+    GraphDissector dissector(graph, std::max(maxLeafSize, 1), tree);
+
+    std::vector<int> vertices(graph.Height());
+    for (int u=0; u<graph.Height(); u++) {
+        vertices[u] = u;
+    }
+    dissector.dissect(std::move(vertices));
+    return tree;
+}
+
+std::vector<int>
+heat::buildKroneckerOrdering (const Array<int>& blockOffsets,
+                              const DissectionTree& temporalTree,
+                              const DissectionTree& spatialTree)
+{
+    std::vector<long> tSizes(temporalTree.nodes.size());
+    std::vector<long> xSizes(spatialTree.nodes.size());
+    countSubtreeDofs(temporalTree, 0, tSizes);
+    countSubtreeDofs(spatialTree, 0, xSizes);
+
+    int numBlocks = blockOffsets.Size()-1;
+    int numTemporalDofs = static_cast<int>(tSizes[0]);
+    Array<int> spatialOffsets
+            = getSpatialOffsets(blockOffsets, numTemporalDofs);
+    int numSpatialDofs = spatialOffsets[numBlocks];
+    assert(xSizes[0] == numSpatialDofs);
+
+    // the dof (i,u) is at row offsets[u] + i*strides[u]
+    std::vector<int> offsets(numSpatialDofs), strides(numSpatialDofs);
+    for (int b=0; b<numBlocks; b++)
+    {
+        int xdim = spatialOffsets[b+1] - spatialOffsets[b];
+        for (int a=0; a<xdim; a++) {
+            offsets[spatialOffsets[b] + a] = blockOffsets[b] + a;
+            strides[spatialOffsets[b] + a] = xdim;
+        }
+    }
+
+    std::vector<int> perm(blockOffsets[numBlocks], -1);
+    int count = 0;
+    auto eliminate = [&](int i, int u) {
+        perm[offsets[u] + i*strides[u]] = count++;
+    };
+    dissectProduct(temporalTree, 0, tSizes,
+                   spatialTree, 0, xSizes, eliminate);
+    assert(count == blockOffsets[numBlocks]);
+
+    return perm;
+}
+
+// End of file
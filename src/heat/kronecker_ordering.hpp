@@ -0,0 +1,95 @@
+#ifndef HEAT_KRONECKER_ORDERING_HPP
+#define HEAT_KRONECKER_ORDERING_HPP
+
+#include "mfem.hpp"
+
+#include <vector>
+
+
+namespace heat
+{
+
+/**
+ * @brief Collapses the sparsity pattern of a space-time matrix
+ * to the graph of the spatial dofs of all blocks.
+ *
+ * The blocks are Kronecker products of temporal and spatial operators,
+ * with the dof (i,a) of a block at row i*Nx + a of the block.
+ * @param mat space-time matrix, or its upper triangle
+ * @param blockOffsets offsets of the blocks
+ * @param numTemporalDofs number of temporal dofs
+ * @return upper triangle of a symmetric positive definite matrix
+ * with the pattern of the graph, the spatial dofs of the blocks
+ * stacked; the caller owns the returned matrix
+ */
+mfem::SparseMatrix* buildSpatialGraph (const mfem::SparseMatrix& mat,
+                                       const mfem::Array<int>& blockOffsets,
+                                       int numTemporalDofs);
+
+/**
+ * @brief Nested dissection tree of a graph.
+ *
+ * Every node holds the dofs eliminated at it, after the ones of its
+ * subtrees: the separator of its two subtrees, or all dofs of a leaf.
+ */
+struct DissectionTree
+{
+    struct Node
+    {
+        std::vector<int> dofs;
+        int left = -1;
+        int right = -1;
+
+        bool isLeaf() const {
+            return left < 0;
+        }
+    };
+
+    //! nodes[0] is the root
+    std::vector<Node> nodes;
+
+    //! Appends the dofs of the subtree of a node, in the post-order
+    void gatherDofs (int node, std::vector<int>& dofs) const;
+
+    //! Returns the dofs in the order of elimination
+    mfem::Array<int> getOrdering() const;
+};
+
+/**
+ * @brief Nested dissection of a graph by recursive bisection.
+ *
+ * A subgraph is split at the middle level of the breadth-first search
+ * from a pseudo-peripheral vertex; disconnected parts are split with
+ * an empty separator.
+ * @param graph symmetric matrix, or its upper triangle, e.g. from
+ * buildSpatialGraph
+ * @param maxLeafSize subgraphs up to this size are not split
+ */
+DissectionTree dissectGraph (const mfem::SparseMatrix& graph,
+                             int maxLeafSize = 16);
+
+/**
+ * @brief Builds the fill-reducing permutation of a space-time matrix
+ * by the tensor-product nested dissection of its Kronecker factors.
+ *
+ * A space-time subdomain, the product of the subtrees of a temporal
+ * and a spatial node, is split either by the temporal separator times
+ * its spatial subdomain, or by its time interval times the spatial
+ * separator, whichever separator is smaller. The two halves are
+ * ordered recursively and the separator is eliminated last, so that
+ * only the top separators couple whole time slices.
+ * @param blockOffsets offsets of the blocks
+ * @param temporalTree nested dissection of the temporal dofs
+ * @param spatialTree nested dissection of the graph of
+ * buildSpatialGraph
+ * @return zero-based permutation; dof i is the perm[i]-th dof
+ * of the permuted matrix, as in PARDISO
+ */
+std::vector<int> buildKroneckerOrdering
+(const mfem::Array<int>& blockOffsets,
+ const DissectionTree& temporalTree,
+ const DissectionTree& spatialTree);
+
+}
+
+#endif // HEAT_KRONECKER_ORDERING_HPP
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <filesystem>
 
+#include "../core/sweep_scheduler.hpp"
 #include "../mymfem/utilities.hpp"
 #include "utilities.hpp"
 
@@ -112,16 +113,30 @@ void heat::Observer
                 +m_solNameSuffix;
         std::string solName2
                 = m_outputDir+"heatFlux"+m_solNameSuffix;
-        std::cout << solName1 << std::endl;
-        std::cout << solName2 << std::endl;
-
-        std::ofstream solOfs1(solName1.c_str());
-        solOfs1.precision(m_precision);
-        temperature->Save(solOfs1);
-
-        std::ofstream solOfs2(solName2.c_str());
-        solOfs2.precision(m_precision);
-        heatFlux->Save(solOfs2);
+        getJobOutput() << solName1 << std::endl;
+        getJobOutput() << solName2 << std::endl;
+
+        // snapshots of the data; the discretisation keeps
+        // the FE spaces alive until the files are written
+        auto temperatureSnapshot
+                = std::make_shared<const GridFunction>(*temperature);
+        auto heatFluxSnapshot
+                = std::make_shared<const GridFunction>(*heatFlux);
+        auto disc = m_disc;
+        int precision = m_precision;
+
+        m_outputService->writeFile(solName1,
+                                   [temperatureSnapshot, disc, precision]
+                                   (std::ostream& solOfs1) {
+            solOfs1.precision(precision);
+            temperatureSnapshot->Save(solOfs1);
+        });
+        m_outputService->writeFile(solName2,
+                                   [heatFluxSnapshot, disc, precision]
+                                   (std::ostream& solOfs2) {
+            solOfs2.precision(precision);
+            heatFluxSnapshot->Save(solOfs2);
+        });
     }
 }
 
@@ -147,8 +162,8 @@ Vector heat::Observer
 {
     Vector solutionError(3);
 
-    auto temperatureData = solutionHandler.getTemperatureData();
-    auto heatFluxData = solutionHandler.getHeatFluxData();
+    const auto& temperatureData = solutionHandler.getTemperatureData();
+    const auto& heatFluxData = solutionHandler.getHeatFluxData();
 
     Vector temperatureRelErrorNormL2H1(2);
     Vector heatFluxRelErrorNormL2L2(2);
@@ -160,27 +175,29 @@ Vector heat::Observer
     int spatialFeSpaceSizeForHeatFlux
             = m_spatialFeSpaceForHeatFlux->GetTrueVSize();
 
-    Vector temperatureSol(spatialFeSpaceSizeForTemperature);
-    std::shared_ptr<GridFunction> temperatureSolGF
-            = std::make_shared<GridFunction>
-            (m_spatialFeSpaceForTemperature, temperatureSol);
+    // temporal shapes at all quadrature points of an element
+    int order = 2*m_temporalFeSpace->GetFE(0)->GetOrder()+1;
+    TemporalShapeTable temporalShapeTable(m_temporalFeSpace, order);
+    int numTemporalPoints = temporalShapeTable.getNumPoints();
 
-    Vector temporalGradientOfTemperatureSol(spatialFeSpaceSizeForTemperature);
-    std::shared_ptr<GridFunction> temporalGradientOfTemperatureSolGF
-            = std::make_shared<GridFunction>
-            (m_spatialFeSpaceForTemperature, temporalGradientOfTemperatureSol);
+    DenseMatrix temporalShapesAndGradients;
+    Vector temporalPoints, temporalWeights;
+    Array<int> temporalVdofs;
+
+    // spatial solutions at all quadrature points of an element;
+    // the temperature values are followed by their temporal gradients
+    DenseMatrix temperatureSols(spatialFeSpaceSizeForTemperature,
+                                2*numTemporalPoints);
+    DenseMatrix heatFluxSols(spatialFeSpaceSizeForHeatFlux,
+                             numTemporalPoints);
 
-    Vector heatFluxSol(spatialFeSpaceSizeForHeatFlux);
+    // views into the columns of the spatial solutions
+    std::shared_ptr<GridFunction> temperatureSolGF
+            = std::make_shared<GridFunction>();
+    std::shared_ptr<GridFunction> temporalGradientOfTemperatureSolGF
+            = std::make_shared<GridFunction>();
     std::shared_ptr<GridFunction> heatFluxSolGF
-            = std::make_shared<GridFunction>
-            (m_spatialFeSpaceForHeatFlux, heatFluxSol);
-
-    ElementTransformation *temporalTrans = nullptr;
-    const FiniteElement *temporalFe = nullptr;
-    Vector temporalShape;
-    DenseMatrix temporalDShape;
-    Vector temporalGrad;
-    Array<int> temporalVdofs;
+            = std::make_shared<GridFunction>();
 
     // auxiliary variables
     double localTemperatureErrorNormH1, localTemperatureNormH1;
@@ -193,44 +210,35 @@ Vector heat::Observer
     for (int n=0; n<numTemporalMeshEls; n++)
     {
         m_temporalFeSpace->GetElementVDofs(n, temporalVdofs);
-        temporalTrans = m_temporalFeSpace->GetElementTransformation(n);
-
-        // compute elvec
-        temporalFe = m_temporalFeSpace->GetFE(n);
-        int tNdofs = temporalFe->GetDof();
-        temporalShape.SetSize(tNdofs);
-        temporalDShape.SetSize(tNdofs, 1);
-        temporalDShape.GetColumnReference(0, temporalGrad);
-
-        int order = 2*temporalFe->GetOrder()+1;
-        const IntegrationRule *ir
-                = &IntRules.Get(temporalFe->GetGeomType(), order);
-
-        for (int i = 0; i < ir->GetNPoints(); i++)
+        temporalShapeTable.evalOnElement(n, temporalShapesAndGradients,
+                                         temporalPoints, temporalWeights);
+
+        // build solution at all quadrature points in time
+        buildSolutionsAtSpecifiedTimes(temperatureData,
+                                       temporalShapesAndGradients,
+                                       temporalVdofs, temperatureSols);
+        buildSolutionsAtSpecifiedTimes(heatFluxData,
+                                       temporalShapeTable.getShapes(),
+                                       temporalVdofs, heatFluxSols);
+
+        for (int i = 0; i < numTemporalPoints; i++)
         {
-            const IntegrationPoint &ip = ir->IntPoint(i);
-            temporalTrans->SetIntPoint(&ip);
-            temporalFe->CalcShape(ip, temporalShape);
-            temporalFe->CalcPhysDShape(*temporalTrans, temporalDShape);
-
-            // build solution at time t
-            Vector t;
-            temporalTrans->Transform(ip, t);
-            buildSolutionAtSpecifiedTime(temperatureData, temporalShape,
-                                         temporalVdofs, temperatureSol);
-            buildSolutionAtSpecifiedTime(temperatureData, temporalGrad,
-                                         temporalVdofs, temporalGradientOfTemperatureSol);
-            buildSolutionAtSpecifiedTime(heatFluxData, temporalShape,
-                                         temporalVdofs, heatFluxSol);
+            temperatureSolGF->MakeRef(m_spatialFeSpaceForTemperature,
+                                      temperatureSols.GetColumn(i));
+            temporalGradientOfTemperatureSolGF->MakeRef
+                    (m_spatialFeSpaceForTemperature,
+                     temperatureSols.GetColumn(numTemporalPoints + i));
+            heatFluxSolGF->MakeRef(m_spatialFeSpaceForHeatFlux,
+                                   heatFluxSols.GetColumn(i));
 
             std::tie (localTemperatureErrorNormH1, localTemperatureNormH1,
                       localHeatFluxErrorNormL2, localHeatFluxNormL2,
                       localSolDivergenceErrorNormL2, localSolDivergenceNormL2)
                     =  evalSpatialErrorOfSolutionInNaturalNorm
                     (temperatureSolGF, temporalGradientOfTemperatureSolGF,
-                     heatFluxSolGF, t(0));
+                     heatFluxSolGF, temporalPoints(i));
 
-            double w = ip.weight*temporalTrans->Weight();
+            double w = temporalWeights(i);
 
             temperatureRelErrorNormL2H1(0)
                     += w*localTemperatureErrorNormH1*localTemperatureErrorNormH1;
@@ -367,8 +375,8 @@ Vector heat::Observer
 {
     Vector solutionError(3);
 
-    auto temperatureData = solutionHandler.getTemperatureData();
-    auto heatFluxData = solutionHandler.getHeatFluxData();
+    const auto& temperatureData = solutionHandler.getTemperatureData();
+    const auto& heatFluxData = solutionHandler.getHeatFluxData();
 
     int numTemporalMeshEls = m_temporalFeSpace->GetNE();
     int spatialFeSpaceSizeForTemperature
@@ -376,27 +384,29 @@ Vector heat::Observer
     int spatialFeSpaceSizeForHeatFlux
             = m_spatialFeSpaceForHeatFlux->GetTrueVSize();
 
-    Vector temperatureSol(spatialFeSpaceSizeForTemperature);
-    std::shared_ptr<GridFunction> temperatureSolGF
-            = std::make_shared<GridFunction>
-            (m_spatialFeSpaceForTemperature, temperatureSol);
+    // temporal shapes at all quadrature points of an element
+    int order = 2*m_temporalFeSpace->GetFE(0)->GetOrder()+1;
+    TemporalShapeTable temporalShapeTable(m_temporalFeSpace, order);
+    int numTemporalPoints = temporalShapeTable.getNumPoints();
 
-    Vector temporalGradientOfTemperatureSol(spatialFeSpaceSizeForTemperature);
-    std::shared_ptr<GridFunction> temporalGradientOfTemperatureSolGF
-            = std::make_shared<GridFunction>
-            (m_spatialFeSpaceForTemperature, temporalGradientOfTemperatureSol);
+    DenseMatrix temporalShapesAndGradients;
+    Vector temporalPoints, temporalWeights;
+    Array<int> temporalVdofs;
 
-    Vector heatFluxSol(spatialFeSpaceSizeForHeatFlux);
+    // spatial solutions at all quadrature points of an element;
+    // the temperature values are followed by their temporal gradients
+    DenseMatrix temperatureSols(spatialFeSpaceSizeForTemperature,
+                                2*numTemporalPoints);
+    DenseMatrix heatFluxSols(spatialFeSpaceSizeForHeatFlux,
+                             numTemporalPoints);
+
+    // views into the columns of the spatial solutions
+    std::shared_ptr<GridFunction> temperatureSolGF
+            = std::make_shared<GridFunction>();
+    std::shared_ptr<GridFunction> temporalGradientOfTemperatureSolGF
+            = std::make_shared<GridFunction>();
     std::shared_ptr<GridFunction> heatFluxSolGF
-            = std::make_shared<GridFunction>
-            (m_spatialFeSpaceForHeatFlux, heatFluxSol);
-
-    ElementTransformation *temporalTrans = nullptr;
-    const FiniteElement *temporalFe = nullptr;
-    Vector temporalShape;
-    DenseMatrix temporalDShape;
-    Vector temporalGrad;
-    Array<int> temporalVdofs;
+            = std::make_shared<GridFunction>();
 
     // error in PDE and flux
     double pdeErrorNormL2L2 = 0;
@@ -406,43 +416,33 @@ Vector heat::Observer
     for (int n=0; n<numTemporalMeshEls; n++)
     {
         m_temporalFeSpace->GetElementVDofs(n, temporalVdofs);
-        temporalTrans = m_temporalFeSpace->GetElementTransformation(n);
-
-        // compute elvec
-        temporalFe = m_temporalFeSpace->GetFE(n);
-        int tNdofs = temporalFe->GetDof();
-
-        temporalShape.SetSize(tNdofs);
-        temporalDShape.SetSize(tNdofs, 1);
-        temporalDShape.GetColumnReference(0, temporalGrad);
-
-        int order = 2*temporalFe->GetOrder()+1;
-        const IntegrationRule *ir
-                = &IntRules.Get(temporalFe->GetGeomType(), order);
-
-        for (int i = 0; i < ir->GetNPoints(); i++)
+        temporalShapeTable.evalOnElement(n, temporalShapesAndGradients,
+                                         temporalPoints, temporalWeights);
+
+        // build solution at all quadrature points in time
+        buildSolutionsAtSpecifiedTimes(temperatureData,
+                                       temporalShapesAndGradients,
+                                       temporalVdofs, temperatureSols);
+        buildSolutionsAtSpecifiedTimes(heatFluxData,
+                                       temporalShapeTable.getShapes(),
+                                       temporalVdofs, heatFluxSols);
+
+        for (int i = 0; i < numTemporalPoints; i++)
         {
-            const IntegrationPoint &ip = ir->IntPoint(i);
-            temporalTrans->SetIntPoint(&ip);
-            temporalFe->CalcShape(ip, temporalShape);
-            temporalFe->CalcPhysDShape(*temporalTrans, temporalDShape);
-
-            // build solution at time t
-            Vector t;
-            temporalTrans->Transform(ip, t);
-            buildSolutionAtSpecifiedTime(temperatureData, temporalShape,
-                                         temporalVdofs, temperatureSol);
-            buildSolutionAtSpecifiedTime(temperatureData, temporalGrad,
-                                         temporalVdofs, temporalGradientOfTemperatureSol);
-            buildSolutionAtSpecifiedTime(heatFluxData, temporalShape,
-                                         temporalVdofs, heatFluxSol);
+            temperatureSolGF->MakeRef(m_spatialFeSpaceForTemperature,
+                                      temperatureSols.GetColumn(i));
+            temporalGradientOfTemperatureSolGF->MakeRef
+                    (m_spatialFeSpaceForTemperature,
+                     temperatureSols.GetColumn(numTemporalPoints + i));
+            heatFluxSolGF->MakeRef(m_spatialFeSpaceForHeatFlux,
+                                   heatFluxSols.GetColumn(i));
 
             std::tie (localPdeErrorNormL2, localHeatFluxErrorNormL2)
                     = evalSpatialErrorOfSolutionInLeastSquaresNorm
                     (temperatureSolGF, temporalGradientOfTemperatureSolGF,
-                     heatFluxSolGF, t(0));
+                     heatFluxSolGF, temporalPoints(i));
 
-            double w = ip.weight*temporalTrans->Weight();
+            double w = temporalWeights(i);
             pdeErrorNormL2L2 += w*localPdeErrorNormL2*localPdeErrorNormL2;
             heatFluxErrorNormL2L2 += w*localHeatFluxErrorNormL2
                     *localHeatFluxErrorNormL2;
@@ -456,18 +456,20 @@ Vector heat::Observer
     {
         int n=0;
         m_temporalFeSpace->GetElementVDofs(n, temporalVdofs);
-        temporalTrans = m_temporalFeSpace->GetElementTransformation(n);
 
-        temporalFe = m_temporalFeSpace->GetFE(n);
+        const FiniteElement *temporalFe = m_temporalFeSpace->GetFE(n);
         int temporalNumDofs = temporalFe->GetDof();
-        temporalShape.SetSize(temporalNumDofs);
+        Vector temporalShape(temporalNumDofs);
 
         IntegrationPoint ip;
         ip.Set1w(0, 1.0);
         temporalFe->CalcShape(ip, temporalShape);
 
+        Vector temperatureSol(spatialFeSpaceSizeForTemperature);
         buildSolutionAtSpecifiedTime(temperatureData, temporalShape,
                                      temporalVdofs, temperatureSol);
+        temperatureSolGF->MakeRef(m_spatialFeSpaceForTemperature,
+                                  temperatureSol.GetData());
 
         m_exactTemperatureCoeff->SetTime(0);
         initialTemperatureErrorNormL2 = temperatureSolGF
@@ -0,0 +1,158 @@
+#include "sensor_probe.hpp"
+
+#include "../mymfem/kronecker_csr_builder.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <stdexcept>
+#include <vector>
+
+using namespace mfem;
+
+
+heat::SensorProbe
+:: SensorProbe (FiniteElementSpace *temporalFes,
+                Array<FiniteElementSpace *> spatialFes,
+                const DenseMatrix& X)
+    : m_temporalFes (temporalFes),
+      m_spatialFes (spatialFes)
+{
+    // temperature and heat flux share the spatial mesh
+    m_spatialProbe = std::make_unique<mymfem::SpatialProbe>
+            (spatialFes[0]->GetMesh(), X);
+
+    m_spatialTemperatureEvaluation.reset
+            (m_spatialProbe->buildEvaluation(*spatialFes[0]));
+    m_spatialHeatFluxEvaluation.reset
+            (m_spatialProbe->buildEvaluation(*spatialFes[1]));
+}
+
+void heat::SensorProbe
+:: setTimes (const Vector& times)
+{
+    auto temporalEvaluation = buildTemporalEvaluation(times);
+    m_times = times;
+
+    int numTimes = times.Size();
+    int temporalSize = m_temporalFes->GetTrueVSize();
+
+    mymfem::KroneckerCsrBuilder temperatureBuilder
+            (numTimes*m_spatialTemperatureEvaluation->Height(),
+             temporalSize*m_spatialTemperatureEvaluation->Width());
+    temperatureBuilder.addTerm(1., *temporalEvaluation,
+                               *m_spatialTemperatureEvaluation);
+    m_temperatureProbe.reset(temperatureBuilder.build());
+
+    mymfem::KroneckerCsrBuilder heatFluxBuilder
+            (numTimes*m_spatialHeatFluxEvaluation->Height(),
+             temporalSize*m_spatialHeatFluxEvaluation->Width());
+    heatFluxBuilder.addTerm(1., *temporalEvaluation,
+                            *m_spatialHeatFluxEvaluation);
+    m_heatFluxProbe.reset(heatFluxBuilder.build());
+}
+
+std::unique_ptr<SparseMatrix> heat::SensorProbe
+:: buildTemporalEvaluation (const Vector& times) const
+{
+    Mesh *temporalMesh = m_temporalFes->GetMesh();
+    int numEls = temporalMesh->GetNE();
+
+    // temporal elements sorted by their left end points
+    struct Interval
+    {
+        double left, right;
+        bool flipped;
+        int elId;
+    };
+    std::vector<Interval> intervals(numEls);
+    Array<int> vertices;
+    for (int n=0; n<numEls; n++)
+    {
+        temporalMesh->GetElementVertices(n, vertices);
+        double t0 = temporalMesh->GetVertex(vertices[0])[0];
+        double t1 = temporalMesh->GetVertex(vertices[1])[0];
+        intervals[n] = {std::min(t0, t1), std::max(t0, t1), t1 < t0, n};
+    }
+    std::sort(intervals.begin(), intervals.end(),
+              [](const Interval& a, const Interval& b) {
+        return a.left < b.left;
+    });
+
+    double startTime = intervals.front().left;
+    double endTime = 0;
+    for (const auto& interval : intervals) {
+        endTime = std::max(endTime, interval.right);
+    }
+
+    int numTimes = times.Size();
+    for (int i=0; i<numTimes; i++)
+    {
+        double t = times(i);
+        if (t < startTime - 1E-12 || t > endTime + 1E-12) {
+            throw std::runtime_error(fmt::format(
+                "Sensor time outside the temporal mesh. "
+                "[{} not in [{}, {}]]", t, startTime, endTime));
+        }
+    }
+
+    auto temporalEvaluation = std::make_unique<SparseMatrix>
+            (numTimes, m_temporalFes->GetTrueVSize());
+
+    Array<int> vdofs;
+    Vector shape;
+    IntegrationPoint ip;
+    for (int i=0; i<numTimes; i++)
+    {
+        double t = times(i);
+        auto it = std::upper_bound(intervals.begin(), intervals.end(), t,
+                                   [](double t, const Interval& a) {
+            return t < a.left;
+        });
+        // times just before the first element, up to roundoff,
+        // are clamped to it
+        const Interval& interval
+                = (it == intervals.begin()) ? *it : *(it-1);
+
+        double eta = (t - interval.left)/(interval.right - interval.left);
+        ip.x = interval.flipped ? 1 - eta : eta;
+
+        const FiniteElement *fe = m_temporalFes->GetFE(interval.elId);
+        shape.SetSize(fe->GetDof());
+        fe->CalcShape(ip, shape);
+        m_temporalFes->GetElementVDofs(interval.elId, vdofs);
+        for (int k=0; k<vdofs.Size(); k++) {
+            temporalEvaluation->Add(i, vdofs[k], shape(k));
+        }
+    }
+    temporalEvaluation->Finalize();
+
+    return temporalEvaluation;
+}
+
+void heat::SensorProbe
+:: probeTemperature (const SolutionHandler& solutionHandler,
+                     DenseMatrix& values) const
+{
+    assert(m_temperatureProbe);
+    assert(solutionHandler.getLayout() == DataLayout::timeMajor);
+
+    values.SetSize(m_spatialTemperatureEvaluation->Height(), getNumTimes());
+    Vector buf(values.Data(), values.Height()*values.Width());
+    m_temperatureProbe->Mult(solutionHandler.getTemperatureData(), buf);
+}
+
+void heat::SensorProbe
+:: probeHeatFlux (const SolutionHandler& solutionHandler,
+                  DenseMatrix& values) const
+{
+    assert(m_heatFluxProbe);
+    assert(solutionHandler.getLayout() == DataLayout::timeMajor);
+
+    values.SetSize(m_spatialHeatFluxEvaluation->Height(), getNumTimes());
+    Vector buf(values.Data(), values.Height()*values.Width());
+    m_heatFluxProbe->Mult(solutionHandler.getHeatFluxData(), buf);
+}
+
+// End of file
@@ -0,0 +1,98 @@
+#ifndef HEAT_SENSOR_PROBE_HPP
+#define HEAT_SENSOR_PROBE_HPP
+
+#include "mfem.hpp"
+
+#include <memory>
+
+#include "../mymfem/spatial_probe.hpp"
+#include "solution_handler.hpp"
+
+
+namespace heat
+{
+
+/**
+ * @brief Evaluates space-time solutions at fixed sensor locations
+ * and a set of times.
+ *
+ * The sensors are located once on the spatial mesh. For the given
+ * times, the temporal shape values are combined with the cached
+ * spatial ones into sparse Kronecker probe matrices, so probing
+ * a solution is one sparse matrix-vector product.
+ * The probed values have one column per time; vector-valued fields
+ * have the components of a sensor fastest.
+ */
+class SensorProbe
+{
+public:
+    /**
+     * @brief Constructor
+     * @param temporalFes temporal FE space
+     * @param spatialFes spatial FE spaces of temperature and heat flux
+     * @param X sensor locations, one column per sensor
+     */
+    SensorProbe (mfem::FiniteElementSpace *temporalFes,
+                 mfem::Array<mfem::FiniteElementSpace *> spatialFes,
+                 const mfem::DenseMatrix& X);
+
+    //! Builds the probe matrices for the given times;
+    //! throws if a time is outside the temporal mesh
+    void setTimes (const mfem::Vector& times);
+
+    int getNumSensors() const {
+        return m_spatialProbe->getNumPoints();
+    }
+
+    int getNumTimes() const {
+        return m_times.Size();
+    }
+
+    //! Returns the number of sensors located on the spatial mesh
+    int getNumFound() const {
+        return m_spatialProbe->getNumFound();
+    }
+
+    //! Returns the indices of the sensors outside the spatial mesh;
+    //! their probed values are zero
+    mfem::Array<int> getUnlocatedSensors() const {
+        return m_spatialProbe->getUnlocatedPoints();
+    }
+
+    const mfem::SparseMatrix& getTemperatureProbe() const {
+        return *m_temperatureProbe;
+    }
+
+    const mfem::SparseMatrix& getHeatFluxProbe() const {
+        return *m_heatFluxProbe;
+    }
+
+    //! Evaluates the temperature, sensors x times
+    void probeTemperature (const SolutionHandler& solutionHandler,
+                           mfem::DenseMatrix& values) const;
+
+    //! Evaluates the heat flux, (sensors * components) x times
+    void probeHeatFlux (const SolutionHandler& solutionHandler,
+                        mfem::DenseMatrix& values) const;
+
+private:
+    //! Builds the temporal evaluation matrix, times x temporal dofs
+    std::unique_ptr<mfem::SparseMatrix> buildTemporalEvaluation
+    (const mfem::Vector& times) const;
+
+private:
+    mfem::FiniteElementSpace *m_temporalFes;
+    mfem::Array<mfem::FiniteElementSpace *> m_spatialFes;
+
+    std::unique_ptr<mymfem::SpatialProbe> m_spatialProbe;
+    std::unique_ptr<mfem::SparseMatrix> m_spatialTemperatureEvaluation;
+    std::unique_ptr<mfem::SparseMatrix> m_spatialHeatFluxEvaluation;
+
+    mfem::Vector m_times;
+    std::unique_ptr<mfem::SparseMatrix> m_temperatureProbe;
+    std::unique_ptr<mfem::SparseMatrix> m_heatFluxProbe;
+};
+
+}
+
+#endif // HEAT_SENSOR_PROBE_HPP
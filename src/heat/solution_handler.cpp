@@ -2,13 +2,18 @@
 
 #include "utilities.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
 using namespace mfem;
 
 
 heat::SolutionHandler
 :: SolutionHandler
 (mfem::FiniteElementSpace* temporalFeSpace,
- mfem::Array<mfem::FiniteElementSpace *> spatialFeSpaces)
+ mfem::Array<mfem::FiniteElementSpace *> spatialFeSpaces,
+ mymfem::MemoryPolicy memoryPolicy)
     : m_temporalFeSpace (temporalFeSpace),
       m_spatialFeSpaces (spatialFeSpaces)
 {
@@ -28,14 +33,15 @@ heat::SolutionHandler
     blockOffsets[1] = temperatureDataSize;
     blockOffsets[2] = blockOffsets[1] + heatFluxDataSize;
 
-    m_data = std::make_shared<BlockVector>(blockOffsets);
-    (*m_data) = 0.;
+    // zero-initialised
+    m_data = mymfem::makeBlockVector(blockOffsets, memoryPolicy);
 }
 
 Vector heat::SolutionHandler
 :: getTemperatureDataAtInitialTime() const
 {
-    auto temperatureData = getTemperatureData();
+    checkLayout(DataLayout::timeMajor);
+    const auto& temperatureData = getTemperatureData();
 
     Array<int> temporalVdofs;
     const FiniteElement *temporalFe
@@ -60,7 +66,8 @@ Vector heat::SolutionHandler
 :: getTemperatureDataAtEndTime() const
 {
     auto temporalMesh = m_temporalFeSpace->GetMesh();
-    auto temperatureData = getTemperatureData();
+    checkLayout(DataLayout::timeMajor);
+    const auto& temperatureData = getTemperatureData();
 
     Array<int> temporalVdofs;
     const FiniteElement *temporalFe
@@ -85,7 +92,8 @@ Vector heat::SolutionHandler
 Vector heat::SolutionHandler
 :: getHeatFluxDataAtInitialTime() const
 {
-    auto heatFluxData = getHeatFluxData();
+    checkLayout(DataLayout::timeMajor);
+    const auto& heatFluxData = getHeatFluxData();
 
     Array<int> temporalVdofs;
     const FiniteElement *temporalFe
@@ -110,7 +118,8 @@ Vector heat::SolutionHandler
 :: getHeatFluxDataAtEndTime() const
 {
     auto temporalMesh = m_temporalFeSpace->GetMesh();
-    auto heatFluxData = getHeatFluxData();
+    checkLayout(DataLayout::timeMajor);
+    const auto& heatFluxData = getHeatFluxData();
 
     Array<int> temporalVdofs;
     const FiniteElement *temporalFe
@@ -131,3 +140,138 @@ Vector heat::SolutionHandler
 
     return heatFluxAtEndTime;
 }
+
+void heat::SolutionHandler
+:: setLayout(DataLayout layout)
+{
+    if (layout == m_layout) {
+        return;
+    }
+
+    // time-major data is a spatial x temporal column-major block
+    int numRows1 = m_spatialFeSpaceSizeForTemperature;
+    int numRows2 = m_spatialFeSpaceSizeForHeatFlux;
+    int numCols = m_temporalFeSpaceSize;
+    if (m_layout == DataLayout::timeMajor) {
+        transposeBlock(getTemperatureData(), numRows1, numCols);
+        transposeBlock(getHeatFluxData(), numRows2, numCols);
+    }
+    else {
+        transposeBlock(getTemperatureData(), numCols, numRows1);
+        transposeBlock(getHeatFluxData(), numCols, numRows2);
+    }
+    m_layout = layout;
+}
+
+void heat::SolutionHandler
+:: checkLayout(DataLayout layout) const
+{
+    if (m_layout != layout) {
+        throw std::runtime_error
+                (std::string("SolutionHandler: the data must be in the ")
+                 +(layout == DataLayout::timeMajor ?
+                       "timeMajor" : "spaceMajor")
+                 +" layout, call setLayout first");
+    }
+}
+
+void heat::SolutionHandler
+:: transposeBlock(Vector& block, int numRows, int numCols) const
+{
+    Vector buf(block);
+    double *in = buf.GetData();
+    double *out = block.GetData();
+
+    // blocked, so that reads and writes stay in cache
+    const int blockSize = 32;
+    #pragma omp parallel for schedule(static)
+    for (int jb=0; jb<numCols; jb+=blockSize) {
+        for (int ib=0; ib<numRows; ib+=blockSize) {
+            int jEnd = std::min(jb+blockSize, numCols);
+            int iEnd = std::min(ib+blockSize, numRows);
+            for (int j=jb; j<jEnd; j++) {
+                for (int i=ib; i<iEnd; i++) {
+                    out[j + i*numCols] = in[i + j*numRows];
+                }
+            }
+        }
+    }
+}
+
+// MFEM has no read-only vector views; the view is returned const
+const Vector heat::SolutionHandler
+:: makeConstRef(int block, int offset, int size) const
+{
+    const Vector& data = m_data->GetBlock(block);
+    return Vector(const_cast<double*>(data.GetData()) + offset, size);
+}
+
+void heat::SolutionHandler
+:: makeTemperatureSliceRef(int temporalDof, Vector& view)
+{
+    checkLayout(DataLayout::timeMajor);
+    view.MakeRef(m_data->GetBlock(0),
+                 temporalDof*m_spatialFeSpaceSizeForTemperature,
+                 m_spatialFeSpaceSizeForTemperature);
+}
+
+const Vector heat::SolutionHandler
+:: makeTemperatureSliceRef(int temporalDof) const
+{
+    checkLayout(DataLayout::timeMajor);
+    return makeConstRef(0, temporalDof*m_spatialFeSpaceSizeForTemperature,
+                        m_spatialFeSpaceSizeForTemperature);
+}
+
+void heat::SolutionHandler
+:: makeHeatFluxSliceRef(int temporalDof, Vector& view)
+{
+    checkLayout(DataLayout::timeMajor);
+    view.MakeRef(m_data->GetBlock(1),
+                 temporalDof*m_spatialFeSpaceSizeForHeatFlux,
+                 m_spatialFeSpaceSizeForHeatFlux);
+}
+
+const Vector heat::SolutionHandler
+:: makeHeatFluxSliceRef(int temporalDof) const
+{
+    checkLayout(DataLayout::timeMajor);
+    return makeConstRef(1, temporalDof*m_spatialFeSpaceSizeForHeatFlux,
+                        m_spatialFeSpaceSizeForHeatFlux);
+}
+
+void heat::SolutionHandler
+:: makeTemperatureTraceRef(int spatialDof, Vector& view)
+{
+    checkLayout(DataLayout::spaceMajor);
+    view.MakeRef(m_data->GetBlock(0),
+                 spatialDof*m_temporalFeSpaceSize,
+                 m_temporalFeSpaceSize);
+}
+
+const Vector heat::SolutionHandler
+:: makeTemperatureTraceRef(int spatialDof) const
+{
+    checkLayout(DataLayout::spaceMajor);
+    return makeConstRef(0, spatialDof*m_temporalFeSpaceSize,
+                        m_temporalFeSpaceSize);
+}
+
+void heat::SolutionHandler
+:: makeHeatFluxTraceRef(int spatialDof, Vector& view)
+{
+    checkLayout(DataLayout::spaceMajor);
+    view.MakeRef(m_data->GetBlock(1),
+                 spatialDof*m_temporalFeSpaceSize,
+                 m_temporalFeSpaceSize);
+}
+
+const Vector heat::SolutionHandler
+:: makeHeatFluxTraceRef(int spatialDof) const
+{
+    checkLayout(DataLayout::spaceMajor);
+    return makeConstRef(1, spatialDof*m_temporalFeSpaceSize,
+                        m_temporalFeSpaceSize);
+}
+
+// End of file
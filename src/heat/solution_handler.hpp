@@ -5,16 +5,27 @@
 
 #include <memory>
 
+#include "../mymfem/data_buffer.hpp"
+
 
 namespace heat
 {
 
+/**
+ * @brief Storage order of the space-time data of a field;
+ * timeMajor stores one spatial vector per temporal dof,
+ * spaceMajor one temporal vector per spatial dof
+ */
+enum class DataLayout {timeMajor, spaceMajor};
+
+
 class SolutionHandler
 {
 public:
     SolutionHandler
     (mfem::FiniteElementSpace* temporalFeSpace,
-     mfem::Array<mfem::FiniteElementSpace *> spatialFeSpaces);
+     mfem::Array<mfem::FiniteElementSpace *> spatialFeSpaces,
+     mymfem::MemoryPolicy memoryPolicy = mymfem::MemoryPolicy::standard);
 
     mfem::Vector getTemperatureDataAtInitialTime() const;
 
@@ -59,8 +70,61 @@ public:
         return blockSizes;
     }
 
+    DataLayout getLayout() const {
+        return m_layout;
+    }
+
+    //! Transposes the data to the given layout, through a scratch
+    //! copy of each block; the data keeps its storage, so views made
+    //! before the call refer to other dofs afterwards.
+    //! The solvers and observers expect timeMajor
+    void setLayout(DataLayout layout);
+
+    //! Makes a non-owning view of the temperature at a temporal dof;
+    //! requires the timeMajor layout
+    void makeTemperatureSliceRef(int temporalDof, mfem::Vector& view);
+
+    //! Returns a read-only view of the temperature at a temporal dof
+    const mfem::Vector makeTemperatureSliceRef(int temporalDof) const;
+
+    //! Makes a non-owning view of the heat flux at a temporal dof;
+    //! requires the timeMajor layout
+    void makeHeatFluxSliceRef(int temporalDof, mfem::Vector& view);
+
+    //! Returns a read-only view of the heat flux at a temporal dof
+    const mfem::Vector makeHeatFluxSliceRef(int temporalDof) const;
+
+    //! Makes a non-owning view of the temperature history
+    //! at a spatial dof; requires the spaceMajor layout
+    void makeTemperatureTraceRef(int spatialDof, mfem::Vector& view);
+
+    //! Returns a read-only view of the temperature history
+    //! at a spatial dof
+    const mfem::Vector makeTemperatureTraceRef(int spatialDof) const;
+
+    //! Makes a non-owning view of the heat flux history
+    //! at a spatial dof; requires the spaceMajor layout
+    void makeHeatFluxTraceRef(int spatialDof, mfem::Vector& view);
+
+    //! Returns a read-only view of the heat flux history
+    //! at a spatial dof
+    const mfem::Vector makeHeatFluxTraceRef(int spatialDof) const;
+
+private:
+    //! Throws if the data is not in the given layout
+    void checkLayout(DataLayout layout) const;
+
+    //! Returns a const view of a range of a data block
+    const mfem::Vector makeConstRef(int block, int offset, int size) const;
+
+    //! Transposes a numRows x numCols column-major block into its
+    //! storage, reading from a scratch copy of the block
+    void transposeBlock(mfem::Vector& block,
+                        int numRows, int numCols) const;
+
 private:
     std::shared_ptr<mfem::BlockVector> m_data;
+    DataLayout m_layout = DataLayout::timeMajor;
 
     mfem::FiniteElementSpace * m_temporalFeSpace;
     mfem::Array<mfem::FiniteElementSpace *> m_spatialFeSpaces;
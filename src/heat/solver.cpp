@@ -1,6 +1,10 @@
 #include "solver.hpp"
 #include "utilities.hpp"
+#include "kronecker_ordering.hpp"
+#include "temporal_operators.hpp"
+#include "../core/sweep_scheduler.hpp"
 
+#include <fmt/format.h>
 #include <iostream>
 #include <chrono>
 
@@ -53,6 +57,42 @@ void heat::Solver
 
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "linear_solver",
                                         m_linearSolver, "pardiso");
+
+    // single-precision factors, refined in double precision
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "pardiso_mixed_precision",
+                                        m_pardisoMixedPrecision, false);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "pardiso_refinement_tolerance",
+             m_pardisoRefinementTolerance, 1E-12);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "pardiso_max_refinement_steps",
+             m_pardisoMaxRefinementSteps, 20);
+
+    // fill-reducing permutations are cached in this directory,
+    // keyed by the sparsity pattern; no cache if empty
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "pardiso_ordering_cache_dir",
+             m_pardisoOrderingCacheDir, "");
+
+    // "metis", or "kronecker" for the tensor-product nested
+    // dissection of the time axis and the spatial graph
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "pardiso_ordering",
+                                        m_pardisoOrdering, "metis");
+    if (m_pardisoOrdering != "metis" && m_pardisoOrdering != "kronecker") {
+        throw std::runtime_error(fmt::format(
+            "Unknown Pardiso ordering. [{}]", m_pardisoOrdering));
+    }
+
+    // "standard", "aligned", "huge_pages" or "numa_interleaved"
+    std::string solutionMemory;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "solution_memory",
+                                        solutionMemory, "standard");
+    m_solutionMemoryPolicy = mymfem::parseMemoryPolicy(solutionMemory);
+
+    // hardware counters per phase in the performance measurements,
+    // only timers if the counters are not permitted
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "perf_counters",
+                                        m_usePerfCounters, false);
 }
 
 void heat::Solver
@@ -67,9 +107,10 @@ void heat::Solver
                 +"_mesh_l"
                 +std::to_string(m_initSpatialLevel)+".mesh";
 #ifndef NDEBUG
-        std::cout << "  Initial mesh file: " << meshFile << std::endl;
-        std::cout << "  Number of uniform refinements: "
-                  << numRefinements << std::endl;
+        getJobOutput() << "  Initial mesh file: "
+                       << meshFile << std::endl;
+        getJobOutput() << "  Number of uniform refinements: "
+                       << numRefinements << std::endl;
 #endif
         m_spatialMesh = std::make_shared<Mesh>(meshFile.c_str());
         for (int k=0; k<numRefinements; k++) {
@@ -81,8 +122,8 @@ void heat::Solver
         const std::string meshFile =
                 m_meshDir+"/mesh_l"+std::to_string(m_spatialLevel)+".mesh";
 #ifndef NDEBUG
-        std::cout << "  Mesh file: "
-                  << meshFile << std::endl;
+        getJobOutput() << "  Mesh file: "
+                       << meshFile << std::endl;
 #endif
         m_spatialMesh = std::make_shared<Mesh>(meshFile.c_str());
     }
@@ -137,34 +178,27 @@ std::pair<Vector, int> heat::Solver
 :: runAndMeasurePerformanceMetrics()
 {
     Vector elapsedTime(4);
-
-    auto start = std::chrono::high_resolution_clock::now();
-    initialize ();
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast
-            <std::chrono::milliseconds>(end - start);
-    elapsedTime(0)
-            = (static_cast<double>(duration.count()))/1000;
-
-    start = std::chrono::high_resolution_clock::now();
-    assembleSystem();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast
-                <std::chrono::milliseconds>(end - start);
-    elapsedTime(1)
-                = (static_cast<double>(duration.count()))/1000;
-
-    start = std::chrono::high_resolution_clock::now();
-    assembleRhs();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast
-                <std::chrono::milliseconds>(end - start);
-    elapsedTime(2)
-                = (static_cast<double>(duration.count()))/1000;
-
+    if (!m_profiler) {
+        m_profiler = std::make_unique<PhaseProfiler>(m_usePerfCounters);
+    }
+    m_profiler->clear();
+
+    elapsedTime(0) = m_profiler->measure("initialization", [this]() {
+        initialize();
+    });
+    elapsedTime(1) = m_profiler->measure("system_assembly", [this]() {
+        assembleSystem();
+    });
+    elapsedTime(2) = m_profiler->measure("rhs_assembly", [this]() {
+        assembleRhs();
+    });
+
+    // the factorization is recorded as a nested phase
     int memoryUsage;
-    std::tie(elapsedTime(3), memoryUsage)
-            = solveAndMeasurePerformanceMetrics();
+    m_profiler->measure("linear_solve", [&]() {
+        std::tie(elapsedTime(3), memoryUsage)
+                = solveAndMeasurePerformanceMetrics();
+    });
 
     return {elapsedTime, memoryUsage};
 }
@@ -177,7 +211,7 @@ void heat::Solver
     auto spatialFeSpaces = m_disc->getSpatialFeSpaces();
     m_solutionHandler
             = std::make_shared<heat::SolutionHandler>
-            (temporalFeSpace, spatialFeSpaces);
+            (temporalFeSpace, spatialFeSpaces, m_solutionMemoryPolicy);
 
     // variable to store rhs data
     m_rhs = std::make_unique<BlockVector>(m_blockOffsets);
@@ -244,13 +278,34 @@ std::pair<double, int> heat::Solver
     if (m_linearSolver == "pardiso")
     {
         setPardisoSolver();
+
+        // built on the zero-based pattern, before initialize
+        if (m_pardisoOrdering == "kronecker")
+        {
+            if (m_profiler) {
+                m_profiler->measure("ordering", [this]() {
+                    m_pardisoSolver->setPermutation
+                            (buildKroneckerOrdering());
+                });
+            } else {
+                m_pardisoSolver->setPermutation(buildKroneckerOrdering());
+            }
+        }
         m_pardisoSolver->initialize(m_systemMat->Size(),
                                     m_systemMat->GetI(),
                                     m_systemMat->GetJ(),
                                     m_systemMat->GetData());
-        m_pardisoSolver->factorize();
+        // a nested phase of the measured runs
+        if (m_profiler) {
+            m_profiler->measure("factorization", [this]() {
+                m_pardisoSolver->factorize();
+            });
+        } else {
+            m_pardisoSolver->factorize();
+        }
         m_pardisoSolver->solve(rhs.GetData(), u.GetData());
         memoryUsage = m_pardisoSolver->getMemoryUsage();
+        m_pardisoStats = m_pardisoSolver->getStats();
         finalizePardisoSolver();
     }
     else if (m_linearSolver == "cg")
@@ -289,6 +344,11 @@ void heat::Solver
 //        int mtype = -2; // real symmetric indefinite
     m_pardisoSolver
             = std::make_unique<PardisoSolver>(mtype);
+    if (m_pardisoMixedPrecision) {
+        m_pardisoSolver->setMixedPrecision(m_pardisoRefinementTolerance,
+                                           m_pardisoMaxRefinementSteps);
+    }
+    m_pardisoSolver->setOrderingCache(m_pardisoOrderingCacheDir);
 }
 
 void heat::Solver
@@ -296,4 +356,19 @@ void heat::Solver
     m_pardisoSolver->finalize();
 }
 
+// the spatial graph is dissected once,
+// its tree is shared by all time intervals
+std::vector<int> heat::Solver
+:: buildKroneckerOrdering() const
+{
+    BandedTemporalOperator temporalOp(*m_disc->getTemporalFeSpace());
+    std::unique_ptr<SparseMatrix> spatialGraph
+            (heat::buildSpatialGraph(*m_systemMat, m_blockOffsets,
+                                     temporalOp.Height()));
+
+    return heat::buildKroneckerOrdering
+            (m_blockOffsets, temporalOp.getNestedDissectionTree(),
+             heat::dissectGraph(*spatialGraph));
+}
+
 // End of file
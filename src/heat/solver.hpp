@@ -4,6 +4,7 @@
 #include "mfem.hpp"
 
 #include "../core/config.hpp"
+#include "../core/perf_counters.hpp"
 #include "../pardiso/pardiso.hpp"
 
 #include "../mymfem/utilities.hpp"
@@ -75,6 +76,21 @@ public:
         return m_disc;
     }
 
+    //! Returns the metrics of the phases of the last measured run
+    const std::vector<PhaseMetrics>& getPhaseMetrics() const {
+        static const std::vector<PhaseMetrics> noPhases;
+        return m_profiler ? m_profiler->getPhases() : noPhases;
+    }
+
+    bool hasPerfCounters() const {
+        return m_profiler && m_profiler->hasCounters();
+    }
+
+    //! Returns the statistics of the last PARDISO solve
+    const PardisoStats& getPardisoStats() const {
+        return m_pardisoStats;
+    }
+
     std::shared_ptr<heat::SolutionHandler> getSolutionHandler() const {
         return m_solutionHandler;
     }
@@ -96,6 +112,11 @@ public:
         return m_solutionHandler->getDataSize().Sum();
     }
 
+private:
+    //! Builds the Kronecker nested dissection ordering
+    //! of the space-time system matrix
+    std::vector<int> buildKroneckerOrdering() const;
+
 private:
     const nlohmann::json& m_config;
 
@@ -110,7 +131,11 @@ private:
 
     std::string m_discType;
     std::string m_linearSolver;
-    
+    mymfem::MemoryPolicy m_solutionMemoryPolicy;
+    bool m_usePerfCounters;
+    //! created by the first measured run
+    std::unique_ptr<PhaseProfiler> m_profiler;
+
     double m_endTime;
 
     std::shared_ptr<mfem::Mesh> m_temporalMesh;
@@ -126,6 +151,13 @@ private:
     std::shared_ptr<heat::SolutionHandler> m_solutionHandler;
     std::unique_ptr <mfem::BlockVector> m_rhs;
 
+    bool m_pardisoMixedPrecision;
+    double m_pardisoRefinementTolerance;
+    int m_pardisoMaxRefinementSteps;
+    std::string m_pardisoOrderingCacheDir;
+    std::string m_pardisoOrdering;
+    PardisoStats m_pardisoStats;
+
 #ifdef PARDISO_HPP
     std::unique_ptr<PardisoSolver> m_pardisoSolver;
 #endif
@@ -0,0 +1,525 @@
+#include "temporal_operators.hpp"
+
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include <assert.h>
+
+using namespace mfem;
+
+
+heat::BandedTemporalOperator
+:: BandedTemporalOperator (const FiniteElementSpace& temporalFes)
+    : Operator (temporalFes.GetVSize())
+{
+    assert(temporalFes.GetMesh()->Dimension() == 1);
+
+    m_bandwidth = temporalFes.GetFE(0)->GetDof()-1;
+    setDofOrdering(temporalFes);
+
+    m_band.SetSize(height*(2*m_bandwidth+1));
+    m_band = 0.;
+    m_isStructural.SetSize(m_band.Size());
+    m_isStructural = false;
+}
+
+// Walks through the elements in increasing time,
+// numbering left vertex, interior dofs and right vertex
+void heat::BandedTemporalOperator
+:: setDofOrdering (const FiniteElementSpace& temporalFes)
+{
+    Mesh *mesh = temporalFes.GetMesh();
+    int numElements = mesh->GetNE();
+
+    Array<double> leftCoords(numElements);
+    Array<bool> isFlipped(numElements);
+    Array<int> verts;
+    for (int n=0; n<numElements; n++) {
+        mesh->GetElementVertices(n, verts);
+        double t0 = mesh->GetVertex(verts[0])[0];
+        double t1 = mesh->GetVertex(verts[1])[0];
+        leftCoords[n] = std::min(t0, t1);
+        isFlipped[n] = (t0 > t1);
+    }
+
+    std::vector<int> elIds(numElements);
+    std::iota(elIds.begin(), elIds.end(), 0);
+    std::sort(elIds.begin(), elIds.end(), [&leftCoords](int a, int b) {
+        return leftCoords[a] < leftCoords[b];
+    });
+
+    m_lexToDof.SetSize(height);
+    m_dofToLex.SetSize(height);
+    m_dofToLex = -1;
+
+    // element vdofs are ordered as: left vertex,
+    // right vertex, interior dofs in increasing reference coordinate
+    int p = 0;
+    Array<int> vdofs;
+    for (int k=0; k<numElements; k++)
+    {
+        int n = elIds[k];
+        temporalFes.GetElementVDofs(n, vdofs);
+        int ndofs = vdofs.Size();
+
+        int left = isFlipped[n] ? vdofs[1] : vdofs[0];
+        int right = isFlipped[n] ? vdofs[0] : vdofs[1];
+        if (k == 0) {
+            m_lexToDof[p++] = left;
+        }
+        else {
+            // neighbouring elements share the vertex dof
+            assert(m_lexToDof[p-1] == left);
+        }
+        for (int l=2; l<ndofs; l++) {
+            m_lexToDof[p++] = isFlipped[n] ? vdofs[ndofs+1-l] : vdofs[l];
+        }
+        m_lexToDof[p++] = right;
+    }
+    assert(p == height);
+
+    for (p=0; p<height; p++) {
+        m_dofToLex[m_lexToDof[p]] = p;
+    }
+}
+
+namespace {
+
+// adds the node of the elements first, ..., last-1, split at the middle
+// vertex, with the interior dofs of an element at a leaf; the bounding
+// vertices are separators of the calling levels
+int dissect (int first, int last, int deg,
+             const Array<int>& lexToDof, heat::DissectionTree& tree)
+{
+    int node = static_cast<int>(tree.nodes.size());
+    tree.nodes.emplace_back();
+    if (last - first == 1) {
+        for (int l=1; l<deg; l++) {
+            tree.nodes[node].dofs.push_back(lexToDof[first*deg + l]);
+        }
+        return node;
+    }
+
+    int mid = (first + last)/2;
+    int left = dissect(first, mid, deg, lexToDof, tree);
+    int right = dissect(mid, last, deg, lexToDof, tree);
+    tree.nodes[node].left = left;
+    tree.nodes[node].right = right;
+    tree.nodes[node].dofs.push_back(lexToDof[mid*deg]);
+    return node;
+}
+
+}
+
+// the boundary vertices only couple to the first and last element,
+// and are eliminated with their interior dofs
+heat::DissectionTree heat::BandedTemporalOperator
+:: getNestedDissectionTree() const
+{
+    int numElements = (height-1)/m_bandwidth;
+
+    DissectionTree tree;
+    if (numElements == 0) {
+        tree.nodes.emplace_back();
+        tree.nodes[0].dofs.push_back(m_lexToDof[0]);
+        return tree;
+    }
+    dissect(0, numElements, m_bandwidth, m_lexToDof, tree);
+
+    int first = 0, last = 0;
+    while (!tree.nodes[first].isLeaf()) {
+        first = tree.nodes[first].left;
+    }
+    while (!tree.nodes[last].isLeaf()) {
+        last = tree.nodes[last].right;
+    }
+    auto& firstDofs = tree.nodes[first].dofs;
+    firstDofs.insert(firstDofs.begin(), m_lexToDof[0]);
+    tree.nodes[last].dofs.push_back(m_lexToDof[height-1]);
+
+    return tree;
+}
+
+Array<int> heat::BandedTemporalOperator
+:: getNestedDissectionOrdering() const
+{
+    Array<int> ordering = getNestedDissectionTree().getOrdering();
+    assert(ordering.Size() == height);
+    return ordering;
+}
+
+double heat::BandedTemporalOperator
+:: elem (int i, int j) const
+{
+    int p = m_dofToLex[i];
+    int q = m_dofToLex[j];
+    if (std::abs(p-q) > m_bandwidth) {
+        return 0.;
+    }
+    return band(p,q);
+}
+
+void heat::BandedTemporalOperator
+:: addElem (int i, int j, double val)
+{
+    int p = m_dofToLex[i];
+    int q = m_dofToLex[j];
+    assert(std::abs(p-q) <= m_bandwidth);
+    band(p,q) += val;
+    m_isStructural[p*(2*m_bandwidth+1) + q-p+m_bandwidth] = true;
+    m_isFactorized = false;
+}
+
+void heat::BandedTemporalOperator
+:: add (const BandedTemporalOperator& other, double a)
+{
+    assert(other.height == height);
+    assert(other.m_bandwidth == m_bandwidth);
+    m_band.Add(a, other.m_band);
+    for (int k=0; k<m_isStructural.Size(); k++) {
+        m_isStructural[k] = m_isStructural[k] || other.m_isStructural[k];
+    }
+    m_isFactorized = false;
+}
+
+std::unique_ptr<heat::BandedTemporalOperator> heat::BandedTemporalOperator
+:: transpose() const
+{
+    auto opT = std::make_unique<BandedTemporalOperator>(*this);
+    opT->m_isFactorized = false;
+    opT->m_luBand.Destroy();
+    for (int p=0; p<height; p++)
+        for (int q=getFirstCol(p); q<=getLastCol(p); q++) {
+            opT->band(q,p) = band(p,q);
+            opT->m_isStructural[q*(2*m_bandwidth+1) + p-q+m_bandwidth]
+                    = isStructural(p,q);
+        }
+    return opT;
+}
+
+void heat::BandedTemporalOperator
+:: Mult (const Vector& x, Vector& y) const
+{
+    for (int p=0; p<height; p++)
+    {
+        double s = 0;
+        for (int q=getFirstCol(p); q<=getLastCol(p); q++) {
+            s += band(p,q)*x(m_lexToDof[q]);
+        }
+        y(m_lexToDof[p]) = s;
+    }
+}
+
+void heat::BandedTemporalOperator
+:: MultTranspose (const Vector& x, Vector& y) const
+{
+    for (int q=0; q<height; q++)
+    {
+        double s = 0;
+        for (int p=getFirstCol(q); p<=getLastCol(q); p++) {
+            s += band(p,q)*x(m_lexToDof[p]);
+        }
+        y(m_lexToDof[q]) = s;
+    }
+}
+
+void heat::BandedTemporalOperator
+:: factorize()
+{
+    m_luBand = m_band;
+    int w = 2*m_bandwidth+1;
+    auto lu = [this, w](int p, int q) -> double& {
+        return m_luBand[p*w + q-p+m_bandwidth];
+    };
+
+    // pivots below round-off relative to the entries
+    // flag a singular operator
+    double pivotTol = 1E-12*m_band.Normlinf();
+
+    for (int k=0; k<height; k++)
+    {
+        double pivot = lu(k,k);
+        if (std::abs(pivot) <= pivotTol) {
+            throw std::runtime_error("Zero pivot in the banded LU "
+                                     "factorisation of the temporal "
+                                     "operator, which is singular");
+        }
+
+        for (int i=k+1; i<=getLastCol(k); i++)
+        {
+            double l = (lu(i,k) /= pivot);
+            for (int j=k+1; j<=getLastCol(k); j++) {
+                lu(i,j) -= l*lu(k,j);
+            }
+        }
+    }
+    m_isFactorized = true;
+}
+
+void heat::BandedTemporalOperator
+:: solve (const Vector& b, Vector& x) const
+{
+    assert(m_isFactorized);
+    int w = 2*m_bandwidth+1;
+    auto lu = [this, w](int p, int q) {
+        return m_luBand[p*w + q-p+m_bandwidth];
+    };
+
+    // forward substitution, unit lower triangle
+    Vector z(height);
+    for (int p=0; p<height; p++) {
+        double s = b(m_lexToDof[p]);
+        for (int q=getFirstCol(p); q<p; q++) {
+            s -= lu(p,q)*z(q);
+        }
+        z(p) = s;
+    }
+
+    // backward substitution
+    for (int p=height-1; p>=0; p--) {
+        double s = z(p);
+        for (int q=p+1; q<=getLastCol(p); q++) {
+            s -= lu(p,q)*z(q);
+        }
+        z(p) = s/lu(p,p);
+    }
+
+    for (int p=0; p<height; p++) {
+        x(m_lexToDof[p]) = z(p);
+    }
+}
+
+void heat::BandedTemporalOperator
+:: getSortedRow (int p, Array<int>& cols, Array<double>& vals) const
+{
+    cols.SetSize(0);
+    vals.SetSize(0);
+    for (int q=getFirstCol(p); q<=getLastCol(p); q++) {
+        if (isStructural(p,q)) {
+            cols.Append(m_lexToDof[q]);
+            vals.Append(band(p,q));
+        }
+    }
+
+    // insertion sort by FE space dof; rows hold at most 2p+1 entries
+    for (int k=1; k<cols.Size(); k++) {
+        for (int l=k; l>0 && cols[l-1] > cols[l]; l--) {
+            std::swap(cols[l-1], cols[l]);
+            std::swap(vals[l-1], vals[l]);
+        }
+    }
+}
+
+SparseMatrix* heat::BandedTemporalOperator
+:: getSparseMatrix() const
+{
+    SparseMatrix *mat = new SparseMatrix(height, width);
+
+    Array<int> cols;
+    Array<double> vals;
+    for (int p=0; p<height; p++) {
+        getSortedRow(p, cols, vals);
+        for (int k=0; k<cols.Size(); k++) {
+            mat->Set(m_lexToDof[p], cols[k], vals[k]);
+        }
+    }
+    // keeps the structural zeros, as kroneckerProduct
+    mat->Finalize(0);
+
+    return mat;
+}
+
+SparseMatrix* heat::BandedTemporalOperator
+:: kroneckerProduct (const SparseMatrix& spatialMat) const
+{
+    int xdimOut = spatialMat.Height();
+    int xdimIn = spatialMat.Width();
+    const int *xI = spatialMat.GetI();
+    const int *xJ = spatialMat.GetJ();
+    const double *xA = spatialMat.GetData();
+
+    int numRows = height*xdimOut;
+    int numCols = width*xdimIn;
+
+    // row pointers; every row (i,a) holds the non-zeros of
+    // temporal row i times the non-zeros of spatial row a
+    Array<int> tRowSizes(height);
+    Array<int> cols;
+    Array<double> vals;
+    for (int p=0; p<height; p++) {
+        getSortedRow(p, cols, vals);
+        tRowSizes[m_lexToDof[p]] = cols.Size();
+    }
+
+    int *I = new int[numRows+1];
+    I[0] = 0;
+    for (int i=0; i<height; i++)
+        for (int a=0; a<xdimOut; a++) {
+            int r = i*xdimOut + a;
+            I[r+1] = I[r] + tRowSizes[i]*(xI[a+1]-xI[a]);
+        }
+
+    int nnz = I[numRows];
+    int *J = new int[nnz];
+    double *A = new double[nnz];
+
+    #pragma omp parallel for private(cols, vals)
+    for (int p=0; p<height; p++)
+    {
+        getSortedRow(p, cols, vals);
+        int i = m_lexToDof[p];
+        for (int a=0; a<xdimOut; a++)
+        {
+            int pos = I[i*xdimOut + a];
+            for (int k=0; k<cols.Size(); k++)
+                for (int l=xI[a]; l<xI[a+1]; l++) {
+                    J[pos] = cols[k]*xdimIn + xJ[l];
+                    A[pos] = vals[k]*xA[l];
+                    pos++;
+                }
+        }
+    }
+
+    // the matrix owns the arrays
+    return new SparseMatrix(I, J, A, numRows, numCols);
+}
+
+void heat::BandedTemporalOperator
+:: kroneckerMult (const Operator& spatialOp,
+                  const Vector& x, Vector& y) const
+{
+    int xdimIn = spatialOp.Width();
+    int xdimOut = spatialOp.Height();
+
+    // apply the spatial operator to every temporal slice
+    m_buf.SetSize(xdimOut*width);
+    for (int j=0; j<width; j++) {
+        Vector xSlice(const_cast<double*>(x.GetData()) + j*xdimIn, xdimIn);
+        Vector bufSlice(m_buf.GetData() + j*xdimOut, xdimOut);
+        spatialOp.Mult(xSlice, bufSlice);
+    }
+
+    // combine the slices along the band
+    #pragma omp parallel for
+    for (int p=0; p<height; p++)
+    {
+        double *ySlice = y.GetData() + m_lexToDof[p]*xdimOut;
+        std::fill(ySlice, ySlice + xdimOut, 0.);
+        for (int q=getFirstCol(p); q<=getLastCol(p); q++)
+        {
+            double a = band(p,q);
+            if (a == 0.) { continue; }
+
+            const double *bufSlice
+                    = m_buf.GetData() + m_lexToDof[q]*xdimOut;
+            for (int l=0; l<xdimOut; l++) {
+                ySlice[l] += a*bufSlice[l];
+            }
+        }
+    }
+}
+
+
+//------------------------//
+//  Temporal assemblers   //
+//------------------------//
+
+namespace {
+
+enum class TemporalForm { mass, stiffness, gradient };
+
+//! Assembles a temporal form from its reference element matrix;
+//! elements are affine, so only the scaling changes with the element
+std::unique_ptr<heat::BandedTemporalOperator> assembleBandedTemporalForm
+(const FiniteElementSpace& temporalFes, TemporalForm form)
+{
+    auto op = std::make_unique<heat::BandedTemporalOperator>(temporalFes);
+
+    const FiniteElement *fe = temporalFes.GetFE(0);
+    int ndofs = fe->GetDof();
+    Vector shape(ndofs);
+    DenseMatrix dshape(ndofs, 1);
+
+    DenseMatrix refMat(ndofs);
+    refMat = 0.;
+    const IntegrationRule &ir
+            = IntRules.Get(Geometry::SEGMENT, 2*fe->GetOrder());
+    for (int i=0; i<ir.GetNPoints(); i++)
+    {
+        const IntegrationPoint &ip = ir.IntPoint(i);
+        fe->CalcShape(ip, shape);
+        fe->CalcDShape(ip, dshape);
+        for (int k=0; k<ndofs; k++)
+            for (int l=0; l<ndofs; l++) {
+                double val = 0;
+                if (form == TemporalForm::mass) {
+                    val = shape(k)*shape(l);
+                } else if (form == TemporalForm::stiffness) {
+                    val = dshape(k,0)*dshape(l,0);
+                } else {
+                    val = shape(k)*dshape(l,0);
+                }
+                refMat(k,l) += ip.weight*val;
+            }
+    }
+
+    Mesh *mesh = temporalFes.GetMesh();
+    Array<int> vdofs, verts;
+    for (int n=0; n<mesh->GetNE(); n++)
+    {
+        mesh->GetElementVertices(n, verts);
+        double h = mesh->GetVertex(verts[1])[0]
+                - mesh->GetVertex(verts[0])[0];
+
+        double scale = 1.;
+        if (form == TemporalForm::mass) {
+            scale = std::abs(h);
+        } else if (form == TemporalForm::stiffness) {
+            scale = 1./std::abs(h);
+        } else {
+            scale = (h > 0) ? 1. : -1.;
+        }
+
+        temporalFes.GetElementVDofs(n, vdofs);
+        for (int k=0; k<ndofs; k++)
+            for (int l=0; l<ndofs; l++) {
+                op->addElem(vdofs[k], vdofs[l], scale*refMat(k,l));
+            }
+    }
+
+    return op;
+}
+
+}
+
+std::unique_ptr<heat::BandedTemporalOperator>
+heat::assembleBandedTemporalMass (const FiniteElementSpace& temporalFes)
+{
+    return assembleBandedTemporalForm(temporalFes, TemporalForm::mass);
+}
+
+std::unique_ptr<heat::BandedTemporalOperator>
+heat::assembleBandedTemporalStiffness
+(const FiniteElementSpace& temporalFes)
+{
+    return assembleBandedTemporalForm(temporalFes, TemporalForm::stiffness);
+}
+
+std::unique_ptr<heat::BandedTemporalOperator>
+heat::assembleBandedTemporalGradient
+(const FiniteElementSpace& temporalFes)
+{
+    return assembleBandedTemporalForm(temporalFes, TemporalForm::gradient);
+}
+
+std::unique_ptr<heat::BandedTemporalOperator>
+heat::assembleBandedTemporalInitial
+(const FiniteElementSpace& temporalFes)
+{
+    auto op = std::make_unique<BandedTemporalOperator>(temporalFes);
+    op->addElem(0, 0, 1.);
+    return op;
+}
+
+// End of file
@@ -0,0 +1,175 @@
+#ifndef HEAT_TEMPORAL_OPERATORS_HPP
+#define HEAT_TEMPORAL_OPERATORS_HPP
+
+#include "mfem.hpp"
+#include "kronecker_ordering.hpp"
+
+#include <algorithm>
+#include <memory>
+
+
+namespace heat {
+
+/**
+ * @brief Banded matrix for the operators on a 1D temporal FE space.
+ *
+ * The dofs are renumbered lexicographically along the time axis,
+ * in which ordering a degree p discretisation has half-bandwidth p.
+ * Only the 2p+1 diagonals are stored, row by row; the public interface
+ * uses the dof numbering of the temporal FE space.
+ */
+class BandedTemporalOperator : public mfem::Operator
+{
+public:
+    //! Creates a zero operator on the temporal FE space
+    explicit BandedTemporalOperator
+    (const mfem::FiniteElementSpace& temporalFes);
+
+    //! Returns the half-bandwidth
+    int getBandwidth() const {
+        return m_bandwidth;
+    }
+
+    //! Returns the nested dissection tree of the dofs, by recursive
+    //! bisection of the time axis at vertex dofs; the leaves hold
+    //! the interior dofs of the elements
+    DissectionTree getNestedDissectionTree() const;
+
+    //! Returns the nested dissection ordering of the dofs;
+    //! ordering[k] is the FE space dof eliminated k-th
+    mfem::Array<int> getNestedDissectionOrdering() const;
+
+    //! Returns the entry (i,j), indices in FE space numbering
+    double elem (int i, int j) const;
+
+    //! Adds val to the entry (i,j), indices in FE space numbering
+    void addElem (int i, int j, double val);
+
+    //! Adds a * other to this operator
+    void add (const BandedTemporalOperator& other, double a=1.);
+
+    //! Returns the transposed operator
+    std::unique_ptr<BandedTemporalOperator> transpose() const;
+
+    //! Banded matrix-vector product, O(Nt p)
+    void Mult (const mfem::Vector& x, mfem::Vector& y) const override;
+
+    void MultTranspose (const mfem::Vector& x,
+                        mfem::Vector& y) const override;
+
+    //! Computes the banded LU factorisation without pivoting, O(Nt p^2);
+    //! requires an operator whose leading minors are nonsingular, e.g.
+    //! the mass matrix or the stiffness plus the initial-condition term,
+    //! but not the stiffness alone. Throws on a zero pivot.
+    void factorize();
+
+    //! Solves with the LU factors, O(Nt p)
+    void solve (const mfem::Vector& b, mfem::Vector& x) const;
+
+    //! Returns the operator as a SparseMatrix;
+    //! the caller owns the returned matrix
+    mfem::SparseMatrix* getSparseMatrix() const;
+
+    //! Returns the Kronecker product with a spatial matrix,
+    //! built in a single pass with sorted column indices;
+    //! the caller owns the returned matrix
+    mfem::SparseMatrix* kroneckerProduct
+    (const mfem::SparseMatrix& spatialMat) const;
+
+    //! Applies the Kronecker product with a spatial operator,
+    //! with vectors stored as column-major spatial x temporal arrays
+    void kroneckerMult (const mfem::Operator& spatialOp,
+                        const mfem::Vector& x, mfem::Vector& y) const;
+
+private:
+    //! Sets the lexicographic ordering of the dofs
+    void setDofOrdering (const mfem::FiniteElementSpace& temporalFes);
+
+    //! Returns the lexicographic column range of row p
+    inline int getFirstCol(int p) const {
+        return std::max(0, p-m_bandwidth);
+    }
+    inline int getLastCol(int p) const {
+        return std::min(height-1, p+m_bandwidth);
+    }
+
+    //! Returns a reference to the entry (p,q),
+    //! indices in lexicographic numbering
+    inline double& band(int p, int q) {
+        return m_band[p*(2*m_bandwidth+1) + q-p+m_bandwidth];
+    }
+    inline double band(int p, int q) const {
+        return m_band[p*(2*m_bandwidth+1) + q-p+m_bandwidth];
+    }
+
+    inline bool isStructural(int p, int q) const {
+        return m_isStructural[p*(2*m_bandwidth+1) + q-p+m_bandwidth];
+    }
+
+    //! Returns the sorted structurally non-zero FE space columns of row p
+    void getSortedRow (int p, mfem::Array<int>& cols,
+                       mfem::Array<double>& vals) const;
+
+private:
+    int m_bandwidth;
+
+    //! m_lexToDof[p] is the FE space dof at lexicographic position p
+    mfem::Array<int> m_lexToDof, m_dofToLex;
+
+    mfem::Vector m_band;
+
+    //! flags the entries set by the assembly; the band also
+    //! covers dofs of different elements, which never couple
+    mfem::Array<bool> m_isStructural;
+
+    bool m_isFactorized = false;
+    mfem::Vector m_luBand;
+
+    mutable mfem::Vector m_buf;
+};
+
+
+//! Assembles the temporal mass matrix; (u, v)
+std::unique_ptr<BandedTemporalOperator> assembleBandedTemporalMass
+(const mfem::FiniteElementSpace& temporalFes);
+
+//! Assembles the temporal stiffness matrix; (du/dt, dv/dt)
+std::unique_ptr<BandedTemporalOperator> assembleBandedTemporalStiffness
+(const mfem::FiniteElementSpace& temporalFes);
+
+//! Assembles the temporal gradient matrix; (du/dt, v),
+//! rows indexed by v
+std::unique_ptr<BandedTemporalOperator> assembleBandedTemporalGradient
+(const mfem::FiniteElementSpace& temporalFes);
+
+//! Assembles the temporal initial matrix; u(0) v(0)
+std::unique_ptr<BandedTemporalOperator> assembleBandedTemporalInitial
+(const mfem::FiniteElementSpace& temporalFes);
+
+
+/**
+ * @brief Matrix-free Kronecker product of a banded temporal operator
+ * and a spatial operator
+ */
+class BandedKroneckerOperator : public mfem::Operator
+{
+public:
+    BandedKroneckerOperator (const BandedTemporalOperator& temporalOp,
+                             const mfem::Operator& spatialOp)
+        : mfem::Operator (temporalOp.Height()*spatialOp.Height(),
+                          temporalOp.Width()*spatialOp.Width()),
+          m_temporalOp (temporalOp),
+          m_spatialOp (spatialOp) {}
+
+    void Mult (const mfem::Vector& x, mfem::Vector& y) const override {
+        m_temporalOp.kroneckerMult(m_spatialOp, x, y);
+    }
+
+private:
+    const BandedTemporalOperator& m_temporalOp;
+    const mfem::Operator& m_spatialOp;
+};
+
+}
+
+#endif // HEAT_TEMPORAL_OPERATORS_HPP
@@ -25,4 +25,105 @@ void buildSolutionAtSpecifiedTime(const Vector& spaceTimeSolution,
     }
 }
 
+// The spatial solutions are the product of the spatial x temporal
+// block of the element with the temporal shapes. The block is read
+// in-place when the temporal dofs are consecutive.
+void buildSolutionsAtSpecifiedTimes(const Vector& spaceTimeSolution,
+                                    const DenseMatrix& temporalShapes,
+                                    const Array<int>& temporalVdofs,
+                                    DenseMatrix& spatialSolutions)
+{
+    int temporalNumDofs = temporalShapes.Height();
+    int spatialNumDofs = spatialSolutions.Height();
+    spatialSolutions.SetSize(spatialNumDofs, temporalShapes.Width());
+
+    bool isConsecutive = true;
+    for (int j=1; j<temporalNumDofs; j++) {
+        isConsecutive = isConsecutive
+                && (temporalVdofs[j] == temporalVdofs[0] + j);
+    }
+
+    DenseMatrix spaceTimeBlock;
+    if (isConsecutive) {
+        spaceTimeBlock.UseExternalData
+                (const_cast<double*>(spaceTimeSolution.GetData())
+                 + temporalVdofs[0]*spatialNumDofs,
+                 spatialNumDofs, temporalNumDofs);
+    }
+    else {
+        spaceTimeBlock.SetSize(spatialNumDofs, temporalNumDofs);
+        for (int j=0; j<temporalNumDofs; j++)
+        {
+            int shift = temporalVdofs[j]*spatialNumDofs;
+            double *col = spaceTimeBlock.GetColumn(j);
+            for (int k=0; k<spatialNumDofs; k++) {
+                col[k] = spaceTimeSolution(k + shift);
+            }
+        }
+    }
+
+    // BLAS-3 if MFEM is built with LAPACK
+    Mult(spaceTimeBlock, temporalShapes, spatialSolutions);
+}
+
+
+TemporalShapeTable
+:: TemporalShapeTable (FiniteElementSpace *temporalFes, int order)
+    : m_temporalFes (temporalFes)
+{
+    const FiniteElement *fe = m_temporalFes->GetFE(0);
+    m_ir = &IntRules.Get(fe->GetGeomType(), order);
+
+    int ndofs = fe->GetDof();
+    int nq = m_ir->GetNPoints();
+    m_shapes.SetSize(ndofs, nq);
+    m_referenceGradients.SetSize(ndofs, nq);
+
+    Vector shape;
+    for (int i=0; i<nq; i++)
+    {
+        const IntegrationPoint &ip = m_ir->IntPoint(i);
+        m_shapes.GetColumnReference(i, shape);
+        fe->CalcShape(ip, shape);
+        DenseMatrix dshape(m_referenceGradients.GetColumn(i), ndofs, 1);
+        fe->CalcDShape(ip, dshape);
+    }
+}
+
+void TemporalShapeTable
+:: evalOnElement (int n, DenseMatrix& shapesAndGradients,
+                  Vector& times, Vector& weights) const
+{
+    assert(m_temporalFes->GetFE(n)->GetDof() == m_shapes.Height());
+
+    int ndofs = m_shapes.Height();
+    int nq = m_ir->GetNPoints();
+    shapesAndGradients.SetSize(ndofs, 2*nq);
+    times.SetSize(nq);
+    weights.SetSize(nq);
+
+    // the temporal elements are affine
+    ElementTransformation *trans
+            = m_temporalFes->GetElementTransformation(n);
+    trans->SetIntPoint(&m_ir->IntPoint(0));
+    double jacobian = trans->Jacobian()(0,0);
+
+    Vector t;
+    for (int i=0; i<nq; i++)
+    {
+        const IntegrationPoint &ip = m_ir->IntPoint(i);
+        trans->SetIntPoint(&ip);
+        trans->Transform(ip, t);
+        times(i) = t(0);
+        weights(i) = ip.weight*trans->Weight();
+
+        for (int a=0; a<ndofs; a++)
+        {
+            shapesAndGradients(a, i) = m_shapes(a, i);
+            shapesAndGradients(a, nq + i)
+                    = m_referenceGradients(a, i)/jacobian;
+        }
+    }
+}
+
 // End of file
@@ -16,5 +16,64 @@ void buildSolutionAtSpecifiedTime(const mfem::Vector& uXtSol,
                  mfem::Array<int> tVdofs,
                  mfem::Vector& uSol);
 
+/**
+ * @brief Builds the solutions at several times in a space-time element
+ * with one dense matrix-matrix multiplication
+ * @param uXtSol coefficients of the discrete space-time solution,
+ * column-major spatial x temporal
+ * @param tShapes FE shape vectors in temporal dimension, one column per time
+ * @param tVdofs Indices of the dofs in temporal dimension
+ * @param uSols coefficients of the discrete spatial solutions,
+ * one column per time; the height is the spatial size and is preset
+ */
+void buildSolutionsAtSpecifiedTimes(const mfem::Vector& uXtSol,
+                                    const mfem::DenseMatrix& tShapes,
+                                    const mfem::Array<int>& tVdofs,
+                                    mfem::DenseMatrix& uSols);
+
+
+/**
+ * @brief Temporal shape functions and their gradients
+ * tabulated at the quadrature points of a temporal FE space
+ *
+ * The temporal mesh is one-dimensional and all its elements
+ * share the same finite element, so the reference shapes are
+ * evaluated once; on an element, the gradients are only scaled.
+ */
+class TemporalShapeTable
+{
+public:
+    //! Constructor with the temporal FE space
+    //! and the order of the quadrature rule
+    TemporalShapeTable (mfem::FiniteElementSpace *temporalFes, int order);
+
+    int getNumPoints() const {
+        return m_ir->GetNPoints();
+    }
+
+    //! Returns the shape values, one column per quadrature point
+    const mfem::DenseMatrix& getShapes() const {
+        return m_shapes;
+    }
+
+    /**
+     * @brief Evaluates the tabulated data on a temporal element
+     * @param n temporal element id
+     * @param shapesAndGradients shape values in the first
+     * getNumPoints() columns, and gradients in the next ones
+     * @param times quadrature points in time
+     * @param weights quadrature weights, scaled by the element size
+     */
+    void evalOnElement (int n, mfem::DenseMatrix& shapesAndGradients,
+                        mfem::Vector& times, mfem::Vector& weights) const;
+
+private:
+    mfem::FiniteElementSpace *m_temporalFes;
+    const mfem::IntegrationRule *m_ir;
+
+    mfem::DenseMatrix m_shapes;
+    mfem::DenseMatrix m_referenceGradients;
+};
+
 
 #endif // HEAT_UTILITIES_HPP
@@ -7,6 +7,7 @@ using namespace mfem;
 
 mymfem::BaseObserver
 :: BaseObserver (const nlohmann::json& config)
+    : BaseObserver ()
 {
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "visualization",
                                         m_boolVisualize, false);
@@ -60,10 +61,15 @@ void mymfem::BaseObserver
                 = m_outputDir+"mesh"+m_meshNameSuffix;
         std::cout << meshName << std::endl;
 
-        std::ofstream meshOfs(meshName.c_str());
-        meshOfs.precision(m_precision);
-        mesh->Print(meshOfs);
-        meshOfs.close();
+        // the mesh is shared, and not modified after its construction
+        std::shared_ptr<const Mesh> meshSnapshot = mesh;
+        int precision = m_precision;
+        m_outputService->writeFile(meshName,
+                                   [meshSnapshot, precision]
+                                   (std::ostream& meshOfs) {
+            meshOfs.precision(precision);
+            meshSnapshot->Print(meshOfs);
+        });
     }
 }
 
@@ -4,6 +4,9 @@
 #include "mfem.hpp"
 
 #include "../core/config.hpp"
+#include "../core/output_service.hpp"
+
+#include <memory>
 
 
 namespace mymfem {
@@ -17,7 +20,8 @@ public:
     /**
      * @brief Default constructor.
      */
-    BaseObserver () {}
+    BaseObserver ()
+        : m_outputService (std::make_shared<OutputService>(0)) {}
 
     /**
      * @brief Custom constructor.
@@ -67,8 +71,20 @@ public:
      * @param mesh Mesh passed as a shared pointer.
      */
     void dumpMesh (std::shared_ptr<mfem::Mesh>&) const;
-    
+
+    /**
+     * @brief Sets the service that writes the output files;
+     * by default, files are written synchronously.
+     * @param outputService output service, shared with other writers.
+     */
+    void setOutputService (std::shared_ptr<OutputService> outputService) {
+        m_outputService = std::move(outputService);
+    }
+
 protected:
+    //! Writes output files, possibly in the background.
+    std::shared_ptr<OutputService> m_outputService;
+
     //! Numerical precision of output data.
     int m_precision = 8;
 
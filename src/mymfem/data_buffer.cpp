@@ -0,0 +1,228 @@
+#include "data_buffer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace mfem;
+
+
+namespace {
+
+constexpr std::size_t cacheLineSize = 64;
+constexpr std::size_t hugePageSize = 2 << 20;
+
+std::size_t roundUp (std::size_t n, std::size_t m) {
+    return ((n + m - 1)/m)*m;
+}
+
+#ifdef __linux__
+//! Reads the online NUMA nodes, e.g. "0-1,3", as a bit mask
+std::vector<unsigned long> readOnlineNumaNodes ()
+{
+    std::vector<unsigned long> mask;
+    std::ifstream file("/sys/devices/system/node/online");
+    std::string line;
+    if (!file || !std::getline(file, line)) {
+        return mask;
+    }
+
+    const int bitsPerWord = 8*sizeof(unsigned long);
+    auto setNode = [&](int node) {
+        std::size_t word = static_cast<std::size_t>(node/bitsPerWord);
+        if (mask.size() <= word) {
+            mask.resize(word+1, 0);
+        }
+        mask[word] |= 1UL << (node%bitsPerWord);
+    };
+
+    std::size_t pos = 0;
+    while (pos < line.size())
+    {
+        std::size_t end = line.find(',', pos);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        std::string range = line.substr(pos, end-pos);
+        std::size_t dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = (dash == std::string::npos) ?
+                    first : std::atoi(range.c_str()+dash+1);
+        for (int node=first; node<=last; node++) {
+            setNode(node);
+        }
+        pos = end+1;
+    }
+    return mask;
+}
+#endif
+
+}
+
+
+mymfem::MemoryPolicy mymfem
+:: parseMemoryPolicy(const std::string& policy)
+{
+    if (policy == "standard") {
+        return MemoryPolicy::standard;
+    }
+    else if (policy == "aligned") {
+        return MemoryPolicy::aligned;
+    }
+    else if (policy == "huge_pages") {
+        return MemoryPolicy::hugePages;
+    }
+    else if (policy == "numa_interleaved") {
+        return MemoryPolicy::numaInterleaved;
+    }
+    throw std::runtime_error("Unknown memory policy: "+policy);
+}
+
+
+mymfem::DataBuffer
+:: DataBuffer (std::size_t size, MemoryPolicy policy)
+    : m_size (size), m_policy (policy)
+{
+    if (m_policy == MemoryPolicy::standard) {
+        m_data = new double[std::max<std::size_t>(m_size, 1)]();
+        return;
+    }
+
+    if (m_policy == MemoryPolicy::hugePages
+            || m_policy == MemoryPolicy::numaInterleaved)
+    {
+        if (map(m_policy)) {
+            return;
+        }
+        m_policy = MemoryPolicy::aligned;
+    }
+    allocateAligned();
+}
+
+mymfem::DataBuffer
+:: ~DataBuffer ()
+{
+    if (m_isMapped) {
+#ifdef __linux__
+        munmap(m_data, m_numBytes);
+#endif
+    }
+    else if (m_policy == MemoryPolicy::standard) {
+        delete[] m_data;
+    }
+    else {
+        std::free(m_data);
+    }
+}
+
+void mymfem::DataBuffer
+:: allocateAligned ()
+{
+    m_numBytes = roundUp(std::max<std::size_t>(m_size, 1)*sizeof(double),
+                         cacheLineSize);
+    m_data = static_cast<double*>
+            (std::aligned_alloc(cacheLineSize, m_numBytes));
+    if (!m_data) {
+        throw std::bad_alloc();
+    }
+
+    // first touch by the threads that will work on the data
+    long long size = static_cast<long long>(m_size);
+    #pragma omp parallel for schedule(static)
+    for (long long i=0; i<size; i++) {
+        m_data[i] = 0.;
+    }
+}
+
+bool mymfem::DataBuffer
+:: map (MemoryPolicy policy)
+{
+#ifdef __linux__
+    std::size_t alignment = (policy == MemoryPolicy::hugePages) ?
+                hugePageSize : static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    m_numBytes = roundUp(std::max<std::size_t>(m_size, 1)*sizeof(double),
+                         alignment);
+
+    // transparent huge pages only back 2 MB aligned ranges;
+    // the mapping is over-allocated by a huge page and trimmed
+    std::size_t mappedBytes = m_numBytes;
+    if (policy == MemoryPolicy::hugePages) {
+        mappedBytes += alignment;
+    }
+    void *ptr = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    if (policy == MemoryPolicy::hugePages)
+    {
+        auto start = reinterpret_cast<std::uintptr_t>(ptr);
+        auto alignedStart = roundUp(start, alignment);
+        std::size_t head = alignedStart - start;
+        std::size_t tail = mappedBytes - head - m_numBytes;
+        if (head > 0) {
+            munmap(ptr, head);
+        }
+        if (tail > 0) {
+            munmap(reinterpret_cast<char*>(alignedStart) + m_numBytes, tail);
+        }
+        ptr = reinterpret_cast<void*>(alignedStart);
+    }
+
+    bool success = true;
+    if (policy == MemoryPolicy::hugePages) {
+#ifdef MADV_HUGEPAGE
+        success = (madvise(ptr, m_numBytes, MADV_HUGEPAGE) == 0);
+#else
+        success = false;
+#endif
+    }
+    else
+    {
+        // the policy applies to the pages faulted in later
+        const int mpolInterleave = 3;
+        auto nodes = readOnlineNumaNodes();
+        success = !nodes.empty()
+                && syscall(SYS_mbind, ptr, m_numBytes, mpolInterleave,
+                           nodes.data(), 8*sizeof(unsigned long)*nodes.size()+1,
+                           0) == 0;
+    }
+
+    if (!success) {
+        munmap(ptr, m_numBytes);
+        return false;
+    }
+
+    // anonymous mappings are zero-initialised
+    m_data = static_cast<double*>(ptr);
+    m_isMapped = true;
+    return true;
+#else
+    (void) policy;
+    return false;
+#endif
+}
+
+
+std::shared_ptr<BlockVector> mymfem
+:: makeBlockVector(const Array<int>& blockOffsets, MemoryPolicy policy)
+{
+    auto buffer = std::make_shared<DataBuffer>
+            (static_cast<std::size_t>(blockOffsets.Last()), policy);
+
+    // the deleter keeps the buffer alive
+    return std::shared_ptr<BlockVector>
+            (new BlockVector(buffer->getData(), blockOffsets),
+             [buffer](BlockVector *v) { delete v; });
+}
+
+// End of file
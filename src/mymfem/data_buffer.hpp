@@ -0,0 +1,81 @@
+#ifndef MYMFEM_DATA_BUFFER_HPP
+#define MYMFEM_DATA_BUFFER_HPP
+
+#include "mfem.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+
+namespace mymfem {
+
+/**
+ * @brief Allocation policies for large solution vectors
+ *
+ * aligned: 64-byte aligned, initialised in parallel (first touch).
+ * hugePages: anonymous mapping aligned to 2 MB, with transparent
+ * huge pages advised; the kernel may still back it with small pages.
+ * numaInterleaved: anonymous mapping with the pages interleaved
+ * over the online NUMA nodes.
+ * The mapped policies fall back to aligned when not supported.
+ */
+enum class MemoryPolicy {standard, aligned, hugePages, numaInterleaved};
+
+//! Parses "standard", "aligned", "huge_pages" or "numa_interleaved"
+MemoryPolicy parseMemoryPolicy(const std::string& policy);
+
+
+/**
+ * @brief Zero-initialised buffer of doubles,
+ * allocated with a memory policy
+ */
+class DataBuffer
+{
+public:
+    DataBuffer (std::size_t size, MemoryPolicy policy);
+
+    ~DataBuffer ();
+
+    DataBuffer (const DataBuffer&) = delete;
+    DataBuffer& operator= (const DataBuffer&) = delete;
+
+    double* getData() const {
+        return m_data;
+    }
+
+    std::size_t getSize() const {
+        return m_size;
+    }
+
+    //! Returns the policy in effect, after any fallback
+    MemoryPolicy getPolicy() const {
+        return m_policy;
+    }
+
+private:
+    //! Maps anonymous memory; returns false on failure
+    bool map (MemoryPolicy policy);
+
+    void allocateAligned ();
+
+private:
+    double *m_data = nullptr;
+    std::size_t m_size;
+    std::size_t m_numBytes = 0;
+    bool m_isMapped = false;
+    MemoryPolicy m_policy;
+};
+
+
+/**
+ * @brief Builds a zero-initialised block vector
+ * whose data is allocated with a memory policy;
+ * the data lives as long as the block vector
+ */
+std::shared_ptr<mfem::BlockVector> makeBlockVector
+(const mfem::Array<int>& blockOffsets, MemoryPolicy policy);
+
+}
+
+#endif // MYMFEM_DATA_BUFFER_HPP
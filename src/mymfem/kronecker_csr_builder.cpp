@@ -0,0 +1,176 @@
+#include "kronecker_csr_builder.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+using namespace mfem;
+
+
+mymfem::KroneckerCsrBuilder
+:: KroneckerCsrBuilder (int numRows, int numCols)
+    : m_numRows (numRows),
+      m_numCols (numCols)
+{}
+
+void mymfem::KroneckerCsrBuilder
+:: addTerm (const KroneckerTerm& term)
+{
+    assert(term.rowOffset + term.temporal->Height()
+           *term.spatial->Height() <= m_numRows);
+    assert(term.colOffset + term.temporal->Width()
+           *term.spatial->Width() <= m_numCols);
+    m_terms.push_back(term);
+}
+
+std::vector<mymfem::KroneckerCsrBuilder::RowBlock>
+mymfem::KroneckerCsrBuilder
+:: evalRowBlocks () const
+{
+    std::vector<int> breaks{0, m_numRows};
+    for (const auto& term : m_terms) {
+        breaks.push_back(term.rowOffset);
+        breaks.push_back(term.rowOffset
+                         + term.temporal->Height()*term.spatial->Height());
+    }
+    std::sort(breaks.begin(), breaks.end());
+    breaks.erase(std::unique(breaks.begin(), breaks.end()), breaks.end());
+
+    std::vector<RowBlock> rowBlocks;
+    for (size_t k=0; k+1<breaks.size(); k++)
+    {
+        RowBlock rowBlock{breaks[k], breaks[k+1], {}};
+        for (int n=0; n<static_cast<int>(m_terms.size()); n++) {
+            const KroneckerTerm& term = m_terms[n];
+            int termEnd = term.rowOffset
+                    + term.temporal->Height()*term.spatial->Height();
+            if (term.rowOffset <= rowBlock.begin
+                    && rowBlock.end <= termEnd) {
+                rowBlock.termIds.push_back(n);
+            }
+        }
+        rowBlocks.push_back(std::move(rowBlock));
+    }
+    return rowBlocks;
+}
+
+template <typename Visitor>
+void mymfem::KroneckerCsrBuilder
+:: visitRow (const RowBlock& rowBlock, int row, Visitor& visit) const
+{
+    for (int termId : rowBlock.termIds)
+    {
+        const KroneckerTerm& term = m_terms[termId];
+        const SparseMatrix& T = *term.temporal;
+        const SparseMatrix& X = *term.spatial;
+
+        int nxOut = X.Height();
+        int nxIn = X.Width();
+        int t = (row - term.rowOffset) / nxOut;
+        int a = (row - term.rowOffset) % nxOut;
+
+        const int *tI = T.GetI(), *tJ = T.GetJ();
+        const int *xI = X.GetI(), *xJ = X.GetJ();
+        const double *tA = T.GetData(), *xA = X.GetData();
+        for (int k=tI[t]; k<tI[t+1]; k++)
+        {
+            int colShift = term.colOffset + tJ[k]*nxIn;
+            double val = term.coeff*tA[k];
+            for (int l=xI[a]; l<xI[a+1]; l++) {
+                visit(colShift + xJ[l], val*xA[l]);
+            }
+        }
+    }
+}
+
+SparseMatrix* mymfem::KroneckerCsrBuilder
+:: build (bool upperTriangle) const
+{
+    auto rowBlocks = evalRowBlocks();
+
+    int *I = new int[m_numRows+1];
+    I[0] = 0;
+
+    // symbolic pass; exact row lengths
+    #pragma omp parallel
+    {
+        Array<int> colMarker(m_numCols);
+        colMarker = -1;
+
+        for (const auto& rowBlock : rowBlocks)
+        {
+            #pragma omp for schedule(dynamic, 64)
+            for (int row=rowBlock.begin; row<rowBlock.end; row++)
+            {
+                int count = 0;
+                auto countCol = [&](int col, double) {
+                    if (upperTriangle && col < row) { return; }
+                    if (colMarker[col] != row) {
+                        colMarker[col] = row;
+                        count++;
+                    }
+                };
+                visitRow(rowBlock, row, countCol);
+                I[row+1] = count;
+            }
+        }
+    }
+    for (int r=0; r<m_numRows; r++) {
+        I[r+1] += I[r];
+    }
+
+    int nnz = I[m_numRows];
+    int *J = new int[nnz];
+    double *A = new double[nnz];
+
+    // numeric pass; collect, sort and accumulate
+    #pragma omp parallel
+    {
+        Array<int> colPos(m_numCols);
+        colPos = -1;
+
+        for (const auto& rowBlock : rowBlocks)
+        {
+            #pragma omp for schedule(dynamic, 64)
+            for (int row=rowBlock.begin; row<rowBlock.end; row++)
+            {
+                int *rowJ = J + I[row];
+                double *rowA = A + I[row];
+                int rowSize = I[row+1] - I[row];
+
+                int count = 0;
+                auto collect = [&](int col, double) {
+                    if (upperTriangle && col < row) { return; }
+                    if (colPos[col] < 0) {
+                        colPos[col] = count;
+                        rowJ[count++] = col;
+                    }
+                };
+                visitRow(rowBlock, row, collect);
+                assert(count == rowSize);
+
+                std::sort(rowJ, rowJ + rowSize);
+                for (int k=0; k<rowSize; k++) {
+                    colPos[rowJ[k]] = k;
+                    rowA[k] = 0.;
+                }
+
+                // values are summed in term order,
+                // independent of the number of threads
+                auto accumulate = [&](int col, double val) {
+                    if (upperTriangle && col < row) { return; }
+                    rowA[colPos[col]] += val;
+                };
+                visitRow(rowBlock, row, accumulate);
+
+                for (int k=0; k<rowSize; k++) {
+                    colPos[rowJ[k]] = -1;
+                }
+            }
+        }
+    }
+
+    // the matrix owns the arrays
+    return new SparseMatrix(I, J, A, m_numRows, m_numCols);
+}
+
+// End of file
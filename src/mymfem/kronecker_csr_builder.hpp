@@ -0,0 +1,76 @@
+#ifndef MYMFEM_KRONECKER_CSR_BUILDER_HPP
+#define MYMFEM_KRONECKER_CSR_BUILDER_HPP
+
+#include "mfem.hpp"
+
+#include <vector>
+
+
+namespace mymfem {
+
+/**
+ * @brief Term coeff * (temporal \otimes spatial), placed at the
+ * given row and column offsets of the assembled matrix;
+ * the Kronecker layout is spatial index fastest
+ */
+struct KroneckerTerm
+{
+    double coeff = 1.;
+    const mfem::SparseMatrix *temporal = nullptr;
+    const mfem::SparseMatrix *spatial = nullptr;
+    int rowOffset = 0;
+    int colOffset = 0;
+};
+
+
+/**
+ * @brief Assembles a sum of Kronecker terms directly into
+ * one CSR matrix with sorted column indices.
+ *
+ * A symbolic pass evaluates the exact row lengths, a numeric pass
+ * writes the merged rows; both are threaded over the rows of each
+ * row block. Only the upper triangle can be kept, for symmetric
+ * solvers. The input matrices are not owned.
+ */
+class KroneckerCsrBuilder
+{
+public:
+    KroneckerCsrBuilder (int numRows, int numCols);
+
+    //! Adds a term; overlapping terms are summed
+    void addTerm (const KroneckerTerm& term);
+
+    void addTerm (double coeff,
+                  const mfem::SparseMatrix& temporal,
+                  const mfem::SparseMatrix& spatial,
+                  int rowOffset=0, int colOffset=0) {
+        addTerm({coeff, &temporal, &spatial, rowOffset, colOffset});
+    }
+
+    //! Builds the matrix; the caller owns the returned matrix
+    mfem::SparseMatrix* build (bool upperTriangle=false) const;
+
+private:
+    //! Row range covered by the same set of terms
+    struct RowBlock
+    {
+        int begin, end;
+        std::vector<int> termIds;
+    };
+
+    //! Splits the rows into blocks at the term row offsets
+    std::vector<RowBlock> evalRowBlocks () const;
+
+    //! Visits the columns and values of a row in a row block
+    template <typename Visitor>
+    void visitRow (const RowBlock& rowBlock, int row,
+                   Visitor& visit) const;
+
+private:
+    int m_numRows, m_numCols;
+    std::vector<KroneckerTerm> m_terms;
+};
+
+}
+
+#endif // MYMFEM_KRONECKER_CSR_BUILDER_HPP
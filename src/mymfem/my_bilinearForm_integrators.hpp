@@ -5,6 +5,8 @@
 
 #include <fmt/format.h>
 
+#include "nested_hierarchy.hpp"
+
 
 namespace mymfem {
 
@@ -28,12 +30,15 @@ public:
     //! Assembles the integrator
     //! over two nested coarse and fine mesh elements.
     //! Coarse element is for the trial functions
-    //! and fine element is for the test function
+    //! and fine element is for the test function;
+    //! fineToCoarse maps the fine reference element
+    //! into the coarse reference element
     virtual void assembleElementMatrix
     (const mfem::FiniteElement &testFeFine,
      mfem::ElementTransformation& testElTransFine,
      const mfem::FiniteElement &trialFeCoarse,
      mfem::ElementTransformation& trialElTransCoarse,
+     const ChildInAncestorMap& fineToCoarse,
      mfem::DenseMatrix& elmat) = 0;
 };
 
@@ -58,12 +63,15 @@ public:
     //! Assembles the integrator
     //! over two nested coarse and fine mesh elements.
     //! Coarse element is for the trial functions
-    //! and fine element is for the test function
+    //! and fine element is for the test function;
+    //! fineToCoarse maps the fine reference element
+    //! into the coarse reference element
     virtual void assembleElementMatrix
     (const mfem::FiniteElement &testFeFine,
      mfem::ElementTransformation& testElTransFine,
      const mfem::FiniteElement &trialFeCoarse,
      mfem::ElementTransformation& trialElTransCoarse,
+     const ChildInAncestorMap& fineToCoarse,
      mfem::DenseMatrix& elmat) = 0;
 
     //! Assembles the integrator
@@ -75,6 +83,7 @@ public:
      mfem::ElementTransformation& testElTransCoarse,
      const mfem::FiniteElement &trialFeFine,
      mfem::ElementTransformation& trialElTransFine,
+     const ChildInAncestorMap& fineToCoarse,
      mfem::DenseMatrix& elmat) = 0;
 };
 
@@ -1,9 +1,300 @@
 #include "my_bilinearForms.hpp"
 #include "utilities.hpp"
 
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace mfem;
 
 
+std::vector<mymfem::LevelPairBlock> mymfem
+:: buildLevelPairBlocks
+(const std::shared_ptr<NestedFEHierarchy>& nestedFEHierarchy,
+ BlockMatrix& blockMatrix, bool withLowerBlocks, bool withUpperBlocks)
+{
+    int numLevels = nestedFEHierarchy->getNumLevels();
+    auto feSpaces = nestedFEHierarchy->getFESpaces();
+    auto meshHierarchy = nestedFEHierarchy->getNestedMeshHierarchy();
+
+    std::vector<LevelPairBlock> blocks;
+
+    // diagonal blocks
+    for (int n=0; n<numLevels; n++)
+    {
+        LevelPairBlock block{n, n, LevelPairBlock::diagonal,
+                    &blockMatrix.GetBlock(n,n), {}};
+        int numEls = feSpaces[n]->GetNE();
+        block.elementPairs.reserve(numEls);
+        for (int i=0; i<numEls; i++) {
+            block.elementPairs.push_back({i, i});
+        }
+        blocks.push_back(std::move(block));
+    }
+
+    if (!withLowerBlocks) {
+        return blocks;
+    }
+
+    // lower-triangular blocks, and upper-triangular blocks
+    // with the same coarse-fine element pairs
+    for (int m=1; m<numLevels; m++)
+    {
+        for (int n=m-1; n>=0; n--)
+        {
+            // hierarchical mesh transformations
+            // across non-successive mesh levels are memoized
+            auto hierMultiLevelMeshTrans
+                    = meshHierarchy->getTransformation(n, m);
+
+            LevelPairBlock lower{m, n, LevelPairBlock::fineTestCoarseTrial,
+                        &blockMatrix.GetBlock(m,n), {}};
+            for (int i=0; i < feSpaces[n]->GetNE(); i++) {
+                for (int j : (*hierMultiLevelMeshTrans)(i)) {
+                    lower.elementPairs.push_back({j, i});
+                }
+            }
+
+            if (withUpperBlocks)
+            {
+                LevelPairBlock upper{n, m,
+                            LevelPairBlock::coarseTestFineTrial,
+                            &blockMatrix.GetBlock(n,m), {}};
+                upper.elementPairs.reserve(lower.elementPairs.size());
+                for (const auto& pair : lower.elementPairs) {
+                    upper.elementPairs.push_back({pair.trialElId,
+                                                  pair.testElId});
+                }
+                blocks.push_back(std::move(lower));
+                blocks.push_back(std::move(upper));
+            }
+            else {
+                blocks.push_back(std::move(lower));
+            }
+        }
+    }
+
+    return blocks;
+}
+
+// Every round takes the next chunk of element pairs of every block.
+// The element matrices of a round are computed concurrently;
+// then every block adds its element matrices to its own matrix,
+// one thread per block, in the element order of the serial loop.
+// The sums are thus bitwise independent of the number of threads.
+void mymfem
+:: assembleLevelPairBlocks (std::vector<LevelPairBlock>& blocks,
+                            const NestedFESpaces& testFeSpaces,
+                            const NestedFESpaces& trialFeSpaces,
+                            const NestedMeshHierarchy& meshHierarchy,
+                            int numIntegrators,
+                            const ElementPairIntegrator& integrate,
+                            int skip_zeros)
+{
+    int numThreads = 1;
+#ifdef _OPENMP
+    numThreads = omp_get_max_threads();
+#endif
+    const int chunkSize = 64*numThreads;
+
+    // curved meshes evaluate their transformations with the shared
+    // nodal FE space, whose elements are not thread-safe
+    bool threaded = true;
+    for (const auto& fes : testFeSpaces) {
+        threaded = threaded && !fes->GetMesh()->GetNodes();
+    }
+
+    // MFEM basis evaluation uses scratch buffers stored in the
+    // FiniteElement objects, so every thread draws its
+    // elements from a private copy of the FE collections
+    struct Workspace
+    {
+        std::unique_ptr<FiniteElementCollection> testFec, trialFec;
+        IsoparametricTransformation testElTrans, trialElTrans;
+        ElementPairData data;
+    };
+    auto makeWorkspace = [&]()
+    {
+        auto ws = std::make_unique<Workspace>();
+        ws->testFec.reset(FiniteElementCollection::New
+                          (testFeSpaces[0]->FEColl()->Name()));
+        ws->trialFec.reset(FiniteElementCollection::New
+                           (trialFeSpaces[0]->FEColl()->Name()));
+        return ws;
+    };
+
+    auto setElementPair = [&](const LevelPairBlock& block,
+            const ElementPair& pair, Workspace& ws)
+    {
+        ElementPairData& data = ws.data;
+        Mesh *testMesh = testFeSpaces[block.testLevel]->GetMesh();
+        Mesh *trialMesh = trialFeSpaces[block.trialLevel]->GetMesh();
+
+        testMesh->GetElementTransformation(pair.testElId, &ws.testElTrans);
+        data.testFe = ws.testFec->FiniteElementForGeometry
+                (testMesh->GetElementBaseGeometry(pair.testElId));
+        data.testElTrans = &ws.testElTrans;
+        data.trialFe = ws.trialFec->FiniteElementForGeometry
+                (trialMesh->GetElementBaseGeometry(pair.trialElId));
+
+        if (block.kind == LevelPairBlock::diagonal) {
+            data.trialElTrans = &ws.testElTrans;
+        }
+        else
+        {
+            trialMesh->GetElementTransformation(pair.trialElId,
+                                                &ws.trialElTrans);
+            data.trialElTrans = &ws.trialElTrans;
+            if (block.kind == LevelPairBlock::fineTestCoarseTrial) {
+                data.fineToCoarse
+                        = meshHierarchy.getChildInAncestorMap
+                        (block.testLevel, pair.testElId,
+                         block.trialLevel);
+            } else {
+                data.fineToCoarse
+                        = meshHierarchy.getChildInAncestorMap
+                        (block.trialLevel, pair.trialElId,
+                         block.testLevel);
+            }
+        }
+    };
+
+    // MFEM creates the integration rules lazily, which is not
+    // thread-safe; an element pair of every block kind and geometry
+    // is computed alone first, and its element matrices discarded
+    if (threaded)
+    {
+        auto ws = makeWorkspace();
+        DenseMatrix elmat;
+        std::set<std::tuple<int, int, int>> done;
+        for (const auto& block : blocks)
+        {
+            Mesh *testMesh = testFeSpaces[block.testLevel]->GetMesh();
+            Mesh *trialMesh = trialFeSpaces[block.trialLevel]->GetMesh();
+            for (const auto& pair : block.elementPairs)
+            {
+                auto key = std::make_tuple
+                        (static_cast<int>(block.kind),
+                         testMesh->GetElementBaseGeometry(pair.testElId),
+                         trialMesh->GetElementBaseGeometry(pair.trialElId));
+                if (!done.insert(key).second) { continue; }
+                setElementPair(block, pair, *ws);
+                for (int q=0; q<numIntegrators; q++) {
+                    integrate(q, block, ws->data, elmat);
+                }
+            }
+        }
+    }
+
+    int numBlocks = static_cast<int>(blocks.size());
+    std::vector<size_t> cursors(numBlocks, 0);
+
+    // element pairs of a round, and their element matrices
+    std::vector<std::pair<int, size_t>> roundPairs;
+    std::vector<int> roundBlockOffsets;
+    std::vector<DenseMatrix> elmats;
+
+    while (true)
+    {
+        roundPairs.clear();
+        roundBlockOffsets.assign(1, 0);
+        std::vector<int> roundBlocks;
+        for (int b=0; b<numBlocks; b++)
+        {
+            size_t numPairs = blocks[b].elementPairs.size();
+            size_t end = std::min(cursors[b] + chunkSize, numPairs);
+            if (cursors[b] == end) { continue; }
+            for (size_t k=cursors[b]; k<end; k++) {
+                roundPairs.push_back({b, k});
+            }
+            cursors[b] = end;
+            roundBlocks.push_back(b);
+            roundBlockOffsets.push_back
+                    (static_cast<int>(roundPairs.size()));
+        }
+        if (roundPairs.empty()) { break; }
+
+        int numRoundPairs = static_cast<int>(roundPairs.size());
+        elmats.resize(static_cast<size_t>(numRoundPairs)*numIntegrators);
+
+        #pragma omp parallel if (threaded)
+        {
+            auto ws = makeWorkspace();
+
+            #pragma omp for schedule(dynamic, 16)
+            for (int k=0; k<numRoundPairs; k++)
+            {
+                const LevelPairBlock& block = blocks[roundPairs[k].first];
+                setElementPair(block,
+                               block.elementPairs[roundPairs[k].second],
+                               *ws);
+                for (int q=0; q<numIntegrators; q++) {
+                    integrate(q, block, ws->data,
+                              elmats[static_cast<size_t>(k)
+                            *numIntegrators + q]);
+                }
+            }
+        }
+
+        // every block is owned by one thread
+        int numRoundBlocks = static_cast<int>(roundBlocks.size());
+        #pragma omp parallel for schedule(dynamic, 1) if (threaded)
+        for (int r=0; r<numRoundBlocks; r++)
+        {
+            const LevelPairBlock& block = blocks[roundBlocks[r]];
+            auto testFes = testFeSpaces[block.testLevel];
+            auto trialFes = trialFeSpaces[block.trialLevel];
+
+            Array<int> testVdofs, trialVdofs;
+            for (int k=roundBlockOffsets[r]; k<roundBlockOffsets[r+1]; k++)
+            {
+                const ElementPair& pair
+                        = block.elementPairs[roundPairs[k].second];
+                testFes->GetElementVDofs(pair.testElId, testVdofs);
+                trialFes->GetElementVDofs(pair.trialElId, trialVdofs);
+                for (int q=0; q<numIntegrators; q++) {
+                    block.mat->AddSubMatrix
+                            (testVdofs, trialVdofs,
+                             elmats[static_cast<size_t>(k)
+                            *numIntegrators + q], skip_zeros);
+                }
+            }
+        }
+    }
+}
+
+
+std::vector<std::vector<std::unique_ptr<SparseMatrix>>> mymfem
+:: buildMultiLevelProlongations
+(const std::shared_ptr<NestedFEHierarchy>& nestedFEHierarchy)
+{
+    int numLevels = nestedFEHierarchy->getNumLevels();
+
+    std::vector<std::unique_ptr<SparseMatrix>> singleLevel;
+    for (int k=0; k<numLevels-1; k++) {
+        singleLevel.emplace_back(nestedFEHierarchy->buildProlongation(k));
+    }
+
+    // P_{n->m} = P_{m-1} P_{n->m-1}
+    std::vector<std::vector<std::unique_ptr<SparseMatrix>>>
+            prolongations(numLevels);
+    for (int n=0; n<numLevels-1; n++)
+    {
+        prolongations[n].emplace_back
+                (new SparseMatrix(*singleLevel[n]));
+        for (int m=n+2; m<numLevels; m++) {
+            prolongations[n].emplace_back
+                    (Mult(*singleLevel[m-1], *prolongations[n].back()));
+        }
+    }
+
+    return prolongations;
+}
+
 //! Constructor with nested finite element hierarchy
 //! defines the block offsets of storage matrix
 mymfem::BlockBilinearForm
@@ -35,96 +326,47 @@ void mymfem::BlockBilinearForm
     if (mydbfi.size())
     {
         auto feSpaces = m_nestedFEHierarchy->getFESpaces();
-        auto hierMeshTrans
-                = m_nestedFEHierarchy->getHierarchicalMeshTransformations();
-
-        DenseMatrix elmat;        
-
-        // Diagonal blocks
-        Array<int> vdofs;
-        ElementTransformation *elTrans = nullptr;
-
-        for (int n=0; n<m_numLevels; n++)
+        bool useProlongations
+                = (m_crossLevelAssembly == CrossLevelAssembly::prolongation);
+        auto blocks = buildLevelPairBlocks(m_nestedFEHierarchy,
+                                           *m_blockMatrix,
+                                           !useProlongations, false);
+
+        int numIntegrators = static_cast<int>(mydbfi.size());
+        auto integrate = [this](int k, const LevelPairBlock& block,
+                const ElementPairData& data, DenseMatrix& elmat)
         {
-            auto& mat = m_blockMatrix->GetBlock(n,n);
-            std::shared_ptr<FiniteElementSpace> fes(feSpaces[n]);
-
-            for (int i = 0; i < fes -> GetNE(); i++)
-            {
-                fes->GetElementVDofs(i, vdofs);
-
-                const FiniteElement &fe = *(fes->GetFE(i));
-                elTrans = fes->GetElementTransformation(i);
-                for (int k = 0; k < static_cast<int>(mydbfi.size()); k++)
-                {
-                    mydbfi[k]->assembleElementMatrix
-                            (fe, *elTrans, elmat);
-                    mat.AddSubMatrix(vdofs, vdofs, elmat, skip_zeros);
-                }
-            }            
-        }
-
-        // Lower-triangular blocks
-        Array<int> trialVdofsCoarse, testVdofsFine;
-        ElementTransformation *trialElTransCoarse = nullptr;
-        ElementTransformation *testElTransFine = nullptr;
+            if (block.kind == LevelPairBlock::diagonal) {
+                mydbfi[k]->assembleElementMatrix
+                        (*data.testFe, *data.testElTrans, elmat);
+            }
+            else {
+                mydbfi[k]->assembleElementMatrix
+                        (*data.testFe, *data.testElTrans,
+                         *data.trialFe, *data.trialElTrans,
+                         data.fineToCoarse, elmat);
+            }
+        };
+        assembleLevelPairBlocks(blocks, feSpaces, feSpaces,
+                                *m_nestedFEHierarchy
+                                ->getNestedMeshHierarchy(),
+                                numIntegrators, integrate, skip_zeros);
+        m_blockMatrix->Finalize(skip_zeros, false);
 
-        for (int m=1; m<m_numLevels; m++)
+        // lower-triangular blocks A_m P_{n->m}
+        if (useProlongations)
         {
-            std::shared_ptr<FiniteElementSpace> fesFine(feSpaces[m]);
-            auto hierMultiLevelMeshTrans = hierMeshTrans[m-1];
-
-            for (int n=m-1; n>=0; n--)
-            {
-                std::shared_ptr<FiniteElementSpace> fesCoarse(feSpaces[n]);
-                // generate hierarchical mesh transformations
-                // across non-successive mesh levels
-                if (n < m-1) {
-                    hierMultiLevelMeshTrans
-                            = buildMultiLevelMeshHierarchy
-                            (hierMeshTrans[n], hierMultiLevelMeshTrans);
-                }
-
-                auto& mat = m_blockMatrix->GetBlock(m, n);
-                for (int i=0; i < fesCoarse->GetNE(); i++)
+            auto prolongations
+                    = buildMultiLevelProlongations(m_nestedFEHierarchy);
+            for (int n=0; n<m_numLevels-1; n++)
+                for (int m=n+1; m<m_numLevels; m++)
                 {
-                    fesCoarse->GetElementVDofs(i, trialVdofsCoarse);
-                    const FiniteElement &trialFECoarse
-                            = *(fesCoarse->GetFE(i));
-                    trialElTransCoarse
-                            = fesCoarse->GetElementTransformation(i);
-
-                    auto childElems = (*hierMultiLevelMeshTrans)(i);
-                    for (auto it=childElems.begin();
-                         it!= childElems.end(); it++)
-                    {
-                        int j = *it;
-//                        std::cout << n << "\t" << m << "\t"
-//                                  << i << "\t" << j << std::endl;
-
-                        fesFine->GetElementVDofs(j, testVdofsFine);
-                        const FiniteElement &testFEFine
-                                = *(fesFine->GetFE(j));
-                        testElTransFine
-                                = fesFine->GetElementTransformation(j);
-
-                        // call the integrators here
-                        for (int k = 0; k < static_cast<int>(mydbfi.size()); k++)
-                        {
-                            mydbfi[k]->assembleElementMatrix
-                                    (testFEFine, *testElTransFine,
-                                     trialFECoarse, *trialElTransCoarse,
-                                     elmat);
-                            mat.AddSubMatrix(testVdofsFine,
-                                             trialVdofsCoarse,
-                                             elmat, skip_zeros);
-                        }
-                    }
+                    auto mat = Mult(m_blockMatrix->GetBlock(m,m),
+                                    *prolongations[n][m-n-1]);
+                    m_blockMatrix->GetBlock(m,n) = *mat;
+                    delete mat;
                 }
-//                std::cout << "\n\n";
-            }
         }
-        m_blockMatrix->Finalize(skip_zeros, false);
 
         // upper-triangle blocks
         if (symmetric) {
@@ -207,142 +449,66 @@ void mymfem::BlockMixedBilinearForm
     if (mydbfi.size())
     {
         // The underlying mesh hierarchy is the same for both test and trial spaces
-        auto hierMeshTrans
-                = m_testNestedFEHierarchy->getHierarchicalMeshTransformations();
-
         auto testFeSpaces = m_testNestedFEHierarchy->getFESpaces();
         auto trialFeSpaces = m_trialNestedFEHierarchy->getFESpaces();
-
-        // Diagonal blocks
-        DenseMatrix elmat;
-        Array<int> testVdofs, trialVdofs;
-        ElementTransformation *elTrans = nullptr;
-
-        for (int n=0; n<m_numLevels; n++)
+        bool useProlongations
+                = (m_crossLevelAssembly == CrossLevelAssembly::prolongation);
+        auto blocks = buildLevelPairBlocks(m_testNestedFEHierarchy,
+                                           *m_blockMatrix,
+                                           !useProlongations,
+                                           !useProlongations);
+
+        int numIntegrators = static_cast<int>(mydbfi.size());
+        auto integrate = [this](int k, const LevelPairBlock& block,
+                const ElementPairData& data, DenseMatrix& elmat)
         {
-            auto& mat = m_blockMatrix->GetBlock(n,n);
-            std::shared_ptr<FiniteElementSpace> testFes(testFeSpaces[n]);
-            std::shared_ptr<FiniteElementSpace> trialFes(trialFeSpaces[n]);
-
-            for (int i = 0; i < testFes -> GetNE(); i++)
-            {
-                testFes->GetElementVDofs(i, testVdofs);
-                trialFes->GetElementVDofs(i, trialVdofs);
-
-                const FiniteElement &testFe = *(testFes->GetFE(i));
-                const FiniteElement &trialFe = *(trialFes->GetFE(i));
-                elTrans = testFes->GetElementTransformation(i);
-                for (int k = 0; k < static_cast<int>(mydbfi.size()); k++)
-                {
-                    mydbfi[k]->assembleElementMatrix
-                            (testFe, trialFe, *elTrans, elmat);
-                    mat.AddSubMatrix(testVdofs, trialVdofs, elmat, skip_zeros);
-                }
+            if (block.kind == LevelPairBlock::diagonal) {
+                mydbfi[k]->assembleElementMatrix
+                        (*data.testFe, *data.trialFe,
+                         *data.testElTrans, elmat);
             }
-        }
-
-        // Lower-triangular and upper-triangular blocks
-        DenseMatrix elmat1, elmat2;
-
-        // auxiliary variables for lower-triangular blocks
-        Array<int> trialVdofsCoarse, testVdofsFine;
-        ElementTransformation *trialElTransCoarse = nullptr;
-        ElementTransformation *testElTransFine = nullptr;
-        std::shared_ptr<FiniteElementSpace> trialFesCoarse, testFesFine;
-
-        // auxiliary variables for upper-triangular blocks
-        Array<int> trialVdofsFine, testVdofsCoarse;
-        ElementTransformation *trialElTransFine = nullptr;
-        ElementTransformation *testElTransCoarse = nullptr;
-        std::shared_ptr<FiniteElementSpace> trialFesFine, testFesCoarse;
+            else if (block.kind == LevelPairBlock::fineTestCoarseTrial) {
+                mydbfi[k]->assembleElementMatrix
+                        (*data.testFe, *data.testElTrans,
+                         *data.trialFe, *data.trialElTrans,
+                         data.fineToCoarse, elmat);
+            }
+            else {
+                mydbfi[k]->assembleElementMatrix2
+                        (*data.testFe, *data.testElTrans,
+                         *data.trialFe, *data.trialElTrans,
+                         data.fineToCoarse, elmat);
+            }
+        };
+        assembleLevelPairBlocks(blocks, testFeSpaces, trialFeSpaces,
+                                *m_testNestedFEHierarchy
+                                ->getNestedMeshHierarchy(),
+                                numIntegrators, integrate, skip_zeros);
+        m_blockMatrix->Finalize(skip_zeros, false);
 
-        for (int m=1; m<m_numLevels; m++)
+        // lower-triangular blocks B_m P^{trial}_{n->m},
+        // upper-triangular blocks (P^{test}_{n->m})^T B_m
+        if (useProlongations)
         {
-            auto hierMultiLevelMeshTrans = hierMeshTrans[m-1];
-
-            testFesFine = testFeSpaces[m];
-            trialFesFine = trialFeSpaces[m];
-
-            for (int n=m-1; n>=0; n--)
-            {
-                testFesCoarse = testFeSpaces[n];
-                trialFesCoarse = trialFeSpaces[n];
-
-                // generate hierarchical mesh transformations
-                // across non-successive mesh levels
-                if (n < m-1) {
-                    hierMultiLevelMeshTrans
-                            = buildMultiLevelMeshHierarchy
-                            (hierMeshTrans[n], hierMultiLevelMeshTrans);
-                }
-
-                auto& mat1 = m_blockMatrix->GetBlock(m, n);
-                auto& mat2 = m_blockMatrix->GetBlock(n, m);
-                for (int i=0; i < trialFesCoarse->GetNE(); i++)
+            auto testProlongations
+                    = buildMultiLevelProlongations(m_testNestedFEHierarchy);
+            auto trialProlongations
+                    = buildMultiLevelProlongations(m_trialNestedFEHierarchy);
+            for (int n=0; n<m_numLevels-1; n++)
+                for (int m=n+1; m<m_numLevels; m++)
                 {
-                    // set variables for computing the matrices in lower-triangular blocks
-                    trialFesCoarse->GetElementVDofs(i, trialVdofsCoarse);
-                    const FiniteElement &trialFECoarse
-                            = *(trialFesCoarse->GetFE(i));
-                    trialElTransCoarse
-                            = trialFesCoarse->GetElementTransformation(i);
-
-                    // set variables for computing the matrices in upper-triangular blocks
-                    testFesCoarse->GetElementVDofs(i, testVdofsCoarse);
-                    const FiniteElement &testFECoarse
-                            = *(testFesCoarse->GetFE(i));
-                    testElTransCoarse
-                            = testFesCoarse->GetElementTransformation(i);
-
-                    auto childElems = (*hierMultiLevelMeshTrans)(i);
-                    for (auto it=childElems.begin();
-                         it!= childElems.end(); it++)
-                    {
-                        int j = *it;
-//                        std::cout << n << "\t" << m << "\t"
-//                                  << i << "\t" << j << std::endl;
-
-                        // set variables for computing the matrices in the lower-triangular blocks
-                        testFesFine->GetElementVDofs(j, testVdofsFine);
-                        const FiniteElement &testFEFine
-                                = *(testFesFine->GetFE(j));
-                        testElTransFine
-                                = testFesFine->GetElementTransformation(j);
-
-                        // set variables for computing the matrices in the upper-triangular blocks
-                        trialFesFine->GetElementVDofs(j, trialVdofsFine);
-                        const FiniteElement &trialFEFine
-                                = *(trialFesFine->GetFE(j));
-                        trialElTransFine
-                                = trialFesFine->GetElementTransformation(j);
-
-                        // call the integrators here
-                        for (int k = 0; k < static_cast<int>(mydbfi.size()); k++)
-                        {
-                            // compute matrices in the lower-triangular blocks
-                            mydbfi[k]->assembleElementMatrix
-                                    (testFEFine, *testElTransFine,
-                                     trialFECoarse, *trialElTransCoarse,
-                                     elmat1);
-                            mat1.AddSubMatrix(testVdofsFine,
-                                              trialVdofsCoarse,
-                                              elmat1, skip_zeros);
-
-                            // compute matrices in the uppwer-triangular blocks
-                            mydbfi[k]->assembleElementMatrix2
-                                    (testFECoarse, *testElTransCoarse,
-                                     trialFEFine, *trialElTransFine,
-                                     elmat2);
-                            mat2.AddSubMatrix(testVdofsCoarse,
-                                              trialVdofsFine,
-                                              elmat2, skip_zeros);
-                        }
-                    }
+                    auto& diagBlock = m_blockMatrix->GetBlock(m,m);
+                    auto mat1 = Mult(diagBlock,
+                                     *trialProlongations[n][m-n-1]);
+                    m_blockMatrix->GetBlock(m,n) = *mat1;
+                    delete mat1;
+
+                    auto mat2 = TransposeMult(*testProlongations[n][m-n-1],
+                                              diagBlock);
+                    m_blockMatrix->GetBlock(n,m) = *mat2;
+                    delete mat2;
                 }
-//                std::cout << "\n\n";
-            }
         }
-        m_blockMatrix->Finalize(skip_zeros, false);
     }
 }
 
@@ -3,12 +3,96 @@
 
 #include "mfem.hpp"
 
+#include <functional>
+#include <vector>
+
 #include "nested_hierarchy.hpp"
 #include "my_bilinearForm_integrators.hpp"
 
 
 namespace mymfem {
 
+//! Test and trial elements of an element matrix
+struct ElementPair
+{
+    int testElId;
+    int trialElId;
+};
+
+/**
+ * @brief Element pairs of one level-pair block of a block form,
+ * in the order of the serial assembly
+ */
+struct LevelPairBlock
+{
+    enum Kind {diagonal, fineTestCoarseTrial, coarseTestFineTrial};
+
+    int testLevel;
+    int trialLevel;
+    Kind kind;
+    mfem::SparseMatrix *mat;
+    std::vector<ElementPair> elementPairs;
+};
+
+/**
+ * @brief Element data handed to the integrators;
+ * the finite elements and transformations are private
+ * to the calling thread
+ */
+struct ElementPairData
+{
+    const mfem::FiniteElement *testFe = nullptr;
+    const mfem::FiniteElement *trialFe = nullptr;
+
+    mfem::ElementTransformation *testElTrans = nullptr;
+    mfem::ElementTransformation *trialElTrans = nullptr;
+
+    //! map of the fine element into the coarse one,
+    //! for the off-diagonal blocks
+    ChildInAncestorMap fineToCoarse;
+};
+
+//! Computes the element matrix of the k-th integrator
+using ElementPairIntegrator
+= std::function<void (int k, const LevelPairBlock&,
+                      const ElementPairData&, mfem::DenseMatrix&)>;
+
+//! Lists the element pairs of the diagonal blocks, and optionally
+//! of the lower-triangular and the upper-triangular blocks
+std::vector<LevelPairBlock> buildLevelPairBlocks
+(const std::shared_ptr<NestedFEHierarchy>&,
+ mfem::BlockMatrix&, bool withLowerBlocks, bool withUpperBlocks);
+
+/**
+ * @brief OpenMP-parallel assembly of level-pair blocks.
+ * The element matrices are computed concurrently, and summed
+ * in the order of the serial assembly; the integrators must
+ * thus be safe to call concurrently.
+ * The result is bitwise independent of the number of threads.
+ */
+void assembleLevelPairBlocks (std::vector<LevelPairBlock>& blocks,
+                              const NestedFESpaces& testFeSpaces,
+                              const NestedFESpaces& trialFeSpaces,
+                              const NestedMeshHierarchy& meshHierarchy,
+                              int numIntegrators,
+                              const ElementPairIntegrator& integrate,
+                              int skip_zeros);
+
+//! Returns the prolongations from every level n to all the finer
+//! levels m, indexed [n][m-n-1]
+std::vector<std::vector<std::unique_ptr<mfem::SparseMatrix>>>
+buildMultiLevelProlongations
+(const std::shared_ptr<NestedFEHierarchy>&);
+
+/**
+ * @brief Assembly of the off-diagonal level-pair blocks;
+ * either with quadrature on the fine elements,
+ * or, for nested conforming spaces, as the product of the
+ * diagonal block on the fine level with the prolongations
+ */
+enum class CrossLevelAssembly {quadrature, prolongation};
+
+
 /**
  * @brief BlockBilinearForm class provides functions to
  * assemble bilinear forms between different mesh levels
@@ -30,6 +114,11 @@ public:
         mydbfi.push_back(bfi);
     }
 
+    //! Sets the assembly of the off-diagonal blocks
+    void setCrossLevelAssembly(CrossLevelAssembly crossLevelAssembly) {
+        m_crossLevelAssembly = crossLevelAssembly;
+    }
+
     /**
      * @brief Assembles all the integrators
      * @param skip_zeros Skips zero entries
@@ -60,6 +149,9 @@ private:
     //! Block Matrix, sparse
     std::shared_ptr<mfem::BlockMatrix> m_blockMatrix;
 
+    CrossLevelAssembly m_crossLevelAssembly
+    = CrossLevelAssembly::quadrature;
+
     //! domain block bilinear form integrators
     std::vector<std::shared_ptr<BlockBilinearFormIntegrator>> mydbfi;
 };
@@ -88,6 +180,11 @@ public:
         mydbfi.push_back(bfi);
     }
 
+    //! Sets the assembly of the off-diagonal blocks
+    void setCrossLevelAssembly(CrossLevelAssembly crossLevelAssembly) {
+        m_crossLevelAssembly = crossLevelAssembly;
+    }
+
     /**
      * @brief Assembles all the integrators
      * @param skip_zeros Skips zero entries
@@ -124,6 +221,9 @@ private:
     //! Block Matrix, sparse
     std::shared_ptr<mfem::BlockMatrix> m_blockMatrix;
 
+    CrossLevelAssembly m_crossLevelAssembly
+    = CrossLevelAssembly::quadrature;
+
     //! domain block bilinear form integrators
     std::vector<std::shared_ptr<BlockMixedBilinearFormIntegrator>> mydbfi;
 };
@@ -1,26 +1,139 @@
 #include "nested_hierarchy.hpp"
 
+#include <stdexcept>
+#include <string>
+
 using namespace mfem;
 
 
+// The reference vertex 0 is the origin of every MFEM geometry,
+// and the unit vectors are reference vertices as well;
+// their images in the parent, given by evalVertexImage,
+// define the affine map
+template <typename VertexImage>
+static mymfem::ChildInAncestorMap buildAffineMap
+(Geometry::Type geom, int dim, VertexImage evalVertexImage)
+{
+    const IntegrationRule *refVertices = Geometries.GetVertices(geom);
+
+    mymfem::ChildInAncestorMap map;
+    map.setIdentity(dim);
+    evalVertexImage(0, map.b);
+    for (int v=1; v<refVertices->GetNPoints(); v++)
+    {
+        const IntegrationPoint& refVertex = refVertices->IntPoint(v);
+        double xi[3] = {refVertex.x, refVertex.y, refVertex.z};
+        int axis = -1, numNonZeros = 0;
+        for (int d=0; d<dim; d++) {
+            if (xi[d] != 0) { axis = d; numNonZeros++; }
+        }
+        if (numNonZeros != 1) { continue; }
+
+        double xv[3];
+        evalVertexImage(v, xv);
+        for (int d=0; d<dim; d++) {
+            map.A[axis*dim + d] = xv[d] - map.b[d];
+        }
+    }
+    return map;
+}
+
+void HierarchicalMeshTransformationTable
+:: finalize()
+{
+    // counting sort of the children by parent;
+    // children of a parent stay sorted by index
+    m_childOffsets.assign(m_numParents+1, 0);
+    for (int parent : m_parentIds) {
+        if (parent >= 0) { m_childOffsets[parent+1]++; }
+    }
+    for (int i=0; i<m_numParents; i++) {
+        m_childOffsets[i+1] += m_childOffsets[i];
+    }
+
+    m_children.resize(m_childOffsets[m_numParents]);
+    std::vector<int> pos(m_childOffsets.begin(), m_childOffsets.end()-1);
+    for (int c=0; c<static_cast<int>(m_parentIds.size()); c++) {
+        if (m_parentIds[c] >= 0) {
+            m_children[pos[m_parentIds[c]]++] = c;
+        }
+    }
+
+    m_finalized = true;
+}
+
+
 void mymfem::NestedMeshHierarchy
 :: buildHierarchicalTranformations() const
 {
     int numMeshes = m_meshes.size();
 
     m_hierarchicalTransformations.resize(numMeshes-1);
+    m_childInParentMaps.resize(numMeshes-1);
+
+    m_multiLevelTransformations.clear();
+    m_multiLevelTransformations.resize(numMeshes);
+    for (int i=0; i<numMeshes; i++) {
+        m_multiLevelTransformations[i].resize(numMeshes);
+    }
 
     for (int i=0; i<numMeshes-1; i++)
     {
         assert(m_meshes[i]->GetNE() <= m_meshes[i+1]->GetNE());
 
-        // initialise hierarchical transformation
-        m_hierarchicalTransformations[i]
-                = std::make_shared<HierarchicalMeshTransformationTable>
-                (m_meshes[i]->GetNE());
-
         buildTranformationBetweenSuccessiveLevels(i);
+        buildChildInParentMaps(i);
+
+        m_multiLevelTransformations[i][i+1]
+                = m_hierarchicalTransformations[i];
+    }
+}
+
+void mymfem::NestedMeshHierarchy
+:: addUniformlyRefinedMesh(std::shared_ptr<Mesh>& mesh)
+{
+    assert(!m_meshes.empty());
+    int numElsCoarse = m_meshes.back()->GetNE();
+
+    m_meshes.push_back(mesh);
+    m_refinementParentIds.emplace_back();
+    m_refinementChildMaps.emplace_back();
+
+    // the records are those of the last refinement of the mesh
+    const CoarseFineTransformations& refinementTransforms
+            = mesh->GetRefinementTransforms();
+    if (refinementTransforms.embeddings.Size() != mesh->GetNE()) {
+        return;
     }
+
+    // the point matrix of a fine element holds its vertices
+    // in the reference coordinates of its parent
+    int dim = mesh->Dimension();
+    std::vector<int> parentIds(mesh->GetNE());
+    std::vector<ChildInAncestorMap> childMaps(mesh->GetNE());
+    for (int i=0; i<mesh->GetNE(); i++)
+    {
+        const Embedding& embedding = refinementTransforms.embeddings[i];
+        parentIds[i] = embedding.parent;
+        if (parentIds[i] < 0 || parentIds[i] >= numElsCoarse) {
+            return;
+        }
+
+        auto geom = mesh->GetElementBaseGeometry(i);
+        const DenseTensor& pointMatrices
+                = refinementTransforms.point_matrices[geom];
+        if (embedding.matrix < 0
+                || embedding.matrix >= pointMatrices.SizeK()
+                || pointMatrices.SizeI() != dim) {
+            return;
+        }
+        const DenseMatrix& pointMatrix = pointMatrices(embedding.matrix);
+        childMaps[i] = buildAffineMap(geom, dim, [&](int v, double *xi) {
+            for (int d=0; d<dim; d++) { xi[d] = pointMatrix(d, v); }
+        });
+    }
+    m_refinementParentIds.back() = std::move(parentIds);
+    m_refinementChildMaps.back() = std::move(childMaps);
 }
 
 void mymfem::NestedMeshHierarchy
@@ -28,6 +141,25 @@ void mymfem::NestedMeshHierarchy
 (int id) const
 {
     auto coarseMesh = m_meshes[id];
+
+    std::vector<int> parentIds;
+    if (!m_refinementParentIds[id+1].empty()) {
+        parentIds = m_refinementParentIds[id+1];
+    } else {
+        parentIds = locateParentElements(id);
+    }
+
+    m_hierarchicalTransformations[id]
+            = std::make_shared<HierarchicalMeshTransformationTable>
+            (coarseMesh->GetNE(), std::move(parentIds));
+}
+
+// The parent of a fine element is the coarse element
+// containing the centre of the fine element
+std::vector<int> mymfem::NestedMeshHierarchy
+:: locateParentElements
+(int id) const
+{
     auto fineMesh = m_meshes[id+1];
 
     std::unique_ptr<PointLocator> pointLocatorCoarse
@@ -36,97 +168,146 @@ void mymfem::NestedMeshHierarchy
     // number of elements in the fine mesh
     int numElsFine = fineMesh->GetNE();
 
-    int elIdCoarse;
-    IntegrationPoint dip; // dummy
-
-    int initElIdCoarse = 0;
-    Vector xC(fineMesh->Dimension());
-
-    for (int i=0; i<numElsFine; i++)
-    {
+    DenseMatrix centres(fineMesh->Dimension(), numElsFine);
+    Vector xC;
+    for (int i=0; i<numElsFine; i++) {
+        centres.GetColumnReference(i, xC);
         getElementCenter(fineMesh, i, xC);
-        std::tie(elIdCoarse, dip)
-                = (*pointLocatorCoarse)(xC, initElIdCoarse);
+    }
+
+    Array<int> elIdsCoarse;
+    Array<IntegrationPoint> dips; // dummy
+    pointLocatorCoarse->locate(centres, elIdsCoarse, dips);
 
-        m_hierarchicalTransformations[id]->add(elIdCoarse, i);
+    std::vector<int> parentIds(numElsFine);
+    for (int i=0; i<numElsFine; i++) {
+        if (elIdsCoarse[i] < 0) {
+            throw std::runtime_error("No parent found on the mesh level "
+                                     +std::to_string(id)+" for the element "
+                                     +std::to_string(i)+" of the level "
+                                     +std::to_string(id+1)
+                                     +"; the meshes are not nested");
+        }
+        parentIds[i] = elIdsCoarse[i];
     }
-}
 
+    return parentIds;
+}
 
-// Builds mesh hierarchy across multiple-levels
-// using the hierarchies given between successive levels
 std::shared_ptr<HierarchicalMeshTransformationTable>
-mymfem::buildMultiLevelMeshHierarchy
-(mymfem::HierarchicalMeshTransformations& hierMeshTrans)
+mymfem::NestedMeshHierarchy
+:: getTransformation (int coarseLevel, int fineLevel) const
 {
-    int numCoarseEls = hierMeshTrans[0]->getNumParents();
-    auto multiLevelHierMeshTrans = std::make_shared
-            <HierarchicalMeshTransformationTable>(numCoarseEls);
+    assert(coarseLevel < fineLevel);
 
-    for (int i=0; i<numCoarseEls; i++) {
-        (*multiLevelHierMeshTrans)(i)
-                = buildElemMultiLevelMeshHierarchy(i, hierMeshTrans);
+    std::shared_ptr<HierarchicalMeshTransformationTable> transformation;
+    #pragma omp critical (nestedMeshHierarchyTransformations)
+    {
+        // compose from the finest successive transformation downwards,
+        // memoizing every intermediate level pair
+        for (int l=fineLevel-1; l>=coarseLevel; l--)
+        {
+            auto& memo = m_multiLevelTransformations[l][fineLevel];
+            if (!memo) {
+                memo = buildMultiLevelMeshHierarchy
+                        (m_hierarchicalTransformations[l],
+                         m_multiLevelTransformations[l+1][fineLevel]);
+            }
+        }
+        transformation = m_multiLevelTransformations[coarseLevel][fineLevel];
     }
 
-    return multiLevelHierMeshTrans;
+    return transformation;
 }
 
-// For a given element in the coarsest mesh,
-// builds mesh hierarchy across multiple-levels
-// using the hierarchies given between successive levels
-std::set<int> mymfem::buildElemMultiLevelMeshHierarchy
-(int coarseElId, mymfem::HierarchicalMeshTransformations& hierMeshTrans)
+void mymfem::NestedMeshHierarchy
+:: buildChildInParentMaps
+(int id) const
 {
-    // if only one mesh hierarchy is given,
-    // return its children directly
-    if (hierMeshTrans.size() == 1) {
-        return (*hierMeshTrans[0])(coarseElId);
+    if (hasRefinementRecords(id+1)) {
+        m_childInParentMaps[id] = m_refinementChildMaps[id+1];
+        return;
     }
 
-    // else gather all children at the finest level
-    // by recursively calling this function
-    std::set<int> allChildren;
+    auto coarseMesh = m_meshes[id];
+    auto fineMesh = m_meshes[id+1];
+
+    int dim = fineMesh->Dimension();
+    int numElsFine = fineMesh->GetNE();
+    m_childInParentMaps[id].resize(numElsFine);
+
+    Array<int> vertices;
+    IntegrationPoint ip;
+    for (int i=0; i<numElsFine; i++)
+    {
+        auto geom = fineMesh->GetElementBaseGeometry(i);
+        fineMesh->GetElementVertices(i, vertices);
+
+        ElementTransformation *coarseTrans
+                = coarseMesh->GetElementTransformation
+                (m_hierarchicalTransformations[id]->getParentId(i));
+        m_childInParentMaps[id][i]
+                = buildAffineMap(geom, dim, [&](int v, double *xi)
+        {
+            Vector x(fineMesh->GetVertex(vertices[v]), dim);
+            coarseTrans->TransformBack(x, ip);
+            xi[0] = ip.x;
+            if (dim > 1) { xi[1] = ip.y; }
+            if (dim > 2) { xi[2] = ip.z; }
+        });
+    }
+}
+
+mymfem::ChildInAncestorMap mymfem::NestedMeshHierarchy
+:: getChildInAncestorMap (int fineLevel, int fineElId,
+                          int coarseLevel) const
+{
+    assert(coarseLevel <= fineLevel);
+
+    ChildInAncestorMap map;
+    map.setIdentity(m_meshes[fineLevel]->Dimension());
+    for (int l=fineLevel; l>coarseLevel; l--) {
+        map = map.composeWith(m_childInParentMaps[l-1][fineElId]);
+        fineElId = getParentId(l, fineElId);
+    }
+    return map;
+}
 
-    // crete a sub-hierarchy without the first entry from hierarchy
-    HierarchicalMeshTransformations
-            subHierMeshTrans(hierMeshTrans.begin() + 1,
-                             hierMeshTrans.end());
 
-    auto coarseBuf = (*hierMeshTrans[0])(coarseElId);
-    for (auto it=coarseBuf.begin(); it!= coarseBuf.end(); it++) {
-//        std::cout << "Sub-element " << *it
-//                  << " of element " << coarseElId << std::endl;
-        auto children
-                = buildElemMultiLevelMeshHierarchy(*it, subHierMeshTrans);
-        allChildren.insert(children.begin(), children.end());
+// Builds mesh hierarchy across multiple-levels
+// using the hierarchies given between successive levels
+std::shared_ptr<HierarchicalMeshTransformationTable>
+mymfem::buildMultiLevelMeshHierarchy
+(const mymfem::HierarchicalMeshTransformations& hierMeshTrans)
+{
+    auto multiLevelHierMeshTrans = hierMeshTrans.back();
+    for (int l=static_cast<int>(hierMeshTrans.size())-2; l>=0; l--) {
+        multiLevelHierMeshTrans = buildMultiLevelMeshHierarchy
+                (hierMeshTrans[l], multiLevelHierMeshTrans);
     }
 
-    return allChildren;
+    return multiLevelHierMeshTrans;
 }
 
 // Builds mesh hierarchy across multiple-levels
 // using the hierarchical transformation of current mesh
-// and the next hierarchy
+// and the next hierarchy;
+// the ancestor of a child is the parent of its parent
 std::shared_ptr<HierarchicalMeshTransformationTable>
 mymfem::buildMultiLevelMeshHierarchy
-(std::shared_ptr<HierarchicalMeshTransformationTable>& curHierarchy,
- std::shared_ptr<HierarchicalMeshTransformationTable>& nextHierarchy)
+(const std::shared_ptr<HierarchicalMeshTransformationTable>& curHierarchy,
+ const std::shared_ptr<HierarchicalMeshTransformationTable>& nextHierarchy)
 {
-    int numCurEls = curHierarchy->getNumParents();
-    auto multiLevelHierarchy = std::make_shared
-            <HierarchicalMeshTransformationTable>(numCurEls);
+    const std::vector<int>& nextParentIds = nextHierarchy->getParentIds();
 
-    for (int i=0; i<numCurEls; i++)
-    {
-        auto curBuf = (*curHierarchy)(i);
-        for (auto it=curBuf.begin(); it!= curBuf.end(); it++) {
-            auto children = (*nextHierarchy)(*it);
-            ((*multiLevelHierarchy)(i)).insert(children.begin(),
-                                               children.end());
-        }
+    std::vector<int> parentIds(nextParentIds.size());
+    for (size_t i=0; i<nextParentIds.size(); i++) {
+        parentIds[i] = nextParentIds[i] < 0 ? -1
+                : curHierarchy->getParentId(nextParentIds[i]);
     }
 
-    return multiLevelHierarchy;
+    return std::make_shared<HierarchicalMeshTransformationTable>
+            (curHierarchy->getNumParents(), std::move(parentIds));
 }
 
 Array<int> mymfem::NestedFEHierarchy
@@ -142,4 +323,87 @@ Array<int> mymfem::NestedFEHierarchy
     return numDims;
 }
 
+SparseMatrix* mymfem::NestedFEHierarchy
+:: buildProlongation(int coarseLevel)
+{
+    assert(coarseLevel+1 < static_cast<int>(m_feSpaces.size()));
+
+    auto coarseFes = m_feSpaces[coarseLevel];
+    auto fineFes = m_feSpaces[coarseLevel+1];
+    Mesh *coarseMesh = coarseFes->GetMesh();
+    Mesh *fineMesh = fineFes->GetMesh();
+    auto transformation
+            = m_nestedMeshHierarchy->getTransformations()[coarseLevel];
+
+    int dim = fineMesh->Dimension();
+    int vdim = fineFes->GetVDim();
+    auto P = new SparseMatrix(fineFes->GetVSize(), coarseFes->GetVSize());
+
+    // rows shared by neighbouring fine elements are set once
+    Array<bool> isRowSet(fineFes->GetVSize());
+    isRowSet = false;
+
+    IsoparametricTransformation fineToCoarseTrans;
+    DenseMatrix localP;
+    Array<int> coarseDofs, fineDofs, fineVertices;
+    IntegrationPoint ip;
+    for (int c=0; c<transformation->getNumParents(); c++)
+    {
+        ElementTransformation *coarseTrans
+                = coarseMesh->GetElementTransformation(c);
+        coarseFes->GetElementDofs(c, coarseDofs);
+
+        for (int f : (*transformation)(c))
+        {
+            // vertices of the fine element,
+            // in the reference coordinates of the coarse element
+            fineMesh->GetElementVertices(f, fineVertices);
+            fineToCoarseTrans.SetFE
+                    (Mesh::GetTransformationFEforElementType
+                     (fineMesh->GetElementType(f)));
+            DenseMatrix& pointMat = fineToCoarseTrans.GetPointMat();
+            pointMat.SetSize(dim, fineVertices.Size());
+            for (int v=0; v<fineVertices.Size(); v++)
+            {
+                Vector x(fineMesh->GetVertex(fineVertices[v]), dim);
+                coarseTrans->TransformBack(x, ip);
+                pointMat(0, v) = ip.x;
+                if (dim > 1) { pointMat(1, v) = ip.y; }
+                if (dim > 2) { pointMat(2, v) = ip.z; }
+            }
+            fineFes->GetFE(f)->GetLocalInterpolation(fineToCoarseTrans,
+                                                     localP);
+
+            // negative indices encode flipped dof orientations
+            fineFes->GetElementDofs(f, fineDofs);
+            for (int d=0; d<vdim; d++) {
+                for (int i=0; i<fineDofs.Size(); i++)
+                {
+                    int fi = fineDofs[i] >= 0 ? fineDofs[i]
+                                              : -1-fineDofs[i];
+                    int row = fineFes->DofToVDof(fi, d);
+                    if (isRowSet[row]) { continue; }
+                    isRowSet[row] = true;
+
+                    double fineSign = fineDofs[i] >= 0 ? 1. : -1.;
+                    for (int j=0; j<coarseDofs.Size(); j++)
+                    {
+                        double val = localP(i, j);
+                        if (std::abs(val) < 1E-12) { continue; }
+
+                        int cj = coarseDofs[j] >= 0 ? coarseDofs[j]
+                                                    : -1-coarseDofs[j];
+                        double coarseSign = coarseDofs[j] >= 0 ? 1. : -1.;
+                        P->Add(row, coarseFes->DofToVDof(cj, d),
+                               fineSign*coarseSign*val);
+                    }
+                }
+            }
+        }
+    }
+    P->Finalize();
+
+    return P;
+}
+
 // End of file
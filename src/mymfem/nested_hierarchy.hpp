@@ -3,31 +3,85 @@
 
 #include "mfem.hpp"
 
+#include <algorithm>
 #include <vector>
-#include <set>
 #include <memory>
+#include <assert.h>
 
 #include "utilities.hpp"
 
 
+/**
+ * @brief Read-only view of the sorted child indices of a parent element
+ */
+struct ChildElementIds
+{
+    typedef const int* const_iterator;
+    typedef const int* iterator;
+    typedef int value_type;
+
+    const int* begin() const { return m_begin; }
+    const int* end() const { return m_end; }
+
+    int size() const {
+        return static_cast<int>(m_end - m_begin);
+    }
+
+    bool operator== (const ChildElementIds& other) const {
+        return std::equal(m_begin, m_end, other.m_begin, other.m_end);
+    }
+
+    bool operator!= (const ChildElementIds& other) const {
+        return !(*this == other);
+    }
+
+    const int* m_begin;
+    const int* m_end;
+};
+
+
+/**
+ * @brief Parent-child table between two nested meshes.
+ * Stores the parent of every child element in a dense array,
+ * and the children of every parent element in flat CSR arrays,
+ * sorted by index. The CSR arrays are built from the parent array
+ * by finalize, which must be called after the adds; the finalized
+ * table is read-only and can be read concurrently.
+ */
 typedef struct HierarchicalMeshTransformationTable
 {
 public:
     //! Constructor with number of parent mesh elements
     HierarchicalMeshTransformationTable(int numParentEls)
-        : m_numParents(numParentEls) {
-        m_data.resize(m_numParents);
+        : m_numParents(numParentEls) {}
+
+    //! Constructor with number of parent mesh elements
+    //! and the parent of every child element
+    HierarchicalMeshTransformationTable(int numParentEls,
+                                        std::vector<int> parentIds)
+        : m_numParents(numParentEls),
+          m_parentIds(std::move(parentIds)) {
+        finalize();
     }
 
     //! Adds a child element to the hierarchy of a parent element
     void add (int parentElId, int childElId) {
-        m_data[parentElId].insert(childElId);
+        if (childElId >= static_cast<int>(m_parentIds.size())) {
+            m_parentIds.resize(childElId+1, -1);
+        }
+        m_parentIds[childElId] = parentElId;
+        m_finalized = false;
     }
-   
+
+    //! Builds the CSR child arrays from the parent array
+    void finalize();
+
     //! Returns the child indices for the parent element with
     //! index parentElId
-    std::set<int>& operator() (int parentElId) {
-        return m_data[parentElId];
+    ChildElementIds operator() (int parentElId) const {
+        assert(m_finalized);
+        return {m_children.data() + m_childOffsets[parentElId],
+                    m_children.data() + m_childOffsets[parentElId+1]};
     }
 
     //! Returns the number of parent elements
@@ -35,19 +89,25 @@ public:
         return m_numParents;
     }
 
+    //! Returns the number of child elements
+    int getNumChildElements() const {
+        return static_cast<int>(m_parentIds.size());
+    }
+
     //! Returns the number of children for the parent element with
     //! index parentElId
     int getNumChildren(int parentElId) const {
-        return m_data[parentElId].size();
+        assert(m_finalized);
+        return m_childOffsets[parentElId+1] - m_childOffsets[parentElId];
     }
 
     //! Returns the index of the parent element for a given child element
-    int getParentId(int childId)
+    int getParentId(int childId) const
     {
-        for (int i=0; i<m_numParents; i++) {
-          if (m_data[i].find(childId) != m_data[i].end()) {
-              return i;
-          }
+        if (childId >= 0
+                && childId < static_cast<int>(m_parentIds.size())
+                && m_parentIds[childId] >= 0) {
+            return m_parentIds[childId];
         }
 #ifndef NDEBUG
         std::cout << "Child element with id " << childId
@@ -57,10 +117,15 @@ public:
         return -1;
     }
 
-    void print() {
+    //! Returns the parent of every child element
+    const std::vector<int>& getParentIds() const {
+        return m_parentIds;
+    }
+
+    void print() const {
         for (int i=0; i<m_numParents; i++) {
-            for (auto it=m_data[i].begin(); it!= m_data[i].end(); it++) {
-                std::cout << *it << "\t";
+            for (int child : (*this)(i)) {
+                std::cout << child << "\t";
             }
             std::cout << "\n";
         }
@@ -68,12 +133,76 @@ public:
 
 private:
    int m_numParents; // number of parent mesh elements
-   std::vector<std::set<int>> m_data; // stores the mesh hierarchy
+   std::vector<int> m_parentIds; // parent of every child element
+
+   // children of parent i are m_children[m_childOffsets[i]:m_childOffsets[i+1]]
+   bool m_finalized = false;
+   std::vector<int> m_childOffsets;
+   std::vector<int> m_children;
 } HierarchicalMeshTransformationTable;
 
 
 namespace mymfem
 {
+/**
+ * @brief Affine map from the reference coordinates of a child element
+ * to the reference coordinates of one of its ancestors;
+ * exact for nested meshes obtained by uniform refinement
+ */
+struct ChildInAncestorMap
+{
+    int dim = 0;
+    double A[9] = {}; // column-major, dim x dim
+    double b[3] = {};
+
+    //! Sets the identity map in dimension d
+    void setIdentity(int d) {
+        dim = d;
+        for (int i=0; i<9; i++) { A[i] = 0; }
+        for (int i=0; i<3; i++) { b[i] = 0; }
+        for (int i=0; i<dim; i++) { A[i*dim+i] = 1; }
+    }
+
+    //! Maps a point of the child reference element
+    //! to the ancestor reference element
+    void transform(const mfem::IntegrationPoint& ipChild,
+                   mfem::IntegrationPoint& ipAncestor) const
+    {
+        double xi[3] = {ipChild.x, ipChild.y, ipChild.z};
+        double x[3];
+        for (int i=0; i<dim; i++) {
+            x[i] = b[i];
+            for (int j=0; j<dim; j++) {
+                x[i] += A[j*dim+i]*xi[j];
+            }
+        }
+        ipAncestor.x = x[0];
+        ipAncestor.y = dim > 1 ? x[1] : 0.;
+        ipAncestor.z = dim > 2 ? x[2] : 0.;
+        ipAncestor.weight = ipChild.weight;
+    }
+
+    //! Returns the composition outer(this(.)),
+    //! for outer the map of the ancestor into its own ancestor
+    ChildInAncestorMap composeWith(const ChildInAncestorMap& outer) const
+    {
+        ChildInAncestorMap map;
+        map.dim = dim;
+        for (int i=0; i<dim; i++) {
+            map.b[i] = outer.b[i];
+            for (int k=0; k<dim; k++) {
+                map.b[i] += outer.A[k*dim+i]*b[k];
+            }
+            for (int j=0; j<dim; j++) {
+                for (int k=0; k<dim; k++) {
+                    map.A[j*dim+i] += outer.A[k*dim+i]*A[j*dim+k];
+                }
+            }
+        }
+        return map;
+    }
+};
+
 typedef std::vector<std::shared_ptr<mfem::Mesh>>
 NestedMeshes;
 
@@ -93,11 +222,20 @@ public:
     //! Default constructor
     NestedMeshHierarchy() {}
 
-    //! Adds mesh to the hierarchy
+    //! Adds mesh to the hierarchy;
+    //! the parents of its elements are located geometrically
     void addMesh(std::shared_ptr<mfem::Mesh>& mesh) {
         m_meshes.push_back(mesh);
+        m_refinementParentIds.emplace_back();
+        m_refinementChildMaps.emplace_back();
     }
 
+    //! Adds a mesh obtained by one uniform refinement
+    //! of the previously added mesh;
+    //! the parents of its elements, and their maps into the parents,
+    //! are read from the refinement records
+    void addUniformlyRefinedMesh(std::shared_ptr<mfem::Mesh>& mesh);
+
     void finalize() {
         buildHierarchicalTranformations();
     }
@@ -125,34 +263,87 @@ public:
         return m_hierarchicalTransformations;
     }
 
+    //! Returns the parent, on the level fineLevel-1,
+    //! of the element fineElId on the level fineLevel
+    int getParentId(int fineLevel, int fineElId) const {
+        return m_hierarchicalTransformations[fineLevel-1]
+                ->getParentId(fineElId);
+    }
+
+    //! Returns the transformation from the level coarseLevel
+    //! to the level fineLevel; built once per level pair
+    std::shared_ptr<HierarchicalMeshTransformationTable>
+    getTransformation(int coarseLevel, int fineLevel) const;
+
+    //! Returns true if the parents of the elements on the level
+    //! are taken from the refinement records of its mesh
+    bool hasRefinementRecords(int level) const {
+        return !m_refinementParentIds[level].empty();
+    }
+
+    //! Returns the ancestor, on the level coarseLevel,
+    //! of the element fineElId on the level fineLevel
+    int getAncestorId(int fineLevel, int fineElId, int coarseLevel) const {
+        if (coarseLevel == fineLevel) { return fineElId; }
+        return getTransformation(coarseLevel, fineLevel)
+                ->getParentId(fineElId);
+    }
+
+    //! Returns the map from the reference element of the element
+    //! fineElId on the level fineLevel to the reference element
+    //! of its ancestor on the level coarseLevel
+    ChildInAncestorMap getChildInAncestorMap(int fineLevel,
+                                             int fineElId,
+                                             int coarseLevel) const;
+
 private:
-    //! Builds the hierarchy tranformation between two successive meshes
+    //! Builds the hierarchy tranformation between two successive meshes,
+    //! from the refinement records if available
     void buildTranformationBetweenSuccessiveLevels (int id) const;
 
+    //! Locates the parents of the fine elements geometrically
+    std::vector<int> locateParentElements (int id) const;
+
+    //! Builds the maps of the fine elements into their parents,
+    //! between two successive meshes; from the refinement records
+    //! if available, else by inverting the parent transformations
+    void buildChildInParentMaps (int id) const;
+
 private:
     NestedMeshes m_meshes;
     mutable HierarchicalMeshTransformations m_hierarchicalTransformations;
+
+    //! per mesh, the parents of its elements in the previous mesh
+    //! from the refinement records; empty if not available
+    std::vector<std::vector<int>> m_refinementParentIds;
+
+    //! per mesh, the maps of its elements into their parents
+    //! from the refinement records; empty if not available
+    std::vector<std::vector<ChildInAncestorMap>> m_refinementChildMaps;
+
+    //! per level pair (coarse, fine), the memoized transformations
+    mutable std::vector<HierarchicalMeshTransformations>
+    m_multiLevelTransformations;
+
+    //! per successive level pair,
+    //! the map of every fine element into its parent
+    mutable std::vector<std::vector<ChildInAncestorMap>>
+    m_childInParentMaps;
 };
 
 //! Builds mesh hierarchy across multiple-levels
 //! using the hierarchies given between successive levels
 std::shared_ptr<HierarchicalMeshTransformationTable>
 buildMultiLevelMeshHierarchy
-(HierarchicalMeshTransformations& hierMeshTrans);
-
-//! For a given element in the coarsest mesh,
-//! builds mesh hierarchy across multiple-levels
-//! using the hierarchies given between successive levels
-std::set<int> buildElemMultiLevelMeshHierarchy
-(int coarseElId, HierarchicalMeshTransformations& hierMeshTrans);
+(const HierarchicalMeshTransformations& hierMeshTrans);
 
 //! Builds mesh hierarchy across multiple-levels
 //! using the hierarchical transformation of current mesh
 //! and the next hierarchy
 std::shared_ptr<HierarchicalMeshTransformationTable>
 buildMultiLevelMeshHierarchy
-(std::shared_ptr<HierarchicalMeshTransformationTable>& curHierarchy,
- std::shared_ptr<HierarchicalMeshTransformationTable>& nextHierarchy);
+(const std::shared_ptr<HierarchicalMeshTransformationTable>& curHierarchy,
+ const std::shared_ptr<HierarchicalMeshTransformationTable>& nextHierarchy);
 
 
 /**
@@ -201,9 +392,23 @@ public:
         return m_nestedMeshHierarchy->getTransformations();
     }
 
+    //! Returns the map of a fine element into its ancestor
+    ChildInAncestorMap getChildInAncestorMap(int fineLevel,
+                                             int fineElId,
+                                             int coarseLevel) const {
+        return m_nestedMeshHierarchy->getChildInAncestorMap
+                (fineLevel, fineElId, coarseLevel);
+    }
+
     //! Returns the number of dimensions (size) of the FE spaces
     mfem::Array<int> getNumDims();
 
+    //! Builds the prolongation from the level coarseLevel
+    //! to the level coarseLevel+1, by local interpolation
+    //! on every child of a coarse element;
+    //! the caller owns the returned matrix
+    mfem::SparseMatrix* buildProlongation(int coarseLevel);
+
 private:
     NestedFESpaces m_feSpaces;
     std::shared_ptr<NestedMeshHierarchy> m_nestedMeshHierarchy;
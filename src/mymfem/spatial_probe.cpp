@@ -0,0 +1,111 @@
+#include "spatial_probe.hpp"
+#include "utilities.hpp"
+
+#include <assert.h>
+
+using namespace mfem;
+
+
+mymfem::SpatialProbe
+:: SpatialProbe (Mesh *mesh, const DenseMatrix& X)
+    : m_mesh (mesh)
+{
+    assert(X.NumRows() == mesh->SpaceDimension());
+
+    PointLocator locator(mesh);
+    locator.locate(X, m_elIds, m_ips);
+}
+
+int mymfem::SpatialProbe
+:: getNumFound () const
+{
+    int numFound = 0;
+    for (int k=0; k<m_elIds.Size(); k++) {
+        if (m_elIds[k] >= 0) { numFound++; }
+    }
+    return numFound;
+}
+
+Array<int> mymfem::SpatialProbe
+:: getUnlocatedPoints () const
+{
+    Array<int> unlocated;
+    for (int k=0; k<m_elIds.Size(); k++) {
+        if (m_elIds[k] < 0) { unlocated.Append(k); }
+    }
+    return unlocated;
+}
+
+int mymfem::SpatialProbe
+:: getNumComponents (const FiniteElementSpace& fes)
+{
+    const FiniteElement *fe = fes.GetFE(0);
+    if (fe->GetRangeType() == FiniteElement::VECTOR) {
+        return fes.GetMesh()->SpaceDimension();
+    }
+    return fes.GetVDim();
+}
+
+SparseMatrix* mymfem::SpatialProbe
+:: buildEvaluation (FiniteElementSpace& fes) const
+{
+    assert(fes.GetMesh() == m_mesh);
+
+    int numPoints = getNumPoints();
+    int numComponents = getNumComponents(fes);
+    auto evaluation = new SparseMatrix(numPoints*numComponents,
+                                       fes.GetTrueVSize());
+
+    Array<int> vdofs;
+    Vector shape;
+    DenseMatrix vshape;
+    IsoparametricTransformation trans;
+    for (int k=0; k<numPoints; k++)
+    {
+        int elId = m_elIds[k];
+        if (elId < 0) { continue; }
+
+        const FiniteElement *fe = fes.GetFE(elId);
+        int ndofs = fe->GetDof();
+        fes.GetElementVDofs(elId, vdofs);
+
+        // negative dof indices flip the orientation of vector FEs
+        auto add = [&](int row, int dof, double val)
+        {
+            if (dof < 0) {
+                dof = -1-dof;
+                val = -val;
+            }
+            evaluation->Add(row, dof, val);
+        };
+
+        if (fe->GetRangeType() == FiniteElement::VECTOR)
+        {
+            m_mesh->GetElementTransformation(elId, &trans);
+            trans.SetIntPoint(&m_ips[k]);
+            vshape.SetSize(ndofs, numComponents);
+            fe->CalcVShape(trans, vshape);
+            for (int d=0; d<numComponents; d++) {
+                for (int i=0; i<ndofs; i++) {
+                    add(k*numComponents + d, vdofs[i], vshape(i,d));
+                }
+            }
+        }
+        else
+        {
+            shape.SetSize(ndofs);
+            fe->CalcShape(m_ips[k], shape);
+            for (int d=0; d<numComponents; d++) {
+                for (int i=0; i<ndofs; i++) {
+                    add(k*numComponents + d,
+                        vdofs[i + d*ndofs], shape(i));
+                }
+            }
+        }
+    }
+    evaluation->Finalize();
+
+    return evaluation;
+}
+
+// End of file
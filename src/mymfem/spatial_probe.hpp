@@ -0,0 +1,69 @@
+#ifndef MYMFEM_SPATIAL_PROBE_HPP
+#define MYMFEM_SPATIAL_PROBE_HPP
+
+#include "mfem.hpp"
+
+
+namespace mymfem {
+
+/**
+ * @brief Probes finite element functions at fixed physical points.
+ *
+ * The points are located once with the batched PointLocator;
+ * the element ids and reference points are cached, and the
+ * shape values of an FE space at the points are assembled into
+ * a sparse evaluation matrix. For vector-valued functions,
+ * the rows are ordered point-wise with the components fastest.
+ * Points outside the mesh have zero rows.
+ */
+class SpatialProbe
+{
+public:
+    /**
+     * @brief Locates the points on a mesh
+     * @param mesh Mesh, passed as pointer
+     * @param X collection of physical points, one column per point
+     */
+    SpatialProbe (mfem::Mesh *mesh, const mfem::DenseMatrix& X);
+
+    int getNumPoints() const {
+        return m_elIds.Size();
+    }
+
+    //! Returns the number of points located on the mesh
+    int getNumFound() const;
+
+    //! Returns the indices of the points outside the mesh
+    mfem::Array<int> getUnlocatedPoints() const;
+
+    const mfem::Array<int>& getElementIds() const {
+        return m_elIds;
+    }
+
+    const mfem::Array<mfem::IntegrationPoint>& getRefPoints() const {
+        return m_ips;
+    }
+
+    //! Returns the number of components of functions in the FE space
+    static int getNumComponents(const mfem::FiniteElementSpace& fes);
+
+    /**
+     * @brief Builds the evaluation matrix of an FE space
+     * defined on the mesh of the probe
+     * @param fes FE space
+     * @return matrix of size (number of points * components) x
+     * true size of the FE space; the caller owns the matrix
+     */
+    mfem::SparseMatrix* buildEvaluation
+    (mfem::FiniteElementSpace& fes) const;
+
+private:
+    mfem::Mesh *m_mesh;
+
+    mfem::Array<int> m_elIds;
+    mfem::Array<mfem::IntegrationPoint> m_ips;
+};
+
+}
+
+#endif // MYMFEM_SPATIAL_PROBE_HPP
@@ -0,0 +1,857 @@
+#include "tensor_kernels.hpp"
+
+#include <cmath>
+#include <assert.h>
+
+using namespace mfem;
+
+
+//----------------------//
+//  Sum-factorisations  //
+//----------------------//
+
+// The 1D tables are row-major, B[q*D1D + d]. Element dofs and
+// quadrature point values are lexicographic, x fastest.
+
+namespace {
+
+template <int D1D, int Q1D>
+inline void evalValues2D (const double *B, const double *X, double *U)
+{
+    double T[D1D*Q1D];
+    for (int dy=0; dy<D1D; dy++)
+        for (int qx=0; qx<Q1D; qx++) {
+            double s = 0;
+            for (int dx=0; dx<D1D; dx++) {
+                s += B[qx*D1D+dx]*X[dy*D1D+dx];
+            }
+            T[dy*Q1D+qx] = s;
+        }
+    for (int qy=0; qy<Q1D; qy++)
+        for (int qx=0; qx<Q1D; qx++) {
+            double s = 0;
+            for (int dy=0; dy<D1D; dy++) {
+                s += B[qy*D1D+dy]*T[dy*Q1D+qx];
+            }
+            U[qy*Q1D+qx] = s;
+        }
+}
+
+template <int D1D, int Q1D>
+inline void integrateValues2D (const double *B, const double *U, double *Y)
+{
+    double T[D1D*Q1D];
+    for (int dy=0; dy<D1D; dy++)
+        for (int qx=0; qx<Q1D; qx++) {
+            double s = 0;
+            for (int qy=0; qy<Q1D; qy++) {
+                s += B[qy*D1D+dy]*U[qy*Q1D+qx];
+            }
+            T[dy*Q1D+qx] = s;
+        }
+    for (int dy=0; dy<D1D; dy++)
+        for (int dx=0; dx<D1D; dx++) {
+            double s = 0;
+            for (int qx=0; qx<Q1D; qx++) {
+                s += B[qx*D1D+dx]*T[dy*Q1D+qx];
+            }
+            Y[dy*D1D+dx] = s;
+        }
+}
+
+template <int D1D, int Q1D>
+inline void evalGradients2D (const double *B, const double *G,
+                             const double *X, double *U0, double *U1)
+{
+    double BX[D1D*Q1D], GX[D1D*Q1D];
+    for (int dy=0; dy<D1D; dy++)
+        for (int qx=0; qx<Q1D; qx++) {
+            double sb = 0, sg = 0;
+            for (int dx=0; dx<D1D; dx++) {
+                sb += B[qx*D1D+dx]*X[dy*D1D+dx];
+                sg += G[qx*D1D+dx]*X[dy*D1D+dx];
+            }
+            BX[dy*Q1D+qx] = sb;
+            GX[dy*Q1D+qx] = sg;
+        }
+    for (int qy=0; qy<Q1D; qy++)
+        for (int qx=0; qx<Q1D; qx++) {
+            double s0 = 0, s1 = 0;
+            for (int dy=0; dy<D1D; dy++) {
+                s0 += B[qy*D1D+dy]*GX[dy*Q1D+qx];
+                s1 += G[qy*D1D+dy]*BX[dy*Q1D+qx];
+            }
+            U0[qy*Q1D+qx] = s0;
+            U1[qy*Q1D+qx] = s1;
+        }
+}
+
+template <int D1D, int Q1D>
+inline void integrateGradients2D (const double *B, const double *G,
+                                  const double *F0, const double *F1,
+                                  double *Y)
+{
+    double T0[D1D*Q1D], T1[D1D*Q1D];
+    for (int dy=0; dy<D1D; dy++)
+        for (int qx=0; qx<Q1D; qx++) {
+            double s0 = 0, s1 = 0;
+            for (int qy=0; qy<Q1D; qy++) {
+                s0 += B[qy*D1D+dy]*F0[qy*Q1D+qx];
+                s1 += G[qy*D1D+dy]*F1[qy*Q1D+qx];
+            }
+            T0[dy*Q1D+qx] = s0;
+            T1[dy*Q1D+qx] = s1;
+        }
+    for (int dy=0; dy<D1D; dy++)
+        for (int dx=0; dx<D1D; dx++) {
+            double s = 0;
+            for (int qx=0; qx<Q1D; qx++) {
+                s += G[qx*D1D+dx]*T0[dy*Q1D+qx]
+                        + B[qx*D1D+dx]*T1[dy*Q1D+qx];
+            }
+            Y[dy*D1D+dx] = s;
+        }
+}
+
+template <int D1D, int Q1D>
+inline void evalValues3D (const double *B, const double *X, double *U)
+{
+    double T1[D1D*D1D*Q1D], T2[D1D*Q1D*Q1D];
+    for (int dz=0; dz<D1D; dz++)
+        for (int dy=0; dy<D1D; dy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double s = 0;
+                for (int dx=0; dx<D1D; dx++) {
+                    s += B[qx*D1D+dx]*X[(dz*D1D+dy)*D1D+dx];
+                }
+                T1[(dz*D1D+dy)*Q1D+qx] = s;
+            }
+    for (int dz=0; dz<D1D; dz++)
+        for (int qy=0; qy<Q1D; qy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double s = 0;
+                for (int dy=0; dy<D1D; dy++) {
+                    s += B[qy*D1D+dy]*T1[(dz*D1D+dy)*Q1D+qx];
+                }
+                T2[(dz*Q1D+qy)*Q1D+qx] = s;
+            }
+    for (int qz=0; qz<Q1D; qz++)
+        for (int qy=0; qy<Q1D; qy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double s = 0;
+                for (int dz=0; dz<D1D; dz++) {
+                    s += B[qz*D1D+dz]*T2[(dz*Q1D+qy)*Q1D+qx];
+                }
+                U[(qz*Q1D+qy)*Q1D+qx] = s;
+            }
+}
+
+template <int D1D, int Q1D>
+inline void integrateValues3D (const double *B, const double *U, double *Y)
+{
+    double T1[D1D*D1D*Q1D], T2[D1D*Q1D*Q1D];
+    for (int dz=0; dz<D1D; dz++)
+        for (int qy=0; qy<Q1D; qy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double s = 0;
+                for (int qz=0; qz<Q1D; qz++) {
+                    s += B[qz*D1D+dz]*U[(qz*Q1D+qy)*Q1D+qx];
+                }
+                T2[(dz*Q1D+qy)*Q1D+qx] = s;
+            }
+    for (int dz=0; dz<D1D; dz++)
+        for (int dy=0; dy<D1D; dy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double s = 0;
+                for (int qy=0; qy<Q1D; qy++) {
+                    s += B[qy*D1D+dy]*T2[(dz*Q1D+qy)*Q1D+qx];
+                }
+                T1[(dz*D1D+dy)*Q1D+qx] = s;
+            }
+    for (int dz=0; dz<D1D; dz++)
+        for (int dy=0; dy<D1D; dy++)
+            for (int dx=0; dx<D1D; dx++) {
+                double s = 0;
+                for (int qx=0; qx<Q1D; qx++) {
+                    s += B[qx*D1D+dx]*T1[(dz*D1D+dy)*Q1D+qx];
+                }
+                Y[(dz*D1D+dy)*D1D+dx] = s;
+            }
+}
+
+template <int D1D, int Q1D>
+inline void evalGradients3D (const double *B, const double *G,
+                             const double *X,
+                             double *U0, double *U1, double *U2)
+{
+    double BX[D1D*D1D*Q1D], GX[D1D*D1D*Q1D];
+    for (int dz=0; dz<D1D; dz++)
+        for (int dy=0; dy<D1D; dy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double sb = 0, sg = 0;
+                for (int dx=0; dx<D1D; dx++) {
+                    double x = X[(dz*D1D+dy)*D1D+dx];
+                    sb += B[qx*D1D+dx]*x;
+                    sg += G[qx*D1D+dx]*x;
+                }
+                BX[(dz*D1D+dy)*Q1D+qx] = sb;
+                GX[(dz*D1D+dy)*Q1D+qx] = sg;
+            }
+
+    double BBX[D1D*Q1D*Q1D], BGX[D1D*Q1D*Q1D], GBX[D1D*Q1D*Q1D];
+    for (int dz=0; dz<D1D; dz++)
+        for (int qy=0; qy<Q1D; qy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double sbb = 0, sbg = 0, sgb = 0;
+                for (int dy=0; dy<D1D; dy++) {
+                    int k = (dz*D1D+dy)*Q1D+qx;
+                    sbb += B[qy*D1D+dy]*BX[k];
+                    sbg += B[qy*D1D+dy]*GX[k];
+                    sgb += G[qy*D1D+dy]*BX[k];
+                }
+                int l = (dz*Q1D+qy)*Q1D+qx;
+                BBX[l] = sbb;
+                BGX[l] = sbg;
+                GBX[l] = sgb;
+            }
+
+    for (int qz=0; qz<Q1D; qz++)
+        for (int qy=0; qy<Q1D; qy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double s0 = 0, s1 = 0, s2 = 0;
+                for (int dz=0; dz<D1D; dz++) {
+                    int l = (dz*Q1D+qy)*Q1D+qx;
+                    s0 += B[qz*D1D+dz]*BGX[l];
+                    s1 += B[qz*D1D+dz]*GBX[l];
+                    s2 += G[qz*D1D+dz]*BBX[l];
+                }
+                int q = (qz*Q1D+qy)*Q1D+qx;
+                U0[q] = s0;
+                U1[q] = s1;
+                U2[q] = s2;
+            }
+}
+
+template <int D1D, int Q1D>
+inline void integrateGradients3D (const double *B, const double *G,
+                                  const double *F0, const double *F1,
+                                  const double *F2, double *Y)
+{
+    double BGX[D1D*Q1D*Q1D], GBX[D1D*Q1D*Q1D], BBX[D1D*Q1D*Q1D];
+    for (int dz=0; dz<D1D; dz++)
+        for (int qy=0; qy<Q1D; qy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double s0 = 0, s1 = 0, s2 = 0;
+                for (int qz=0; qz<Q1D; qz++) {
+                    int q = (qz*Q1D+qy)*Q1D+qx;
+                    s0 += B[qz*D1D+dz]*F0[q];
+                    s1 += B[qz*D1D+dz]*F1[q];
+                    s2 += G[qz*D1D+dz]*F2[q];
+                }
+                int l = (dz*Q1D+qy)*Q1D+qx;
+                BGX[l] = s0;
+                GBX[l] = s1;
+                BBX[l] = s2;
+            }
+
+    double GX[D1D*D1D*Q1D], BX[D1D*D1D*Q1D];
+    for (int dz=0; dz<D1D; dz++)
+        for (int dy=0; dy<D1D; dy++)
+            for (int qx=0; qx<Q1D; qx++) {
+                double sg = 0, sb = 0;
+                for (int qy=0; qy<Q1D; qy++) {
+                    int l = (dz*Q1D+qy)*Q1D+qx;
+                    sg += B[qy*D1D+dy]*BGX[l];
+                    sb += G[qy*D1D+dy]*GBX[l] + B[qy*D1D+dy]*BBX[l];
+                }
+                GX[(dz*D1D+dy)*Q1D+qx] = sg;
+                BX[(dz*D1D+dy)*Q1D+qx] = sb;
+            }
+
+    for (int dz=0; dz<D1D; dz++)
+        for (int dy=0; dy<D1D; dy++)
+            for (int dx=0; dx<D1D; dx++) {
+                double s = 0;
+                for (int qx=0; qx<Q1D; qx++) {
+                    int k = (dz*D1D+dy)*Q1D+qx;
+                    s += G[qx*D1D+dx]*GX[k] + B[qx*D1D+dx]*BX[k];
+                }
+                Y[(dz*D1D+dy)*D1D+dx] = s;
+            }
+}
+
+//! Sets the integration point of a tensor-product rule
+inline void setTensorIntPoint (const mymfem::TensorBasis1D& basis,
+                               int dim, int q, IntegrationPoint& ip)
+{
+    int Q1D = basis.numQuads;
+    int qx = q % Q1D;
+    int qy = (q / Q1D) % Q1D;
+    ip.x = basis.points[qx];
+    ip.y = basis.points[qy];
+    ip.weight = basis.weights[qx]*basis.weights[qy];
+    if (dim == 3) {
+        int qz = q / (Q1D*Q1D);
+        ip.z = basis.points[qz];
+        ip.weight *= basis.weights[qz];
+    }
+}
+
+//! Evaluates K = M adj(J)^T and the weighted det(J)
+//! at a quadrature point; M is the identity if not given
+inline void evalGeometry (MatrixCoefficient *M,
+                          ElementTransformation& trans,
+                          const IntegrationPoint& ip,
+                          DenseMatrix& K, double& detJ)
+{
+    int dim = trans.GetDimension();
+    DenseMatrix adjJ(dim), matM(dim);
+
+    trans.SetIntPoint(&ip);
+    CalcAdjugate(trans.Jacobian(), adjJ);
+    detJ = trans.Weight();
+
+    if (M) {
+        M->Eval(matM, trans, ip);
+        MultABt(matM, adjJ, K);
+    }
+    else {
+        K.Transpose(adjJ);
+    }
+}
+
+}
+
+
+//---------------//
+//  1D Basis     //
+//---------------//
+
+mymfem::TensorBasis1D mymfem::evalTensorBasis1D
+(int order, int numQuads, int basisType)
+{
+    TensorBasis1D basis;
+    basis.numDofs = order+1;
+    basis.numQuads = numQuads;
+
+    const IntegrationRule &ir
+            = IntRules.Get(Geometry::SEGMENT, 2*numQuads-1);
+    assert(ir.GetNPoints() == numQuads);
+
+    Poly_1D::Basis &basis1D = poly1d.GetBasis(order, basisType);
+    Vector u(order+1), d(order+1);
+
+    basis.B.SetSize(numQuads*(order+1));
+    basis.G.SetSize(numQuads*(order+1));
+    basis.points.SetSize(numQuads);
+    basis.weights.SetSize(numQuads);
+    for (int q=0; q<numQuads; q++)
+    {
+        const IntegrationPoint &ip = ir.IntPoint(q);
+        basis1D.Eval(ip.x, u, d);
+        for (int i=0; i<=order; i++) {
+            basis.B[q*(order+1)+i] = u(i);
+            basis.G[q*(order+1)+i] = d(i);
+        }
+        basis.points[q] = ip.x;
+        basis.weights[q] = ip.weight;
+    }
+
+    return basis;
+}
+
+
+//---------------------//
+//  Base PA operator   //
+//---------------------//
+
+mymfem::TensorPAOperator
+:: TensorPAOperator (FiniteElementSpace *trialFes,
+                     FiniteElementSpace *testFes,
+                     int numQuads1D)
+    : Operator (testFes->GetVSize(), trialFes->GetVSize()),
+      m_trialFes (trialFes),
+      m_testFes (testFes)
+{
+    assert(hasTensorKernelSupport(*m_trialFes));
+    assert(hasTensorKernelSupport(*m_testFes));
+
+    m_dim = m_testFes->GetMesh()->Dimension();
+    m_numElements = m_testFes->GetNE();
+    m_numQuads = static_cast<int>(std::pow(numQuads1D, m_dim));
+
+    auto h1Coll = dynamic_cast<const H1_FECollection*>
+            (m_trialFes->FEColl());
+    m_basis = evalTensorBasis1D(m_trialFes->GetFE(0)->GetOrder(),
+                                numQuads1D,
+                                h1Coll->GetBasisType());
+
+    setElementDofs(m_trialFes, m_trialElDofs);
+    setElementDofs(m_testFes, m_testElDofs);
+
+    m_coloring = std::make_unique<ElementColoring>(*m_testFes);
+}
+
+void mymfem::TensorPAOperator
+:: setElementDofs (FiniteElementSpace *fes,
+                   Array<int>& elDofs) const
+{
+    int vdim = fes->GetVDim();
+    int ndofs = fes->GetFE(0)->GetDof();
+    elDofs.SetSize(m_numElements*vdim*ndofs);
+
+    Array<int> vdofs;
+    for (int e=0; e<m_numElements; e++)
+    {
+        fes->GetElementVDofs(e, vdofs);
+        auto tensorFe = dynamic_cast<const TensorBasisElement*>
+                (fes->GetFE(e));
+        const Array<int>& dofMap = tensorFe->GetDofMap();
+
+        // an empty dof map means the native ordering is lexicographic
+        for (int c=0; c<vdim; c++)
+            for (int l=0; l<ndofs; l++) {
+                int native = dofMap.Size() ? dofMap[l] : l;
+                elDofs[(e*vdim + c)*ndofs + l]
+                        = vdofs[c*ndofs + native];
+            }
+    }
+}
+
+bool mymfem::hasTensorKernelSupport (const FiniteElementSpace& fes)
+{
+    if (!dynamic_cast<const H1_FECollection*>(fes.FEColl())) {
+        return false;
+    }
+
+    const Mesh *mesh = fes.GetMesh();
+    int dim = mesh->Dimension();
+    if (dim != 2 && dim != 3) {
+        return false;
+    }
+
+    const int geom = (dim == 2) ? Geometry::SQUARE : Geometry::CUBE;
+    for (int e=0; e<mesh->GetNE(); e++) {
+        if (mesh->GetElementBaseGeometry(e) != geom) {
+            return false;
+        }
+    }
+
+    int order = fes.GetFE(0)->GetOrder();
+    return (order >= 1 && order <= 4);
+}
+
+
+//-------------------//
+//  Mass operator    //
+//-------------------//
+
+template <int Dim, int Order>
+mymfem::TensorMassOperator<Dim, Order>
+:: TensorMassOperator (FiniteElementSpace *fes)
+    : TensorPAOperator (fes, fes, Q1D)
+{
+    Mesh *mesh = fes->GetMesh();
+    m_geomFactors.SetSize(m_numElements*m_numQuads);
+
+    IntegrationPoint ip;
+    for (int e=0; e<m_numElements; e++)
+    {
+        ElementTransformation *trans = mesh->GetElementTransformation(e);
+        for (int q=0; q<m_numQuads; q++) {
+            setTensorIntPoint(m_basis, Dim, q, ip);
+            trans->SetIntPoint(&ip);
+            m_geomFactors(e*m_numQuads + q) = ip.weight*trans->Weight();
+        }
+    }
+}
+
+template <int Dim, int Order>
+void mymfem::TensorMassOperator<Dim, Order>
+:: Mult (const Vector& x, Vector& y) const
+{
+    constexpr int ND = (Dim == 2) ? D1D*D1D : D1D*D1D*D1D;
+    constexpr int NQ = (Dim == 2) ? Q1D*Q1D : Q1D*Q1D*Q1D;
+
+    const double *B = m_basis.B.GetData();
+    const double *D = m_geomFactors.GetData();
+    const double *xData = x.GetData();
+    double *yData = y.GetData();
+
+    y = 0.;
+    #pragma omp parallel
+    {
+        double X[ND], Y[ND], U[NQ];
+        for (int c=0; c<m_coloring->getNumColors(); c++)
+        {
+            const int *elIds = m_coloring->getElements(c);
+
+            #pragma omp for
+            for (int k=0; k<m_coloring->getNumElements(c); k++)
+            {
+                int e = elIds[k];
+                const int *dofs = m_trialElDofs.GetData() + e*ND;
+                for (int l=0; l<ND; l++) { X[l] = xData[dofs[l]]; }
+
+                if constexpr (Dim == 2) {
+                    evalValues2D<D1D, Q1D>(B, X, U);
+                } else {
+                    evalValues3D<D1D, Q1D>(B, X, U);
+                }
+                for (int q=0; q<NQ; q++) { U[q] *= D[e*NQ + q]; }
+                if constexpr (Dim == 2) {
+                    integrateValues2D<D1D, Q1D>(B, U, Y);
+                } else {
+                    integrateValues3D<D1D, Q1D>(B, U, Y);
+                }
+
+                for (int l=0; l<ND; l++) { yData[dofs[l]] += Y[l]; }
+            }
+        }
+    }
+}
+
+
+//----------------------//
+//  Stiffness operator  //
+//----------------------//
+
+template <int Dim, int Order>
+mymfem::TensorStiffnessOperator<Dim, Order>
+:: TensorStiffnessOperator (FiniteElementSpace *fes,
+                            MatrixCoefficient *M)
+    : TensorPAOperator (fes, fes, Q1D)
+{
+    Mesh *mesh = fes->GetMesh();
+    m_geomFactors.SetSize(m_numElements*m_numQuads*numSymm);
+
+    IntegrationPoint ip;
+    DenseMatrix K(Dim), KtK(Dim);
+    double detJ;
+    for (int e=0; e<m_numElements; e++)
+    {
+        ElementTransformation *trans = mesh->GetElementTransformation(e);
+        for (int q=0; q<m_numQuads; q++)
+        {
+            setTensorIntPoint(m_basis, Dim, q, ip);
+            evalGeometry(M, *trans, ip, K, detJ);
+            MultAtB(K, K, KtK);
+
+            double *D = m_geomFactors.GetData()
+                    + (e*m_numQuads + q)*numSymm;
+            double w = ip.weight/detJ;
+            for (int i=0, k=0; i<Dim; i++)
+                for (int j=i; j<Dim; j++) {
+                    D[k++] = w*KtK(i,j);
+                }
+        }
+    }
+}
+
+template <int Dim, int Order>
+void mymfem::TensorStiffnessOperator<Dim, Order>
+:: Mult (const Vector& x, Vector& y) const
+{
+    constexpr int ND = (Dim == 2) ? D1D*D1D : D1D*D1D*D1D;
+    constexpr int NQ = (Dim == 2) ? Q1D*Q1D : Q1D*Q1D*Q1D;
+
+    const double *B = m_basis.B.GetData();
+    const double *G = m_basis.G.GetData();
+    const double *xData = x.GetData();
+    double *yData = y.GetData();
+
+    y = 0.;
+    #pragma omp parallel
+    {
+        double X[ND], Y[ND], U[Dim][NQ];
+        for (int c=0; c<m_coloring->getNumColors(); c++)
+        {
+            const int *elIds = m_coloring->getElements(c);
+
+            #pragma omp for
+            for (int k=0; k<m_coloring->getNumElements(c); k++)
+            {
+                int e = elIds[k];
+                const int *dofs = m_trialElDofs.GetData() + e*ND;
+                for (int l=0; l<ND; l++) { X[l] = xData[dofs[l]]; }
+
+                const double *D = m_geomFactors.GetData() + e*NQ*numSymm;
+                if constexpr (Dim == 2)
+                {
+                    evalGradients2D<D1D, Q1D>(B, G, X, U[0], U[1]);
+                    for (int q=0; q<NQ; q++, D+=numSymm) {
+                        double g0 = U[0][q], g1 = U[1][q];
+                        U[0][q] = D[0]*g0 + D[1]*g1;
+                        U[1][q] = D[1]*g0 + D[2]*g1;
+                    }
+                    integrateGradients2D<D1D, Q1D>(B, G, U[0], U[1], Y);
+                }
+                else
+                {
+                    evalGradients3D<D1D, Q1D>(B, G, X, U[0], U[1], U[2]);
+                    for (int q=0; q<NQ; q++, D+=numSymm) {
+                        double g0 = U[0][q], g1 = U[1][q], g2 = U[2][q];
+                        U[0][q] = D[0]*g0 + D[1]*g1 + D[2]*g2;
+                        U[1][q] = D[1]*g0 + D[3]*g1 + D[4]*g2;
+                        U[2][q] = D[2]*g0 + D[4]*g1 + D[5]*g2;
+                    }
+                    integrateGradients3D<D1D, Q1D>(B, G, U[0], U[1], U[2],
+                                                   Y);
+                }
+
+                for (int l=0; l<ND; l++) { yData[dofs[l]] += Y[l]; }
+            }
+        }
+    }
+}
+
+
+//---------------------//
+//  Gradient operator  //
+//---------------------//
+
+template <int Dim, int Order>
+mymfem::TensorGradientOperator<Dim, Order>
+:: TensorGradientOperator (FiniteElementSpace *trialFes,
+                           FiniteElementSpace *testFes,
+                           MatrixCoefficient *M)
+    : TensorPAOperator (trialFes, testFes, Q1D)
+{
+    assert(trialFes->GetVDim() == 1);
+    assert(testFes->GetVDim() == Dim);
+    assert(testFes->GetFE(0)->GetOrder() == Order);
+
+    Mesh *mesh = trialFes->GetMesh();
+    m_geomFactors.SetSize(m_numElements*m_numQuads*Dim*Dim);
+
+    IntegrationPoint ip;
+    DenseMatrix K(Dim);
+    double detJ;
+    for (int e=0; e<m_numElements; e++)
+    {
+        ElementTransformation *trans = mesh->GetElementTransformation(e);
+        for (int q=0; q<m_numQuads; q++)
+        {
+            setTensorIntPoint(m_basis, Dim, q, ip);
+            evalGeometry(M, *trans, ip, K, detJ);
+
+            double *D = m_geomFactors.GetData()
+                    + (e*m_numQuads + q)*Dim*Dim;
+            for (int i=0; i<Dim; i++)
+                for (int j=0; j<Dim; j++) {
+                    D[i*Dim+j] = ip.weight*K(i,j);
+                }
+        }
+    }
+}
+
+template <int Dim, int Order>
+void mymfem::TensorGradientOperator<Dim, Order>
+:: Mult (const Vector& x, Vector& y) const
+{
+    constexpr int ND = (Dim == 2) ? D1D*D1D : D1D*D1D*D1D;
+    constexpr int NQ = (Dim == 2) ? Q1D*Q1D : Q1D*Q1D*Q1D;
+
+    const double *B = m_basis.B.GetData();
+    const double *G = m_basis.G.GetData();
+    const double *xData = x.GetData();
+    double *yData = y.GetData();
+
+    y = 0.;
+    #pragma omp parallel
+    {
+        double X[ND], Y[ND], U[Dim][NQ], F[NQ];
+        for (int c=0; c<m_coloring->getNumColors(); c++)
+        {
+            const int *elIds = m_coloring->getElements(c);
+
+            #pragma omp for
+            for (int k=0; k<m_coloring->getNumElements(c); k++)
+            {
+                int e = elIds[k];
+                const int *trialDofs = m_trialElDofs.GetData() + e*ND;
+                for (int l=0; l<ND; l++) { X[l] = xData[trialDofs[l]]; }
+
+                if constexpr (Dim == 2) {
+                    evalGradients2D<D1D, Q1D>(B, G, X, U[0], U[1]);
+                } else {
+                    evalGradients3D<D1D, Q1D>(B, G, X, U[0], U[1], U[2]);
+                }
+
+                // every component of the flux is
+                // tested with the scalar basis
+                const double *D = m_geomFactors.GetData() + e*NQ*Dim*Dim;
+                for (int i=0; i<Dim; i++)
+                {
+                    for (int q=0; q<NQ; q++) {
+                        double s = 0;
+                        for (int j=0; j<Dim; j++) {
+                            s += D[q*Dim*Dim + i*Dim + j]*U[j][q];
+                        }
+                        F[q] = s;
+                    }
+                    if constexpr (Dim == 2) {
+                        integrateValues2D<D1D, Q1D>(B, F, Y);
+                    } else {
+                        integrateValues3D<D1D, Q1D>(B, F, Y);
+                    }
+
+                    const int *testDofs
+                            = m_testElDofs.GetData() + (e*Dim + i)*ND;
+                    for (int l=0; l<ND; l++) {
+                        yData[testDofs[l]] += Y[l];
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+//-------------//
+//  Factories  //
+//-------------//
+
+namespace {
+
+//! Instantiates the operator for the runtime dimension and order
+template <template<int, int> class TensorOp, typename... Args>
+std::unique_ptr<mymfem::TensorPAOperator>
+makeTensorOperator (int dim, int order, Args... args)
+{
+    switch (10*dim + order)
+    {
+    case 21: return std::make_unique<TensorOp<2,1>>(args...);
+    case 22: return std::make_unique<TensorOp<2,2>>(args...);
+    case 23: return std::make_unique<TensorOp<2,3>>(args...);
+    case 24: return std::make_unique<TensorOp<2,4>>(args...);
+    case 31: return std::make_unique<TensorOp<3,1>>(args...);
+    case 32: return std::make_unique<TensorOp<3,2>>(args...);
+    case 33: return std::make_unique<TensorOp<3,3>>(args...);
+    case 34: return std::make_unique<TensorOp<3,4>>(args...);
+    default: return nullptr;
+    }
+}
+
+}
+
+std::unique_ptr<mymfem::TensorPAOperator> mymfem::makeTensorMassOperator
+(FiniteElementSpace *fes)
+{
+    if (!hasTensorKernelSupport(*fes) || fes->GetVDim() != 1) {
+        return nullptr;
+    }
+    return makeTensorOperator<TensorMassOperator>
+            (fes->GetMesh()->Dimension(), fes->GetFE(0)->GetOrder(), fes);
+}
+
+std::unique_ptr<mymfem::TensorPAOperator>
+mymfem::makeTensorStiffnessOperator
+(FiniteElementSpace *fes, MatrixCoefficient *M)
+{
+    if (!hasTensorKernelSupport(*fes) || fes->GetVDim() != 1) {
+        return nullptr;
+    }
+    return makeTensorOperator<TensorStiffnessOperator>
+            (fes->GetMesh()->Dimension(), fes->GetFE(0)->GetOrder(),
+             fes, M);
+}
+
+std::unique_ptr<mymfem::TensorPAOperator>
+mymfem::makeTensorGradientOperator
+(FiniteElementSpace *trialFes, FiniteElementSpace *testFes,
+ MatrixCoefficient *M)
+{
+    int dim = trialFes->GetMesh()->Dimension();
+    int order = trialFes->GetFE(0)->GetOrder();
+    if (!hasTensorKernelSupport(*trialFes)
+            || !hasTensorKernelSupport(*testFes)
+            || trialFes->GetVDim() != 1
+            || testFes->GetVDim() != dim
+            || testFes->GetFE(0)->GetOrder() != order) {
+        return nullptr;
+    }
+    return makeTensorOperator<TensorGradientOperator>
+            (dim, order, trialFes, testFes, M);
+}
+
+
+//----------------------//
+//  Kronecker operator  //
+//----------------------//
+
+mymfem::KroneckerOperator
+:: KroneckerOperator (const SparseMatrix& temporalMat,
+                      const Operator& spatialOp)
+    : Operator (temporalMat.Height()*spatialOp.Height(),
+                temporalMat.Width()*spatialOp.Width()),
+      m_temporalMat (temporalMat),
+      m_spatialOp (spatialOp)
+{}
+
+void mymfem::KroneckerOperator
+:: Mult (const Vector& x, Vector& y) const
+{
+    int xdimIn = m_spatialOp.Width();
+    int xdimOut = m_spatialOp.Height();
+    int tdimIn = m_temporalMat.Width();
+    int tdimOut = m_temporalMat.Height();
+
+    // apply the spatial operator to every temporal slice
+    m_buf.SetSize(xdimOut*tdimIn);
+    for (int j=0; j<tdimIn; j++) {
+        Vector xSlice(const_cast<double*>(x.GetData()) + j*xdimIn, xdimIn);
+        Vector bufSlice(m_buf.GetData() + j*xdimOut, xdimOut);
+        m_spatialOp.Mult(xSlice, bufSlice);
+    }
+
+    // combine the slices with the temporal matrix
+    const int *I = m_temporalMat.GetI();
+    const int *J = m_temporalMat.GetJ();
+    const double *A = m_temporalMat.GetData();
+
+    y = 0.;
+    #pragma omp parallel for
+    for (int i=0; i<tdimOut; i++)
+    {
+        double *ySlice = y.GetData() + i*xdimOut;
+        for (int k=I[i]; k<I[i+1]; k++)
+        {
+            const double *bufSlice = m_buf.GetData() + J[k]*xdimOut;
+            for (int l=0; l<xdimOut; l++) {
+                ySlice[l] += A[k]*bufSlice[l];
+            }
+        }
+    }
+}
+
+
+// explicit instantiations
+template class mymfem::TensorMassOperator<2,1>;
+template class mymfem::TensorMassOperator<2,2>;
+template class mymfem::TensorMassOperator<2,3>;
+template class mymfem::TensorMassOperator<2,4>;
+template class mymfem::TensorMassOperator<3,1>;
+template class mymfem::TensorMassOperator<3,2>;
+template class mymfem::TensorMassOperator<3,3>;
+template class mymfem::TensorMassOperator<3,4>;
+
+template class mymfem::TensorStiffnessOperator<2,1>;
+template class mymfem::TensorStiffnessOperator<2,2>;
+template class mymfem::TensorStiffnessOperator<2,3>;
+template class mymfem::TensorStiffnessOperator<2,4>;
+template class mymfem::TensorStiffnessOperator<3,1>;
+template class mymfem::TensorStiffnessOperator<3,2>;
+template class mymfem::TensorStiffnessOperator<3,3>;
+template class mymfem::TensorStiffnessOperator<3,4>;
+
+template class mymfem::TensorGradientOperator<2,1>;
+template class mymfem::TensorGradientOperator<2,2>;
+template class mymfem::TensorGradientOperator<2,3>;
+template class mymfem::TensorGradientOperator<2,4>;
+template class mymfem::TensorGradientOperator<3,1>;
+template class mymfem::TensorGradientOperator<3,2>;
+template class mymfem::TensorGradientOperator<3,3>;
+template class mymfem::TensorGradientOperator<3,4>;
+
+// End of file
@@ -0,0 +1,184 @@
+#ifndef MYMFEM_TENSOR_KERNELS_HPP
+#define MYMFEM_TENSOR_KERNELS_HPP
+
+#include "mfem.hpp"
+
+#include <memory>
+
+#include "threaded_assembly.hpp"
+
+
+namespace mymfem {
+
+/**
+ * @brief One-dimensional H1 basis values and derivatives
+ * at the Gauss-Legendre points, stored row-major
+ * as numQuads x numDofs
+ */
+struct TensorBasis1D
+{
+    int numDofs = 0;
+    int numQuads = 0;
+
+    mfem::Array<double> B, G;
+    mfem::Array<double> points, weights;
+};
+
+//! Evaluates the 1D basis of given order and basis type
+//! at numQuads Gauss-Legendre points
+TensorBasis1D evalTensorBasis1D (int order, int numQuads, int basisType);
+
+
+/**
+ * @brief Base class for partially assembled operators on
+ * tensor-product (quad/hex) meshes with H1 spaces.
+ *
+ * Stores the element dofs in lexicographic order and
+ * the 1D basis tables; the derived classes store the
+ * geometric factors at the quadrature points.
+ * Mult is threaded over the colours of the test space elements.
+ */
+class TensorPAOperator : public mfem::Operator
+{
+public:
+    TensorPAOperator (mfem::FiniteElementSpace *trialFes,
+                      mfem::FiniteElementSpace *testFes,
+                      int numQuads1D);
+
+    virtual ~ TensorPAOperator () = default;
+
+    //! Returns the number of quadrature points per element
+    int getNumQuads() const {
+        return m_numQuads;
+    }
+
+protected:
+    void setElementDofs (mfem::FiniteElementSpace *fes,
+                         mfem::Array<int>& elDofs) const;
+
+protected:
+    mfem::FiniteElementSpace *m_trialFes = nullptr;
+    mfem::FiniteElementSpace *m_testFes = nullptr;
+
+    int m_dim, m_numElements, m_numQuads;
+    TensorBasis1D m_basis;
+
+    //! element vdofs in lexicographic order, per element
+    mfem::Array<int> m_trialElDofs, m_testElDofs;
+
+    std::unique_ptr<ElementColoring> m_coloring;
+};
+
+
+/**
+ * @brief Partially assembled mass operator; (u, v)
+ */
+template <int Dim, int Order>
+class TensorMassOperator : public TensorPAOperator
+{
+public:
+    static constexpr int D1D = Order+1;
+    static constexpr int Q1D = Order+2;
+
+    explicit TensorMassOperator (mfem::FiniteElementSpace *fes);
+
+    void Mult (const mfem::Vector& x, mfem::Vector& y) const override;
+
+private:
+    //! w*det(J) at the quadrature points
+    mfem::Vector m_geomFactors;
+};
+
+
+/**
+ * @brief Partially assembled stiffness operator; (M grad(u), M grad(v)),
+ * with the material coefficient M evaluated at the quadrature points
+ */
+template <int Dim, int Order>
+class TensorStiffnessOperator : public TensorPAOperator
+{
+public:
+    static constexpr int D1D = Order+1;
+    static constexpr int Q1D = Order+3;
+    static constexpr int numSymm = (Dim*(Dim+1))/2;
+
+    TensorStiffnessOperator (mfem::FiniteElementSpace *fes,
+                             mfem::MatrixCoefficient *M=nullptr);
+
+    void Mult (const mfem::Vector& x, mfem::Vector& y) const override;
+
+private:
+    //! w/det(J) adj(J) M^T M adj(J)^T at the quadrature points,
+    //! symmetric and stored packed
+    mfem::Vector m_geomFactors;
+};
+
+
+/**
+ * @brief Partially assembled gradient operator; (M grad(u), v),
+ * u scalar H1 and v vector H1 of dimension Dim
+ */
+template <int Dim, int Order>
+class TensorGradientOperator : public TensorPAOperator
+{
+public:
+    static constexpr int D1D = Order+1;
+    static constexpr int Q1D = Order+2;
+
+    TensorGradientOperator (mfem::FiniteElementSpace *trialFes,
+                            mfem::FiniteElementSpace *testFes,
+                            mfem::MatrixCoefficient *M=nullptr);
+
+    void Mult (const mfem::Vector& x, mfem::Vector& y) const override;
+
+private:
+    //! w M adj(J)^T at the quadrature points, stored row-major
+    mfem::Vector m_geomFactors;
+};
+
+
+//! Returns the partially assembled mass operator,
+//! or nullptr if the space is not supported
+std::unique_ptr<TensorPAOperator> makeTensorMassOperator
+(mfem::FiniteElementSpace *fes);
+
+//! Returns the partially assembled stiffness operator,
+//! or nullptr if the space is not supported
+std::unique_ptr<TensorPAOperator> makeTensorStiffnessOperator
+(mfem::FiniteElementSpace *fes, mfem::MatrixCoefficient *M=nullptr);
+
+//! Returns the partially assembled gradient operator,
+//! or nullptr if the spaces are not supported
+std::unique_ptr<TensorPAOperator> makeTensorGradientOperator
+(mfem::FiniteElementSpace *trialFes,
+ mfem::FiniteElementSpace *testFes,
+ mfem::MatrixCoefficient *M=nullptr);
+
+//! Checks if the FE space has tensor-product H1 elements
+//! of order supported by the kernels
+bool hasTensorKernelSupport (const mfem::FiniteElementSpace& fes);
+
+
+/**
+ * @brief Matrix-free application of the Kronecker product
+ * of a temporal and a spatial operator.
+ * Vectors are stored as column-major spatial x temporal arrays.
+ */
+class KroneckerOperator : public mfem::Operator
+{
+public:
+    KroneckerOperator (const mfem::SparseMatrix& temporalMat,
+                       const mfem::Operator& spatialOp);
+
+    void Mult (const mfem::Vector& x, mfem::Vector& y) const override;
+
+private:
+    const mfem::SparseMatrix& m_temporalMat;
+    const mfem::Operator& m_spatialOp;
+
+    mutable mfem::Vector m_buf;
+};
+
+}
+
+#endif // MYMFEM_TENSOR_KERNELS_HPP
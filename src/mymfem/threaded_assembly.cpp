@@ -0,0 +1,456 @@
+#include "threaded_assembly.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <assert.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace mfem;
+
+
+void mymfem::buildElementToVDofTable (const FiniteElementSpace& fes,
+                                      Table& elToVDof)
+{
+    int numElements = fes.GetNE();
+    Array<int> vdofs;
+
+    elToVDof.MakeI(numElements);
+    for (int i=0; i<numElements; i++) {
+        fes.GetElementVDofs(i, vdofs);
+        elToVDof.AddColumnsInRow(i, vdofs.Size());
+    }
+    elToVDof.MakeJ();
+    for (int i=0; i<numElements; i++) {
+        fes.GetElementVDofs(i, vdofs);
+        for (int k=0; k<vdofs.Size(); k++) {
+            int vdof = vdofs[k];
+            elToVDof.AddConnection(i, (vdof >= 0) ? vdof : -1-vdof);
+        }
+    }
+    elToVDof.ShiftUpI();
+}
+
+
+void mymfem::assembleLoadVector (const FiniteElementSpace& fes,
+                                 LinearFormIntegrator& lfi,
+                                 Vector& b)
+{
+    Mesh *mesh = fes.GetMesh();
+
+    // a private copy of the FE collection, see ThreadedAssembler
+    std::unique_ptr<FiniteElementCollection> fec
+            (FiniteElementCollection::New(fes.FEColl()->Name()));
+    IsoparametricTransformation elTrans;
+    Array<int> vdofs;
+    Vector elvec;
+
+    b.SetSize(fes.GetVSize());
+    b = 0.;
+    for (int i=0; i<fes.GetNE(); i++)
+    {
+        mesh->GetElementTransformation(i, &elTrans);
+        fes.GetElementVDofs(i, vdofs);
+        const FiniteElement *fe = fec->FiniteElementForGeometry
+                (mesh->GetElementBaseGeometry(i));
+
+        lfi.AssembleRHSElementVect(*fe, elTrans, elvec);
+        b.AddElementVector(vdofs, elvec);
+    }
+}
+
+mymfem::ElementColoring
+:: ElementColoring (const FiniteElementSpace& fes)
+{
+    Table elToVDof;
+    buildElementToVDofTable(fes, elToVDof);
+    build(elToVDof, fes.GetVSize());
+}
+
+mymfem::ElementColoring
+:: ElementColoring (const Table& elToDof, int numDofs)
+{
+    build(elToDof, numDofs);
+}
+
+void mymfem::ElementColoring
+:: build (const Table& elToDof, int numDofs)
+{
+    int numElements = elToDof.Size();
+
+    Table dofToEl;
+    Transpose(elToDof, dofToEl, numDofs);
+
+    // greedy colouring, in element order;
+    // colorMarker[c] == i flags colour c as taken by a neighbour of i
+    Array<int> elColors(numElements);
+    elColors = -1;
+    Array<int> colorMarker;
+    int numColors = 0;
+    for (int i=0; i<numElements; i++)
+    {
+        const int *dofs = elToDof.GetRow(i);
+        for (int k=0; k<elToDof.RowSize(i); k++)
+        {
+            const int *neighbours = dofToEl.GetRow(dofs[k]);
+            for (int l=0; l<dofToEl.RowSize(dofs[k]); l++) {
+                int c = elColors[neighbours[l]];
+                if (c >= 0) { colorMarker[c] = i; }
+            }
+        }
+
+        int c = 0;
+        while (c < numColors && colorMarker[c] == i) { c++; }
+        if (c == numColors) {
+            colorMarker.Append(-1);
+            numColors++;
+        }
+        elColors[i] = c;
+    }
+
+    // group the elements by colour
+    m_colorOffsets.SetSize(numColors+1);
+    m_colorOffsets = 0;
+    for (int i=0; i<numElements; i++) {
+        m_colorOffsets[elColors[i]+1]++;
+    }
+    m_colorOffsets.PartialSum();
+
+    Array<int> counter(numColors);
+    for (int c=0; c<numColors; c++) {
+        counter[c] = m_colorOffsets[c];
+    }
+
+    m_elements.SetSize(numElements);
+    for (int i=0; i<numElements; i++) {
+        m_elements[counter[elColors[i]]++] = i;
+    }
+}
+
+
+mymfem::ThreadedAssembler
+:: ThreadedAssembler (FiniteElementSpace *fes)
+    : m_trialFes (fes),
+      m_testFes (fes),
+      m_isMixed (false)
+{
+    initialize();
+}
+
+mymfem::ThreadedAssembler
+:: ThreadedAssembler (FiniteElementSpace *trialFes,
+                      FiniteElementSpace *testFes)
+    : m_trialFes (trialFes),
+      m_testFes (testFes),
+      m_isMixed (true)
+{
+    assert(m_trialFes->GetNE() == m_testFes->GetNE());
+    initialize();
+}
+
+mymfem::ThreadedAssembler
+:: ThreadedAssembler (FiniteElementSpace *trialFes,
+                      FiniteElementSpace *testFes,
+                      const Array<int>& trialElIds)
+    : m_trialFes (trialFes),
+      m_testFes (testFes),
+      m_isMixed (true)
+{
+    assert(trialElIds.Size() == m_testFes->GetNE());
+    trialElIds.Copy(m_trialElIds);
+    initialize();
+}
+
+void mymfem::ThreadedAssembler
+:: initialize()
+{
+    buildElementToVDofTable(*m_testFes, m_testElToVDof);
+    if (m_isMixed) {
+        buildElementToVDofTable(*m_trialFes, m_trialElToVDof);
+    }
+
+    m_coloring = std::make_unique<ElementColoring>
+            (m_testElToVDof, m_testFes->GetVSize());
+
+    buildSparsityPattern();
+}
+
+void mymfem::ThreadedAssembler
+:: buildSparsityPattern()
+{
+    int numRows = m_testFes->GetVSize();
+    int numCols = m_trialFes->GetVSize();
+    const Table& trialElToVDof
+            = m_isMixed ? m_trialElToVDof : m_testElToVDof;
+
+    Table rowToEl;
+    Transpose(m_testElToVDof, rowToEl, numRows);
+
+    m_rowPtr.SetSize(numRows+1);
+    m_rowPtr[0] = 0;
+
+    #pragma omp parallel
+    {
+        Array<int> colMarker(numCols);
+        colMarker = -1;
+
+        // count the non-zeros per row
+        #pragma omp for
+        for (int r=0; r<numRows; r++)
+        {
+            int count = 0;
+            const int *els = rowToEl.GetRow(r);
+            for (int k=0; k<rowToEl.RowSize(r); k++)
+            {
+                int trialElId = getTrialElId(els[k]);
+                const int *cols = trialElToVDof.GetRow(trialElId);
+                for (int l=0; l<trialElToVDof.RowSize(trialElId); l++) {
+                    if (colMarker[cols[l]] != r) {
+                        colMarker[cols[l]] = r;
+                        count++;
+                    }
+                }
+            }
+            m_rowPtr[r+1] = count;
+        }
+
+        #pragma omp single
+        {
+            m_rowPtr.PartialSum();
+            m_colId.SetSize(m_rowPtr[numRows]);
+        }
+
+        // fill and sort the column indices
+        colMarker = -1;
+        #pragma omp for
+        for (int r=0; r<numRows; r++)
+        {
+            int pos = m_rowPtr[r];
+            const int *els = rowToEl.GetRow(r);
+            for (int k=0; k<rowToEl.RowSize(r); k++)
+            {
+                int trialElId = getTrialElId(els[k]);
+                const int *cols = trialElToVDof.GetRow(trialElId);
+                for (int l=0; l<trialElToVDof.RowSize(trialElId); l++) {
+                    if (colMarker[cols[l]] != r) {
+                        colMarker[cols[l]] = r;
+                        m_colId[pos++] = cols[l];
+                    }
+                }
+            }
+            std::sort(m_colId.GetData() + m_rowPtr[r],
+                      m_colId.GetData() + m_rowPtr[r+1]);
+        }
+    }
+}
+
+SparseMatrix* mymfem::ThreadedAssembler
+:: allocateMatrix() const
+{
+    int numRows = m_testFes->GetVSize();
+    int numCols = m_trialFes->GetVSize();
+    int nnz = m_rowPtr[numRows];
+
+    int *I = new int[numRows+1];
+    int *J = new int[nnz];
+    double *data = new double[nnz];
+    std::copy(m_rowPtr.GetData(), m_rowPtr.GetData() + numRows+1, I);
+    std::copy(m_colId.GetData(), m_colId.GetData() + nnz, J);
+    std::fill(data, data + nnz, 0.);
+
+    // the matrix owns the arrays
+    return new SparseMatrix(I, J, data, numRows, numCols);
+}
+
+SparseMatrix* mymfem::ThreadedAssembler
+:: assemble (const BilinearFormIntegratorFactory& makeIntegrator) const
+{
+    // integrators keep scratch buffers as members,
+    // so every thread gets its own instance
+    assert(m_trialElIds.Size() == 0);
+
+    int numThreads = 1;
+#ifdef _OPENMP
+    numThreads = omp_get_max_threads();
+#endif
+    std::vector<std::unique_ptr<BilinearFormIntegrator>>
+            integrators(numThreads);
+    for (auto& bfi : integrators) {
+        bfi.reset(makeIntegrator());
+    }
+
+    bool isMixed = m_isMixed;
+    auto kernel = [&integrators, isMixed]
+            (const ElementAssemblyData& data, DenseMatrix& elmat)
+    {
+        int threadId = 0;
+#ifdef _OPENMP
+        threadId = omp_get_thread_num();
+#endif
+        auto& bfi = integrators[threadId];
+        if (isMixed) {
+            bfi->AssembleElementMatrix2(*data.trialFe, *data.testFe,
+                                        *data.testElTrans, elmat);
+        }
+        else {
+            bfi->AssembleElementMatrix(*data.testFe,
+                                       *data.testElTrans, elmat);
+        }
+    };
+
+    return assemble(kernel);
+}
+
+SparseMatrix* mymfem::ThreadedAssembler
+:: assemble (const ElementMatrixKernel& kernel) const
+{
+    SparseMatrix *mat = allocateMatrix();
+    assemble(kernel, *mat);
+    return mat;
+}
+
+void mymfem::ThreadedAssembler
+:: assemble (const ElementMatrixKernel& kernel,
+             SparseMatrix& mat) const
+{
+    assert(mat.NumNonZeroElems() == m_colId.Size());
+
+    const int *I = mat.GetI();
+    const int *J = mat.GetJ();
+    double *A = mat.GetData();
+
+    Mesh *testMesh = m_testFes->GetMesh();
+    Mesh *trialMesh = m_trialFes->GetMesh();
+    bool isNested = (m_trialElIds.Size() > 0);
+
+    // curved meshes evaluate their transformations with the shared
+    // nodal FE space, whose elements are not thread-safe
+    bool threaded = !testMesh->GetNodes() && !trialMesh->GetNodes();
+
+    // MFEM basis evaluation uses scratch buffers stored in the
+    // FiniteElement objects, so every thread draws its
+    // elements from a private copy of the FE collections
+    struct Workspace
+    {
+        std::unique_ptr<FiniteElementCollection> testFec, trialFec;
+        IsoparametricTransformation testElTrans, trialElTrans;
+        Array<int> testVdofs, trialVdofs;
+        DenseMatrix elmat;
+        ElementAssemblyData data;
+    };
+    auto makeWorkspace = [this]()
+    {
+        auto ws = std::make_unique<Workspace>();
+        ws->testFec.reset(FiniteElementCollection::New
+                          (m_testFes->FEColl()->Name()));
+        if (m_isMixed) {
+            ws->trialFec.reset(FiniteElementCollection::New
+                               (m_trialFes->FEColl()->Name()));
+        }
+        return ws;
+    };
+
+    auto setElement = [&](int i, Workspace& ws)
+    {
+        int j = getTrialElId(i);
+        ElementAssemblyData& data = ws.data;
+
+        testMesh->GetElementTransformation(i, &ws.testElTrans);
+        m_testFes->GetElementVDofs(i, ws.testVdofs);
+
+        data.testElId = i;
+        data.trialElId = j;
+        data.testFe = ws.testFec->FiniteElementForGeometry
+                (testMesh->GetElementBaseGeometry(i));
+        data.testElTrans = &ws.testElTrans;
+
+        if (!m_isMixed) {
+            data.trialFe = data.testFe;
+            data.trialElTrans = &ws.testElTrans;
+        }
+        else {
+            m_trialFes->GetElementVDofs(j, ws.trialVdofs);
+            data.trialFe = ws.trialFec->FiniteElementForGeometry
+                    (trialMesh->GetElementBaseGeometry(j));
+            if (isNested) {
+                trialMesh->GetElementTransformation
+                        (j, &ws.trialElTrans);
+                data.trialElTrans = &ws.trialElTrans;
+            }
+            else {
+                data.trialElTrans = &ws.testElTrans;
+            }
+        }
+    };
+
+    // MFEM creates the integration rules lazily, which is not
+    // thread-safe; an element of every geometry is computed alone
+    // first, and its element matrix discarded
+    if (threaded)
+    {
+        auto ws = makeWorkspace();
+        Array<bool> hasGeometry(Geometry::NumGeom);
+        hasGeometry = false;
+        for (int i=0; i<testMesh->GetNE(); i++)
+        {
+            int geom = testMesh->GetElementBaseGeometry(i);
+            if (hasGeometry[geom]) { continue; }
+            hasGeometry[geom] = true;
+            setElement(i, *ws);
+            kernel(ws->data, ws->elmat);
+        }
+    }
+
+    #pragma omp parallel if (threaded)
+    {
+        auto ws = makeWorkspace();
+        const Array<int>& testVdofs = ws->testVdofs;
+        DenseMatrix& elmat = ws->elmat;
+
+        for (int c=0; c<m_coloring->getNumColors(); c++)
+        {
+            const int *elIds = m_coloring->getElements(c);
+            int numElements = m_coloring->getNumElements(c);
+
+            // implicit barrier at the end of every colour
+            #pragma omp for schedule(dynamic, 16)
+            for (int k=0; k<numElements; k++)
+            {
+                setElement(elIds[k], *ws);
+                const Array<int>& cols
+                        = m_isMixed ? ws->trialVdofs : testVdofs;
+
+                kernel(ws->data, elmat);
+                assert(elmat.Height() == testVdofs.Size());
+                assert(elmat.Width() == cols.Size());
+
+                // rows of this element are not touched by
+                // any other element of the same colour
+                for (int a=0; a<testVdofs.Size(); a++)
+                {
+                    int row = testVdofs[a];
+                    double rowSign = 1;
+                    if (row < 0) { row = -1-row; rowSign = -1; }
+
+                    const int *rowBegin = J + I[row];
+                    const int *rowEnd = J + I[row+1];
+                    for (int b=0; b<cols.Size(); b++)
+                    {
+                        int col = cols[b];
+                        double sign = rowSign;
+                        if (col < 0) { col = -1-col; sign = -sign; }
+
+                        const int *pos
+                                = std::lower_bound(rowBegin, rowEnd, col);
+                        assert(pos != rowEnd && *pos == col);
+                        A[pos - J] += sign*elmat(a,b);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// End of file
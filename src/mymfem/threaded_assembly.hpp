@@ -0,0 +1,164 @@
+#ifndef MYMFEM_THREADED_ASSEMBLY_HPP
+#define MYMFEM_THREADED_ASSEMBLY_HPP
+
+#include "mfem.hpp"
+
+#include <functional>
+#include <memory>
+
+
+namespace mymfem {
+
+/**
+ * @brief Element data handed to an element matrix kernel.
+ * The finite elements and transformations are private
+ * to the calling thread.
+ */
+struct ElementAssemblyData
+{
+    int testElId = -1;
+    int trialElId = -1;
+
+    const mfem::FiniteElement *testFe = nullptr;
+    const mfem::FiniteElement *trialFe = nullptr;
+
+    mfem::ElementTransformation *testElTrans = nullptr;
+    mfem::ElementTransformation *trialElTrans = nullptr;
+};
+
+//! Computes the element matrix, of size testNdofs x trialNdofs
+using ElementMatrixKernel
+= std::function<void (const ElementAssemblyData&, mfem::DenseMatrix&)>;
+
+//! Creates a new bilinear form integrator; called once per thread
+using BilinearFormIntegratorFactory
+= std::function<mfem::BilinearFormIntegrator* ()>;
+
+
+//! Builds the element to vdof table of an FE space;
+//! the orientation signs of the vdofs are dropped
+void buildElementToVDofTable (const mfem::FiniteElementSpace& fes,
+                              mfem::Table& elToVDof);
+
+//! Assembles the load vector of a domain linear form integrator
+//! without the scratch data shared through the FE space,
+//! so that threads can assemble load vectors concurrently,
+//! each with its own integrator; curved meshes share the
+//! nodal FE space in their transformations, so not concurrently
+void assembleLoadVector (const mfem::FiniteElementSpace& fes,
+                         mfem::LinearFormIntegrator& lfi,
+                         mfem::Vector& b);
+
+
+/**
+ * @brief Greedy colouring of mesh elements such that no two
+ * elements of the same colour share a row degree of freedom
+ */
+class ElementColoring
+{
+public:
+    //! Colours the elements of the given FE space
+    explicit ElementColoring (const mfem::FiniteElementSpace& fes);
+
+    //! Colours the elements, given the element to dof connectivity
+    ElementColoring (const mfem::Table& elToDof, int numDofs);
+
+    //! Returns the number of colours
+    int getNumColors() const {
+        return m_colorOffsets.Size()-1;
+    }
+
+    //! Returns the number of elements with colour c
+    int getNumElements(int c) const {
+        return m_colorOffsets[c+1] - m_colorOffsets[c];
+    }
+
+    //! Returns the elements with colour c
+    const int* getElements(int c) const {
+        return m_elements.GetData() + m_colorOffsets[c];
+    }
+
+private:
+    void build (const mfem::Table& elToDof, int numDofs);
+
+private:
+    mfem::Array<int> m_colorOffsets;
+    mfem::Array<int> m_elements;
+};
+
+
+/**
+ * @brief OpenMP-parallel assembly of square and mixed bilinear forms.
+ *
+ * Elements of one colour share no row, so their element matrices
+ * are computed and scattered into a pre-computed CSR pattern
+ * concurrently, without locks; colours are processed one after
+ * the other. The trial elements may live on a coarser nested mesh,
+ * in which case every test element is mapped to its trial element.
+ */
+class ThreadedAssembler
+{
+public:
+    //! Constructor for square forms
+    explicit ThreadedAssembler (mfem::FiniteElementSpace *fes);
+
+    //! Constructor for mixed forms,
+    //! arguments ordered as in mfem::MixedBilinearForm
+    ThreadedAssembler (mfem::FiniteElementSpace *trialFes,
+                       mfem::FiniteElementSpace *testFes);
+
+    //! Constructor for mixed forms between nested meshes;
+    //! trialElIds maps every test element to the trial element
+    //! that contains it
+    ThreadedAssembler (mfem::FiniteElementSpace *trialFes,
+                       mfem::FiniteElementSpace *testFes,
+                       const mfem::Array<int>& trialElIds);
+
+    //! Returns a new zero matrix with the assembly sparsity pattern
+    mfem::SparseMatrix* allocateMatrix() const;
+
+    //! Assembles the form defined by an integrator;
+    //! the caller owns the returned matrix
+    mfem::SparseMatrix* assemble
+    (const BilinearFormIntegratorFactory& makeIntegrator) const;
+
+    //! Assembles the form defined by an element matrix kernel;
+    //! the caller owns the returned matrix
+    mfem::SparseMatrix* assemble
+    (const ElementMatrixKernel& kernel) const;
+
+    //! Adds the form defined by an element matrix kernel to mat,
+    //! which must have been created with allocateMatrix
+    void assemble (const ElementMatrixKernel& kernel,
+                   mfem::SparseMatrix& mat) const;
+
+    //! Returns the element colouring
+    const ElementColoring& getColoring() const {
+        return *m_coloring;
+    }
+
+private:
+    void initialize();
+    void buildSparsityPattern();
+
+    inline int getTrialElId(int testElId) const {
+        return m_trialElIds.Size() ? m_trialElIds[testElId] : testElId;
+    }
+
+private:
+    mfem::FiniteElementSpace *m_trialFes = nullptr;
+    mfem::FiniteElementSpace *m_testFes = nullptr;
+
+    bool m_isMixed = false;
+    mfem::Array<int> m_trialElIds;
+
+    mfem::Table m_testElToVDof, m_trialElToVDof;
+    std::unique_ptr<ElementColoring> m_coloring;
+
+    //! CSR sparsity pattern, column indices sorted
+    mfem::Array<int> m_rowPtr, m_colId;
+};
+
+}
+
+#endif // MYMFEM_THREADED_ASSEMBLY_HPP
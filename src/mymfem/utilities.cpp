@@ -1,6 +1,12 @@
 #include "utilities.hpp"
 #include <assert.h>
 
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
 using namespace mfem;
 
 
@@ -58,6 +64,113 @@ void getElementCenter(const std::shared_ptr<Mesh>& mesh,
 
 using namespace mymfem;
 
+PointLocator
+:: PointLocator (Mesh *mesh, bool has_shared_vertices)
+    : m_hasSharedVertices (has_shared_vertices),
+      m_mesh (mesh)
+{
+    m_workspace = std::make_unique<Workspace>();
+
+    if (!m_hasSharedVertices) {
+        m_vToEl.reset(m_mesh->GetVertexToElementTable());
+    }
+    else {
+        m_sharedVertices = std::make_unique<Table>();
+        getSharedVerticesTable();
+
+        m_vToEl = std::make_unique<Table>();
+        getVerticesToElementsTable();
+    }
+
+    buildSearchGrid();
+}
+
+// Element centroids and bounding boxes are computed from the vertices;
+// the boxes are padded, generously for curved meshes
+void PointLocator :: buildSearchGrid()
+{
+    int dim = m_mesh->Dimension();
+    int ne = m_mesh->GetNE();
+    double padding = m_mesh->GetNodes() ? 0.25 : 1E-8;
+
+    m_centroids.SetSize(dim, ne);
+    m_boxMin.SetSize(dim, ne);
+    m_boxMax.SetSize(dim, ne);
+    for (int d=0; d<dim; d++) {
+        m_gridMin[d] = std::numeric_limits<double>::max();
+        m_gridMax[d] = -std::numeric_limits<double>::max();
+    }
+
+    Array<int> vertices;
+    for (int i=0; i<ne; i++)
+    {
+        m_mesh->GetElementVertices(i, vertices);
+        for (int d=0; d<dim; d++)
+        {
+            double xmin = std::numeric_limits<double>::max();
+            double xmax = -xmin, xsum = 0;
+            for (int v=0; v<vertices.Size(); v++) {
+                double x = m_mesh->GetVertex(vertices[v])[d];
+                xmin = std::min(xmin, x);
+                xmax = std::max(xmax, x);
+                xsum += x;
+            }
+            double pad = padding*(xmax - xmin) + m_TOL;
+            m_centroids(d, i) = xsum/vertices.Size();
+            m_boxMin(d, i) = xmin - pad;
+            m_boxMax(d, i) = xmax + pad;
+            m_gridMin[d] = std::min(m_gridMin[d], m_boxMin(d, i));
+            m_gridMax[d] = std::max(m_gridMax[d], m_boxMax(d, i));
+        }
+    }
+
+    // about one element per cell
+    double volume = 1;
+    for (int d=0; d<dim; d++) {
+        volume *= m_gridMax[d] - m_gridMin[d];
+    }
+    double h = std::pow(volume/std::max(ne, 1), 1./dim);
+    int numCellsTotal = 1;
+    for (int d=0; d<dim; d++)
+    {
+        double extent = m_gridMax[d] - m_gridMin[d];
+        m_numCells[d] = std::max(1, std::min
+                                 (static_cast<int>(std::ceil(extent/h)),
+                                  ne));
+        m_cellSize[d] = extent/m_numCells[d];
+        numCellsTotal *= m_numCells[d];
+    }
+    m_maxWalkSteps = 4*(*std::max_element(m_numCells, m_numCells+dim)) + 16;
+
+    // registers every element in the cells overlapped by its box
+    auto forEachCell = [&](int i, auto&& fn)
+    {
+        int lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+        for (int d=0; d<dim; d++) {
+            lo[d] = getCellCoord(m_boxMin(d, i), d);
+            hi[d] = getCellCoord(m_boxMax(d, i), d);
+        }
+        for (int c2=lo[2]; c2<=hi[2]; c2++)
+            for (int c1=lo[1]; c1<=hi[1]; c1++)
+                for (int c0=lo[0]; c0<=hi[0]; c0++) {
+                    fn(c0 + m_numCells[0]*(c1 + m_numCells[1]*c2));
+                }
+    };
+
+    m_gridOffsets.assign(numCellsTotal+1, 0);
+    for (int i=0; i<ne; i++) {
+        forEachCell(i, [&](int c) { m_gridOffsets[c+1]++; });
+    }
+    for (int c=0; c<numCellsTotal; c++) {
+        m_gridOffsets[c+1] += m_gridOffsets[c];
+    }
+    m_gridElements.resize(m_gridOffsets[numCellsTotal]);
+    std::vector<int> pos(m_gridOffsets.begin(), m_gridOffsets.end()-1);
+    for (int i=0; i<ne; i++) {
+        forEachCell(i, [&](int c) { m_gridElements[pos[c]++] = i; });
+    }
+}
+
 // Locates a given physical point x to a mesh element
 // using the initial guess initElId
 std::pair <Array<int>, Array<IntegrationPoint>>
@@ -73,145 +186,285 @@ PointLocator :: operator() (const DenseMatrix& X,
     {
         X.GetColumn(i, x);
         std::tie (elIds[i], ips[i]) = (*this)(x, initElId);
-        initElId = elIds[i];
+        if (elIds[i] >= 0) { initElId = elIds[i]; }
     }
 
     return {elIds, ips};
 }
 
-
 // Locates a given physical point x to a mesh element
 // using the initial guess initElId
 std::pair <int, IntegrationPoint>
 PointLocator :: operator() (const Vector& x,
                             const int initElId) const
 {
-    auto [info_, ip_] = computeRefPoint(x, initElId);
-    if (info_ == InverseElementTransformation::Inside) {
-        return {initElId, ip_};
-    }
+    return walk(x, initElId, *m_workspace);
+}
 
-    bool found = false;
+std::pair <int, IntegrationPoint>
+PointLocator :: walk (const Vector& x, int initElId,
+                      Workspace& ws) const
+{
     int info;
-    int elId = initElId, oldElId = initElId;
     IntegrationPoint ip;
+    std::tie (info, ip) = computeRefPoint(x, initElId, ws);
+    if (info == InverseElementTransformation::Inside) {
+        return {initElId, ip};
+    }
 
-    Array <int> vertices;
-    Vector z (m_mesh->Dimension());
-    double minDist = std::numeric_limits<double>::max();
+    int dim = m_mesh->Dimension();
+    auto distToCentroid = [&](int el)
+    {
+        double dist = 0;
+        for (int d=0; d<dim; d++) {
+            double dx = m_centroids(d, el) - x(d);
+            dist += dx*dx;
+        }
+        return dist;
+    };
 
-    while(!found)
+    int elId = initElId;
+    double minDist = distToCentroid(elId);
+
+    Array <int> vertices;
+    for (int step=0; step<m_maxWalkSteps; step++)
     {
         // find the element closest to point x amongst the
         // neighbours of the vertices of the current element
+        int nextElId = elId;
         m_mesh->GetElementVertices(elId, vertices);
         for (int i=0; i < vertices.Size(); i++)
         {
             int v = vertices[i];
             int ne = m_vToEl->RowSize(v);
             const int* els = m_vToEl->GetRow(v);
-            //std::cout << "\n\nFor vertex: " << i << std::endl;
             for (int j=0; j<ne; j++)
             {
-                if (els[j] == elId) {continue;}
-
-                m_mesh->GetElementTransformation(els[j])
-                        ->Transform(Geometries.GetCenter
-                         (m_mesh->GetElementBaseGeometry
-                          (els[j])), z);
-                double dist = z.DistanceTo(x.GetData());
-
-                //std::cout << els[j] << "\t" << elId << "\t"
-                //          << dist << "\t"
-                //          << minDist << std::endl;
-                if (dist < minDist)
-                {
+                double dist = distToCentroid(els[j]);
+                if (dist < minDist) {
                     minDist = dist;
-                    elId = els[j];
-                    //std::cout << "Minimum: "
-                    //          << minDist << "\t"
-                    //          << elId << std::endl;
+                    nextElId = els[j];
                 }
             }
         }
 
-        if (elId == oldElId) {
-            // if elId is not upadted, search
+        if (nextElId == elId)
+        {
+            // if elId is not updated, search
             // all neighbours of its vertices
             for (int i=0; i < vertices.Size(); i++)
             {
                 int v = vertices[i];
                 int ne = m_vToEl->RowSize(v);
                 const int* els = m_vToEl->GetRow(v);
-
                 for (int j=0; j<ne; j++)
                 {
                     if (els[j] == elId) {continue;}
-                    //std::cout << "Search neighbours: "
-                    //          << x(0) << "\t"
-                    //          << x(1) << "\t"
-                    //          << els[j] << std::endl;
-                    std::tie (info, ip) = computeRefPoint(x, els[j]);
+                    std::tie (info, ip) = computeRefPoint(x, els[j], ws);
                     if (info == InverseElementTransformation::Inside) {
-                        //std::cout << "Exception: "
-                        //          << els[j] << std::endl;
-                        return {els[j],ip};
+                        return {els[j], ip};
                     }
                 }
             }
-            // in case the neighbour search fails,
-            // loop over other elements
-            //if (elId < m_mesh->GetNE()-1) { elId++;}
-            //else { elId = 0; }
+            break;
         }
-        else {
-            // if elId is upadted, check if it contains point x
-            std::tie (info, ip) = computeRefPoint(x, elId);
-            if (info == InverseElementTransformation::Inside) {
-                found = true;
-            }
-            oldElId = elId;
+
+        // if elId is updated, check if it contains point x
+        elId = nextElId;
+        std::tie (info, ip) = computeRefPoint(x, elId, ws);
+        if (info == InverseElementTransformation::Inside) {
+            return {elId, ip};
         }
     }
 
-    return {elId, ip};
+    // the walk stalled, search globally
+    return searchGrid(x, ws);
+}
+
+std::pair <int, IntegrationPoint>
+PointLocator :: searchGrid (const Vector& x, Workspace& ws) const
+{
+    int dim = m_mesh->Dimension();
+    IntegrationPoint ip;
+    for (int d=0; d<dim; d++) {
+        if (x(d) < m_gridMin[d] || x(d) > m_gridMax[d]) {
+            return {-1, ip};
+        }
+    }
+
+    int cell = 0;
+    for (int d=dim-1; d>=0; d--) {
+        cell = cell*m_numCells[d] + getCellCoord(x(d), d);
+    }
+
+    int info;
+    for (int k=m_gridOffsets[cell]; k<m_gridOffsets[cell+1]; k++)
+    {
+        int elId = m_gridElements[k];
+        bool inBox = true;
+        for (int d=0; d<dim; d++) {
+            inBox = inBox && x(d) >= m_boxMin(d, elId)
+                    && x(d) <= m_boxMax(d, elId);
+        }
+        if (!inBox) { continue; }
+
+        std::tie (info, ip) = computeRefPoint(x, elId, ws);
+        if (info == InverseElementTransformation::Inside) {
+            return {elId, ip};
+        }
+    }
+
+    return {-1, ip};
+}
+
+// Interleaves the bits of the coordinates,
+// quantized on the bounding box of the mesh
+std::uint64_t PointLocator :: getMortonCode (const double *x) const
+{
+    int dim = m_mesh->Dimension();
+    int numBits = 63/dim;
+    std::uint64_t maxCoord = (std::uint64_t(1) << numBits) - 1;
+
+    std::uint64_t code = 0;
+    std::uint64_t q[3] = {0, 0, 0};
+    for (int d=0; d<dim; d++)
+    {
+        double s = (x[d] - m_gridMin[d])/(m_gridMax[d] - m_gridMin[d]);
+        s = std::min(std::max(s, 0.), 1.);
+        q[d] = static_cast<std::uint64_t>(s*maxCoord);
+    }
+    for (int b=numBits-1; b>=0; b--) {
+        for (int d=0; d<dim; d++) {
+            code = (code << 1) | ((q[d] >> b) & 1);
+        }
+    }
+
+    return code;
+}
+
+void PointLocator :: locate (const DenseMatrix& X,
+                             Array<int>& elIds,
+                             Array<IntegrationPoint>& ips) const
+{
+    int dim = X.NumRows();
+    int numPoints = X.NumCols();
+    elIds.SetSize(numPoints);
+    ips.SetSize(numPoints);
+
+    std::vector<std::uint64_t> codes(numPoints);
+    for (int k=0; k<numPoints; k++) {
+        codes[k] = getMortonCode(X.GetColumn(k));
+    }
+    std::vector<int> order(numPoints);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return codes[a] < codes[b];
+    });
+
+    // transformations of curved meshes are not thread-safe
+    bool threaded = (m_mesh->GetNodes() == nullptr);
+
+    #pragma omp parallel if (threaded)
+    {
+        Workspace ws;
+        int prevElId = -1;
+
+        #pragma omp for schedule(static)
+        for (int k=0; k<numPoints; k++)
+        {
+            int p = order[k];
+            Vector x(const_cast<double*>(X.GetColumn(p)), dim);
+
+            std::pair<int, IntegrationPoint> result {-1, {}};
+            if (prevElId >= 0)
+            {
+                int info;
+                IntegrationPoint ip;
+                std::tie (info, ip) = computeRefPoint(x, prevElId, ws);
+                if (info == InverseElementTransformation::Inside) {
+                    result = {prevElId, ip};
+                }
+            }
+            if (result.first < 0) {
+                result = searchGrid(x, ws);
+            }
+
+            elIds[p] = result.first;
+            ips[p] = result.second;
+            if (result.first >= 0) { prevElId = result.first; }
+        }
+    }
 }
 
 // Generates a table of vertices,
 // which are shared by different processors.
 // Needed when a ParMesh is written to one file,
 // the same vertices at the partition interfaces
-// will have a different numbering for each processor
+// will have a different numbering for each processor.
+// Coincident vertices are found with a hash grid
+// of cell size m_TOL.
 void PointLocator :: getSharedVerticesTable() const
 {
     int nv = m_mesh->GetNV();
     int dim = m_mesh->Dimension();
 
-    m_sharedVertices->MakeI (nv);
-    for (int i=0; i<nv; i++)
-    {
-        Vector v1(m_mesh->GetVertex(i), dim);
-        for (int j=i+1; j<nv; j++)
-        {
-            if (v1.DistanceTo(m_mesh->GetVertex(j)) < m_TOL) {
-                m_sharedVertices->AddAColumnInRow(i);
-                m_sharedVertices->AddAColumnInRow(j);
-            }
+    typedef std::array<long long, 3> Key;
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<long long>()(k[0])
+                    ^ (std::hash<long long>()(k[1]) * 0x9E3779B97F4A7C15ULL)
+                    ^ (std::hash<long long>()(k[2]) * 0xC2B2AE3D27D4EB4FULL);
+        }
+    };
+    auto getKey = [&](const double *x) {
+        Key key = {0, 0, 0};
+        for (int d=0; d<dim; d++) {
+            key[d] = static_cast<long long>(std::floor(x[d]/m_TOL));
         }
+        return key;
+    };
+
+    std::unordered_map<Key, std::vector<int>, KeyHash> cells;
+    cells.reserve(nv);
+    for (int i=0; i<nv; i++) {
+        cells[getKey(m_mesh->GetVertex(i))].push_back(i);
     }
-    m_sharedVertices->MakeJ();
 
+    // pairs i < j of coincident vertices, in lexicographic order
+    std::vector<std::pair<int, int>> pairs;
     for (int i=0; i<nv; i++)
     {
         Vector v1(m_mesh->GetVertex(i), dim);
-        for (int j=i+1; j<nv; j++)
+        Key key = getKey(m_mesh->GetVertex(i));
+        int num = (dim == 1) ? 3 : (dim == 2) ? 9 : 27;
+        for (int n=0; n<num; n++)
         {
-            if (v1.DistanceTo(m_mesh->GetVertex(j)) < m_TOL) {
-                m_sharedVertices->AddConnection(i, j);
-                m_sharedVertices->AddConnection(j, i);
+            Key nbr = key;
+            for (int d=0, r=n; d<dim; d++, r/=3) {
+                nbr[d] += r%3 - 1;
+            }
+            auto it = cells.find(nbr);
+            if (it == cells.end()) { continue; }
+            for (int j : it->second) {
+                if (j > i && v1.DistanceTo(m_mesh->GetVertex(j)) < m_TOL) {
+                    pairs.push_back({i, j});
+                }
             }
         }
     }
+    std::sort(pairs.begin(), pairs.end());
+
+    m_sharedVertices->MakeI (nv);
+    for (const auto& pair : pairs) {
+        m_sharedVertices->AddAColumnInRow(pair.first);
+        m_sharedVertices->AddAColumnInRow(pair.second);
+    }
+    m_sharedVertices->MakeJ();
+
+    for (const auto& pair : pairs) {
+        m_sharedVertices->AddConnection(pair.first, pair.second);
+        m_sharedVertices->AddConnection(pair.second, pair.first);
+    }
     m_sharedVertices->ShiftUpI();
 }
 
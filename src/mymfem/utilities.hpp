@@ -3,7 +3,10 @@
 
 #include "mfem.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 
 //! Deletes allocated memory and sets pointer to nullptr
@@ -29,6 +32,11 @@ namespace mymfem {
 /**
  * @brief Provides functions to locate physical points on a mesh,
  * a faster alternative to the implementation provided by MFEM.
+ *
+ * Points are located by walking from an initial guess through the
+ * vertex neighbours towards the closest element centroid.
+ * A uniform grid over the element bounding boxes is the fallback
+ * when the walk stalls, and the search structure of the batched API.
  */
 class PointLocator
 {
@@ -38,24 +46,7 @@ public:
      * @param mesh Mesh, passed as pointer
      * @param has_shared_vertices boolean flag when mesh has shared vertices
      */
-    PointLocator (mfem::Mesh *mesh, bool has_shared_vertices=false)
-        : m_hasSharedVertices (has_shared_vertices),
-          m_mesh (mesh)
-    {
-        m_invTr = std::make_unique
-                <mfem::InverseElementTransformation>();
-
-        if (!m_hasSharedVertices) {
-            m_vToEl.reset(m_mesh->GetVertexToElementTable());
-        }
-        else {
-            m_sharedVertices = std::make_unique<mfem::Table>();
-            getSharedVerticesTable();
-
-            m_vToEl = std::make_unique<mfem::Table>();
-            getVerticesToElementsTable();
-        }
-    }
+    PointLocator (mfem::Mesh *mesh, bool has_shared_vertices=false);
 
     /**
      * @brief Locates the given physical points on a mesh,
@@ -72,11 +63,24 @@ public:
      * speeds up search with an initial guess
      * @param x physical point
      * @param initElId initial guess for index of mesh element
-     * @return info flag and coordinates of reference point
+     * @return index of mesh element, -1 if not found,
+     * and coordinates of reference point
      */
     std::pair <int, mfem::IntegrationPoint> operator()
     (const mfem::Vector& x, const int initElId) const;
 
+    /**
+     * @brief Locates a batch of physical points in parallel;
+     * the points are ordered along a Morton curve, so that
+     * every point is searched first in the element of its predecessor
+     * @param X collection of physical points
+     * @param elIds indices of mesh elements, -1 if not found
+     * @param ips coordinates of reference points
+     */
+    void locate (const mfem::DenseMatrix& X,
+                 mfem::Array<int>& elIds,
+                 mfem::Array<mfem::IntegrationPoint>& ips) const;
+
     /**
      * @brief Generates a table of shared vertices
      */
@@ -95,24 +99,75 @@ public:
      * @return info flag and coordinates of reference point
      */
     inline std::pair <int, mfem::IntegrationPoint>
-    computeRefPoint (const mfem::Vector& x, const int elId) const
+    computeRefPoint (const mfem::Vector& x, const int elId) const {
+        return computeRefPoint(x, elId, *m_workspace);
+    }
+
+private:
+    //! Thread-private transformations
+    struct Workspace
+    {
+        mfem::IsoparametricTransformation trans;
+        mfem::InverseElementTransformation invTr;
+    };
+
+    inline std::pair <int, mfem::IntegrationPoint>
+    computeRefPoint (const mfem::Vector& x, const int elId,
+                     Workspace& ws) const
     {
         mfem::IntegrationPoint ip;
-        m_invTr->SetTransformation
-                (*m_mesh->GetElementTransformation(elId));
-        auto info = m_invTr->Transform(x, ip);
+        m_mesh->GetElementTransformation(elId, &ws.trans);
+        ws.invTr.SetTransformation(ws.trans);
+        auto info = ws.invTr.Transform(x, ip);
         return {info, ip};
     }
 
+    //! Walks from the element initElId towards the point x
+    std::pair <int, mfem::IntegrationPoint>
+    walk (const mfem::Vector& x, int initElId, Workspace& ws) const;
+
+    //! Searches the elements registered in the grid cell of the point x
+    std::pair <int, mfem::IntegrationPoint>
+    searchGrid (const mfem::Vector& x, Workspace& ws) const;
+
+    //! Builds the element centroids, bounding boxes and the search grid
+    void buildSearchGrid ();
+
+    //! Returns the grid cell coordinate of x along the axis d
+    inline int getCellCoord (double x, int d) const {
+        int c = static_cast<int>((x - m_gridMin[d])/m_cellSize[d]);
+        return std::min(std::max(c, 0), m_numCells[d]-1);
+    }
+
+    //! Returns the Morton code of the point x on the bounding box
+    std::uint64_t getMortonCode (const double *x) const;
+
 private:
     double m_TOL = 1E-12;
     bool m_hasSharedVertices = false;
 
     mfem::Mesh *m_mesh = nullptr;
-    std::unique_ptr<mfem::InverseElementTransformation> m_invTr;
+    std::unique_ptr<Workspace> m_workspace;
 
     std::unique_ptr<mfem::Table> m_vToEl;
     std::unique_ptr<mfem::Table> m_sharedVertices;
+
+    //! element centroids and bounding boxes, column-wise
+    mfem::DenseMatrix m_centroids;
+    mfem::DenseMatrix m_boxMin, m_boxMax;
+
+    //! uniform grid over the mesh bounding box; the elements whose
+    //! bounding boxes overlap cell c are
+    //! m_gridElements[m_gridOffsets[c]:m_gridOffsets[c+1]]
+    int m_numCells[3] = {1, 1, 1};
+    double m_gridMin[3] = {0, 0, 0};
+    double m_gridMax[3] = {0, 0, 0};
+    double m_cellSize[3] = {1, 1, 1};
+    std::vector<int> m_gridOffsets;
+    std::vector<int> m_gridElements;
+
+    //! bound on the steps of a walk
+    int m_maxWalkSteps;
 };
 
 }
@@ -1,5 +1,20 @@
 #include "pardiso.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
 
 #define PARDISO_ERROR(err, errMsg)                 \
     if (err != 0) {                                \
@@ -26,6 +41,267 @@ PardisoSolver :: ~PardisoSolver ()
     }
 }
 
+void PardisoSolver :: setMixedPrecision (double tolerance,
+                                        int maxRefinementSteps)
+{
+    m_mixedPrecision = true;
+    m_refinementTolerance = tolerance;
+    m_maxRefinementSteps = maxRefinementSteps;
+}
+
+// Solves the linear system Ax = b; with single-precision factors,
+// the solution is refined in double precision
+void PardisoSolver :: solve(double *b, double *x)
+{
+    backSubstitute(b, x);
+    if (!m_singlePrecisionFactors) {
+        return;
+    }
+
+    auto evalNorm = [this](const double *v) {
+        double sum = 0;
+        for (int i=0; i<m_sizeA; i++) { sum += v[i]*v[i]; }
+        return std::sqrt(sum);
+    };
+    double normB = evalNorm(b);
+    if (normB == 0) {
+        return;
+    }
+
+    // the refinement stalls if the residual is not at least halved
+    double stallFactor = 0.5;
+    double residual = std::numeric_limits<double>::max();
+    std::vector<double> r(m_sizeA), d(m_sizeA);
+    for (int k=0; ; k++)
+    {
+        double prevResidual = residual;
+        evalResidual(b, x, r.data());
+        residual = evalNorm(r.data())/normB;
+        if (residual <= m_refinementTolerance) {
+            break;
+        }
+
+        if (k == m_maxRefinementSteps
+                || residual > stallFactor*prevResidual)
+        {
+            std::cout << "Mixed-precision refinement stalled at "
+                         "relative residual " << residual
+                      << ", factorizing in double precision"
+                      << std::endl;
+            releaseFactors();
+            m_singlePrecisionFactors = false;
+            factorize();
+            backSubstitute(b, x);
+
+            evalResidual(b, x, r.data());
+            residual = evalNorm(r.data())/normB;
+            m_stats.hasFallenBack = true;
+            break;
+        }
+
+        backSubstitute(r.data(), d.data());
+        for (int i=0; i<m_sizeA; i++) {
+            x[i] += d[i];
+        }
+        m_stats.numRefinementSteps++;
+    }
+    m_stats.relativeResidual = residual;
+}
+
+void PardisoSolver :: setPermutation (const std::vector<int>& perm)
+{
+    m_perm = perm;
+    m_hasUserPermutation = true;
+}
+
+void PardisoSolver :: setOrderingCache (const std::string& dir)
+{
+    m_orderingCacheDir = dir;
+}
+
+std::vector<int> PardisoSolver :: computeOrdering ()
+{
+    analyze();
+    return m_perm;
+}
+
+// FNV-1a hash of the matrix type and the zero-based CSR pattern
+std::uint64_t PardisoSolver :: getPatternHash () const
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](int value) {
+        auto bytes = static_cast<std::uint32_t>(value);
+        for (int k=0; k<4; k++) {
+            hash ^= (bytes >> (8*k)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    add(m_mtype);
+    add(m_sizeA);
+    add(m_nnz);
+    for (int i=0; i<=m_sizeA; i++) {
+        add(m_rowPtrA[i]-m_indexBase);
+    }
+    for (int k=0; k<m_nnz; k++) {
+        add(m_colIdA[k]-m_indexBase);
+    }
+    return hash;
+}
+
+void PardisoSolver :: analyze ()
+{
+    // a user permutation, the one of the previous factorization
+    // of the same pattern, or a cached one
+    bool isReused = m_hasUserPermutation;
+    std::uint64_t hash = 0;
+    if (!isReused)
+    {
+        hash = getPatternHash();
+        isReused = (!m_perm.empty() && hash == m_permHash)
+                || (!m_orderingCacheDir.empty() && loadOrdering(hash));
+    }
+    if (isReused && static_cast<int>(m_perm.size()) != m_sizeA) {
+        throw std::runtime_error("Size of the fill-reducing permutation "
+                                 "does not match the matrix");
+    }
+
+    // IPARM(5): 1 uses the given permutation,
+    // 2 returns the computed one
+    std::vector<int> perm(m_sizeA);
+    if (isReused) {
+        for (int i=0; i<m_sizeA; i++) {
+            perm[i] = m_perm[i] + m_indexBase;
+        }
+    }
+    m_iparm[4] = isReused ? 1 : 2;
+    m_iparm[17] = -1; // reports the nonzeros in the factors
+    symbolicFactorize(perm.data());
+    m_stats.isOrderingReused = isReused;
+    m_stats.factorNonzeros = m_iparm[17];
+
+    if (!isReused)
+    {
+        m_perm.resize(m_sizeA);
+        for (int i=0; i<m_sizeA; i++) {
+            m_perm[i] = perm[i] - m_indexBase;
+        }
+        m_permHash = hash;
+        if (!m_orderingCacheDir.empty()) {
+            storeOrdering(hash);
+        }
+    }
+}
+
+namespace {
+
+std::string getOrderingFileName (const std::string& dir,
+                                 std::uint64_t hash)
+{
+    std::ostringstream fileName;
+    fileName << dir << "/pardiso_ordering_"
+             << std::hex << std::setw(16) << std::setfill('0') << hash
+             << ".bin";
+    return fileName.str();
+}
+
+}
+
+bool PardisoSolver :: loadOrdering (std::uint64_t hash)
+{
+    std::ifstream file(getOrderingFileName(m_orderingCacheDir, hash),
+                       std::ios::binary);
+    int size = 0;
+    if (!file.read(reinterpret_cast<char*>(&size), sizeof(int))
+            || size != m_sizeA) {
+        return false;
+    }
+
+    std::vector<int> perm(m_sizeA);
+    if (!file.read(reinterpret_cast<char*>(perm.data()),
+                   m_sizeA*sizeof(int))) {
+        return false;
+    }
+
+    // rejects truncated or corrupted files
+    std::vector<bool> isTaken(m_sizeA, false);
+    for (int i : perm) {
+        if (i < 0 || i >= m_sizeA || isTaken[i]) {
+            return false;
+        }
+        isTaken[i] = true;
+    }
+
+    m_perm = std::move(perm);
+    m_permHash = hash;
+    return true;
+}
+
+void PardisoSolver :: storeOrdering (std::uint64_t hash) const
+{
+    std::error_code ec;
+    fs::create_directories(m_orderingCacheDir, ec);
+
+    // written to a temporary file first, as concurrent threads
+    // and processes may store the same ordering
+    std::string fileName = getOrderingFileName(m_orderingCacheDir, hash);
+    std::ostringstream tmpFileName;
+    tmpFileName << fileName << ".tmp" << getpid() << "_"
+                << std::hash<std::thread::id>{}(std::this_thread::get_id());
+    {
+        std::ofstream file(tmpFileName.str(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&m_sizeA), sizeof(int));
+        file.write(reinterpret_cast<const char*>(m_perm.data()),
+                   m_sizeA*sizeof(int));
+        if (!file) {
+            std::cout << "Could not cache the PARDISO ordering in "
+                      << m_orderingCacheDir << std::endl;
+            fs::remove(tmpFileName.str(), ec);
+            return;
+        }
+    }
+    fs::rename(tmpFileName.str(), fileName, ec);
+    if (ec) {
+        std::cout << "Could not cache the PARDISO ordering in "
+                  << m_orderingCacheDir << ": " << ec.message()
+                  << std::endl;
+        fs::remove(tmpFileName.str(), ec);
+    }
+}
+
+void PardisoSolver :: evalResidual (const double *b,
+                                   const double *x,
+                                   double *r) const
+{
+    const int base = m_indexBase;
+
+    #pragma omp parallel for
+    for (int i=0; i<m_sizeA; i++)
+    {
+        double sum = 0;
+        for (int k=m_rowPtrA[i]-base; k<m_rowPtrA[i+1]-base; k++) {
+            sum += m_dataA[k]*x[m_colIdA[k]-base];
+        }
+        r[i] = b[i] - sum;
+    }
+
+    // the strictly lower triangle, transposed from the upper one
+    if (m_mtype != 2 && m_mtype != -2) {
+        return;
+    }
+    #pragma omp parallel for
+    for (int i=0; i<m_sizeA; i++) {
+        for (int k=m_rowPtrA[i]-base; k<m_rowPtrA[i+1]-base; k++)
+        {
+            int j = m_colIdA[k]-base;
+            if (j != i) {
+                #pragma omp atomic
+                r[j] -= m_dataA[k]*x[i];
+            }
+        }
+    }
+}
+
 #ifdef LIB_PARDISO
 
 void PardisoSolver :: initialize(int sizeA,
@@ -88,6 +364,11 @@ void PardisoSolver :: initialize(int sizeA,
                         &m_error);
     PARDISO_ERROR(m_error,
                   "\nERROR in consistency of matrix: ")
+    m_indexBase = 1;
+
+    m_singlePrecisionFactors = m_mixedPrecision;
+    m_stats = PardisoStats();
+    m_stats.isMixedPrecision = m_mixedPrecision;
 
     m_finalized = false;
 }
@@ -95,24 +376,30 @@ void PardisoSolver :: initialize(int sizeA,
 void PardisoSolver :: finalize()
 {
     // Shift matrix index to C++ 0-based index
-    for (int i=0; i<m_sizeA; i++) {
+    for (int i=0; i<=m_sizeA; i++) {
         m_rowPtrA[i] -= 1;
     }
     for (int i=0; i<m_nnz; i++) {
         m_colIdA[i] -= 1;
     }
+    m_indexBase = 0;
 
+    releaseFactors();
+
+    m_finalized = true;
+}
+
+void PardisoSolver :: releaseFactors()
+{
     // Release internal memory
     m_phase = -1;
     pardiso(m_pt, &m_maxfct, &m_mnum, &m_mtype, &m_phase,
             &m_sizeA, m_dataA, m_rowPtrA, m_colIdA,
             &m_idum, &m_nrhs, m_iparm, &m_verbose,
             &m_ddum, &m_ddum, &m_error, m_dparm);
-
-    m_finalized = true;
 }
 
-void PardisoSolver :: factorize()
+void PardisoSolver :: symbolicFactorize(int *perm)
 {
     m_error = 0;
 
@@ -120,10 +407,20 @@ void PardisoSolver :: factorize()
     m_phase = 11;
     pardiso(m_pt, &m_maxfct, &m_mnum, &m_mtype, &m_phase,
             &m_sizeA, m_dataA, m_rowPtrA, m_colIdA,
-            &m_idum, &m_nrhs, m_iparm, &m_verbose,
+            perm, &m_nrhs, m_iparm, &m_verbose,
             &m_ddum, &m_ddum, &m_error, m_dparm);
     PARDISO_ERROR(m_error,
                   "\nERROR during symbolic factorization: ")
+}
+
+void PardisoSolver :: factorize()
+{
+    m_error = 0;
+
+    // 32-bit factorization, IPARM(29)
+    m_iparm[28] = m_singlePrecisionFactors ? 1 : 0;
+
+    analyze();
 
     // Numerical factorization
     m_phase = 22;
@@ -134,19 +431,20 @@ void PardisoSolver :: factorize()
             &m_ddum, &m_ddum, &m_error, m_dparm);
     PARDISO_ERROR(m_error,
                   "\nERROR during numerical factorization: ")
+    m_stats.factorMemory = m_iparm[16];
 }
 
-// Solves the linear system Ax = b
-void PardisoSolver :: solve(double *b, double *x)
+void PardisoSolver :: backSubstitute(double *b, double *x)
 {
     m_error = 0;
 
     pardiso_chkvec(&m_sizeA, &m_nrhs, b, &m_error);
     PARDISO_ERROR(m_error, "\nERROR in rhs vector: ")
 
-    // Back-substitution and iterative refinement
+    // Back-substitution and iterative refinement;
+    // single-precision factors are refined in solve
     m_phase = 33;
-    m_iparm[7] = 1;
+    m_iparm[7] = m_singlePrecisionFactors ? 0 : 1;
     pardiso(m_pt, &m_maxfct, &m_mnum, &m_mtype, &m_phase,
             &m_sizeA, m_dataA, m_rowPtrA, m_colIdA,
             &m_idum, &m_nrhs, m_iparm, &m_verbose,
@@ -209,10 +507,24 @@ void PardisoSolver :: initialize(int sizeA,
         m_pt[i] = 0;
     }
 
+    m_singlePrecisionFactors = m_mixedPrecision;
+    m_stats = PardisoStats();
+    m_stats.isMixedPrecision = m_mixedPrecision;
+
     m_finalized = false;
 }
 
 void PardisoSolver :: finalize()
+{
+    releaseFactors();
+    std::vector<float>().swap(m_dataSingle);
+    std::vector<float>().swap(m_bSingle);
+    std::vector<float>().swap(m_xSingle);
+
+    m_finalized = true;
+}
+
+void PardisoSolver :: releaseFactors()
 {
     // Release internal memory
     m_phase = -1;
@@ -222,19 +534,19 @@ void PardisoSolver :: finalize()
             &m_ddum, &m_ddum, &m_error);
     PARDISO_ERROR(m_error,
                   "\nERROR during memory release: ")
-
-    m_finalized = true;
 }
 
-void PardisoSolver :: factorize()
+void PardisoSolver :: symbolicFactorize(int *perm)
 {
     m_error = 0;
-    
+
     // Re-ordering and Symbolic factorization
     m_phase = 11;
+    void *dataA = (m_iparm[27] == 1) ?
+                static_cast<void*>(m_dataSingle.data()) : m_dataA;
     PARDISO(m_pt, &m_maxfct, &m_mnum, &m_mtype, &m_phase,
-            &m_sizeA, m_dataA, m_rowPtrA, m_colIdA,
-            &m_idum, &m_nrhs, m_iparm, &m_verbose,
+            &m_sizeA, dataA, m_rowPtrA, m_colIdA,
+            perm, &m_nrhs, m_iparm, &m_verbose,
             &m_ddum, &m_ddum, &m_error);
     //PARDISO_PRINT(m_iparm[17],
     //              "Number of nonzeros in factors: ")
@@ -242,31 +554,66 @@ void PardisoSolver :: factorize()
     //              "Number of factorization MFLOPS: ")
     PARDISO_ERROR(m_error,
                   "\nERROR during symbolic factorization: ")
+}
+
+void PardisoSolver :: factorize()
+{
+    m_error = 0;
+
+    // Single-precision factors in the mixed-precision mode,
+    // from a single-precision copy of the matrix values
+    m_iparm[27] = m_singlePrecisionFactors ? 1 : 0;
+    void *dataA = m_dataA;
+    if (m_singlePrecisionFactors) {
+        m_dataSingle.assign(m_dataA, m_dataA + m_nnz);
+        dataA = m_dataSingle.data();
+    }
+    else {
+        std::vector<float>().swap(m_dataSingle);
+    }
+
+    analyze();
 
     // Numerical factorization
     m_phase = 22;
     PARDISO(m_pt, &m_maxfct, &m_mnum, &m_mtype, &m_phase,
-            &m_sizeA, m_dataA, m_rowPtrA, m_colIdA,
+            &m_sizeA, dataA, m_rowPtrA, m_colIdA,
             &m_idum, &m_nrhs, m_iparm, &m_verbose,
             &m_ddum, &m_ddum, &m_error);
     //PARDISO_PRINT(m_iparm[29],
     //        "Number of zero or negative pivots: ")
     PARDISO_ERROR(m_error,
                   "\nERROR during numerical factorization: ")
+    m_stats.factorMemory = m_iparm[16];
 }
 
-// Solves the linear system Ax = b
-void PardisoSolver :: solve(double *b, double *x)
+void PardisoSolver :: backSubstitute(double *b, double *x)
 {
     m_error = 0;
 
-    // Back-substitution and iterative refinement
+    // Back-substitution and iterative refinement;
+    // single-precision factors are refined in solve
     m_phase = 33;
+    m_iparm[7] = m_singlePrecisionFactors ? 0 : 2;
+    if (!m_singlePrecisionFactors)
+    {
+        PARDISO(m_pt, &m_maxfct, &m_mnum, &m_mtype, &m_phase,
+                &m_sizeA, m_dataA, m_rowPtrA, m_colIdA,
+                &m_idum, &m_nrhs, m_iparm, &m_verbose,
+                b, x, &m_error);
+        PARDISO_ERROR(m_error, "\nERROR during solve: ")
+        return;
+    }
+
+    // single-precision rhs and solution
+    m_bSingle.assign(b, b + m_sizeA);
+    m_xSingle.resize(m_sizeA);
     PARDISO(m_pt, &m_maxfct, &m_mnum, &m_mtype, &m_phase,
-            &m_sizeA, m_dataA, m_rowPtrA, m_colIdA,
+            &m_sizeA, m_dataSingle.data(), m_rowPtrA, m_colIdA,
             &m_idum, &m_nrhs, m_iparm, &m_verbose,
-            b, x, &m_error);
+            m_bSingle.data(), m_xSingle.data(), &m_error);
     PARDISO_ERROR(m_error, "\nERROR during solve: ")
+    std::copy(m_xSingle.begin(), m_xSingle.end(), x);
 }
 
 #endif
@@ -3,6 +3,10 @@
 
 #include "../core/config.hpp"
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 // PARDISO prototype.
 #ifdef LIB_PARDISO
 extern "C" void pardisoinit (void *, int    *, int *,
@@ -19,13 +23,43 @@ extern "C" void pardiso_residual (int *, int * ,
                                   double *, double *, double *,
                                   double *, double *);
 #else // MKL Pardiso
+// the values, rhs and solution are float arrays if IPARM(28) = 1
 extern "C" void PARDISO     (void *, int    *, int *, int    *, int    *,
-                             int  *, double *, int *, int    *, int    *,
-                             int  *, int    *, int *, double *, double *,
+                             int  *, void   *, int *, int    *, int    *,
+                             int  *, int    *, int *, void   *, void   *,
                              int  *);
 #endif
 
 
+/**
+ * @brief Statistics of a PARDISO solve
+ */
+struct PardisoStats
+{
+    //! memory of the numerical factorization, in KB
+    int factorMemory = 0;
+
+    //! nonzeros in the factors, from the symbolic factorization
+    int factorNonzeros = 0;
+
+    bool isMixedPrecision = false;
+
+    //! steps of the double-precision iterative refinement
+    int numRefinementSteps = 0;
+
+    //! true if the refinement stalled and the system
+    //! was factorized again in double precision
+    bool hasFallenBack = false;
+
+    //! relative residual of the returned solution,
+    //! only evaluated in mixed precision
+    double relativeResidual = 0;
+    //! true if the fill-reducing permutation was given,
+    //! cached or kept from a previous factorization
+    bool isOrderingReused = false;
+};
+
+
 /**
  * @brief Provides the function wrappers to use PARDISO solver,
  * available directly or from intel MKL library.
@@ -82,6 +116,72 @@ public:
         return std::max(m_iparm[14], m_iparm[15]+m_iparm[16]);
     }
 
+    /**
+     * @brief Enables the mixed-precision mode, to be called
+     * before initialize. The factors are computed in single
+     * precision, and the solution is refined in double precision
+     * against the original matrix. If the refinement stalls,
+     * the matrix is factorized again in double precision.
+     * @param tolerance relative residual tolerance
+     * @param maxRefinementSteps maximum number of refinement steps
+     */
+    void setMixedPrecision (double tolerance, int maxRefinementSteps);
+
+    //! Returns the statistics of the last factorization and solve
+    const PardisoStats& getStats() const {
+        return m_stats;
+    }
+
+    /**
+     * @brief Sets a user fill-reducing permutation, used by all
+     * following factorizations instead of the METIS reordering
+     * @param perm zero-based permutation; row i of the matrix
+     * is row perm[i] of the permuted matrix
+     */
+    void setPermutation (const std::vector<int>& perm);
+
+    /**
+     * @brief Caches the computed permutations in a directory,
+     * keyed by a hash of the matrix type and sparsity pattern,
+     * and reuses them in later runs
+     * @param dir cache directory; no file cache if empty
+     */
+    void setOrderingCache (const std::string& dir);
+
+    /**
+     * @brief Computes, or reuses, the fill-reducing permutation
+     * of the initialized matrix without factorizing it
+     * @return zero-based permutation, see setPermutation
+     */
+    std::vector<int> computeOrdering ();
+
+    //! Returns a hash of the matrix type and the sparsity pattern
+    std::uint64_t getPatternHash() const;
+
+private:
+    //! Reorders and factorizes symbolically, with a reused
+    //! permutation if available
+    void analyze ();
+
+    //! Runs the reordering and symbolic factorization phase
+    void symbolicFactorize (int *perm);
+
+    //! Loads a cached permutation, returns false if there is none
+    bool loadOrdering (std::uint64_t hash);
+
+    //! Writes the current permutation to the cache
+    void storeOrdering (std::uint64_t hash) const;
+
+    //! Solves with the current factors
+    void backSubstitute (double *b, double *x);
+
+    //! Releases the factors, keeps the matrix
+    void releaseFactors ();
+
+    //! Evaluates r = b - A x in double precision; only the upper
+    //! triangle is stored for symmetric matrix types
+    void evalResidual (const double *b, const double *x, double *r) const;
+
 private:
     int m_nnodes, m_nprocs;
 
@@ -102,6 +202,28 @@ private:
     double m_dparm[64];
 
     bool m_finalized = true;
+
+    //! the CSR indices are shifted to one-based during the solve
+    int m_indexBase = 0;
+
+    bool m_mixedPrecision = false;
+    bool m_singlePrecisionFactors = false;
+#ifndef LIB_PARDISO
+    //! single-precision copies of the matrix values, rhs and solution;
+    //! MKL requires all of them in single precision with IPARM(28) = 1
+    std::vector<float> m_dataSingle, m_bSingle, m_xSingle;
+#endif
+    double m_refinementTolerance = 1E-12;
+    int m_maxRefinementSteps = 20;
+
+    PardisoStats m_stats;
+
+    //! zero-based fill-reducing permutation and the pattern hash
+    //! it was computed for; user permutations match any pattern
+    std::vector<int> m_perm;
+    std::uint64_t m_permHash = 0;
+    bool m_hasUserPermutation = false;
+    std::string m_orderingCacheDir;
 };
 
 #endif /// PARDISO_HPP
@@ -1,10 +1,15 @@
 #include "includes.hpp"
 #include "core/config.hpp"
+#include "core/output_service.hpp"
+#include "core/perf_counters.hpp"
+#include "core/sweep_scheduler.hpp"
 #include "sparse_heat/solver.hpp"
+#include "sparse_heat/combination_solver.hpp"
 #include "sparse_heat/observer.hpp"
 
 #include <iostream>
 #include <filesystem>
+#include <stdexcept>
 
 using namespace mfem;
 namespace fs = std::filesystem;
@@ -16,7 +21,8 @@ void writeErrorConvergenceDataToJsonFile
 (const nlohmann::json& config,
  Array<int> &numDofs,
  Array<double> &meshSizes,
- Array<Vector> &solutionError)
+ Array<Vector> &solutionError,
+ OutputService& outputService)
 {
     assert(numDofs.Size() == meshSizes.Size());
 
@@ -77,10 +83,11 @@ void writeErrorConvergenceDataToJsonFile
         }
     }
 
-    auto file = std::ofstream(outfile);
-    assert(file.good());
-    file << json.dump(2);
-    file.close();
+    // serialised and written in the background
+    outputService.writeFile(outfile,
+                            [json = std::move(json)](std::ostream& file) {
+        file << json.dump(2);
+    });
 }
 
 void writePerformanceMetricsDataToJsonFile
@@ -88,7 +95,10 @@ void writePerformanceMetricsDataToJsonFile
  Array<int> &numDofs,
  Array<double> &meshSizes,
  Array<Vector> &elapsedTime,
- Array<int> &memoryUsage)
+ Array<int> &memoryUsage,
+ const std::vector<std::vector<PhaseMetrics>> &phaseMetrics,
+ const std::vector<PardisoStats> &pardisoStats,
+ OutputService& outputService)
 {
     assert(numDofs.Size() == meshSizes.Size());
     assert(elapsedTime[0].Size() == 4);
@@ -141,10 +151,47 @@ void writePerformanceMetricsDataToJsonFile
         json["memory_usage"][i] = memoryUsage[i];
     }
 
-    auto file = std::ofstream(outfile);
-    assert(file.good());
-    file << json.dump(2);
-    file.close();
+    // factor memory in KB and, in mixed precision,
+    // the double-precision refinement of the factors
+    for (size_t i=0; i<pardisoStats.size(); i++) {
+        json["factor_memory"][i] = pardisoStats[i].factorMemory;
+        if (pardisoStats[i].isMixedPrecision) {
+            json["refinement_steps"][i] = pardisoStats[i].numRefinementSteps;
+            json["precision_fallback"][i] = pardisoStats[i].hasFallenBack;
+        }
+    }
+
+    // per phase; the memory bandwidth is estimated
+    // from the last-level cache misses, of 64 bytes each
+    for (int i=0; i<numDofs.Size(); i++) {
+        for (const auto& phase : phaseMetrics[i])
+        {
+            auto& phaseJson = json["phases"][phase.name];
+            phaseJson["elapsed_time"][i] = phase.elapsedTime;
+            if (!phase.hasCounters) {
+                continue;
+            }
+
+            const auto& counters = phase.counters;
+            for (int k=0; k<PerfCounters::numEvents; k++) {
+                phaseJson[PerfCounters::getEventName(k)][i] = counters[k];
+            }
+            double numCycles = counters[PerfCounters::cycles];
+            phaseJson["instructions_per_cycle"][i]
+                    = numCycles > 0 ?
+                        counters[PerfCounters::instructions]/numCycles : 0;
+            phaseJson["memory_bandwidth_estimate"][i]
+                    = phase.elapsedTime > 0 ?
+                        64*counters[PerfCounters::cacheMisses]
+                        /phase.elapsedTime : 0;
+        }
+    }
+
+    // serialised and written in the background
+    outputService.writeFile(outfile,
+                            [json = std::move(json)](std::ostream& file) {
+        file << json.dump(2);
+    });
 }
 
 }
@@ -184,9 +231,11 @@ runSolverAndMeasurePerformanceMetrics(sparseHeat::Solver& solver)
 }
 
 
-void runOneSimulation (const nlohmann::json config,
-                       std::string baseMeshDir, 
-                       bool loadInitMesh=false)
+void runOneSimulation
+(const nlohmann::json config,
+ std::string baseMeshDir,
+ const std::shared_ptr<OutputService>& outputService,
+ bool loadInitMesh=false)
 {
     int deg;
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "deg", deg, 1);
@@ -216,6 +265,8 @@ void runOneSimulation (const nlohmann::json config,
 
     sparseHeat::Observer observer(config, numLevels, minTemporalLevel);
 
+    observer.setOutputService(outputService);
+
     int numDofs;
     double htMax, hxMax;
     Vector solutionError;
@@ -230,9 +281,11 @@ void runOneSimulation (const nlohmann::json config,
 }
 
 
-void runMultipleSimulationsToTestConvergence (const nlohmann::json config,
-                                              std::string baseMeshDir,
-                                              bool loadInitMesh=false)
+void runMultipleSimulationsToTestConvergence
+(const nlohmann::json config,
+ std::string baseMeshDir,
+ const std::shared_ptr<OutputService>& outputService,
+ bool loadInitMesh=false)
 {
     int deg;
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "deg", deg, 1);
@@ -261,26 +314,35 @@ void runMultipleSimulationsToTestConvergence (const nlohmann::json config,
     Array<double> hxMax(numDofs.Size());
     Array<Vector> solutionError(numDofs.Size());
 
-    int count = 0;
-    for (int numLevels = minNumLevels;
-         numLevels <= maxNumLevels; numLevels++)
+    // the levels are independent jobs; the results are stored per level
+    auto scheduler = makeSweepScheduler(config);
+    for (int count=0; count<numDofs.Size(); count++)
     {
-        sparseHeat::Solver solver(config,
-                                  testCase,
-                                  meshDir,
-                                  numLevels,
-                                  minSpatialLevel,
-                                  minTemporalLevel,
-                                  loadInitMesh);
+        scheduler.addJob(count, [&, count]() {
+            int numLevels = minNumLevels + count;
+            sparseHeat::Solver solver(config,
+                                      testCase,
+                                      meshDir,
+                                      numLevels,
+                                      minSpatialLevel,
+                                      minTemporalLevel,
+                                      loadInitMesh);
 
-        sparseHeat::Observer observer(config, numLevels, minTemporalLevel);
+            sparseHeat::Observer observer(config, numLevels,
+                                          minTemporalLevel);
 
-        std::tie(numDofs[count], htMax[count], hxMax[count],
-                 solutionError[count])
-                = runSolver(solver, observer);
+            observer.setOutputService(outputService);
 
-        count++;
+            std::tie(numDofs[count], htMax[count], hxMax[count],
+                     solutionError[count])
+                    = runSolver(solver, observer);
+
+            SweepScheduler::JobStats stats;
+            stats.numDofs = numDofs[count];
+            return stats;
+        });
     }
+    scheduler.run();
 
     std::cout << "\nTemporal mesh sizes: "; htMax.Print();
     std::cout << "Spatial mesh sizes: "; hxMax.Print();
@@ -298,12 +360,14 @@ void runMultipleSimulationsToTestConvergence (const nlohmann::json config,
     sparseHeat::writeErrorConvergenceDataToJsonFile(config,
                                                     numDofs,
                                                     meshSizes,
-                                                    solutionError);
+                                                    solutionError,
+                                                    *outputService);
 }
 
 void runMultipleSimulationsToMeasurePerformanceMetrics
 (const nlohmann::json config,
  std::string baseMeshDir,
+ const std::shared_ptr<OutputService>& outputService,
  bool loadInitMesh=false)
 {
     int deg;
@@ -336,36 +400,72 @@ void runMultipleSimulationsToMeasurePerformanceMetrics
     Array<double> hxMax(numDofs.Size());
     Array<Vector> elapsedTime(numDofs.Size());
     Array<int> memoryUsage(numDofs.Size());
-
-    int count = 0;
-    for (int numLevels = minNumLevels;
-         numLevels <= maxNumLevels; numLevels++)
-    {
-        Vector localElapsedTime;
+    std::vector<std::vector<PhaseMetrics>> phaseMetrics(numDofs.Size());
+    std::vector<PardisoStats> pardisoStats(numDofs.Size());
+
+    // timing-sensitive repetitions run alone, with all threads
+    bool exclusiveRepetitions;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "sweep_exclusive_measure",
+                                        exclusiveRepetitions, true);
+
+    // the levels and repetitions are independent jobs;
+    // the results are stored per level and repetition
+    std::vector<std::vector<Vector>> localElapsedTime
+            (numDofs.Size(), std::vector<Vector>(numReps));
+    std::vector<std::vector<std::vector<PhaseMetrics>>> localPhaseMetrics
+            (numDofs.Size(), std::vector<std::vector<PhaseMetrics>>(numReps));
+
+    auto scheduler = makeSweepScheduler(config);
+    for (int count=0; count<numDofs.Size(); count++) {
         for (int i=0; i<numReps; i++)
         {
-            sparseHeat::Solver solver(config,
-                                      testCase,
-                                      meshDir,
-                                      numLevels,
-                                      minSpatialLevel,
-                                      minTemporalLevel,
-                                      loadInitMesh);
+            scheduler.addJob(count, [&, count, i]() {
+                sparseHeat::Solver solver(config,
+                                          testCase,
+                                          meshDir,
+                                          minNumLevels + count,
+                                          minSpatialLevel,
+                                          minTemporalLevel,
+                                          loadInitMesh);
+
+                int localNumDofs, localMemoryUsage;
+                double localHtMax, localHxMax;
+                std::tie(localNumDofs, localHtMax, localHxMax,
+                         localElapsedTime[count][i], localMemoryUsage)
+                        = runSolverAndMeasurePerformanceMetrics(solver);
+                localPhaseMetrics[count][i] = solver.getPhaseMetrics();
+
+                // the repetitions of a level give the same values
+                if (i == 0) {
+                    numDofs[count] = localNumDofs;
+                    htMax[count] = localHtMax;
+                    hxMax[count] = localHxMax;
+                    memoryUsage[count] = localMemoryUsage;
+                    pardisoStats[count] = solver.getPardisoStats();
+                }
+
+                // the memory usage is reported in KB
+                SweepScheduler::JobStats stats;
+                stats.numDofs = localNumDofs;
+                stats.memoryUsage = 1024.*localMemoryUsage;
+                return stats;
+            }, exclusiveRepetitions);
+        }
+    }
+    scheduler.run();
 
-            std::tie(numDofs[count], htMax[count], hxMax[count],
-                     localElapsedTime, memoryUsage[count])
-                    = runSolverAndMeasurePerformanceMetrics(solver);
-            if (i == 0) {
-                elapsedTime[count].SetSize(localElapsedTime.Size());
-                elapsedTime[count] = 0.;
-            }
-            else {
-                elapsedTime[count] += localElapsedTime;
-            }
+    // the first repetition is a warm-up
+    for (int count=0; count<numDofs.Size(); count++)
+    {
+        elapsedTime[count].SetSize(localElapsedTime[count][0].Size());
+        elapsedTime[count] = 0.;
+        for (int i=1; i<numReps; i++) {
+            elapsedTime[count] += localElapsedTime[count][i];
+            addPhaseMetrics(phaseMetrics[count],
+                            localPhaseMetrics[count][i]);
         }
         elapsedTime[count] /= (numReps-1);
-
-        count++;
+        scalePhaseMetrics(phaseMetrics[count], 1./(numReps-1));
     }
 
     std::cout << "\nTemporal mesh sizes: "; htMax.Print();
@@ -387,7 +487,132 @@ void runMultipleSimulationsToMeasurePerformanceMetrics
                                                       numDofs,
                                                       meshSizes,
                                                       elapsedTime,
-                                                      memoryUsage);
+                                                      memoryUsage,
+                                                      phaseMetrics,
+                                                      pardisoStats,
+                                                      *outputService);
+}
+
+
+// Solves with the combination technique and, optionally,
+// with the coupled sparse solver for comparison
+void runCombinationTechnique
+(const nlohmann::json config,
+ std::string baseMeshDir,
+ const std::shared_ptr<OutputService>& outputService,
+ bool loadInitMesh=false)
+{
+    int deg;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "deg", deg, 1);
+    if (deg != 1) {
+        throw std::runtime_error("The combination technique "
+                                 "supports only deg = 1");
+    }
+
+    int numLevels, minSpatialLevel, minTemporalLevel;
+    std::string subMeshDir;
+    bool compareWithCoupledSolver;
+
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "num_levels",
+                                        numLevels, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_spatial_level",
+                                        minSpatialLevel, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_temporal_level",
+                                        minTemporalLevel, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config,
+                                        "compare_with_coupled_solver",
+                                        compareWithCoupledSolver, true);
+    READ_CONFIG_PARAM(config, "mesh_dir", subMeshDir);
+    std::string meshDir = baseMeshDir+subMeshDir;
+
+    auto testCase = heat::makeTestCase(config);
+
+    // combination technique
+    sparseHeat::CombinationSolver combiSolver(config,
+                                              testCase,
+                                              meshDir,
+                                              numLevels,
+                                              minSpatialLevel,
+                                              minTemporalLevel,
+                                              loadInitMesh);
+    Vector combiElapsedTime
+            = combiSolver.runAndMeasurePerformanceMetrics();
+
+    sparseHeat::Observer combiObserver(config, numLevels, minTemporalLevel);
+
+    combiObserver.setOutputService(outputService);
+    auto combiTestCase = combiSolver.getTestCase();
+    auto combiDisc = combiSolver.getDiscretisation();
+    combiObserver.set(combiTestCase, combiDisc);
+    auto combiSolutionHandler = combiSolver.getSolutionHandler();
+    auto combiError = combiObserver.evalError(*combiSolutionHandler);
+
+    int numDofs = combiSolver.getNumDofs();
+    double combiTime = combiElapsedTime.Sum();
+
+    std::cout << "\nCombination technique" << std::endl;
+    std::cout << "Sub-problems (temporal level, spatial level, "
+                 "weight, #dofs, elapsed time):" << std::endl;
+    for (const auto& subProblem : combiSolver.getSubProblems()) {
+        std::cout << "  " << subProblem.temporalIndex
+                  << "\t" << subProblem.spatialIndex
+                  << "\t" << subProblem.weight
+                  << "\t" << subProblem.numDofs
+                  << "\t" << subProblem.elapsedTime << std::endl;
+    }
+    std::cout << "Elapsed time (initialize, solve, combine): ";
+    combiElapsedTime.Print();
+    std::cout << "Peak memory estimate [MB]: "
+              << combiSolver.getPeakMemoryEstimate()/(1024*1024)
+              << std::endl;
+    std::cout << "Solution error: ";
+    combiError.Print();
+    std::cout << "#Dofs: " << numDofs << std::endl;
+    std::cout << "#Dofs of sub-problems: "
+              << combiSolver.getNumSubProblemDofs() << std::endl;
+    std::cout << "Throughput [dofs/s]: "
+              << numDofs/combiTime << std::endl;
+
+    if (!compareWithCoupledSolver) {
+        return;
+    }
+
+    // coupled sparse space-time solver
+    sparseHeat::Solver solver(config,
+                              testCase,
+                              meshDir,
+                              numLevels,
+                              minSpatialLevel,
+                              minTemporalLevel,
+                              loadInitMesh);
+    Vector elapsedTime;
+    int memoryUsage;
+    std::tie(elapsedTime, memoryUsage)
+            = solver.runAndMeasurePerformanceMetrics();
+
+    sparseHeat::Observer observer(config, numLevels, minTemporalLevel);
+
+    observer.setOutputService(outputService);
+    auto disc = solver.getDiscretisation();
+    observer.set(testCase, disc);
+    auto solutionHandler = solver.getSolutionHandler();
+    auto solutionError = observer.evalError(*solutionHandler);
+    double time = elapsedTime.Sum();
+
+    Vector diff(*combiSolutionHandler->getData());
+    diff -= *solutionHandler->getData();
+
+    std::cout << "\nCoupled sparse solver" << std::endl;
+    std::cout << "Elapsed time: ";
+    elapsedTime.Print();
+    std::cout << "Solution error: ";
+    solutionError.Print();
+    std::cout << "Throughput [dofs/s]: "
+              << numDofs/time << std::endl;
+    std::cout << "Speedup of the combination technique: "
+              << time/combiTime << std::endl;
+    std::cout << "Max-norm of the solution difference: "
+              << diff.Normlinf() << std::endl;
 }
 
 
@@ -403,6 +628,14 @@ int main(int argc, char *argv[])
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
             (config, "load_init_mesh", loadInitMesh, false);
 
+    // output files are written by a background thread,
+    // with at most output_queue_size pending writes;
+    // a queue size of zero writes synchronously
+    int outputQueueSize;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (config, "output_queue_size", outputQueueSize, 4);
+    auto outputService = std::make_shared<OutputService>(outputQueueSize);
+
     std::string baseMeshDir;
     if (loadInitMesh) {
         baseMeshDir.assign("../meshes/");
@@ -419,19 +652,31 @@ int main(int argc, char *argv[])
     if (run == "simulation") {
         runOneSimulation(std::move(config),
                          std::move(baseMeshDir),
+                         outputService,
                          loadInitMesh);
     }
     else if (run == "convergence") {
         runMultipleSimulationsToTestConvergence(std::move(config),
                                                 std::move(baseMeshDir),
+                                                outputService,
                                                 loadInitMesh);
     }
     else if (run == "measure") {
         runMultipleSimulationsToMeasurePerformanceMetrics
                 (std::move(config),
                  std::move(baseMeshDir),
+                 outputService,
                  loadInitMesh);
     }
+    else if (run == "combination") {
+        runCombinationTechnique(std::move(config),
+                                std::move(baseMeshDir),
+                                outputService,
+                                loadInitMesh);
+    }
+
+    // waits for the pending output
+    outputService->flush();
 
     return 0;
 }
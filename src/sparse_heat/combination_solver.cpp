@@ -0,0 +1,370 @@
+#include "combination_solver.hpp"
+
+#include "../core/task_scheduler.hpp"
+#include "utilities.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace mfem;
+
+
+sparseHeat::CombinationSolver
+:: CombinationSolver (const nlohmann::json& config,
+                      std::shared_ptr<heat::TestCases>& testCase,
+                      std::string meshDir,
+                      const int numLevels,
+                      const int minSpatialLevel,
+                      const int minTemporalLevel,
+                      const bool loadInitMesh)
+    : m_config (config),
+      m_testCase (testCase),
+      m_meshDir (meshDir),
+      m_numLevels (numLevels),
+      m_minSpatialLevel (minSpatialLevel),
+      m_minTemporalLevel (minTemporalLevel),
+      m_loadInitMesh (loadInitMesh)
+{
+    setConfigParams();
+
+    m_sparseSolver = std::make_unique<sparseHeat::Solver>
+            (m_config, m_testCase, m_meshDir,
+             m_numLevels, m_minSpatialLevel, m_minTemporalLevel,
+             m_loadInitMesh);
+
+    setSubProblems();
+}
+
+void sparseHeat::CombinationSolver
+:: setConfigParams()
+{
+    int numHardwareThreads
+            = std::max(1, static_cast<int>
+                       (std::thread::hardware_concurrency()));
+    double memoryBudgetInMB;
+
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config,
+                                        "combination_num_workers",
+                                        m_numWorkers,
+                                        std::min(numHardwareThreads,
+                                                 2*m_numLevels-1));
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "combination_num_threads_per_worker",
+             m_numThreadsPerWorker,
+             std::max(1, numHardwareThreads/std::max(1, m_numWorkers)));
+
+    // memory budget for concurrent sub-problems; unlimited if zero
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config,
+                                        "combination_memory_budget_mb",
+                                        memoryBudgetInMB, 0);
+    m_memoryBudget = memoryBudgetInMB*1024*1024;
+
+    // rough estimate of the matrix, factorization and vector memory
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config,
+                                        "combination_bytes_per_dof",
+                                        m_bytesPerDof, 4096);
+
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "combination_projection_tolerance",
+             m_projectionTolerance, 1E-12);
+    // the sub-problems are solved by heat::Solver
+    std::string linearSolver;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "linear_solver",
+                                        linearSolver, "pardiso");
+    if (linearSolver != "pardiso" && linearSolver != "cg") {
+        throw std::runtime_error("Combination technique: unsupported "
+                                 "linear_solver \""+linearSolver+"\", "
+                                 "use \"pardiso\" or \"cg\"");
+    }
+}
+
+void sparseHeat::CombinationSolver
+:: setSubProblems()
+{
+    auto disc = m_sparseSolver->getDiscretisation();
+    auto spatialSizesTemperature
+            = disc->getSpatialNestedFEHierarchyForTemperature()
+            ->getNumDims();
+    auto spatialSizesHeatFlux
+            = disc->getSpatialNestedFEHierarchyForHeatFlux()
+            ->getNumDims();
+
+    auto addSubProblem = [&](int m, int s, double weight)
+    {
+        int numTemporalDofs
+                = static_cast<int>(std::pow(2, m_minTemporalLevel+m))+1;
+        int numDofs = numTemporalDofs
+                *(spatialSizesTemperature[s] + spatialSizesHeatFlux[s]);
+        m_subProblems.push_back({m, s, weight, numDofs,
+                                 numDofs*m_bytesPerDof});
+    };
+
+    m_subProblems.clear();
+    for (int m=0; m<m_numLevels; m++) {
+        addSubProblem(m, m_numLevels-1-m, +1.);
+    }
+    for (int m=0; m<m_numLevels-1; m++) {
+        addSubProblem(m, m_numLevels-2-m, -1.);
+    }
+}
+
+void sparseHeat::CombinationSolver
+:: run()
+{
+    initialize();
+    solveSubProblems();
+    combine();
+}
+
+Vector sparseHeat::CombinationSolver
+:: runAndMeasurePerformanceMetrics()
+{
+    Vector elapsedTime(3);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    initialize();
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast
+            <std::chrono::milliseconds>(end - start);
+    elapsedTime(0)
+            = (static_cast<double>(duration.count()))/1000;
+
+    start = std::chrono::high_resolution_clock::now();
+    solveSubProblems();
+    end = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast
+                <std::chrono::milliseconds>(end - start);
+    elapsedTime(1)
+                = (static_cast<double>(duration.count()))/1000;
+
+    start = std::chrono::high_resolution_clock::now();
+    combine();
+    end = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast
+                <std::chrono::milliseconds>(end - start);
+    elapsedTime(2)
+                = (static_cast<double>(duration.count()))/1000;
+
+    return elapsedTime;
+}
+
+void sparseHeat::CombinationSolver
+:: initialize()
+{
+    m_sparseSolver->initialize();
+    m_sparseSolver->getDiscretisation()->assembleSpatialMassMatrices();
+
+    auto dataSize = m_sparseSolver->getSolutionHandler()->getDataSize();
+    m_dataOffsets = evalBlockOffsets(dataSize);
+}
+
+void sparseHeat::CombinationSolver
+:: solveSubProblems()
+{
+    int numSubProblems = static_cast<int>(m_subProblems.size());
+    m_contributions.clear();
+    m_contributions.resize(numSubProblems);
+
+    // MFEM creates the integration rules and bases lazily, which
+    // is not thread-safe; the smallest sub-problem is solved alone
+    // first, with all threads
+    int first = static_cast<int>(std::min_element(m_subProblems.begin(),
+                                  m_subProblems.end(),
+                                  [](const CombinationSubProblem& a,
+                                     const CombinationSubProblem& b) {
+        return a.numDofs < b.numDofs;
+    }) - m_subProblems.begin());
+    int numThreads = 1;
+#ifdef _OPENMP
+    numThreads = omp_get_max_threads();
+#endif
+    solveSubProblem(first, numThreads);
+#ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+#endif
+
+    MemoryAwareScheduler scheduler(m_numWorkers, m_memoryBudget);
+    for (int id=0; id<numSubProblems; id++) {
+        if (id == first) {
+            continue;
+        }
+        scheduler.addTask([this, id]() {
+            solveSubProblem(id, m_numThreadsPerWorker);
+        }, m_subProblems[id].memoryEstimate);
+    }
+    scheduler.run();
+    m_peakMemoryEstimate = scheduler.getPeakMemoryEstimate();
+}
+
+void sparseHeat::CombinationSolver
+:: solveSubProblem(int id, int numThreads)
+{
+    // the OpenMP regions of this thread use the given threads
+#ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+#else
+    (void) numThreads;
+#endif
+
+    auto& subProblem = m_subProblems[id];
+    auto start = std::chrono::high_resolution_clock::now();
+
+    auto contribution = std::make_unique<BlockVector>(m_dataOffsets);
+    (*contribution) = 0.;
+    {
+        heat::Solver solver(m_config, m_testCase, m_meshDir,
+                            m_minSpatialLevel + subProblem.spatialIndex,
+                            m_minTemporalLevel + subProblem.temporalIndex,
+                            m_loadInitMesh);
+        solver.run();
+        auto solution = solver.getSolutionHandler();
+
+        auto disc = m_sparseSolver->getDiscretisation();
+        addToSparseData(solution->getTemperatureData(),
+                        subProblem.temporalIndex,
+                        subProblem.spatialIndex,
+                        subProblem.weight,
+                        disc->getSpatialNestedFEHierarchyForTemperature()
+                        ->getNumDims(),
+                        *disc->getSpatialMassForTemperature(),
+                        contribution->GetBlock(0));
+        addToSparseData(solution->getHeatFluxData(),
+                        subProblem.temporalIndex,
+                        subProblem.spatialIndex,
+                        subProblem.weight,
+                        disc->getSpatialNestedFEHierarchyForHeatFlux()
+                        ->getNumDims(),
+                        *disc->getSpatialMassForHeatFlux(),
+                        contribution->GetBlock(1));
+    }
+    m_contributions[id] = std::move(contribution);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast
+            <std::chrono::milliseconds>(end - start);
+    subProblem.elapsedTime
+            = (static_cast<double>(duration.count()))/1000;
+}
+
+// The nodal values on the temporal level m are split into
+// hierarchical surpluses of the temporal levels k <= m;
+// the surplus of the level k lives on the spatial level L-1-k >= s,
+// to which it is L2-projected with the mixed spatial mass matrices
+void sparseHeat::CombinationSolver
+:: addToSparseData(const Vector& fullData,
+                   int temporalIndex, int spatialIndex,
+                   double weight,
+                   const Array<int>& spatialSizes,
+                   BlockMatrix& spatialMass,
+                   Vector& sparseData) const
+{
+    int m = temporalIndex;
+    int s = spatialIndex;
+    int nx = spatialSizes[s];
+
+    auto temporalBlockSizes
+            = evalTemporalBlockSizes(m_minTemporalLevel,
+                                     m_minTemporalLevel + m_numLevels-1);
+    Array<int> spatialBlockSizes(spatialSizes);
+    auto blockSizes = evalSpaceTimeBlockSizes(spatialBlockSizes,
+                                              temporalBlockSizes);
+    auto blockOffsets = evalBlockOffsets(blockSizes);
+
+    Vector surplus;
+    for (int k=0; k<=m; k++)
+    {
+        int ntk = temporalBlockSizes[k];
+        int stride = 1 << (m-k);
+
+        // temporal surpluses, column-major nx x ntk
+        surplus.SetSize(nx*ntk);
+        for (int c=0; c<ntk; c++)
+        {
+            double *out = surplus.GetData() + c*nx;
+            if (k == 0) {
+                const double *u = fullData.GetData() + c*stride*nx;
+                for (int l=0; l<nx; l++) { out[l] = u[l]; }
+            }
+            else {
+                const double *uLeft
+                        = fullData.GetData() + (2*c)*stride*nx;
+                const double *uMid
+                        = fullData.GetData() + (2*c+1)*stride*nx;
+                const double *uRight
+                        = fullData.GetData() + (2*c+2)*stride*nx;
+                for (int l=0; l<nx; l++) {
+                    out[l] = uMid[l] - 0.5*(uLeft[l] + uRight[l]);
+                }
+            }
+        }
+
+        int target = m_numLevels-1-k;
+        double *sparseBlock = sparseData.GetData() + blockOffsets[k];
+        if (target == s) {
+            for (int l=0; l<nx*ntk; l++) {
+                sparseBlock[l] += weight*surplus(l);
+            }
+            continue;
+        }
+
+        // L2-projection to the finer spatial level target
+        const SparseMatrix& massFine = spatialMass.GetBlock(target, target);
+        const SparseMatrix& massMixed = spatialMass.GetBlock(target, s);
+        int nxFine = spatialSizes[target];
+        #pragma omp parallel
+        {
+            DSmoother prec(massFine);
+            CGSolver cg;
+            cg.SetOperator(massFine);
+            cg.SetPreconditioner(prec);
+            cg.SetRelTol(m_projectionTolerance);
+            cg.SetAbsTol(0);
+            cg.SetMaxIter(1000);
+            cg.SetPrintLevel(-1);
+
+            Vector rhs(nxFine), proj(nxFine);
+            #pragma omp for schedule(static)
+            for (int c=0; c<ntk; c++)
+            {
+                Vector col(surplus.GetData() + c*nx, nx);
+                massMixed.Mult(col, rhs);
+                proj = 0.;
+                cg.Mult(rhs, proj);
+
+                double *out = sparseBlock + c*nxFine;
+                for (int l=0; l<nxFine; l++) {
+                    out[l] += weight*proj(l);
+                }
+            }
+        }
+    }
+}
+
+void sparseHeat::CombinationSolver
+:: combine()
+{
+    auto data = m_sparseSolver->getSolutionHandler()->getData();
+    (*data) = 0.;
+    for (const auto& contribution : m_contributions) {
+        (*data) += *contribution;
+    }
+    m_contributions.clear();
+}
+
+int sparseHeat::CombinationSolver
+:: getNumSubProblemDofs() const
+{
+    int numDofs = 0;
+    for (const auto& subProblem : m_subProblems) {
+        numDofs += subProblem.numDofs;
+    }
+    return numDofs;
+}
+
+// End of file
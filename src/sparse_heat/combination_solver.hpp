@@ -0,0 +1,158 @@
+#ifndef SPARSE_HEAT_COMBINATION_SOLVER_HPP
+#define SPARSE_HEAT_COMBINATION_SOLVER_HPP
+
+#include "mfem.hpp"
+
+#include "../core/config.hpp"
+#include "../heat/solver.hpp"
+#include "solver.hpp"
+
+
+namespace sparseHeat{
+
+/**
+ * @brief Anisotropic full-tensor sub-problem
+ * of the combination technique
+ */
+struct CombinationSubProblem
+{
+    int temporalIndex; //! temporal level index
+    int spatialIndex; //! spatial level index
+    double weight; //! combination weight, +1 or -1
+    int numDofs;
+    double memoryEstimate; //! in bytes
+    double elapsedTime = 0; //! in seconds
+};
+
+
+/**
+ * @brief Sparse-grid combination technique for the heat equation
+ *
+ * Solves the full-tensor problems on the temporal levels m and
+ * the spatial levels L-1-m, and on the levels m and L-2-m,
+ * with heat::Solver, concurrently on a memory-aware thread pool.
+ * The solutions are combined with the weights +1 and -1
+ * in the layout of the sparseHeat::SolutionHandler:
+ * the temporal nodal values are converted to hierarchical
+ * surpluses, and the spatial parts are L2-projected to the spatial
+ * level of every temporal level, which is exact for nested spaces.
+ *
+ * The spatial meshes of the sub-problems must be numbered as in the
+ * hierarchy of the coupled solver; with load_init_mesh, this requires
+ * init_mesh_level = 0.
+ */
+class CombinationSolver
+{
+public:
+    CombinationSolver (const nlohmann::json& config,
+                       std::shared_ptr<heat::TestCases>& testCase,
+                       std::string meshDir,
+                       const int numLevels,
+                       const int minSpatialLevel,
+                       const int minTemporalLevel,
+                       const bool loadInitMesh=false);
+
+    void setConfigParams();
+
+    void setSubProblems();
+
+    //! Solves the sub-problems and combines their solutions
+    void run();
+
+    //! Returns the elapsed time for solving the sub-problems
+    //! and for combining their solutions
+    mfem::Vector runAndMeasurePerformanceMetrics();
+
+    void initialize();
+
+    //! Solves the sub-problems concurrently and converts
+    //! their solutions to the sparse layout
+    void solveSubProblems();
+
+    //! Sums the converted solutions
+    void combine();
+
+private:
+    //! Solves a sub-problem with the given number of OpenMP threads
+    void solveSubProblem(int id, int numThreads);
+
+    //! Adds the weighted full-tensor data of one field
+    //! to the sparse data
+    void addToSparseData(const mfem::Vector& fullData,
+                         int temporalIndex, int spatialIndex,
+                         double weight,
+                         const mfem::Array<int>& spatialSizes,
+                         mfem::BlockMatrix& spatialMass,
+                         mfem::Vector& sparseData) const;
+
+public:
+    double getMeshwidthOfFinestTemporalMesh() {
+        return m_sparseSolver->getMeshwidthOfFinestTemporalMesh();
+    }
+
+    double getMeshwidthOfFinestSpatialMesh() {
+        return m_sparseSolver->getMeshwidthOfFinestSpatialMesh();
+    }
+
+    //! Returns the number of dofs of the combined solution
+    int getNumDofs() {
+        return m_sparseSolver->getNumDofs();
+    }
+
+    //! Returns the total number of dofs of the sub-problems
+    int getNumSubProblemDofs() const;
+
+    const std::vector<CombinationSubProblem>& getSubProblems() const {
+        return m_subProblems;
+    }
+
+    double getPeakMemoryEstimate() const {
+        return m_peakMemoryEstimate;
+    }
+
+    std::shared_ptr<heat::TestCases> getTestCase() const {
+        return m_testCase;
+    }
+
+    std::shared_ptr<sparseHeat::LsqSparseXtFem> getDiscretisation() const {
+        return m_sparseSolver->getDiscretisation();
+    }
+
+    std::shared_ptr<sparseHeat::SolutionHandler> getSolutionHandler() const {
+        return m_sparseSolver->getSolutionHandler();
+    }
+
+private:
+    const nlohmann::json& m_config;
+
+    std::shared_ptr<heat::TestCases> m_testCase;
+
+    std::string m_meshDir;
+    int m_numLevels;
+    int m_minSpatialLevel;
+    int m_minTemporalLevel;
+    bool m_loadInitMesh;
+
+    int m_numWorkers;
+    int m_numThreadsPerWorker;
+    double m_memoryBudget;
+    double m_bytesPerDof;
+    double m_projectionTolerance;
+    double m_peakMemoryEstimate = 0;
+
+    //! provides the mesh hierarchy, the spatial mass matrices
+    //! and the solution layout
+    std::unique_ptr<sparseHeat::Solver> m_sparseSolver;
+
+    std::vector<CombinationSubProblem> m_subProblems;
+
+    mfem::Array<int> m_dataOffsets;
+
+    //! weighted sub-problem solutions in the sparse layout,
+    //! summed in a fixed order by combine
+    std::vector<std::unique_ptr<mfem::BlockVector>> m_contributions;
+};
+
+}
+
+#endif // SPARSE_HEAT_COMBINATION_SOLVER_HPP
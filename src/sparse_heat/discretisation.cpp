@@ -3,6 +3,11 @@
 #include "assembly.hpp"
 #include "utilities.hpp"
 #include "../heat/coefficients.hpp"
+#include "../mymfem/threaded_assembly.hpp"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 using namespace mfem;
 
@@ -27,6 +32,37 @@ sparseHeat::LsqSparseXtFem
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "end_time",
                                         m_endTime, 1);
 
+    std::string crossLevelAssembly = "quadrature";
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "cross_level_assembly",
+                                        crossLevelAssembly, "quadrature");
+    if (crossLevelAssembly == "prolongation") {
+        m_crossLevelAssembly = mymfem::CrossLevelAssembly::prolongation;
+    } else if (crossLevelAssembly == "quadrature") {
+        m_crossLevelAssembly = mymfem::CrossLevelAssembly::quadrature;
+    } else {
+        throw std::runtime_error("Unknown cross_level_assembly \""
+                                 +crossLevelAssembly+"\", use "
+                                 "\"quadrature\" or \"prolongation\"");
+    }
+
+    // "quadrature" and "simpson" assemble the source per temporal
+    // level; "prolongation" assembles it once per time point shared
+    // by the temporal levels, on nested Simpson points
+    std::string sourceAssembly;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "source_assembly",
+                                        sourceAssembly, "quadrature");
+    if (sourceAssembly == "quadrature") {
+        m_sourceAssembly = SourceAssembly::gauss;
+    } else if (sourceAssembly == "simpson") {
+        m_sourceAssembly = SourceAssembly::simpson;
+    } else if (sourceAssembly == "prolongation") {
+        m_sourceAssembly = SourceAssembly::nestedSimpson;
+    } else {
+        throw std::runtime_error("Unknown source_assembly \""
+                                 +sourceAssembly+"\", use \"quadrature\", "
+                                 "\"simpson\" or \"prolongation\"");
+    }
+
     m_maxTemporalLevel = m_minTemporalLevel + m_numLevels - 1;
 }
 
@@ -170,6 +206,13 @@ void sparseHeat::LsqSparseXtFem
     assembleSpatialDivergence();
 }
 
+void sparseHeat::LsqSparseXtFem
+:: assembleSpatialMassMatrices()
+{
+    assembleSpatialMassForTemperature();
+    assembleSpatialMassForHeatFlux();
+}
+
 void sparseHeat::LsqSparseXtFem
 :: assembleTemporalInitial()
 {
@@ -220,6 +263,8 @@ void sparseHeat::LsqSparseXtFem
             spatialMassIntegator
             = std::make_shared<sparseHeat::SpatialMassIntegrator>();
     spatialMassBilinearForm->addDomainIntegrator(spatialMassIntegator);
+    spatialMassBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialMassBilinearForm->assemble();
     m_spatialMass1 = spatialMassBilinearForm->getBlockMatrix();
 }
@@ -238,6 +283,8 @@ void sparseHeat::LsqSparseXtFem
             (mediumCoeff);
     spatialStiffnessBilinearForm->addDomainIntegrator
             (spatialStiffnessIntegator);
+    spatialStiffnessBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialStiffnessBilinearForm->assemble();
     m_spatialStiffness1 = spatialStiffnessBilinearForm->getBlockMatrix();
 }
@@ -245,22 +292,154 @@ void sparseHeat::LsqSparseXtFem
 void sparseHeat::LsqSparseXtFem
 :: buildSystemMatrix()
 {
-    buildSystemBlocks();
+    m_systemMatrix = buildMonolithicSystemMatrix(false);
+    applyBCs(*m_systemMatrix);
+}
+
+void sparseHeat::LsqSparseXtFem
+:: buildUpperTriangleOfSystemMatrix()
+{
+    m_systemMatrix = buildMonolithicSystemMatrix(true);
+    applyBCsToUpperTriangle(*m_systemMatrix);
+}
+
+// All Kronecker terms of the four blocks are written
+// into one CSR matrix with sorted columns;
+// no intermediate block or monolithic matrices are formed
+SparseMatrix* sparseHeat::LsqSparseXtFem
+:: buildMonolithicSystemMatrix(bool upperTriangle) const
+{
+    int size1 = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyTemperature).Last();
+    int size2 = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyHeatFlux).Last();
+
+    TransposeCache transposeCache;
+    mymfem::KroneckerCsrBuilder builder(size1 + size2, size1 + size2);
+    addSystemBlock11Terms(builder, 0, 0);
+    addSystemBlock12Terms(builder, 0, size1, transposeCache);
+    if (!upperTriangle) {
+        addSystemBlock21Terms(builder, size1, 0, transposeCache);
+    }
+    addSystemBlock22Terms(builder, size1, size1);
+
+    return builder.build(upperTriangle);
+}
+
+// The blocks are applied matrix-free,
+// term by term, as in buildSystemBlocks
+void sparseHeat::LsqSparseXtFem
+:: buildSystemOperator()
+{
+    auto temporalBlockSizes
+            = evalTemporalBlockSizes(m_minTemporalLevel,
+                                     m_maxTemporalLevel);
+    auto spatialSizesTemperature
+            = m_spatialNestedFEHierarchyTemperature->getNumDims();
+    auto spatialSizesHeatFlux
+            = m_spatialNestedFEHierarchyHeatFlux->getNumDims();
+
+    // block11 = (K^t + E^t) \otimes M^{x; (1,1)}
+    //         + M^t \otimes K^{x; (1,1)}
+    m_systemOperatorBlock11 = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes,
+             spatialSizesTemperature, spatialSizesTemperature);
+    m_systemOperatorBlock11->addTerm
+            ({1., m_temporalInitial, false, m_spatialMass1, false});
+    m_systemOperatorBlock11->addTerm
+            ({1., m_temporalStiffness, false, m_spatialMass1, false});
+    m_systemOperatorBlock11->addTerm
+            ({1., m_temporalMass, false, m_spatialStiffness1, false});
+
+    // block22 = M^t \otimes (M^{x; (2,2)} + K^{x; (2,2)})
+    m_systemOperatorBlock22 = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes,
+             spatialSizesHeatFlux, spatialSizesHeatFlux);
+    m_systemOperatorBlock22->addTerm
+            ({1., m_temporalMass, false, m_spatialMass2, false});
+    m_systemOperatorBlock22->addTerm
+            ({1., m_temporalMass, false, m_spatialStiffness2, false});
+
+    // block12 = - (C^t)^{\top} \otimes B^{x; (1,2)}
+    //           - M^t \otimes (C^{x; (2,1)})^{\top}
+    m_systemOperatorBlock12 = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes,
+             spatialSizesTemperature, spatialSizesHeatFlux);
+    m_systemOperatorBlock12->addTerm
+            ({-1., m_temporalGradient, true, m_spatialDivergence, false});
+    m_systemOperatorBlock12->addTerm
+            ({-1., m_temporalMass, false, m_spatialGradient, true});
+
+    // block21 = block12^{\top}
+    m_systemOperatorBlock21 = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes,
+             spatialSizesHeatFlux, spatialSizesTemperature);
+    m_systemOperatorBlock21->addTerm
+            ({-1., m_temporalGradient, false, m_spatialDivergence, true});
+    m_systemOperatorBlock21->addTerm
+            ({-1., m_temporalMass, true, m_spatialGradient, false});
 
     Array<int> blockOffsets(3);
     blockOffsets[0] = 0;
-    blockOffsets[1] = m_systemBlock11->NumRows();
-    blockOffsets[2] = m_systemBlock21->NumRows();
+    blockOffsets[1] = m_systemOperatorBlock11->Height();
+    blockOffsets[2] = m_systemOperatorBlock22->Height();
     blockOffsets.PartialSum();
 
-    BlockMatrix buf(blockOffsets);
-    buf.SetBlock(0, 0, m_systemBlock11);
-    buf.SetBlock(0, 1, m_systemBlock12);
-    buf.SetBlock(1, 0, m_systemBlock21);
-    buf.SetBlock(1, 1, m_systemBlock22);
+    m_systemBlockOperator = std::make_unique<BlockOperator>(blockOffsets);
+    m_systemBlockOperator->SetBlock(0, 0, m_systemOperatorBlock11.get());
+    m_systemBlockOperator->SetBlock(0, 1, m_systemOperatorBlock12.get());
+    m_systemBlockOperator->SetBlock(1, 0, m_systemOperatorBlock21.get());
+    m_systemBlockOperator->SetBlock(1, 1, m_systemOperatorBlock22.get());
 
-    m_systemMatrix = buf.CreateMonolithic();
-    applyBCs(*m_systemMatrix);
+    // same as eliminating the essential rows and columns
+    // with a unit diagonal
+    m_systemOperator = std::make_unique<ConstrainedOperator>
+            (m_systemBlockOperator.get(), m_essentialDofs);
+}
+
+void sparseHeat::LsqSparseXtFem
+:: assembleSystemOperatorDiagonal(Vector& diag) const
+{
+    int size11 = m_systemOperatorBlock11->Height();
+    int size22 = m_systemOperatorBlock22->Height();
+    diag.SetSize(size11 + size22);
+
+    Vector diag11(diag.GetData(), size11);
+    Vector diag22(diag.GetData() + size11, size22);
+    Vector buf;
+    m_systemOperatorBlock11->assembleDiagonal(buf);
+    diag11 = buf;
+    m_systemOperatorBlock22->assembleDiagonal(buf);
+    diag22 = buf;
+
+    diag.SetSubVector(m_essentialDofs, 1.);
+}
+
+void sparseHeat::LsqSparseXtFem
+:: buildMultilevelPreconditioner()
+{
+    auto temporalBlockSizes
+            = evalTemporalBlockSizes(m_minTemporalLevel,
+                                     m_maxTemporalLevel);
+
+    m_multilevelPreconditioner
+            = std::make_unique<SparseMultilevelPreconditioner>
+            (temporalBlockSizes);
+
+    // diagonal terms of block11
+    m_multilevelPreconditioner->addField
+            ({{1., m_temporalInitial, false, m_spatialMass1, false},
+              {1., m_temporalStiffness, false, m_spatialMass1, false},
+              {1., m_temporalMass, false, m_spatialStiffness1, false}},
+             m_spatialNestedFEHierarchyTemperature);
+
+    // diagonal terms of block22
+    m_multilevelPreconditioner->addField
+            ({{1., m_temporalMass, false, m_spatialMass2, false},
+              {1., m_temporalMass, false, m_spatialStiffness2, false}},
+             m_spatialNestedFEHierarchyHeatFlux);
+
+    m_multilevelPreconditioner->setEssentialDofs(m_essentialDofs);
 }
 
 void sparseHeat::LsqSparseXtFem
@@ -275,164 +454,199 @@ void sparseHeat::LsqSparseXtFem
 void sparseHeat::LsqSparseXtFem
 :: buildSystemBlock11()
 {
-    auto temporalBlockSizes
-            = evalTemporalBlockSizes(m_minTemporalLevel,
-                                     m_maxTemporalLevel);
-    auto spatialBlockSizes
-            = m_spatialNestedFEHierarchyTemperature->getNumDims();
+    int size = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyTemperature).Last();
 
-    auto blockSizes = evalSpaceTimeBlockSizes(spatialBlockSizes,
-                                              temporalBlockSizes);
-    auto blockOffsets = evalBlockOffsets(blockSizes);
+    mymfem::KroneckerCsrBuilder builder(size, size);
+    addSystemBlock11Terms(builder, 0, 0);
+    m_systemBlock11 = builder.build();
+}
 
-    // tmp1 = (K^t_{\ell1, \ell2} + E^t_{\ell1, \ell2})
-    //            \otimes M^{x; (1,1)}_{L-\ell1, L-\ell2}
-    auto buf = std::make_unique<BlockMatrix>(blockOffsets);
-    for (int i=0; i<m_numLevels; i++)
-    {
-        int ii = getSpatialIndex(i);
-        for (int j=0; j<m_numLevels; j++)
-        {
-            int jj = getSpatialIndex(j);
-            auto tmp = Add(m_temporalInitial->GetBlock(i, j),
-                           m_temporalStiffness->GetBlock(i, j));
-            auto mat = OuterProduct(*tmp, m_spatialMass1->GetBlock(ii, jj));
-            buf->SetBlock(i, j, mat);
-            delete tmp;
-        }
-    }
-    buf->owns_blocks = true;
-    auto tmp1 = buf->CreateMonolithic();
+void sparseHeat::LsqSparseXtFem
+:: buildSystemBlock22()
+{
+    int size = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyHeatFlux).Last();
+
+    mymfem::KroneckerCsrBuilder builder(size, size);
+    addSystemBlock22Terms(builder, 0, 0);
+    m_systemBlock22 = builder.build();
+}
+
+void sparseHeat::LsqSparseXtFem
+:: buildSystemBlock12()
+{
+    int numRows = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyTemperature).Last();
+    int numCols = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyHeatFlux).Last();
+
+    TransposeCache transposeCache;
+    mymfem::KroneckerCsrBuilder builder(numRows, numCols);
+    addSystemBlock12Terms(builder, 0, 0, transposeCache);
+    m_systemBlock12 = builder.build();
+}
+
+void sparseHeat::LsqSparseXtFem
+:: buildSystemBlock21()
+{
+    int numRows = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyHeatFlux).Last();
+    int numCols = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyTemperature).Last();
+
+    TransposeCache transposeCache;
+    mymfem::KroneckerCsrBuilder builder(numRows, numCols);
+    addSystemBlock21Terms(builder, 0, 0, transposeCache);
+    m_systemBlock21 = builder.build();
+}
+
+// block11 = (K^t_{\ell1, \ell2} + E^t_{\ell1, \ell2})
+//              \otimes M^{x; (1,1)}_{L-\ell1, L-\ell2}
+//         + M^t_{\ell1, \ell2} \otimes K^{x;(1,1)}_{L-\ell1, L-\ell2}
+void sparseHeat::LsqSparseXtFem
+:: addSystemBlock11Terms(mymfem::KroneckerCsrBuilder& builder,
+                         int rowOffset, int colOffset) const
+{
+    auto blockOffsets = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyTemperature);
 
-    // tmp2 = M^t_{\ell1, \ell2} \otimes K^{x;(1,1)}_{L-\ell1, L-\ell2}
-    buf.reset(new BlockMatrix(blockOffsets));
     for (int i=0; i<m_numLevels; i++)
     {
         int ii = getSpatialIndex(i);
         for (int j=0; j<m_numLevels; j++)
         {
             int jj = getSpatialIndex(j);
-            auto mat = OuterProduct(m_temporalMass->GetBlock(i, j),
-                                    m_spatialStiffness1->GetBlock(ii, jj));
-            buf->SetBlock(i, j, mat);
+            int r = rowOffset + blockOffsets[i];
+            int c = colOffset + blockOffsets[j];
+            builder.addTerm(1., m_temporalInitial->GetBlock(i, j),
+                            m_spatialMass1->GetBlock(ii, jj), r, c);
+            builder.addTerm(1., m_temporalStiffness->GetBlock(i, j),
+                            m_spatialMass1->GetBlock(ii, jj), r, c);
+            builder.addTerm(1., m_temporalMass->GetBlock(i, j),
+                            m_spatialStiffness1->GetBlock(ii, jj), r, c);
         }
     }
-    buf->owns_blocks = true;
-    auto tmp2 = buf->CreateMonolithic();
-
-    m_systemBlock11 = Add(*tmp1, *tmp2);
-
-    delete tmp1;
-    delete tmp2;
 }
 
+// block22 = M^t_{\ell1, \ell2}
+// \otimes (M^{x; (2,2)}_{L-\ell1, L-\ell2}
+//        + K^{x; (2,2)}_{L-\ell1, L-\ell2})
 void sparseHeat::LsqSparseXtFem
-:: buildSystemBlock22()
+:: addSystemBlock22Terms(mymfem::KroneckerCsrBuilder& builder,
+                         int rowOffset, int colOffset) const
 {
-    auto temporalBlockSizes
-            = evalTemporalBlockSizes(m_minTemporalLevel,
-                                     m_maxTemporalLevel);
-    auto spatialBlockSizes
-            = m_spatialNestedFEHierarchyHeatFlux->getNumDims();
+    auto blockOffsets = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyHeatFlux);
 
-    auto blockSizes = evalSpaceTimeBlockSizes(spatialBlockSizes,
-                                              temporalBlockSizes);
-    auto blockOffsets = evalBlockOffsets(blockSizes);
-
-    auto buf = std::make_unique<BlockMatrix>(blockOffsets);
-    // block22 = M^t_{\ell1, \ell2}
-    // \otimes (M^{x; (2,2)}_{L-\ell1, L-\ell2}
-    //        + K^{x; (2,2)}_{L-\ell1, L-\ell2})
     for (int i=0; i<m_numLevels; i++)
     {
         int ii = getSpatialIndex(i);
         for (int j=0; j<m_numLevels; j++)
         {
             int jj = getSpatialIndex(j);
-            auto tmp = Add(m_spatialMass2->GetBlock(ii, jj),
-                           m_spatialStiffness2->GetBlock(ii, jj));
-            auto mat = OuterProduct(m_temporalMass->GetBlock(i, j), *tmp);
-            buf->SetBlock(i, j, mat);
-            delete tmp;
+            int r = rowOffset + blockOffsets[i];
+            int c = colOffset + blockOffsets[j];
+            builder.addTerm(1., m_temporalMass->GetBlock(i, j),
+                            m_spatialMass2->GetBlock(ii, jj), r, c);
+            builder.addTerm(1., m_temporalMass->GetBlock(i, j),
+                            m_spatialStiffness2->GetBlock(ii, jj), r, c);
         }
     }
-    buf->owns_blocks = true;
-    m_systemBlock22 = buf->CreateMonolithic();
 }
 
-void sparseHeat::LsqSparseXtFem
-:: buildSystemBlock12()
+namespace {
+
+//! Returns the transpose of A, evaluated once per cache
+const SparseMatrix& getTransposed
+(const SparseMatrix& A,
+ std::map<const SparseMatrix*, std::unique_ptr<SparseMatrix>>& cache)
 {
-    auto temporalBlockSizes
-            = evalTemporalBlockSizes(m_minTemporalLevel,
-                                     m_maxTemporalLevel);
-    auto spatialRowBlockSizes
-            = m_spatialNestedFEHierarchyTemperature->getNumDims();
-    auto spatialColBlockSizes
-            = m_spatialNestedFEHierarchyHeatFlux->getNumDims();
+    auto& transposed = cache[&A];
+    if (!transposed) {
+        transposed.reset(Transpose(A));
+    }
+    return *transposed;
+}
 
-    auto rowBlockSizes = evalSpaceTimeBlockSizes(spatialRowBlockSizes,
-                                                 temporalBlockSizes);
-    auto colBlockSizes = evalSpaceTimeBlockSizes(spatialColBlockSizes,
-                                                 temporalBlockSizes);
+}
 
-    auto rowBlockOffsets = evalBlockOffsets(rowBlockSizes);
-    auto colBlockOffsets = evalBlockOffsets(colBlockSizes);
+// block12 = - (C^t_{\ell2, \ell1})^{\top}
+//              \otimes B^{x; (1,2)}_{L-\ell1, L-\ell2}
+//           - M^t_{\ell1, \ell2}
+//              \otimes (C^{x; (2,1)}_{L-\ell2, L-\ell1})^{\top}
+void sparseHeat::LsqSparseXtFem
+:: addSystemBlock12Terms(mymfem::KroneckerCsrBuilder& builder,
+                         int rowOffset, int colOffset,
+                         TransposeCache& transposeCache) const
+{
+    auto rowBlockOffsets = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyTemperature);
+    auto colBlockOffsets = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyHeatFlux);
 
-    auto buf = std::make_unique<BlockMatrix>(rowBlockOffsets,
-                                             colBlockOffsets);
-    // tmp1 = (C^t_{\ell1, \ell2})^{\top}
-    //           \otimes B^{x; (1,2)}_{L-\ell1, L-\ell2})
     for (int i=0; i<m_numLevels; i++)
     {
         int ii = getSpatialIndex(i);
         for (int j=0; j<m_numLevels; j++)
         {
             int jj = getSpatialIndex(j);
-            auto tmp = Transpose(m_temporalGradient->GetBlock(j, i));
-            auto mat = OuterProduct
-                    (*tmp, m_spatialDivergence->GetBlock(ii, jj));
-//            std::cout << i << "\t"
-//                      << j << "\t"
-//                      << mat->NumRows() << "\t"
-//                      << mat->NumCols() << "\t"
-//                      << rowBlockSizes[i] << "\t"
-//                      << colBlockSizes[j] << std::endl;
-            buf->SetBlock(i, j, mat);
-            delete tmp;
+            int r = rowOffset + rowBlockOffsets[i];
+            int c = colOffset + colBlockOffsets[j];
+            builder.addTerm(-1., getTransposed
+                            (m_temporalGradient->GetBlock(j, i),
+                             transposeCache),
+                            m_spatialDivergence->GetBlock(ii, jj), r, c);
+            builder.addTerm(-1., m_temporalMass->GetBlock(i, j),
+                            getTransposed
+                            (m_spatialGradient->GetBlock(jj, ii),
+                             transposeCache), r, c);
         }
     }
-    buf->owns_blocks = true;
-    auto tmp1 = buf->CreateMonolithic();
+}
+
+// block21 = block12^{\top}, term by term
+void sparseHeat::LsqSparseXtFem
+:: addSystemBlock21Terms(mymfem::KroneckerCsrBuilder& builder,
+                         int rowOffset, int colOffset,
+                         TransposeCache& transposeCache) const
+{
+    auto rowBlockOffsets = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyHeatFlux);
+    auto colBlockOffsets = evalSpaceTimeBlockOffsets
+            (m_spatialNestedFEHierarchyTemperature);
 
-    // tmp2 = (M^t_{\ell1, \ell2})^{\top}
-    //           \otimes C^{x; (1,2)}_{L-\ell1, L-\ell2}
-    buf.reset(new BlockMatrix(rowBlockOffsets, colBlockOffsets));
     for (int i=0; i<m_numLevels; i++)
     {
         int ii = getSpatialIndex(i);
         for (int j=0; j<m_numLevels; j++)
         {
             int jj = getSpatialIndex(j);
-            auto tmp = Transpose(m_spatialGradient->GetBlock(jj, ii));
-            auto mat = OuterProduct(m_temporalMass->GetBlock(i, j), *tmp);
-            buf->SetBlock(i, j, mat);
-            delete tmp;
+            int r = rowOffset + rowBlockOffsets[i];
+            int c = colOffset + colBlockOffsets[j];
+            builder.addTerm(-1., m_temporalGradient->GetBlock(i, j),
+                            getTransposed
+                            (m_spatialDivergence->GetBlock(jj, ii),
+                             transposeCache), r, c);
+            builder.addTerm(-1., getTransposed
+                            (m_temporalMass->GetBlock(j, i),
+                             transposeCache),
+                            m_spatialGradient->GetBlock(ii, jj), r, c);
         }
     }
-    buf->owns_blocks = true;
-    auto tmp2 = buf->CreateMonolithic();
-
-    m_systemBlock12 = Add(-1., *tmp1, -1., *tmp2);
-
-    delete tmp1;
-    delete tmp2;
 }
 
-void sparseHeat::LsqSparseXtFem
-:: buildSystemBlock21()
+Array<int> sparseHeat::LsqSparseXtFem
+:: evalSpaceTimeBlockOffsets
+(const std::shared_ptr<mymfem::NestedFEHierarchy>& spatialHierarchy) const
 {
-    m_systemBlock21 = Transpose(*m_systemBlock12);
+    auto temporalBlockSizes
+            = evalTemporalBlockSizes(m_minTemporalLevel,
+                                     m_maxTemporalLevel);
+    auto spatialBlockSizes = spatialHierarchy->getNumDims();
+    auto blockSizes = evalSpaceTimeBlockSizes(spatialBlockSizes,
+                                              temporalBlockSizes);
+    return evalBlockOffsets(blockSizes);
 }
 
 int sparseHeat::LsqSparseXtFem
@@ -480,217 +694,257 @@ void sparseHeat::LsqSparseXtFem
 void sparseHeat::LsqSparseXtFem
 :: assembleSourceWithTemporalGradientOfTemperatureBasis(Vector& b) const
 {
-    auto spatialFes = m_spatialNestedFEHierarchyTemperature->getFESpaces();
-
-    // auxiliary variables
-    Vector buf;
-    int shift = 0;
-
-    // temporal integration rule
-    int order = 4;
-    const IntegrationRule *ir
-            = &IntRules.Get(Geometry::SEGMENT, order);
-
-    // coarsest temporal + finest spatial level
-    // standard FE basis at the coarsest temporal level
-    {
-        int numTemporalMeshElements
-                = static_cast<int>(std::pow(2, m_minTemporalLevel));
-        double ht = m_endTime / numTemporalMeshElements;
-
-        int spatialId = getSpatialIndex(0);
-        auto curSpatialFes = spatialFes[spatialId];
-        int curSpatialFesDim = curSpatialFes->GetTrueVSize();
-
-        buf.SetSize(curSpatialFesDim);
-        for (int n=0; n<numTemporalMeshElements; n++)
-        {
-            double tLeft = n*ht;
-            double tRight = (n+1)*ht;
-
-            Vector tmp1(b.GetData() + n*curSpatialFesDim + shift,
-                        curSpatialFesDim);
-            Vector tmp2(b.GetData() + (n+1)*curSpatialFesDim + shift,
-                        curSpatialFesDim);
+    auto assembleAtGivenTime
+            = [this](double t,
+                     const std::shared_ptr<FiniteElementSpace>& spatialFes,
+                     Vector& buf) {
+        assembleSourceWithTemporalGradientOfTemperatureBasisAtGivenTime
+                (t, spatialFes, buf);
+    };
+    assembleSourceTerm(m_spatialNestedFEHierarchyTemperature, true,
+                       assembleAtGivenTime, b);
+}
 
-            for (int i=0; i<ir->GetNPoints(); i++)
-            {
-                const IntegrationPoint &ip = ir->IntPoint(i);
-                double t = affineTransform(tLeft, tRight, ip.x);
+void sparseHeat::LsqSparseXtFem
+:: assembleSourceWithTemporalGradientOfTemperatureBasisAtGivenTime
+(double t,
+ const std::shared_ptr<FiniteElementSpace>& spatialFes,
+ Vector& b) const
+{
+    heat::SourceCoeff sourceCoeff(m_testCase);
+    sourceCoeff.SetTime(t);
+    DomainLFIntegrator lfi(sourceCoeff, 2, 4);
+    mymfem::assembleLoadVector(*spatialFes, lfi, b);
+}
 
-                assembleSourceWithTemporalGradientOfTemperatureBasisAtGivenTime
-                        (t, curSpatialFes, buf);
+void sparseHeat::LsqSparseXtFem
+:: assembleSourceWithSpatialDivergenceOfHeatFluxBasis(Vector& b) const
+{
+    auto assembleAtGivenTime
+            = [this](double t,
+                     const std::shared_ptr<FiniteElementSpace>& spatialFes,
+                     Vector& buf) {
+        assembleSourceWithSpatialDivergenceOfHeatFluxBasisAtGivenTime
+                (t, spatialFes, buf);
+    };
+    assembleSourceTerm(m_spatialNestedFEHierarchyHeatFlux, false,
+                       assembleAtGivenTime, b);
+}
 
-                // tmp1 += weight * temporalGradient1 * ht * ft
-                // temporalGradient1 * ht = -1
-                tmp1.Add(-ip.weight, buf);
+namespace {
 
-                // tmp2 += weight * temporalGradient2 * ht * ft
-                // temporalGradient2 * ht = +1
-                tmp2.Add(+ip.weight, buf);
+// load vectors of one element or time, keyed by their offset in b;
+// they are added to b in a fixed order after the threaded assembly,
+// so that b does not depend on the scheduling of the threads
+using Contributions = std::vector<std::pair<int, Vector>>;
 
-//                std::cout << n << "\t"
-//                          << tLeft << "\t"
-//                          << tRight << "\t"
-//                          << i << "\t"
-//                          << t << std::endl;
-            }
+// adds a*v to the contribution at the offset
+void addContribution(Contributions& contributions,
+                     int offset, double a, const Vector& v)
+{
+    for (auto& entry : contributions) {
+        if (entry.first == offset) {
+            entry.second.Add(a, v);
+            return;
         }
-        shift += (numTemporalMeshElements+1)*curSpatialFesDim;
     }
+    contributions.emplace_back(offset, Vector(v.Size()));
+    contributions.back().second.Set(a, v);
+}
 
-    // hierarchical temporal basis for the remaining levels
-    for (int m=1; m<m_numLevels; m++)
-    {
-        int numTemporalMeshElements
-                = static_cast<int>(std::pow(2, m_minTemporalLevel + m));
-        double ht = m_endTime / numTemporalMeshElements;
-
-        int spatialId = getSpatialIndex(m);
-        auto curSpatialFes = spatialFes[spatialId];
-        int curSpatialFesDim = curSpatialFes->GetTrueVSize();
-
-        buf.SetSize(curSpatialFesDim);
-        for (int n=0; n<numTemporalMeshElements; n++)
-        {
-            double tLeft = n*ht;
-            double tRight = (n+1)*ht;
-
-            int nn = n/2;
-            Vector tmp(b.GetData() + nn*curSpatialFesDim + shift, curSpatialFesDim);
-
-            for (int i=0; i<ir->GetNPoints(); i++)
-            {
-                const IntegrationPoint &ip = ir->IntPoint(i);
-                double t = affineTransform(tLeft, tRight, ip.x);
-
-                assembleSourceWithTemporalGradientOfTemperatureBasisAtGivenTime
-                        (t, curSpatialFes, buf);
-
-                if (n%2 == 0) {
-                    // tmp += weight * temporalGradient * ht * f(t)
-                    // temporalGradient * h = +1
-                    tmp.Add(+ip.weight, buf);
-                }
-                else {
-                    // tmp += weight * temporalGradient * ht * ft
-                    // temporalGradient * h = -1
-                    tmp.Add(-ip.weight, buf);
-                }
+// b[offset, offset+v.Size()) += v for all contributions, in order
+void addContributions(Vector& b,
+                      const std::vector<Contributions>& contributions)
+{
+    for (const auto& item : contributions) {
+        for (const auto& entry : item) {
+            double *out = b.GetData() + entry.first;
+            const Vector& v = entry.second;
+            for (int l=0; l<v.Size(); l++) {
+                out[l] += v[l];
             }
         }
-        shift += (numTemporalMeshElements/2)*curSpatialFesDim;
     }
 }
 
-void sparseHeat::LsqSparseXtFem
-:: assembleSourceWithTemporalGradientOfTemperatureBasisAtGivenTime
-(double t,
- const std::shared_ptr<FiniteElementSpace>& spatialFes,
- Vector& b) const
-{
-    LinearForm sourceForm(spatialFes.get());
-    heat::SourceCoeff sourceCoeff(m_testCase);
-    sourceCoeff.SetTime(t);
-    sourceForm.AddDomainIntegrator
-            (new DomainLFIntegrator(sourceCoeff, 2, 4));
-    sourceForm.Assemble();
-    b = sourceForm.GetData();
 }
 
+// The temporal level 0 has the standard hat basis, with the hats
+// n and n+1 on the element n; the levels m >= 1 have the
+// hierarchical hats, the element n carrying the rising half
+// of the hat n/2 if n is even, and its falling half otherwise
 void sparseHeat::LsqSparseXtFem
-:: assembleSourceWithSpatialDivergenceOfHeatFluxBasis(Vector& b) const
+:: assembleSourceTerm
+(const std::shared_ptr<mymfem::NestedFEHierarchy>& spatialHierarchy,
+ bool useTemporalGradient,
+ const SourceAssemblerAtGivenTime& assembleAtGivenTime,
+ Vector& b) const
 {
-    auto spatialFes = m_spatialNestedFEHierarchyHeatFlux->getFESpaces();
+    auto spatialFes = spatialHierarchy->getFESpaces();
 
-    // auxiliary variables
-    Vector buf;
+    Array<int> numTemporalElements(m_numLevels);
+    Array<int> shifts(m_numLevels);
     int shift = 0;
+    for (int m=0; m<m_numLevels; m++)
+    {
+        numTemporalElements[m]
+                = static_cast<int>(std::pow(2, m_minTemporalLevel + m));
+        int spatialDim = spatialFes[getSpatialIndex(m)]->GetTrueVSize();
+        shifts[m] = shift;
+        shift += (m == 0 ? numTemporalElements[m]+1
+                         : numTemporalElements[m]/2)*spatialDim;
+    }
 
-    // temporal integration rule
-    int order = 4;
-    const IntegrationRule *ir
-            = &IntRules.Get(Geometry::SEGMENT, order);
-
-    // coarsest temporal + finest spatial level
-    // standard FE basis at the coarsest temporal level
+    // adds the load vector v at time t, with weight w,
+    // to the hats of the level m supported on the element n;
+    // the temporal basis or its gradient is scaled by ht
+    auto addToLevel = [&](int m, int n, double t, double w,
+            const Vector& v, Contributions& contributions)
     {
-        int numTemporalMeshElements
-                = static_cast<int>(std::pow(2, m_minTemporalLevel));
-        double ht = m_endTime / numTemporalMeshElements;
+        double ht = m_endTime / numTemporalElements[m];
+        double tLeft = n*ht;
+        auto evalTemporalBasis = [&](bool isRising) {
+            if (useTemporalGradient) {
+                return isRising ? +1. : -1.;
+            }
+            return ht*(isRising ? evalLeftHalfOfHatBasis(t, tLeft, ht)
+                                : evalRightHalfOfHatBasis(t, tLeft, ht));
+        };
+
+        int spatialDim = v.Size();
+        if (m == 0) {
+            addContribution(contributions, shifts[0] + n*spatialDim,
+                            w*evalTemporalBasis(false), v);
+            addContribution(contributions, shifts[0] + (n+1)*spatialDim,
+                            w*evalTemporalBasis(true), v);
+        }
+        else {
+            addContribution(contributions, shifts[m] + (n/2)*spatialDim,
+                            w*evalTemporalBasis(n%2 == 0), v);
+        }
+    };
 
-        int spatialId = getSpatialIndex(0);
-        auto curSpatialFes = spatialFes[spatialId];
-        int curSpatialFesDim = curSpatialFes->GetTrueVSize();
+    // the load vectors of different times are assembled concurrently,
+    // except on curved meshes; the first one is assembled alone,
+    // since MFEM creates the integration rules lazily
+    bool threaded = !spatialFes.back()->GetMesh()->GetNodes();
 
-        buf.SetSize(curSpatialFesDim);
-        for (int n=0; n<numTemporalMeshElements; n++)
+    if (m_sourceAssembly != SourceAssembly::nestedSimpson)
+    {
+        // every level at the Gauss or Simpson points of its own elements
+        int order = 4;
+        const IntegrationRule *ir
+                = &IntRules.Get(Geometry::SEGMENT, order);
+        IntegrationRule simpsonRule(3);
+        if (m_sourceAssembly == SourceAssembly::simpson)
         {
-            double tLeft = n*ht;
-            double tRight = (n+1)*ht;
+            const double points[3] = {0., 0.5, 1.};
+            const double weights[3] = {1./6, 4./6, 1./6};
+            for (int i=0; i<3; i++) {
+                simpsonRule.IntPoint(i).x = points[i];
+                simpsonRule.IntPoint(i).weight = weights[i];
+            }
+            ir = &simpsonRule;
+        }
 
-            Vector tmp1(b.GetData() + n*curSpatialFesDim + shift,
-                        curSpatialFesDim);
-            Vector tmp2(b.GetData() + (n+1)*curSpatialFesDim + shift,
-                        curSpatialFesDim);
+        std::vector<std::pair<int, int>> elements;
+        for (int m=0; m<m_numLevels; m++) {
+            for (int n=0; n<numTemporalElements[m]; n++) {
+                elements.emplace_back(m, n);
+            }
+        }
 
+        int numElements = static_cast<int>(elements.size());
+        std::vector<Contributions> contributions(numElements);
+        auto assembleElement = [&](int k, Vector& buf)
+        {
+            int m = elements[k].first;
+            int n = elements[k].second;
+            double ht = m_endTime / numTemporalElements[m];
+            auto curSpatialFes = spatialFes[getSpatialIndex(m)];
             for (int i=0; i<ir->GetNPoints(); i++)
             {
                 const IntegrationPoint &ip = ir->IntPoint(i);
-                double t = affineTransform(tLeft, tRight, ip.x);
-
-                assembleSourceWithSpatialDivergenceOfHeatFluxBasisAtGivenTime
-                        (t, curSpatialFes, buf);
-
-                // tmp1 += weight * temporalBasisVal1 * ht * ft
-                tmp1.Add(ip.weight * evalRightHalfOfHatBasis(t, tLeft, ht) * ht, buf);
-
-                // tmp2 += weight * temporalBasisVal2 * ht * ft
-                tmp2.Add(+ip.weight * evalLeftHalfOfHatBasis(t, tLeft, ht) * ht, buf);
+                double t = affineTransform(n*ht, (n+1)*ht, ip.x);
+                assembleAtGivenTime(t, curSpatialFes, buf);
+                addToLevel(m, n, t, ip.weight, buf, contributions[k]);
             }
+        };
+
+        Vector buf;
+        assembleElement(0, buf);
+        #pragma omp parallel for schedule(dynamic) firstprivate(buf) \
+            if (threaded)
+        for (int k=1; k<numElements; k++) {
+            assembleElement(k, buf);
         }
-        shift += (numTemporalMeshElements+1)*curSpatialFesDim;
+        addContributions(b, contributions);
     }
-
-    // hierarchical temporal basis for the remaining levels
-    for (int m=1; m<m_numLevels; m++)
+    else
     {
-        int numTemporalMeshElements
-                = static_cast<int>(std::pow(2, m_minTemporalLevel + m));
-        double ht = m_endTime / numTemporalMeshElements;
+        // Simpson's rule on the elements of every level: the points
+        // of the level m are the nodes of the level m+1, so they are
+        // also points of all finer levels. Every point is assembled
+        // once, on the spatial level of the coarsest temporal level
+        // that uses it, and restricted to the coarser spatial levels
+        // of the finer temporal levels with the transposed
+        // prolongations, which is exact for nested spaces.
+        std::vector<std::unique_ptr<SparseMatrix>> prolongations;
+        for (int s=0; s<m_numLevels-1; s++) {
+            prolongations.emplace_back
+                    (spatialHierarchy->buildProlongation(s));
+        }
 
-        int spatialId = getSpatialIndex(m);
-        auto curSpatialFes = spatialFes[spatialId];
-        int curSpatialFesDim = curSpatialFes->GetTrueVSize();
+        int finestLevel = m_numLevels-1;
+        int numPoints = 2*numTemporalElements[finestLevel] + 1;
+        double h = m_endTime / (numPoints-1);
 
-        buf.SetSize(curSpatialFesDim);
-        for (int n=0; n<numTemporalMeshElements; n++)
+        std::vector<Contributions> contributions(numPoints);
+        auto assemblePoint = [&](int j, Vector& v, Vector& w)
         {
-            double tLeft = n*ht;
-            double tRight = (n+1)*ht;
-
-            int nn = n/2;
-            Vector tmp(b.GetData() + nn*curSpatialFesDim + shift, curSpatialFesDim);
+            // the points of the level m are the multiples
+            // of 2^{finestLevel-m} h
+            int coarsestLevel = finestLevel;
+            while (coarsestLevel > 0
+                   && j % (1 << (finestLevel-coarsestLevel+1)) == 0) {
+                coarsestLevel--;
+            }
 
-            for (int i=0; i<ir->GetNPoints(); i++)
+            double t = j*h;
+            assembleAtGivenTime
+                    (t, spatialFes[getSpatialIndex(coarsestLevel)], v);
+            for (int m=coarsestLevel; m<m_numLevels; m++)
             {
-                const IntegrationPoint &ip = ir->IntPoint(i);
-                double t = affineTransform(tLeft, tRight, ip.x);
-
-                assembleSourceWithSpatialDivergenceOfHeatFluxBasisAtGivenTime
-                        (t, curSpatialFes, buf);
+                if (m > coarsestLevel) {
+                    int s = getSpatialIndex(m);
+                    w.SetSize(prolongations[s]->NumCols());
+                    prolongations[s]->MultTranspose(v, w);
+                    v.Swap(w);
+                }
 
-                if (n%2 == 0) {
-                    // tmp += weight * temporalBasisVal * ht * f(t)
-                    tmp.Add(ip.weight * evalLeftHalfOfHatBasis(t, tLeft, ht) * ht, buf);
+                // q half-elements of the level m from the origin
+                int q = j >> (finestLevel-m);
+                if (q%2 == 1) {
+                    addToLevel(m, q/2, t, 4./6, v, contributions[j]);
+                    continue;
                 }
-                else {
-                    // tmp += weight * temporalGradient * ht * ft
-                    tmp.Add(ip.weight * evalRightHalfOfHatBasis(t, tLeft, ht) * ht, buf);
+                if (q/2 > 0) {
+                    addToLevel(m, q/2-1, t, 1./6, v, contributions[j]);
+                }
+                if (q/2 < numTemporalElements[m]) {
+                    addToLevel(m, q/2, t, 1./6, v, contributions[j]);
                 }
             }
+        };
+
+        Vector v, w;
+        assemblePoint(0, v, w);
+        #pragma omp parallel for schedule(dynamic) firstprivate(v, w) \
+            if (threaded)
+        for (int j=1; j<numPoints; j++) {
+            assemblePoint(j, v, w);
         }
-        shift += (numTemporalMeshElements/2)*curSpatialFesDim;
+        addContributions(b, contributions);
     }
 }
 
@@ -702,6 +956,28 @@ void sparseHeat::LsqSparseXtFem
     }
 }
 
+void sparseHeat::LsqSparseXtFem
+:: applyBCsToUpperTriangle(SparseMatrix &A) const
+{
+    Array<bool> isEssential(A.NumRows());
+    isEssential = false;
+    for (int k=0; k<m_essentialDofs.Size(); k++) {
+        isEssential[m_essentialDofs[k]] = true;
+    }
+
+    const int *I = A.GetI();
+    const int *J = A.GetJ();
+    double *data = A.GetData();
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int r=0; r<A.NumRows(); r++) {
+        for (int k=I[r]; k<I[r+1]; k++) {
+            if (isEssential[r] || isEssential[J[k]]) {
+                data[k] = (J[k] == r) ? 1. : 0.;
+            }
+        }
+    }
+}
+
 void sparseHeat::LsqSparseXtFem
 :: applyBCs(BlockVector &B) const
 {
@@ -3,15 +3,29 @@
 
 #include "mfem.hpp"
 
+#include <functional>
 #include <iostream>
+#include <map>
 
 #include "../core/config.hpp"
 #include "../heat/test_cases.hpp"
+#include "../mymfem/kronecker_csr_builder.hpp"
+#include "../mymfem/my_bilinearForms.hpp"
 #include "../mymfem/nested_hierarchy.hpp"
+#include "matrix_free_operator.hpp"
+#include "multilevel_preconditioner.hpp"
 
 
 namespace sparseHeat {
 
+/**
+ * @brief Temporal quadrature of the source term;
+ * gauss and simpson assemble every temporal level on its own elements,
+ * nestedSimpson assembles every Simpson point once and restricts it
+ * to the coarser spatial levels
+ */
+enum class SourceAssembly {gauss, simpson, nestedSimpson};
+
 /**
  * @brief Base class for Least-squares sparse space-time FE
  * discretisation of the heat equation
@@ -52,6 +66,10 @@ public:
     //! Assembles the sub-matrices in the discretisation
     void assembleSystemSubMatrices();
 
+    //! Assembles only the spatial mass matrices,
+    //! e.g. for L2-projections between the spatial levels
+    void assembleSpatialMassMatrices();
+
 protected:
     void assembleTemporalInitial();
     void assembleTemporalMass();
@@ -67,18 +85,59 @@ protected:
     virtual void assembleSpatialDivergence() = 0;
 
 public:
-    //! Builds the system matrix
+    //! Builds the system matrix in a single pass
     void buildSystemMatrix();
 
-private:
+    //! Builds the upper triangle of the system matrix,
+    //! for symmetric solvers
+    void buildUpperTriangleOfSystemMatrix();
+
     //! Builds the system matrix blocks
     void buildSystemBlocks();
 
+    //! Builds the matrix-free system operator,
+    //! with the boundary conditions applied
+    void buildSystemOperator();
+
+    //! Evaluates the diagonal of the system operator
+    void assembleSystemOperatorDiagonal(mfem::Vector& diag) const;
+
+    //! Builds the additive multilevel preconditioner
+    //! for the diagonal blocks of the system
+    void buildMultilevelPreconditioner();
+
+private:
+    //! Transposed blocks, keyed by the original block
+    using TransposeCache
+    = std::map<const mfem::SparseMatrix*,
+    std::unique_ptr<mfem::SparseMatrix>>;
+
+    //! Adds the Kronecker terms of the system blocks to a builder,
+    //! shifted by the given offsets
+    void addSystemBlock11Terms(mymfem::KroneckerCsrBuilder&,
+                               int rowOffset, int colOffset) const;
+    void addSystemBlock22Terms(mymfem::KroneckerCsrBuilder&,
+                               int rowOffset, int colOffset) const;
+    void addSystemBlock12Terms(mymfem::KroneckerCsrBuilder&,
+                               int rowOffset, int colOffset,
+                               TransposeCache&) const;
+    void addSystemBlock21Terms(mymfem::KroneckerCsrBuilder&,
+                               int rowOffset, int colOffset,
+                               TransposeCache&) const;
+
+    //! Builds the system matrix, or its upper triangle
+    mfem::SparseMatrix* buildMonolithicSystemMatrix
+    (bool upperTriangle) const;
+
     void buildSystemBlock11();
     void buildSystemBlock22();
     void buildSystemBlock12();
     void buildSystemBlock21();
 
+    //! Returns the space-time block offsets over the levels
+    mfem::Array<int> evalSpaceTimeBlockOffsets
+    (const std::shared_ptr<mymfem::NestedFEHierarchy>&) const;
+
     inline int getSpatialIndex(int i) const;
 
 public:
@@ -98,6 +157,20 @@ private:
     void assembleSourceWithSpatialDivergenceOfHeatFluxBasis
     (mfem::Vector& b) const;
 
+    //! Assembles the spatial load vector of a source term at a time
+    using SourceAssemblerAtGivenTime = std::function<void
+    (double, const std::shared_ptr<mfem::FiniteElementSpace>&,
+     mfem::Vector&)>;
+
+    //! Assembles a source term against the sparse space-time basis,
+    //! against the temporal hats or their gradients;
+    //! in parallel over the temporal quadrature points
+    void assembleSourceTerm
+    (const std::shared_ptr<mymfem::NestedFEHierarchy>& spatialHierarchy,
+     bool useTemporalGradient,
+     const SourceAssemblerAtGivenTime& assembleAtGivenTime,
+     mfem::Vector& b) const;
+
 protected:
     virtual
     void assembleSourceWithSpatialDivergenceOfHeatFluxBasisAtGivenTime
@@ -108,6 +181,10 @@ protected:
 public:
     void applyBCs(mfem::SparseMatrix& A) const;
 
+    //! Applies the boundary conditions to the upper triangle
+    //! of the system matrix, as EliminateRowCol on the full matrix
+    void applyBCsToUpperTriangle(mfem::SparseMatrix& A) const;
+
     void applyBCs(mfem::BlockVector& B) const;
 
 public:
@@ -115,6 +192,14 @@ public:
         return m_systemMatrix;
     }
 
+    mfem::Operator* getSystemOperator() const {
+        return m_systemOperator.get();
+    }
+
+    mfem::Solver* getMultilevelPreconditioner() const {
+        return m_multilevelPreconditioner.get();
+    }
+
     mfem::SparseMatrix* getSystemBlock11() const {
         return m_systemBlock11;
     }
@@ -131,6 +216,37 @@ public:
         return m_systemBlock22;
     }
 
+    std::shared_ptr<mfem::BlockMatrix> getTemporalMass() const {
+        return m_temporalMass;
+    }
+
+    std::shared_ptr<mfem::BlockMatrix> getTemporalStiffness() const {
+        return m_temporalStiffness;
+    }
+
+    std::shared_ptr<mfem::BlockMatrix> getTemporalGradient() const {
+        return m_temporalGradient;
+    }
+
+    std::shared_ptr<mfem::BlockMatrix>
+    getSpatialMassForTemperature() const {
+        return m_spatialMass1;
+    }
+
+    std::shared_ptr<mfem::BlockMatrix>
+    getSpatialMassForHeatFlux() const {
+        return m_spatialMass2;
+    }
+
+    std::shared_ptr<mfem::BlockMatrix>
+    getSpatialStiffnessForHeatFlux() const {
+        return m_spatialStiffness2;
+    }
+
+    std::shared_ptr<mfem::BlockMatrix> getSpatialDivergence() const {
+        return m_spatialDivergence;
+    }
+
     std::shared_ptr<mymfem::NestedFEHierarchy>
     getSpatialNestedFEHierarchyForTemperature() const {
         return m_spatialNestedFEHierarchyTemperature;
@@ -158,6 +274,10 @@ protected:
     std::shared_ptr<mymfem::NestedFEHierarchy>
     m_spatialNestedFEHierarchyHeatFlux;
 
+    mymfem::CrossLevelAssembly m_crossLevelAssembly;
+
+    SourceAssembly m_sourceAssembly;
+
     mfem::Array<int> m_essentialDofs;
 
     std::shared_ptr<mfem::BlockMatrix> m_temporalMass;
@@ -178,6 +298,15 @@ protected:
     mfem::SparseMatrix* m_systemBlock22 = nullptr;
 
     mfem::SparseMatrix* m_systemMatrix = nullptr;
+
+    std::unique_ptr<sparseHeat::SparseKroneckerOperator>
+    m_systemOperatorBlock11, m_systemOperatorBlock12,
+    m_systemOperatorBlock21, m_systemOperatorBlock22;
+    std::unique_ptr<mfem::BlockOperator> m_systemBlockOperator;
+    std::unique_ptr<mfem::Operator> m_systemOperator;
+
+    std::unique_ptr<sparseHeat::SparseMultilevelPreconditioner>
+    m_multilevelPreconditioner;
 };
 
 
@@ -3,6 +3,7 @@
 #include "assembly.hpp"
 #include "../heat/coefficients.hpp"
 #include "../heat/assembly.hpp"
+#include "../mymfem/threaded_assembly.hpp"
 
 using namespace mfem;
 
@@ -64,6 +65,8 @@ void sparseHeat::LsqSparseXtFemH1H1
             = std::make_shared<sparseHeat::SpatialVectorMassIntegrator>();
     spatialVectorMassBilinearForm->addDomainIntegrator
             (spatialVectorMassIntegator);
+    spatialVectorMassBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialVectorMassBilinearForm->assemble();
     m_spatialMass2 = spatialVectorMassBilinearForm->getBlockMatrix();
 }
@@ -79,6 +82,8 @@ void sparseHeat::LsqSparseXtFemH1H1
             = std::make_shared<sparseHeat::SpatialVectorStiffnessIntegrator>();
     spatialVectorStiffnessBilinearForm->addDomainIntegrator
             (spatialVectorStiffnessIntegator);
+    spatialVectorStiffnessBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialVectorStiffnessBilinearForm->assemble();
     m_spatialStiffness2 = spatialVectorStiffnessBilinearForm->getBlockMatrix();
 }
@@ -98,6 +103,8 @@ void sparseHeat::LsqSparseXtFemH1H1
             <sparseHeat::SpatialVectorGradientIntegrator>(mediumCoeff);
     spatialVectorGradientBilinearForm->addDomainIntegrator
             (spatialVectorGradientIntegator);
+    spatialVectorGradientBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialVectorGradientBilinearForm->assemble();
     m_spatialGradient = spatialVectorGradientBilinearForm->getBlockMatrix();
 }
@@ -114,6 +121,8 @@ void sparseHeat::LsqSparseXtFemH1H1
             = std::make_shared<sparseHeat::SpatialVectorDivergenceIntegrator>();
     spatialVectorDivergenceBilinearForm->addDomainIntegrator
             (spatialVectorDivergenceIntegator);
+    spatialVectorDivergenceBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialVectorDivergenceBilinearForm->assemble();
     m_spatialDivergence = spatialVectorDivergenceBilinearForm->getBlockMatrix();
 }
@@ -124,13 +133,10 @@ void sparseHeat::LsqSparseXtFemH1H1
  const std::shared_ptr<FiniteElementSpace>& spatialFes,
  Vector& b) const
 {
-    LinearForm sourceForm(spatialFes.get());
     heat::SourceCoeff sourceCoeff(m_testCase);
     sourceCoeff.SetTime(t);
-    sourceForm.AddDomainIntegrator
-            (new heat::SpatialVectorDivergenceLFIntegrator(sourceCoeff, -1));
-    sourceForm.Assemble();
-    b = sourceForm.GetData();
+    heat::SpatialVectorDivergenceLFIntegrator lfi(sourceCoeff, -1);
+    mymfem::assembleLoadVector(*spatialFes, lfi, b);
 }
 
 // End of file
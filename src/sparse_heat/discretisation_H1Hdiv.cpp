@@ -3,6 +3,7 @@
 #include "assembly.hpp"
 #include "../heat/coefficients.hpp"
 #include "../heat/assembly.hpp"
+#include "../mymfem/threaded_assembly.hpp"
 
 using namespace mfem;
 
@@ -63,6 +64,8 @@ void sparseHeat::LsqSparseXtFemH1Hdiv
             = std::make_shared<sparseHeat::SpatialVectorFEMassIntegrator>();
     spatialVectorFEMassBilinearForm->addDomainIntegrator
             (spatialVectorFEMassIntegator);
+    spatialVectorFEMassBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialVectorFEMassBilinearForm->assemble();
     m_spatialMass2 = spatialVectorFEMassBilinearForm->getBlockMatrix();
 }
@@ -78,6 +81,8 @@ void sparseHeat::LsqSparseXtFemH1Hdiv
             = std::make_shared<sparseHeat::SpatialVectorFEStiffnessIntegrator>();
     spatialVectorFEStiffnessBilinearForm->addDomainIntegrator
             (spatialVectorFEStiffnessIntegator);
+    spatialVectorFEStiffnessBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialVectorFEStiffnessBilinearForm->assemble();
     m_spatialStiffness2 = spatialVectorFEStiffnessBilinearForm->getBlockMatrix();
 }
@@ -97,6 +102,8 @@ void sparseHeat::LsqSparseXtFemH1Hdiv
             <sparseHeat::SpatialVectorFEGradientIntegrator>(mediumCoeff);
     spatialVectorFEGradientBilinearForm->addDomainIntegrator
             (spatialVectorFEGradientIntegator);
+    spatialVectorFEGradientBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialVectorFEGradientBilinearForm->assemble();
     m_spatialGradient = spatialVectorFEGradientBilinearForm->getBlockMatrix();
 }
@@ -113,6 +120,8 @@ void sparseHeat::LsqSparseXtFemH1Hdiv
             = std::make_shared<sparseHeat::SpatialVectorFEDivergenceIntegrator>();
     spatialVectorFEDivergenceBilinearForm->addDomainIntegrator
             (spatialVectorFEDivergenceIntegator);
+    spatialVectorFEDivergenceBilinearForm->setCrossLevelAssembly
+            (m_crossLevelAssembly);
     spatialVectorFEDivergenceBilinearForm->assemble();
     m_spatialDivergence = spatialVectorFEDivergenceBilinearForm->getBlockMatrix();
 }
@@ -123,13 +132,10 @@ void sparseHeat::LsqSparseXtFemH1Hdiv
  const std::shared_ptr<FiniteElementSpace>& spatialFes,
  Vector& b) const
 {
-    LinearForm sourceForm(spatialFes.get());
     heat::SourceCoeff sourceCoeff(m_testCase);
     sourceCoeff.SetTime(t);
-    sourceForm.AddDomainIntegrator
-            (new heat::SpatialVectorFEDivergenceLFIntegrator(sourceCoeff, -1));
-    sourceForm.Assemble();
-    b = sourceForm.GetData();
+    heat::SpatialVectorFEDivergenceLFIntegrator lfi(sourceCoeff, -1);
+    mymfem::assembleLoadVector(*spatialFes, lfi, b);
 }
 
 // End of file
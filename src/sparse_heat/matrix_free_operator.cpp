@@ -0,0 +1,182 @@
+#include "matrix_free_operator.hpp"
+#include "utilities.hpp"
+
+#include <assert.h>
+
+using namespace mfem;
+
+
+sparseHeat::SparseKroneckerOperator
+:: SparseKroneckerOperator (const Array<int>& temporalBlockSizes,
+                            const Array<int>& rowSpatialSizes,
+                            const Array<int>& colSpatialSizes)
+{
+    m_numLevels = temporalBlockSizes.Size();
+    assert(rowSpatialSizes.Size() == m_numLevels);
+    assert(colSpatialSizes.Size() == m_numLevels);
+
+    temporalBlockSizes.Copy(m_temporalBlockSizes);
+    rowSpatialSizes.Copy(m_rowSpatialSizes);
+    colSpatialSizes.Copy(m_colSpatialSizes);
+
+    auto rowBlockSizes = evalSpaceTimeBlockSizes(m_rowSpatialSizes,
+                                                 m_temporalBlockSizes);
+    auto colBlockSizes = evalSpaceTimeBlockSizes(m_colSpatialSizes,
+                                                 m_temporalBlockSizes);
+    m_rowOffsets = evalBlockOffsets(rowBlockSizes);
+    m_colOffsets = evalBlockOffsets(colBlockSizes);
+
+    height = m_rowOffsets.Last();
+    width = m_colOffsets.Last();
+}
+
+void sparseHeat::SparseKroneckerOperator
+:: addTerm (const SparseKroneckerTerm& term)
+{
+    m_terms.push_back(term);
+
+    std::vector<const SparseMatrix*> blocks(m_numLevels*m_numLevels);
+    for (int i=0; i<m_numLevels; i++)
+        for (int j=0; j<m_numLevels; j++)
+        {
+            if (term.transposeTemporal) {
+                m_ownedTemporalBlocks.emplace_back
+                        (Transpose(term.temporal->GetBlock(j, i)));
+                blocks[i*m_numLevels + j]
+                        = m_ownedTemporalBlocks.back().get();
+            }
+            else {
+                blocks[i*m_numLevels + j] = &term.temporal->GetBlock(i, j);
+            }
+        }
+    m_temporalBlocks.push_back(std::move(blocks));
+}
+
+void sparseHeat::SparseKroneckerOperator
+:: Mult (const Vector& x, Vector& y) const
+{
+    y = 0.;
+
+    // every thread owns the output temporal levels it works on
+    #pragma omp parallel
+    {
+        Vector buf;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int i=0; i<m_numLevels; i++)
+        {
+            double *yi = y.GetData() + m_rowOffsets[i];
+            for (int j=0; j<m_numLevels; j++)
+            {
+                const double *xj = x.GetData() + m_colOffsets[j];
+                for (int k=0; k<static_cast<int>(m_terms.size()); k++) {
+                    addMultBlock(k, i, j, xj, yi, buf);
+                }
+            }
+        }
+    }
+}
+
+void sparseHeat::SparseKroneckerOperator
+:: addMultBlock (int termId, int i, int j,
+                 const double *xj, double *yi, Vector& buf) const
+{
+    const SparseKroneckerTerm& term = m_terms[termId];
+    const SparseMatrix& T = *m_temporalBlocks[termId][i*m_numLevels + j];
+
+    int ii = getSpatialIndex(i);
+    int jj = getSpatialIndex(j);
+    const SparseMatrix& X = term.transposeSpatial
+            ? term.spatial->GetBlock(jj, ii)
+            : term.spatial->GetBlock(ii, jj);
+
+    int ntOut = m_temporalBlockSizes[i];
+    int ntIn = m_temporalBlockSizes[j];
+    int nxOut = m_rowSpatialSizes[ii];
+    int nxIn = m_colSpatialSizes[jj];
+
+    const int *tI = T.GetI();
+    const int *tJ = T.GetJ();
+    const double *tA = T.GetData();
+    if (T.NumNonZeroElems() == 0) {
+        return;
+    }
+
+    // y_i += coeff * X xmat_j T^T, in either order
+    auto applySpatial = [&](const double *in, double *out) {
+        Vector inVec(const_cast<double*>(in), nxIn);
+        Vector outVec(out, nxOut);
+        if (term.transposeSpatial) {
+            X.AddMultTranspose(inVec, outVec, term.coeff);
+        } else {
+            X.AddMult(inVec, outVec, term.coeff);
+        }
+    };
+
+    if (static_cast<long>(nxIn)*ntOut <= static_cast<long>(nxOut)*ntIn)
+    {
+        // temporal first; buf = xmat_j T^T, of size nxIn x ntOut
+        buf.SetSize(nxIn*ntOut);
+        buf = 0.;
+        for (int r=0; r<ntOut; r++) {
+            double *bufCol = buf.GetData() + r*nxIn;
+            for (int k=tI[r]; k<tI[r+1]; k++) {
+                const double *xCol = xj + tJ[k]*nxIn;
+                for (int l=0; l<nxIn; l++) {
+                    bufCol[l] += tA[k]*xCol[l];
+                }
+            }
+        }
+        for (int r=0; r<ntOut; r++) {
+            if (tI[r] == tI[r+1]) { continue; }
+            applySpatial(buf.GetData() + r*nxIn, yi + r*nxOut);
+        }
+    }
+    else
+    {
+        // spatial first; buf = X xmat_j, of size nxOut x ntIn
+        buf.SetSize(nxOut*ntIn);
+        buf = 0.;
+        for (int c=0; c<ntIn; c++) {
+            applySpatial(xj + c*nxIn, buf.GetData() + c*nxOut);
+        }
+        for (int r=0; r<ntOut; r++) {
+            double *yCol = yi + r*nxOut;
+            for (int k=tI[r]; k<tI[r+1]; k++) {
+                const double *bufCol = buf.GetData() + tJ[k]*nxOut;
+                for (int l=0; l<nxOut; l++) {
+                    yCol[l] += tA[k]*bufCol[l];
+                }
+            }
+        }
+    }
+}
+
+void sparseHeat::SparseKroneckerOperator
+:: assembleDiagonal (Vector& diag) const
+{
+    assert(height == width);
+    diag.SetSize(height);
+    diag = 0.;
+
+    Vector tDiag, xDiag;
+    for (int k=0; k<static_cast<int>(m_terms.size()); k++)
+    {
+        const SparseKroneckerTerm& term = m_terms[k];
+        for (int i=0; i<m_numLevels; i++)
+        {
+            int ii = getSpatialIndex(i);
+            m_temporalBlocks[k][i*m_numLevels + i]->GetDiag(tDiag);
+            term.spatial->GetBlock(ii, ii).GetDiag(xDiag);
+
+            double *d = diag.GetData() + m_rowOffsets[i];
+            int nx = xDiag.Size();
+            for (int r=0; r<tDiag.Size(); r++)
+                for (int l=0; l<nx; l++) {
+                    d[r*nx + l] += term.coeff*tDiag(r)*xDiag(l);
+                }
+        }
+    }
+}
+
+// End of file
@@ -0,0 +1,101 @@
+#ifndef SPARSE_HEAT_MATRIX_FREE_OPERATOR_HPP
+#define SPARSE_HEAT_MATRIX_FREE_OPERATOR_HPP
+
+#include "mfem.hpp"
+
+#include <memory>
+#include <vector>
+
+
+namespace sparseHeat {
+
+/**
+ * @brief One Kronecker term of a sparse space-time operator;
+ * its block between the temporal levels i and j is
+ * coeff * T_{i,j} \otimes X_{L-1-i, L-1-j},
+ * where T_{i,j} = temporal(j,i)^T if transposeTemporal,
+ * and X likewise
+ */
+struct SparseKroneckerTerm
+{
+    double coeff = 1.;
+
+    std::shared_ptr<mfem::BlockMatrix> temporal;
+    bool transposeTemporal = false;
+
+    std::shared_ptr<mfem::BlockMatrix> spatial;
+    bool transposeSpatial = false;
+};
+
+
+/**
+ * @brief Matrix-free sparse space-time operator,
+ * a sum of Kronecker terms over the sparse grid levels.
+ *
+ * Each block is applied with the unidirectional principle:
+ * the temporal and spatial factors are applied one after the other,
+ * in the order whose intermediate result lives on the coarser
+ * space-time level. The cost is thus proportional to the number of
+ * sparse grid dofs times the number of levels.
+ * Vectors are stored as in the SolutionHandler: per temporal level m,
+ * a column-major spatial x temporal array with the spatial level L-1-m.
+ */
+class SparseKroneckerOperator : public mfem::Operator
+{
+public:
+    /**
+     * @brief Constructor
+     * @param temporalBlockSizes hierarchical temporal sizes per level
+     * @param rowSpatialSizes spatial FE space sizes of the test spaces
+     * @param colSpatialSizes spatial FE space sizes of the trial spaces
+     */
+    SparseKroneckerOperator (const mfem::Array<int>& temporalBlockSizes,
+                             const mfem::Array<int>& rowSpatialSizes,
+                             const mfem::Array<int>& colSpatialSizes);
+
+    //! Adds a Kronecker term
+    void addTerm (const SparseKroneckerTerm& term);
+
+    void Mult (const mfem::Vector& x, mfem::Vector& y) const override;
+
+    //! Evaluates the diagonal; defined for square operators
+    void assembleDiagonal (mfem::Vector& diag) const;
+
+    //! Returns the row block offsets
+    const mfem::Array<int>& getRowBlockOffsets() const {
+        return m_rowOffsets;
+    }
+
+    //! Returns the column block offsets
+    const mfem::Array<int>& getColBlockOffsets() const {
+        return m_colOffsets;
+    }
+
+private:
+    inline int getSpatialIndex(int i) const {
+        return m_numLevels - i - 1;
+    }
+
+    //! Adds the (i,j) block of a term times x_j to y_i;
+    //! buf is a scratch vector
+    void addMultBlock (int termId, int i, int j,
+                       const double *xj, double *yi,
+                       mfem::Vector& buf) const;
+
+private:
+    int m_numLevels;
+    mfem::Array<int> m_temporalBlockSizes;
+    mfem::Array<int> m_rowSpatialSizes, m_colSpatialSizes;
+    mfem::Array<int> m_rowOffsets, m_colOffsets;
+
+    std::vector<SparseKroneckerTerm> m_terms;
+
+    //! temporal blocks T_{i,j} per term, in row-major level order;
+    //! transposed blocks are owned in m_ownedTemporalBlocks
+    std::vector<std::vector<const mfem::SparseMatrix*>> m_temporalBlocks;
+    std::vector<std::unique_ptr<mfem::SparseMatrix>> m_ownedTemporalBlocks;
+};
+
+}
+
+#endif // SPARSE_HEAT_MATRIX_FREE_OPERATOR_HPP
@@ -0,0 +1,148 @@
+#include "multilevel_preconditioner.hpp"
+#include "utilities.hpp"
+
+#include <assert.h>
+
+using namespace mfem;
+
+
+sparseHeat::SparseMultilevelPreconditioner
+:: SparseMultilevelPreconditioner (const Array<int>& temporalBlockSizes)
+    : Solver (0)
+{
+    m_numLevels = temporalBlockSizes.Size();
+    temporalBlockSizes.Copy(m_temporalBlockSizes);
+}
+
+void sparseHeat::SparseMultilevelPreconditioner
+:: addField (const std::vector<SparseKroneckerTerm>& terms,
+             const std::shared_ptr<mymfem::NestedFEHierarchy>& hierarchy)
+{
+    Field field;
+    field.offset = height;
+    field.spatialSizes = hierarchy->getNumDims();
+    assert(field.spatialSizes.Size() == m_numLevels);
+
+    for (int k=0; k<m_numLevels-1; k++)
+    {
+        field.prolongations.emplace_back(hierarchy->buildProlongation(k));
+        field.restrictions.emplace_back
+                (Transpose(*field.prolongations.back()));
+    }
+
+    for (const auto& term : terms)
+    {
+        std::vector<Vector> temporalDiags(m_numLevels);
+        std::vector<Vector> spatialDiags(m_numLevels);
+        for (int m=0; m<m_numLevels; m++)
+        {
+            temporalDiags[m].SetSize(m_temporalBlockSizes[m]);
+            if (term.temporal->IsZeroBlock(m, m)) {
+                temporalDiags[m] = 0.;
+            } else {
+                term.temporal->GetBlock(m, m).GetDiag(temporalDiags[m]);
+            }
+            temporalDiags[m] *= term.coeff;
+        }
+        for (int k=0; k<m_numLevels; k++) {
+            term.spatial->GetBlock(k, k).GetDiag(spatialDiags[k]);
+        }
+        field.temporalDiags.push_back(std::move(temporalDiags));
+        field.spatialDiags.push_back(std::move(spatialDiags));
+    }
+
+    auto blockSizes = evalSpaceTimeBlockSizes(field.spatialSizes,
+                                              m_temporalBlockSizes);
+    height = width = height + blockSizes.Sum();
+
+    m_fields.push_back(std::move(field));
+}
+
+void sparseHeat::SparseMultilevelPreconditioner
+:: Mult (const Vector& x, Vector& y) const
+{
+    y.SetSize(height);
+
+    // the residual is zero on the essential dofs
+    Vector xr(x);
+    xr.SetSubVector(m_essentialDofs, 0.);
+
+    for (const auto& field : m_fields)
+    {
+        int offset = field.offset;
+        for (int m=0; m<m_numLevels; m++)
+        {
+            int blockSize = m_temporalBlockSizes[m]
+                    *field.spatialSizes[getSpatialIndex(m)];
+            multLevel(field, m, xr.GetData() + offset,
+                      y.GetData() + offset);
+            offset += blockSize;
+        }
+    }
+
+    for (int k=0; k<m_essentialDofs.Size(); k++) {
+        y(m_essentialDofs[k]) = x(m_essentialDofs[k]);
+    }
+}
+
+void sparseHeat::SparseMultilevelPreconditioner
+:: multLevel (const Field& field, int m,
+              const double *x, double *y) const
+{
+    int j = getSpatialIndex(m);
+    int nt = m_temporalBlockSizes[m];
+    int numTerms = static_cast<int>(field.temporalDiags.size());
+
+    // the temporal columns are independent
+    #pragma omp parallel
+    {
+        std::vector<Vector> residuals(j+1);
+        for (int k=0; k<=j; k++) {
+            residuals[k].SetSize(field.spatialSizes[k]);
+        }
+        Vector correction, buf;
+
+        #pragma omp for schedule(static)
+        for (int c=0; c<nt; c++)
+        {
+            int nxj = field.spatialSizes[j];
+            residuals[j] = Vector(const_cast<double*>(x) + c*nxj, nxj);
+            for (int k=j; k>0; k--) {
+                field.restrictions[k-1]->Mult(residuals[k],
+                                              residuals[k-1]);
+            }
+
+            // scales the residual on the level pair (m, k)
+            auto scale = [&](int k, Vector& r)
+            {
+                for (int l=0; l<r.Size(); l++)
+                {
+                    double d = 0;
+                    for (int n=0; n<numTerms; n++) {
+                        d += field.temporalDiags[n][m](c)
+                                *field.spatialDiags[n][k](l);
+                    }
+                    r(l) = d > 0 ? r(l)/d : r(l);
+                }
+            };
+
+            correction = residuals[0];
+            scale(0, correction);
+            for (int k=1; k<=j; k++)
+            {
+                buf.SetSize(field.spatialSizes[k]);
+                field.prolongations[k-1]->Mult(correction, buf);
+                scale(k, residuals[k]);
+                buf += residuals[k];
+                correction = buf;
+            }
+
+            double *out = y + c*nxj;
+            for (int l=0; l<nxj; l++) {
+                out[l] = correction(l);
+            }
+        }
+    }
+}
+
+// End of file
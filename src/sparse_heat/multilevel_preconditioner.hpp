@@ -0,0 +1,91 @@
+#ifndef SPARSE_HEAT_MULTILEVEL_PRECONDITIONER_HPP
+#define SPARSE_HEAT_MULTILEVEL_PRECONDITIONER_HPP
+
+#include "mfem.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "../mymfem/nested_hierarchy.hpp"
+#include "matrix_free_operator.hpp"
+
+
+namespace sparseHeat {
+
+/**
+ * @brief Additive multilevel (BPX-type) preconditioner
+ * for the sparse space-time system.
+ *
+ * Block-diagonal over the fields. For a field, the residual on the
+ * temporal level m, which lives on the spatial level j = L-1-m,
+ * is restricted to all the coarser spatial levels k <= j
+ * with the nested prolongations. On every level pair (m, k),
+ * it is scaled with the inverse Kronecker-diagonal
+ * \sum_n diag(T_n(m,m)) \otimes diag(X_n(k,k)),
+ * of the diagonal Kronecker terms of the field,
+ * and the contributions are prolongated back and summed.
+ * The temporal basis is hierarchical already.
+ * Vectors are stored as in the SolutionHandler.
+ */
+class SparseMultilevelPreconditioner : public mfem::Solver
+{
+public:
+    //! Constructor with the hierarchical temporal sizes per level
+    SparseMultilevelPreconditioner
+    (const mfem::Array<int>& temporalBlockSizes);
+
+    /**
+     * @brief Adds a field after the previously added ones
+     * @param terms diagonal Kronecker terms of the field
+     * @param hierarchy nested spatial FE spaces of the field
+     */
+    void addField
+    (const std::vector<SparseKroneckerTerm>& terms,
+     const std::shared_ptr<mymfem::NestedFEHierarchy>& hierarchy);
+
+    //! Sets the essential dofs, on which the preconditioner is identity
+    void setEssentialDofs(const mfem::Array<int>& essentialDofs) {
+        essentialDofs.Copy(m_essentialDofs);
+    }
+
+    void Mult (const mfem::Vector& x, mfem::Vector& y) const override;
+
+    //! The preconditioner only depends on the discretisation
+    void SetOperator (const mfem::Operator&) override {}
+
+private:
+    inline int getSpatialIndex(int i) const {
+        return m_numLevels - i - 1;
+    }
+
+    struct Field
+    {
+        int offset;
+        mfem::Array<int> spatialSizes;
+
+        //! prolongations from the spatial level k to k+1,
+        //! and their transposes
+        std::vector<std::unique_ptr<mfem::SparseMatrix>> prolongations;
+        std::vector<std::unique_ptr<mfem::SparseMatrix>> restrictions;
+
+        //! per term, the temporal diagonals per temporal level
+        //! and the spatial diagonals per spatial level
+        std::vector<std::vector<mfem::Vector>> temporalDiags;
+        std::vector<std::vector<mfem::Vector>> spatialDiags;
+    };
+
+    //! Applies the preconditioner for the temporal level m of a field
+    void multLevel (const Field& field, int m,
+                    const double *x, double *y) const;
+
+private:
+    int m_numLevels;
+    mfem::Array<int> m_temporalBlockSizes;
+
+    std::vector<Field> m_fields;
+    mfem::Array<int> m_essentialDofs;
+};
+
+}
+
+#endif // SPARSE_HEAT_MULTILEVEL_PRECONDITIONER_HPP
@@ -1,7 +1,14 @@
 #include "observer.hpp"
 
 #include <fmt/format.h>
+#include <algorithm>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "../heat/assembly.hpp"
+#include "spatial_assembly.hpp"
 #include "spatial_error_evaluator.hpp"
 #include "utilities.hpp"
 
@@ -26,6 +33,9 @@ sparseHeat::Observer
 
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "error_type",
                                         m_errorType, "natural");
+
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "error_evaluation",
+                                        m_errorEvaluation, "full");
 }
 
 void sparseHeat::Observer
@@ -52,6 +62,13 @@ void sparseHeat::Observer
     m_spatialFinestFESpaceForHeatFlux
             = m_spatialNestedFESpacesForHeatFlux[m_numLevels-1];
 
+    // the discretisation may have changed
+    m_temperatureNormOperator.reset();
+    m_heatFluxNormOperator.reset();
+    m_temperatureTemporalGradientNormOperator.reset();
+    m_heatFluxDivergenceNormOperator.reset();
+    m_divergenceCouplingOperator.reset();
+
     if (m_boolEvalError)
     {
         m_materialCoeff = std::make_shared<heat::MediumTensorCoeff>
@@ -71,30 +88,77 @@ void sparseHeat::Observer
 
         m_sourceCoeff = std::make_shared<heat::SourceCoeff>(m_testCase);
 
-        m_spatialErrorOfSolutionInNaturalNorm
-                    = std::make_unique<SpatialErrorOfSolutionInNaturalNorm>
-                    (m_spatialMeshHierarchy);
-        m_spatialErrorOfSolutionInNaturalNorm
-                ->setCoefficients(m_materialCoeff,
-                                  m_exactTemperatureCoeff,
-                                  m_exactHeatFluxCoeff,
-                                  m_exactSpatialGradientOfTemperatureCoeff,
-                                  m_exactTemporalGradientOfTemperatureCoeff,
-                                  m_sourceCoeff);
-
-        m_spatialErrorOfSolutionInLeastSquaresNorm
-                    = std::make_unique<SpatialErrorOfSolutionInLeastSquaresNorm>
-                    (m_spatialMeshHierarchy);
-        m_spatialErrorOfSolutionInLeastSquaresNorm
-                ->setCoefficients(m_materialCoeff,
-                                  m_exactTemperatureCoeff,
-                                  m_exactHeatFluxCoeff,
-                                  m_exactSpatialGradientOfTemperatureCoeff,
-                                  m_exactTemporalGradientOfTemperatureCoeff,
-                                  m_sourceCoeff);
+        // the spatial quadrature data does not depend on time
+        m_spatialQuadratureTable
+                = std::make_shared<const SpatialQuadratureTable>
+                (m_spatialMeshHierarchy,
+                 m_spatialNestedFESpacesForTemperature,
+                 m_spatialNestedFESpacesForHeatFlux);
+
+        // the evaluators set the time of their coefficients,
+        // so every thread gets its own
+        int numThreads = 1;
+#ifdef _OPENMP
+        numThreads = omp_get_max_threads();
+#endif
+        m_spatialErrorOfSolutionInNaturalNorm.clear();
+        m_spatialErrorOfSolutionInLeastSquaresNorm.clear();
+        for (int i=0; i<numThreads; i++)
+        {
+            m_spatialErrorOfSolutionInNaturalNorm.push_back
+                    (buildSpatialErrorOfSolution("natural"));
+            m_spatialErrorOfSolutionInLeastSquaresNorm.push_back
+                    (buildSpatialErrorOfSolution("lsq"));
+        }
     }
 }
 
+std::unique_ptr<sparseHeat::SpatialErrorOfSolution>
+sparseHeat::Observer
+:: buildSpatialErrorOfSolution(const std::string& errorType)
+{
+    std::unique_ptr<SpatialErrorOfSolution> spatialErrorOfSolution;
+    if (errorType == "natural") {
+        spatialErrorOfSolution
+                = std::make_unique<SpatialErrorOfSolutionInNaturalNorm>
+                (m_spatialMeshHierarchy);
+    }
+    else {
+        spatialErrorOfSolution
+                = std::make_unique<SpatialErrorOfSolutionInLeastSquaresNorm>
+                (m_spatialMeshHierarchy);
+    }
+
+    std::shared_ptr<MatrixCoefficient> materialCoeff
+            = std::make_shared<heat::MediumTensorCoeff>(m_testCase);
+
+    std::shared_ptr<Coefficient> exactTemperatureCoeff
+            = std::make_shared<heat::ExactTemperatureCoeff>(m_testCase);
+    std::shared_ptr<VectorCoefficient> exactHeatFluxCoeff
+            = std::make_shared<heat::ExactHeatFluxCoeff>(m_testCase);
+
+    std::shared_ptr<VectorCoefficient> exactSpatialGradientOfTemperatureCoeff
+            = std::make_shared<heat::ExactTemperatureSpatialGradCoeff>
+            (m_testCase);
+    std::shared_ptr<Coefficient> exactTemporalGradientOfTemperatureCoeff
+            = std::make_shared<heat::ExactTemperatureTemporalGradCoeff>
+            (m_testCase);
+
+    std::shared_ptr<Coefficient> sourceCoeff
+            = std::make_shared<heat::SourceCoeff>(m_testCase);
+
+    spatialErrorOfSolution->setQuadratureTable(m_spatialQuadratureTable);
+    spatialErrorOfSolution
+            ->setCoefficients(materialCoeff,
+                              exactTemperatureCoeff,
+                              exactHeatFluxCoeff,
+                              exactSpatialGradientOfTemperatureCoeff,
+                              exactTemporalGradientOfTemperatureCoeff,
+                              sourceCoeff);
+
+    return spatialErrorOfSolution;
+}
+
 void sparseHeat::Observer
 :: visualizeSolutionAtEndTime
 (const sparseHeat::SolutionHandler& solutionHandler)
@@ -131,7 +195,19 @@ Vector sparseHeat::Observer
 
     if (m_boolEvalError) {
         if (m_errorType == "natural") {
-            solutionError = evalErrorInNaturalNorm(solutionHandler);
+            if (m_errorEvaluation == "full") {
+                solutionError = evalErrorInNaturalNorm(solutionHandler);
+            }
+            else if (m_errorEvaluation == "sparse") {
+                solutionError
+                        = evalErrorInNaturalNormOnSparseGrid
+                        (solutionHandler);
+            }
+            else {
+                throw std::runtime_error(fmt::format(
+                    "Unknown error evaluation for sparse heat solver. "
+                    "[{}]", m_errorEvaluation));
+            }
         }
         else if (m_errorType == "lsq") {
             solutionError = evalErrorInLeastSquaresNorm(solutionHandler);
@@ -155,10 +231,220 @@ mfem::Vector sparseHeat::Observer
 {
     Vector solutionError(3);
 
-    Vector temperatureRelErrorNormL2H1(2);
-    Vector heatFluxRelErrorNormL2L2(2);
-    Vector solDivergenceRelErrorNormL2L2(2);
+    Vector temperatureRelErrorNormL2H1;
+    Vector heatFluxRelErrorNormL2L2;
+    Vector solDivergenceRelErrorNormL2L2;
+    std::tie (temperatureRelErrorNormL2H1,
+              heatFluxRelErrorNormL2L2,
+              solDivergenceRelErrorNormL2L2)
+            = integrateSpatialErrorsInTime
+            (solutionHandler, m_spatialErrorOfSolutionInNaturalNorm, 2);
+
+    solutionError(0) = std::sqrt(temperatureRelErrorNormL2H1(0))
+            / std::sqrt(temperatureRelErrorNormL2H1(1));
+    solutionError(1) = std::sqrt(heatFluxRelErrorNormL2L2(0))
+            / std::sqrt(heatFluxRelErrorNormL2L2(1));
+    solutionError(2) = std::sqrt(solDivergenceRelErrorNormL2L2(0))
+            / std::sqrt(solDivergenceRelErrorNormL2L2(1));
+
+    return solutionError;
+}
+
+mfem::Vector sparseHeat::Observer
+:: evalErrorInNaturalNormOnSparseGrid
+(const SolutionHandler & solutionHandler) const
+{
+    buildNormOperatorsOnSparseGrid();
+
+    const Vector& temperatureData = solutionHandler.getTemperatureData();
+    const Vector& heatFluxData = solutionHandler.getHeatFluxData();
 
+    bool isHeatFluxVectorFE
+            = (m_spatialFinestFESpaceForHeatFlux->GetFE(0)->GetRangeType()
+               == FiniteElement::VECTOR);
+
+    // integration rule for the spatial load vectors
+    auto getIntRule = [](FiniteElementSpace& fes)
+    {
+        const FiniteElement *fe = fes.GetFE(0);
+        return &IntRules.Get(fe->GetGeomType(), 2*fe->GetOrder()+4);
+    };
+
+    // (u, v) + (grad u, grad v)
+    SpatialLoadAssembler assembleTemperatureLoad
+            = [&](double t, FiniteElementSpace& fes, Vector& b)
+    {
+        m_exactTemperatureCoeff->SetTime(t);
+        m_exactSpatialGradientOfTemperatureCoeff->SetTime(t);
+
+        LinearForm form(&fes);
+        auto valueIntegrator
+                = new DomainLFIntegrator(*m_exactTemperatureCoeff);
+        valueIntegrator->SetIntRule(getIntRule(fes));
+        form.AddDomainIntegrator(valueIntegrator);
+        auto gradientIntegrator
+                = new heat::SpatialGradientLFIntegrator
+                (*m_exactSpatialGradientOfTemperatureCoeff, 1);
+        gradientIntegrator->SetIntRule(getIntRule(fes));
+        form.AddDomainIntegrator(gradientIntegrator);
+        form.Assemble();
+        b = form;
+    };
+
+    // (q, r)
+    SpatialLoadAssembler assembleHeatFluxLoad
+            = [&](double t, FiniteElementSpace& fes, Vector& b)
+    {
+        m_exactHeatFluxCoeff->SetTime(t);
+
+        LinearForm form(&fes);
+        LinearFormIntegrator *integrator;
+        if (isHeatFluxVectorFE) {
+            integrator = new VectorFEDomainLFIntegrator
+                    (*m_exactHeatFluxCoeff);
+        }
+        else {
+            integrator = new VectorDomainLFIntegrator
+                    (*m_exactHeatFluxCoeff);
+        }
+        integrator->SetIntRule(getIntRule(fes));
+        form.AddDomainIntegrator(integrator);
+        form.Assemble();
+        b = form;
+    };
+
+    // (f, v), tested with the temporal gradient of the temperature basis
+    SpatialLoadAssembler assembleSourceLoadForTemperature
+            = [&](double t, FiniteElementSpace& fes, Vector& b)
+    {
+        m_sourceCoeff->SetTime(t);
+
+        LinearForm form(&fes);
+        auto integrator = new DomainLFIntegrator(*m_sourceCoeff);
+        integrator->SetIntRule(getIntRule(fes));
+        form.AddDomainIntegrator(integrator);
+        form.Assemble();
+        b = form;
+    };
+
+    // -(f, div r)
+    SpatialLoadAssembler assembleSourceLoadForHeatFlux
+            = [&](double t, FiniteElementSpace& fes, Vector& b)
+    {
+        m_sourceCoeff->SetTime(t);
+
+        LinearForm form(&fes);
+        LinearFormIntegrator *integrator;
+        if (isHeatFluxVectorFE) {
+            integrator = new heat::SpatialVectorFEDivergenceLFIntegrator
+                    (*m_sourceCoeff, -1);
+        }
+        else {
+            integrator = new heat::SpatialVectorDivergenceLFIntegrator
+                    (*m_sourceCoeff, -1);
+        }
+        integrator->SetIntRule(getIntRule(fes));
+        form.AddDomainIntegrator(integrator);
+        form.Assemble();
+        b = form;
+    };
+
+    Vector temperatureLoad, heatFluxLoad;
+    assembleLoadOnSparseGrid(m_spatialNestedFESpacesForTemperature,
+                             assembleTemperatureLoad, nullptr,
+                             temperatureLoad);
+    assembleLoadOnSparseGrid(m_spatialNestedFESpacesForHeatFlux,
+                             assembleHeatFluxLoad, nullptr,
+                             heatFluxLoad);
+
+    Vector temperatureSourceLoad, heatFluxSourceLoad;
+    assembleLoadOnSparseGrid(m_spatialNestedFESpacesForTemperature,
+                             nullptr, assembleSourceLoadForTemperature,
+                             temperatureSourceLoad);
+    assembleLoadOnSparseGrid(m_spatialNestedFESpacesForHeatFlux,
+                             assembleSourceLoadForHeatFlux, nullptr,
+                             heatFluxSourceLoad);
+
+    Vector exactNorms = evalSquaredNormsOfExactSolution();
+
+    // discrete norms
+    Vector temperatureBuf(temperatureData.Size());
+    Vector heatFluxBuf(heatFluxData.Size());
+
+    m_temperatureNormOperator->Mult(temperatureData, temperatureBuf);
+    double temperatureNorm = temperatureData*temperatureBuf;
+
+    m_heatFluxNormOperator->Mult(heatFluxData, heatFluxBuf);
+    double heatFluxNorm = heatFluxData*heatFluxBuf;
+
+    // ||du/dt - div q||^2
+    m_temperatureTemporalGradientNormOperator
+            ->Mult(temperatureData, temperatureBuf);
+    double solDivergenceNorm = temperatureData*temperatureBuf;
+    m_heatFluxDivergenceNormOperator->Mult(heatFluxData, heatFluxBuf);
+    solDivergenceNorm += heatFluxData*heatFluxBuf;
+    m_divergenceCouplingOperator->Mult(heatFluxData, temperatureBuf);
+    solDivergenceNorm -= 2*(temperatureData*temperatureBuf);
+
+    Vector squaredErrors(3);
+    squaredErrors(0) = exactNorms(0)
+            - 2*(temperatureLoad*temperatureData) + temperatureNorm;
+    squaredErrors(1) = exactNorms(1)
+            - 2*(heatFluxLoad*heatFluxData) + heatFluxNorm;
+    squaredErrors(2) = exactNorms(2)
+            - 2*(temperatureSourceLoad*temperatureData
+                 + heatFluxSourceLoad*heatFluxData)
+            + solDivergenceNorm;
+
+    // the expansion may turn slightly negative by cancellation
+    Vector solutionError(3);
+    for (int i=0; i<3; i++) {
+        assert(squaredErrors(i) >= -1E-10*exactNorms(i));
+        solutionError(i) = std::sqrt(std::max(squaredErrors(i), 0.))
+                / std::sqrt(exactNorms(i));
+    }
+
+    return solutionError;
+}
+
+mfem::Vector sparseHeat::Observer
+:: evalErrorInLeastSquaresNorm(const SolutionHandler & solutionHandler) const
+{
+    Vector solutionError(3);
+
+    // pde and heat flux error
+    Vector pdeErrorNormL2L2;
+    Vector heatFluxErrorNormL2L2;
+    std::tie (pdeErrorNormL2L2,
+              heatFluxErrorNormL2L2,
+              std::ignore)
+            = integrateSpatialErrorsInTime
+            (solutionHandler, m_spatialErrorOfSolutionInLeastSquaresNorm, 1);
+
+    solutionError(0) = std::sqrt(pdeErrorNormL2L2(0));
+    solutionError(1) = std::sqrt(heatFluxErrorNormL2L2(0));
+
+    // error in initial conditions
+    auto initialTemperatureData
+            = solutionHandler.getTemperatureDataAtInitialTime();
+    auto initialTemperature
+            = std::make_unique<GridFunction>
+            (m_spatialFinestFESpaceForTemperature.get(),
+             initialTemperatureData.GetData());
+    m_exactTemperatureCoeff->SetTime(0.);
+    solutionError(2)
+            = initialTemperature->ComputeL2Error(*m_exactTemperatureCoeff);
+
+    return solutionError;
+}
+
+std::tuple<Vector, Vector, Vector>
+sparseHeat::Observer
+:: integrateSpatialErrorsInTime
+(const SolutionHandler & solutionHandler,
+ const std::vector<std::unique_ptr<SpatialErrorOfSolution>>& evaluators,
+ int numErrors) const
+{
     // temporal integration rule
     int order = 3;
     const IntegrationRule *ir
@@ -172,196 +458,343 @@ mfem::Vector sparseHeat::Observer
             = evalTemporalBlockSizes(m_minTemporalLevel,
                                      m_maxTemporalLevel);
 
-    // auxiliary variables
-    Array<int> temporalElIds(m_numLevels);
-    Array<double> temporalElLeftEdgeCoords(m_numLevels);
-
-    Array<double> temporalBasisVals(m_numLevels+1);
-    Array<double> temporalBasisGradientVals(m_numLevels+1);
-    Array<std::shared_ptr<GridFunction>> spatialTemperatures(m_numLevels+1);
-    Array<std::shared_ptr<GridFunction>> spatialHeatFluxes(m_numLevels+1);
-
     int numElsTemporalFinestMesh
             = static_cast<int>(std::pow(2, m_maxTemporalLevel));
     double finestTemporalMeshSize = temporalMeshSizes[m_numLevels-1];
-//    std::cout << "\nNumber of temporal elements on finest level: "
-//              << numElsTemporalFinestMesh << std::endl;
 
-    temperatureRelErrorNormL2H1 = 0.;
-    heatFluxRelErrorNormL2L2 = 0.;
-    solDivergenceRelErrorNormL2L2 = 0.;
+    // per finest temporal element, the three errors
+    DenseMatrix localErrors(3*numErrors, numElsTemporalFinestMesh);
+
+    int numThreads = static_cast<int>(evaluators.size());
+    #pragma omp parallel num_threads(numThreads)
+    {
+        int threadId = 0;
+#ifdef _OPENMP
+        threadId = omp_get_thread_num();
+#endif
+        const auto& evaluator = evaluators[threadId];
+
+        // auxiliary variables, reused for all temporal elements
+        Array<int> temporalElIds(m_numLevels);
+        Array<double> temporalElLeftEdgeCoords(m_numLevels);
+
+        Array<double> temporalBasisVals(m_numLevels+1);
+        Array<double> temporalBasisGradientVals(m_numLevels+1);
+        Array<std::shared_ptr<GridFunction>>
+                spatialTemperatures(m_numLevels+1);
+        Array<std::shared_ptr<GridFunction>>
+                spatialHeatFluxes(m_numLevels+1);
+        for (int m=0; m<m_numLevels+1; m++) {
+            spatialTemperatures[m] = std::make_shared<GridFunction>();
+            spatialHeatFluxes[m] = std::make_shared<GridFunction>();
+        }
+
+        Vector localError1, localError2, localError3;
+        #pragma omp for schedule(static)
+        for (int n=0; n<numElsTemporalFinestMesh; n++)
+        {
+            // find current temporal element id for all temporal mesh levels
+            evalTemporalElIds(n, temporalElIds);
+
+            // evaluate the coordinate of left edge
+            // of the current temporal element for all temporal mesh levels
+            evalTemporalElLeftEdgeCoords(temporalMeshSizes, temporalElIds,
+                                         temporalElLeftEdgeCoords);
+
+            collectSpatialGridFunctionsForTemperature
+                    (solutionHandler, temporalFesDims, temporalElIds,
+                     spatialTemperatures);
+            collectSpatialGridFunctionsForHeatFlux
+                    (solutionHandler, temporalFesDims, temporalElIds,
+                     spatialHeatFluxes);
+
+            double tFinestLeft = temporalElLeftEdgeCoords[m_numLevels-1];
+            double tFinestRight = tFinestLeft
+                    + temporalMeshSizes[m_numLevels-1];
+
+            double *errors = localErrors.GetColumn(n);
+            for (int e=0; e<3*numErrors; e++) {
+                errors[e] = 0.;
+            }
+            for (int i=0; i<ir->GetNPoints(); i++)
+            {
+                const IntegrationPoint &ip = ir->IntPoint(i);
+                double t = affineTransform(tFinestLeft, tFinestRight, ip.x);
+
+                evalTemporalBasisVals(temporalMeshSizes,
+                                      temporalElIds,
+                                      temporalElLeftEdgeCoords,
+                                      t, temporalBasisVals);
+                evalTemporalBasisGradientVals(temporalMeshSizes,
+                                              temporalElIds,
+                                              temporalElLeftEdgeCoords,
+                                              t, temporalBasisGradientVals);
+
+                std::tie (localError1, localError2, localError3)
+                        = evaluator->eval(t, temporalBasisVals,
+                                          temporalBasisGradientVals,
+                                          spatialTemperatures,
+                                          spatialHeatFluxes);
+
+                double w = ip.weight*finestTemporalMeshSize;
+                for (int e=0; e<numErrors; e++)
+                {
+                    errors[e] += w*localError1(e);
+                    errors[numErrors + e] += w*localError2(e);
+                    errors[2*numErrors + e] += w*localError3(e);
+                }
+            }
+        }
+    }
+
+    // deterministic reduction
+    Vector error1(numErrors), error2(numErrors), error3(numErrors);
+    error1 = 0.;
+    error2 = 0.;
+    error3 = 0.;
     for (int n=0; n<numElsTemporalFinestMesh; n++)
     {
-        // find current temporal element id for all temporal mesh levels
-        evalTemporalElIds(n, temporalElIds);
-
-        // evaluate the coordinate of left edge
-        // of the current temporal element for all temporal mesh levels
-        evalTemporalElLeftEdgeCoords(temporalMeshSizes, temporalElIds,
-                                     temporalElLeftEdgeCoords);
-
-        collectSpatialGridFunctionsForTemperature
-                (solutionHandler, temporalFesDims, temporalElIds,
-                 spatialTemperatures);
-        collectSpatialGridFunctionsForHeatFlux
-                (solutionHandler, temporalFesDims, temporalElIds,
-                 spatialHeatFluxes);
-
-        double tFinestLeft = temporalElLeftEdgeCoords[m_numLevels-1];
-        double tFinestRight = tFinestLeft + temporalMeshSizes[m_numLevels-1];
-
-//        std::cout << "\n" << tFinestLeft << "\t"
-//                  << tFinestRight << "\n\n";
-
-        Vector localTemperatureRelErrorNormH1;
-        Vector localHeatFluxRelErrorNormL2;
-        Vector localSolDivergenceRelErrorNormL2;
-        for (int i=0; i<ir->GetNPoints(); i++)
+        const double *errors = localErrors.GetColumn(n);
+        for (int e=0; e<numErrors; e++)
         {
-            const IntegrationPoint &ip = ir->IntPoint(i);
-            double t = affineTransform(tFinestLeft, tFinestRight, ip.x);
-
-            evalTemporalBasisVals(temporalMeshSizes,
-                                  temporalElIds,
-                                  temporalElLeftEdgeCoords,
-                                  t, temporalBasisVals);
-            evalTemporalBasisGradientVals(temporalMeshSizes,
-                                          temporalElIds,
-                                          temporalElLeftEdgeCoords,
-                                          t, temporalBasisGradientVals);
-
-            std::tie (localTemperatureRelErrorNormH1,
-                      localHeatFluxRelErrorNormL2,
-                      localSolDivergenceRelErrorNormL2)
-                    = m_spatialErrorOfSolutionInNaturalNorm
-                    ->eval(t, temporalBasisVals, temporalBasisGradientVals,
-                           spatialTemperatures, spatialHeatFluxes);
-
-            temperatureRelErrorNormL2H1
-                    .Add(ip.weight*finestTemporalMeshSize,
-                         localTemperatureRelErrorNormH1);
-            heatFluxRelErrorNormL2L2
-                    .Add(ip.weight*finestTemporalMeshSize,
-                         localHeatFluxRelErrorNormL2);
-            solDivergenceRelErrorNormL2L2
-                    .Add(ip.weight*finestTemporalMeshSize,
-                         localSolDivergenceRelErrorNormL2);
+            error1(e) += errors[e];
+            error2(e) += errors[numErrors + e];
+            error3(e) += errors[2*numErrors + e];
         }
     }
-    solutionError(0) = std::sqrt(temperatureRelErrorNormL2H1(0))
-            / std::sqrt(temperatureRelErrorNormL2H1(1));
-    solutionError(1) = std::sqrt(heatFluxRelErrorNormL2L2(0))
-            / std::sqrt(heatFluxRelErrorNormL2L2(1));
-    solutionError(2) = std::sqrt(solDivergenceRelErrorNormL2L2(0))
-            / std::sqrt(solDivergenceRelErrorNormL2L2(1));
 
-    return solutionError;
+    return {error1, error2, error3};
 }
 
-mfem::Vector sparseHeat::Observer
-:: evalErrorInLeastSquaresNorm(const SolutionHandler & solutionHandler) const
+void sparseHeat::Observer
+:: assembleLoadOnSparseGrid
+(const mymfem::NestedFESpaces& spatialFes,
+ const SpatialLoadAssembler& assembleValueLoad,
+ const SpatialLoadAssembler& assembleGradientLoad,
+ Vector& b) const
 {
-    Vector solutionError(3);
+    Array<int> temporalFesDims
+            = evalTemporalBlockSizes(m_minTemporalLevel,
+                                     m_maxTemporalLevel);
 
-    Vector pdeErrorNormL2L2(1);
-    Vector heatFluxErrorNormL2L2(1);
-    Vector initialTemperatureErrorNormL2(1);
+    int size = 0;
+    for (int m=0; m<m_numLevels; m++) {
+        size += temporalFesDims[m]
+                *spatialFes[m_numLevels-m-1]->GetTrueVSize();
+    }
+    b.SetSize(size);
+    b = 0.;
 
     // temporal integration rule
-    int order = 3;
+    int order = 4;
     const IntegrationRule *ir
             = &IntRules.Get(Geometry::SEGMENT, order);
 
-    Array<double> temporalMeshSizes
-            = evalTemporalMeshSizes(m_endTime,
-                                    m_minTemporalLevel,
-                                    m_numLevels);
-    Array<int> temporalFesDims
+    // auxiliary variables
+    Vector valueBuf, gradientBuf;
+    int shift = 0;
+
+    // every temporal level is integrated on its own mesh,
+    // against its own spatial level
+    for (int m=0; m<m_numLevels; m++)
+    {
+        int numTemporalMeshElements
+                = static_cast<int>(std::pow(2, m_minTemporalLevel + m));
+        double ht = m_endTime / numTemporalMeshElements;
+
+        int spatialId = m_numLevels - m - 1;
+        auto curSpatialFes = spatialFes[spatialId];
+        int curSpatialFesDim = curSpatialFes->GetTrueVSize();
+
+        for (int n=0; n<numTemporalMeshElements; n++)
+        {
+            double tLeft = n*ht;
+            double tRight = (n+1)*ht;
+
+            for (int i=0; i<ir->GetNPoints(); i++)
+            {
+                const IntegrationPoint &ip = ir->IntPoint(i);
+                double t = affineTransform(tLeft, tRight, ip.x);
+
+                if (assembleValueLoad) {
+                    assembleValueLoad(t, *curSpatialFes, valueBuf);
+                }
+                if (assembleGradientLoad) {
+                    assembleGradientLoad(t, *curSpatialFes, gradientBuf);
+                }
+
+                auto addToBasis = [&](int id, double val, double grad)
+                {
+                    Vector tmp(b.GetData() + id*curSpatialFesDim + shift,
+                               curSpatialFesDim);
+                    if (assembleValueLoad) {
+                        tmp.Add(ip.weight*ht*val, valueBuf);
+                    }
+                    if (assembleGradientLoad) {
+                        tmp.Add(ip.weight*ht*grad, gradientBuf);
+                    }
+                };
+
+                double leftHalf = evalLeftHalfOfHatBasis(t, tLeft, ht);
+                double rightHalf = evalRightHalfOfHatBasis(t, tLeft, ht);
+
+                // coarsest temporal level has standard FE basis functions
+                if (m == 0) {
+                    addToBasis(n, rightHalf, -1./ht);
+                    addToBasis(n+1, leftHalf, +1./ht);
+                }
+                // remaining temporal levels have hierarchical basis functions
+                else if (n%2 == 0) {
+                    addToBasis(n/2, leftHalf, +1./ht);
+                }
+                else {
+                    addToBasis(n/2, rightHalf, -1./ht);
+                }
+            }
+        }
+        shift += temporalFesDims[m]*curSpatialFesDim;
+    }
+}
+
+void sparseHeat::Observer
+:: buildNormOperatorsOnSparseGrid() const
+{
+    if (m_temperatureNormOperator) {
+        return;
+    }
+
+    auto temporalMass = m_disc->getTemporalMass();
+    auto temporalStiffness = m_disc->getTemporalStiffness();
+    auto temporalGradient = m_disc->getTemporalGradient();
+    auto spatialMass1 = m_disc->getSpatialMassForTemperature();
+    auto spatialMass2 = m_disc->getSpatialMassForHeatFlux();
+    auto spatialStiffness2 = m_disc->getSpatialStiffnessForHeatFlux();
+    auto spatialDivergence = m_disc->getSpatialDivergence();
+    assert(temporalMass && temporalStiffness && temporalGradient);
+    assert(spatialMass1 && spatialMass2
+           && spatialStiffness2 && spatialDivergence);
+
+    auto temperatureHierarchy
+            = m_disc->getSpatialNestedFEHierarchyForTemperature();
+    auto heatFluxHierarchy
+            = m_disc->getSpatialNestedFEHierarchyForHeatFlux();
+
+    // the natural norm has a unit material coefficient,
+    // unlike the spatial stiffness of the discretisation
+    auto spatialStiffnessBilinearForm
+            = std::make_unique<mymfem::BlockBilinearForm>
+            (temperatureHierarchy);
+    std::shared_ptr<mymfem::BlockBilinearFormIntegrator>
+            spatialStiffnessIntegator
+            = std::make_shared<sparseHeat::SpatialStiffnessIntegrator>();
+    spatialStiffnessBilinearForm->addDomainIntegrator
+            (spatialStiffnessIntegator);
+    spatialStiffnessBilinearForm->assemble();
+    auto spatialStiffness1 = spatialStiffnessBilinearForm->getBlockMatrix();
+
+    Array<int> temporalBlockSizes
             = evalTemporalBlockSizes(m_minTemporalLevel,
                                      m_maxTemporalLevel);
+    Array<int> temperatureSizes = temperatureHierarchy->getNumDims();
+    Array<int> heatFluxSizes = heatFluxHierarchy->getNumDims();
+
+    // ||u||^2 + ||grad u||^2
+    m_temperatureNormOperator = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes, temperatureSizes, temperatureSizes);
+    m_temperatureNormOperator->addTerm
+            ({1., temporalMass, false, spatialMass1, false});
+    m_temperatureNormOperator->addTerm
+            ({1., temporalMass, false, spatialStiffness1, false});
+
+    // ||q||^2
+    m_heatFluxNormOperator = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes, heatFluxSizes, heatFluxSizes);
+    m_heatFluxNormOperator->addTerm
+            ({1., temporalMass, false, spatialMass2, false});
+
+    // ||du/dt||^2, ||div q||^2 and (du/dt, div q)
+    m_temperatureTemporalGradientNormOperator
+            = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes, temperatureSizes, temperatureSizes);
+    m_temperatureTemporalGradientNormOperator->addTerm
+            ({1., temporalStiffness, false, spatialMass1, false});
+
+    m_heatFluxDivergenceNormOperator
+            = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes, heatFluxSizes, heatFluxSizes);
+    m_heatFluxDivergenceNormOperator->addTerm
+            ({1., temporalMass, false, spatialStiffness2, false});
+
+    m_divergenceCouplingOperator
+            = std::make_unique<SparseKroneckerOperator>
+            (temporalBlockSizes, temperatureSizes, heatFluxSizes);
+    m_divergenceCouplingOperator->addTerm
+            ({1., temporalGradient, true, spatialDivergence, false});
+}
 
-    // auxiliary variables
-    Array<int> temporalElIds(m_numLevels);
-    Array<double> temporalElLeftEdgeCoords(m_numLevels);
+Vector sparseHeat::Observer
+:: evalSquaredNormsOfExactSolution() const
+{
+    Vector norms(3);
+    norms = 0.;
 
-    Array<double> temporalBasisVals(m_numLevels+1);
-    Array<double> temporalBasisGradientVals(m_numLevels+1);
-    Array<std::shared_ptr<GridFunction>> spatialTemperatures(m_numLevels+1);
-    Array<std::shared_ptr<GridFunction>> spatialHeatFluxes(m_numLevels+1);
+    // temporal integration rule on the coarsest temporal mesh
+    int order = 9;
+    const IntegrationRule *ir
+            = &IntRules.Get(Geometry::SEGMENT, order);
 
-    int numElsTemporalFinestMesh
-            = static_cast<int>(std::pow(2, m_maxTemporalLevel));
-    double finestTemporalMeshSize = temporalMeshSizes[m_numLevels-1];
+    int numTemporalMeshElements
+            = static_cast<int>(std::pow(2, m_minTemporalLevel));
+    double ht = m_endTime / numTemporalMeshElements;
 
-    // pde and heat flux error
-    pdeErrorNormL2L2 = 0.;
-    heatFluxErrorNormL2L2 = 0.;
-    for (int n=0; n<numElsTemporalFinestMesh; n++)
+    auto finestSpatialMesh
+            = m_spatialMeshHierarchy->getMeshes()[m_numLevels-1];
+    int dim = finestSpatialMesh->Dimension();
+
+    Vector gradu(dim), heatFlux(dim);
+    for (int n=0; n<numTemporalMeshElements; n++)
     {
-        // find current temporal element id for all temporal mesh levels
-        evalTemporalElIds(n, temporalElIds);
-
-        // evaluate the coordinate of left edge
-        // of the current temporal element for all temporal mesh levels
-        evalTemporalElLeftEdgeCoords(temporalMeshSizes, temporalElIds,
-                                     temporalElLeftEdgeCoords);
-
-        collectSpatialGridFunctionsForTemperature
-                (solutionHandler, temporalFesDims, temporalElIds,
-                 spatialTemperatures);
-        collectSpatialGridFunctionsForHeatFlux
-                (solutionHandler, temporalFesDims, temporalElIds,
-                 spatialHeatFluxes);
-
-        double tFinestLeft = temporalElLeftEdgeCoords[m_numLevels-1];
-        double tFinestRight = tFinestLeft + temporalMeshSizes[m_numLevels-1];
-
-        Vector localPdeErrorNormL2;
-        Vector localHeatFluxErrorNormL2;
         for (int i=0; i<ir->GetNPoints(); i++)
         {
-            const IntegrationPoint &ip = ir->IntPoint(i);
-            double t = affineTransform(tFinestLeft, tFinestRight, ip.x);
-
-            evalTemporalBasisVals(temporalMeshSizes,
-                                  temporalElIds,
-                                  temporalElLeftEdgeCoords,
-                                  t, temporalBasisVals);
-            evalTemporalBasisGradientVals(temporalMeshSizes,
-                                          temporalElIds,
-                                          temporalElLeftEdgeCoords,
-                                          t, temporalBasisGradientVals);
-
-            std::tie (localPdeErrorNormL2,
-                      localHeatFluxErrorNormL2,
-                      std::ignore)
-                    = m_spatialErrorOfSolutionInLeastSquaresNorm
-                    ->eval(t, temporalBasisVals, temporalBasisGradientVals,
-                           spatialTemperatures, spatialHeatFluxes);
-
-            pdeErrorNormL2L2
-                    .Add(ip.weight*finestTemporalMeshSize,
-                         localPdeErrorNormL2);
-            heatFluxErrorNormL2L2
-                    .Add(ip.weight*finestTemporalMeshSize,
-                         localHeatFluxErrorNormL2);
+            const IntegrationPoint &ipTime = ir->IntPoint(i);
+            double t = affineTransform(n*ht, (n+1)*ht, ipTime.x);
+
+            m_exactTemperatureCoeff->SetTime(t);
+            m_exactSpatialGradientOfTemperatureCoeff->SetTime(t);
+            m_exactHeatFluxCoeff->SetTime(t);
+            m_sourceCoeff->SetTime(t);
+
+            // same spatial quadrature as the full evaluation
+            for (int k=0; k<finestSpatialMesh->GetNE(); k++)
+            {
+                auto elTrans
+                        = finestSpatialMesh->GetElementTransformation(k);
+
+                for (int p=m_spatialQuadratureTable->getPointBegin(k);
+                     p<m_spatialQuadratureTable->getPointEnd(k); p++)
+                {
+                    const IntegrationPoint &ip
+                            = m_spatialQuadratureTable->getIntPoint(p);
+                    elTrans->SetIntPoint(&ip);
+
+                    double weight = ipTime.weight*ht
+                            *m_spatialQuadratureTable->getWeight(p);
+
+                    double u = m_exactTemperatureCoeff->Eval(*elTrans, ip);
+                    m_exactSpatialGradientOfTemperatureCoeff
+                            ->Eval(gradu, *elTrans, ip);
+                    m_exactHeatFluxCoeff->Eval(heatFlux, *elTrans, ip);
+                    double f = m_sourceCoeff->Eval(*elTrans, ip);
+
+                    norms(0) += weight*(u*u + (gradu*gradu));
+                    norms(1) += weight*(heatFlux*heatFlux);
+                    norms(2) += weight*f*f;
+                }
+            }
         }
     }
-    solutionError(0) = std::sqrt(pdeErrorNormL2L2(0));
-    solutionError(1) = std::sqrt(heatFluxErrorNormL2L2(0));
-
-    // error in initial conditions
-    auto initialTemperatureData
-            = solutionHandler.getTemperatureDataAtInitialTime();
-    auto initialTemperature
-            = std::make_unique<GridFunction>
-            (m_spatialFinestFESpaceForTemperature.get(),
-             initialTemperatureData.GetData());
-    m_exactTemperatureCoeff->SetTime(0.);
-    solutionError(2)
-            = initialTemperature->ComputeL2Error(*m_exactTemperatureCoeff);
 
-    return solutionError;
+    return norms;
 }
 
 void sparseHeat::Observer
@@ -437,7 +870,7 @@ void sparseHeat::Observer
  const Array<int>& temporalElIds,
  Array<std::shared_ptr<GridFunction>>& spatialTemperature) const
 {
-    auto solutionData = solutionHandler.getData();
+    const auto& solutionData = solutionHandler.getData();
 
     int shift = 0;
 
@@ -449,18 +882,16 @@ void sparseHeat::Observer
         int i = temporalElIds[m];
         int spatialId = m_numLevels - m - 1;
 
-        auto spatialFes
+        const auto& spatialFes
                 = m_spatialNestedFESpacesForTemperature[spatialId];
         int spatialFesDim
                 = spatialFes->GetTrueVSize();
 
-        spatialTemperature[m]
-                = std::make_shared<GridFunction>
+        spatialTemperature[m]->MakeRef
                 (spatialFes.get(),
                  solutionData->GetData() + i*spatialFesDim + shift);
 
-        spatialTemperature[m+1]
-                = std::make_shared<GridFunction>
+        spatialTemperature[m+1]->MakeRef
                 (spatialFes.get(),
                  solutionData->GetData() + (i+1)*spatialFesDim + shift);
 
@@ -472,13 +903,12 @@ void sparseHeat::Observer
         int i = temporalElIds[m]/2;
         int spatialId = m_numLevels - m - 1;
 
-        auto spatialFes
+        const auto& spatialFes
                 = m_spatialNestedFESpacesForTemperature[spatialId];
         int spatialFesDim
                 = spatialFes->GetTrueVSize();
 
-        spatialTemperature[m+1]
-                = std::make_shared<GridFunction>
+        spatialTemperature[m+1]->MakeRef
                 (spatialFes.get(),
                  solutionData->GetData() + i*spatialFesDim + shift);
 
@@ -493,7 +923,7 @@ void sparseHeat::Observer
  const Array<int>& temporalElIds,
  Array<std::shared_ptr<GridFunction>>& spatialHeatFlux) const
 {
-    auto solutionData = solutionHandler.getData();
+    const auto& solutionData = solutionHandler.getData();
 
     int shift = solutionHandler.getTemperatureDataSize();
 
@@ -505,18 +935,16 @@ void sparseHeat::Observer
         int i = temporalElIds[m];
         int spatialId = m_numLevels - m - 1;
 
-        auto spatialFes
+        const auto& spatialFes
                 = m_spatialNestedFESpacesForHeatFlux[spatialId];
         int spatialFesDim
                 = spatialFes->GetTrueVSize();
 
-        spatialHeatFlux[m]
-                = std::make_shared<GridFunction>
+        spatialHeatFlux[m]->MakeRef
                 (spatialFes.get(),
                  solutionData->GetData() + i*spatialFesDim + shift);
 
-        spatialHeatFlux[m+1]
-                = std::make_shared<GridFunction>
+        spatialHeatFlux[m+1]->MakeRef
                 (spatialFes.get(),
                  solutionData->GetData() + (i+1)*spatialFesDim + shift);
 
@@ -528,13 +956,12 @@ void sparseHeat::Observer
         int i = temporalElIds[m]/2;
         int spatialId = m_numLevels - m - 1;
 
-        auto spatialFes
+        const auto& spatialFes
                 = m_spatialNestedFESpacesForHeatFlux[spatialId];
         int spatialFesDim
                 = spatialFes->GetTrueVSize();
 
-        spatialHeatFlux[m+1]
-                = std::make_shared<GridFunction>
+        spatialHeatFlux[m+1]->MakeRef
                 (spatialFes.get(),
                  solutionData->GetData() + i*spatialFesDim + shift);
 
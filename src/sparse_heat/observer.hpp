@@ -3,6 +3,10 @@
 
 #include "mfem.hpp"
 
+#include <functional>
+#include <tuple>
+#include <vector>
+
 #include "../mymfem/base_observer.hpp"
 #include "../mymfem/nested_hierarchy.hpp"
 #include "../heat/coefficients.hpp"
@@ -43,6 +47,24 @@ public:
      */
     mfem::Vector evalErrorInNaturalNorm (const SolutionHandler&) const;
 
+    /**
+     * @brief Evaluates error in the natural norm on the sparse grid
+     *
+     * Expands the squared errors as
+     * ||u||^2 - 2 (u, u_h) + ||u_h||^2. The discrete norms are
+     * applied with the sparse Kronecker operators and the
+     * functionals (u, u_h) are assembled per temporal level
+     * on its own spatial level, so the cost is proportional to
+     * the number of sparse grid dofs. The exact norms are integrated
+     * on the coarsest temporal and the finest spatial mesh.
+     * The expansion loses accuracy by cancellation
+     * for errors below sqrt(machine precision) relative to the norms.
+     * @param solution handler
+     * @return discrete solution error in natural norm
+     */
+    mfem::Vector evalErrorInNaturalNormOnSparseGrid
+    (const SolutionHandler&) const;
+
     /**
      * @brief Evaluates error in the least-squares norm
      * @param solution handler
@@ -51,6 +73,34 @@ public:
     mfem::Vector evalErrorInLeastSquaresNorm (const SolutionHandler&) const;
 
 private:
+    //! Assembles a spatial load vector at a given time
+    using SpatialLoadAssembler
+    = std::function<void(double, mfem::FiniteElementSpace&,
+                         mfem::Vector&)>;
+
+    /**
+     * @brief Assembles a load vector in the sparse layout of a field;
+     * the entry of the temporal basis function phi and the spatial
+     * level of its temporal level is
+     * \int phi(t) F(t) + dphi/dt(t) G(t) dt
+     * @param spatialFes nested spatial FE spaces of the field
+     * @param assembleValueLoad F, skipped if empty
+     * @param assembleGradientLoad G, skipped if empty
+     * @param b load vector
+     */
+    void assembleLoadOnSparseGrid
+    (const mymfem::NestedFESpaces& spatialFes,
+     const SpatialLoadAssembler& assembleValueLoad,
+     const SpatialLoadAssembler& assembleGradientLoad,
+     mfem::Vector& b) const;
+
+    //! Builds the sparse Kronecker operators of the discrete norms
+    void buildNormOperatorsOnSparseGrid() const;
+
+    //! Returns the squared L2H1 norm of the exact temperature,
+    //! the L2L2 norms of the exact heat flux and of the source
+    mfem::Vector evalSquaredNormsOfExactSolution() const;
+
     void evalTemporalBasisVals
     (const mfem::Array<double> &temporalMeshSizes,
      const mfem::Array<int> &temporalElIds,
@@ -63,6 +113,32 @@ private:
      const mfem::Array<double> &temporalElLeftEdgeCoords,
      double t, mfem::Array<double> &temporalBasisGradientVals) const;
 
+    //! Builds a spatial error evaluator with its own coefficients,
+    //! for the error type "natural" or "lsq"
+    std::unique_ptr<SpatialErrorOfSolution> buildSpatialErrorOfSolution
+    (const std::string& errorType);
+
+    /**
+     * @brief Sums the spatial errors over the finest temporal elements,
+     * in parallel over the temporal elements
+     *
+     * The contributions of the temporal elements are stored and
+     * summed in order, so the result does not depend on the number of
+     * threads. The spatial grid functions are views into the solution
+     * data, re-pointed for every temporal element.
+     * @param solution handler
+     * @param evaluators spatial error evaluators, one per thread
+     * @param numErrors number of entries of the three spatial errors
+     * @return the three space-time errors
+     */
+    std::tuple<mfem::Vector, mfem::Vector, mfem::Vector>
+    integrateSpatialErrorsInTime
+    (const SolutionHandler&,
+     const std::vector<std::unique_ptr<SpatialErrorOfSolution>>& evaluators,
+     int numErrors) const;
+
+    //! Re-points the allocated grid functions to the spatial data
+    //! of the temporal basis functions supported on a temporal element
     void collectSpatialGridFunctionsForTemperature
     (const SolutionHandler&,
      const mfem::Array<int>&,
@@ -83,6 +159,7 @@ private:
 
     bool m_boolEvalError;
     std::string m_errorType;
+    std::string m_errorEvaluation;
 
     std::shared_ptr<heat::TestCases> m_testCase;
     std::shared_ptr<LsqSparseXtFem> m_disc;
@@ -107,10 +184,21 @@ private:
 
     mutable std::shared_ptr<mfem::Coefficient> m_sourceCoeff;
 
-    mutable std::unique_ptr<SpatialErrorOfSolution>
+    //! one evaluator per thread, each with its own coefficients
+    std::vector<std::unique_ptr<SpatialErrorOfSolution>>
     m_spatialErrorOfSolutionInNaturalNorm;
-    mutable std::unique_ptr<SpatialErrorOfSolution>
+    std::vector<std::unique_ptr<SpatialErrorOfSolution>>
     m_spatialErrorOfSolutionInLeastSquaresNorm;
+
+    std::shared_ptr<const SpatialQuadratureTable> m_spatialQuadratureTable;
+
+    //! discrete norms on the sparse grid, built on first use
+    mutable std::unique_ptr<SparseKroneckerOperator>
+    m_temperatureNormOperator, m_heatFluxNormOperator;
+    mutable std::unique_ptr<SparseKroneckerOperator>
+    m_temperatureTemporalGradientNormOperator,
+    m_heatFluxDivergenceNormOperator,
+    m_divergenceCouplingOperator;
 };
 
 }
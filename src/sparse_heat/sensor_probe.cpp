@@ -0,0 +1,170 @@
+#include "sensor_probe.hpp"
+#include "utilities.hpp"
+
+#include "../mymfem/kronecker_csr_builder.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <stdexcept>
+
+using namespace mfem;
+
+
+sparseHeat::SensorProbe
+:: SensorProbe (int minTemporalLevel, int maxTemporalLevel,
+                double endTime,
+                const std::shared_ptr<mymfem::NestedFEHierarchy>&
+                spatialNestedFEHierarchyTemperature,
+                const std::shared_ptr<mymfem::NestedFEHierarchy>&
+                spatialNestedFEHierarchyHeatFlux,
+                const DenseMatrix& X)
+    : m_minTemporalLevel (minTemporalLevel),
+      m_endTime (endTime)
+{
+    m_numLevels = maxTemporalLevel - minTemporalLevel + 1;
+    m_temporalBlockSizes
+            = evalTemporalBlockSizes(minTemporalLevel, maxTemporalLevel);
+
+    auto spatialFesTemperature
+            = spatialNestedFEHierarchyTemperature->getFESpaces();
+    auto spatialFesHeatFlux
+            = spatialNestedFEHierarchyHeatFlux->getFESpaces();
+    assert(static_cast<int>(spatialFesTemperature.size()) == m_numLevels);
+    assert(static_cast<int>(spatialFesHeatFlux.size()) == m_numLevels);
+
+    // temperature and heat flux share the spatial meshes
+    for (int j=0; j<m_numLevels; j++)
+    {
+        m_spatialProbes.emplace_back
+                (std::make_unique<mymfem::SpatialProbe>
+                 (spatialFesTemperature[j]->GetMesh(), X));
+        m_spatialTemperatureEvaluations.emplace_back
+                (m_spatialProbes[j]->buildEvaluation
+                 (*spatialFesTemperature[j]));
+        m_spatialHeatFluxEvaluations.emplace_back
+                (m_spatialProbes[j]->buildEvaluation
+                 (*spatialFesHeatFlux[j]));
+    }
+}
+
+void sparseHeat::SensorProbe
+:: setTimes (const Vector& times)
+{
+    for (int i=0; i<times.Size(); i++)
+    {
+        if (times(i) < -1E-12 || times(i) > m_endTime + 1E-12) {
+            throw std::runtime_error(fmt::format(
+                "Sensor time outside the temporal mesh. "
+                "[{} not in [0, {}]]", times(i), m_endTime));
+        }
+    }
+    m_times = times;
+
+    std::vector<std::unique_ptr<SparseMatrix>> temporalEvaluations;
+    for (int m=0; m<m_numLevels; m++) {
+        temporalEvaluations.emplace_back(buildTemporalEvaluation(m));
+    }
+
+    m_temperatureProbe.reset(buildProbe(m_spatialTemperatureEvaluations,
+                                        temporalEvaluations));
+    m_heatFluxProbe.reset(buildProbe(m_spatialHeatFluxEvaluations,
+                                     temporalEvaluations));
+}
+
+std::unique_ptr<SparseMatrix> sparseHeat::SensorProbe
+:: buildTemporalEvaluation (int m) const
+{
+    int numTemporalMeshElements
+            = static_cast<int>(std::pow(2, m_minTemporalLevel + m));
+    double ht = m_endTime / numTemporalMeshElements;
+
+    int numTimes = m_times.Size();
+    auto temporalEvaluation = std::make_unique<SparseMatrix>
+            (numTimes, m_temporalBlockSizes[m]);
+
+    for (int i=0; i<numTimes; i++)
+    {
+        double t = m_times(i);
+
+        // times at the end points, up to roundoff, are clamped
+        int n = static_cast<int>(std::floor(t/ht));
+        n = std::min(std::max(n, 0), numTemporalMeshElements-1);
+        double tLeft = n*ht;
+
+        double leftHalf = evalLeftHalfOfHatBasis(t, tLeft, ht);
+        double rightHalf = evalRightHalfOfHatBasis(t, tLeft, ht);
+
+        // coarsest temporal level has standard FE basis functions
+        if (m == 0) {
+            temporalEvaluation->Add(i, n, rightHalf);
+            temporalEvaluation->Add(i, n+1, leftHalf);
+        }
+        // remaining temporal levels have hierarchical basis functions
+        else if (n%2 == 0) {
+            temporalEvaluation->Add(i, n/2, leftHalf);
+        }
+        else {
+            temporalEvaluation->Add(i, n/2, rightHalf);
+        }
+    }
+    temporalEvaluation->Finalize();
+
+    return temporalEvaluation;
+}
+
+SparseMatrix* sparseHeat::SensorProbe
+:: buildProbe (const std::vector<std::unique_ptr<SparseMatrix>>&
+               spatialEvaluations,
+               const std::vector<std::unique_ptr<SparseMatrix>>&
+               temporalEvaluations) const
+{
+    int numRows = m_times.Size()*spatialEvaluations[0]->Height();
+    int numCols = 0;
+    for (int m=0; m<m_numLevels; m++) {
+        numCols += m_temporalBlockSizes[m]
+                *spatialEvaluations[getSpatialIndex(m)]->Width();
+    }
+
+    // the levels are placed side by side, as in the SolutionHandler
+    mymfem::KroneckerCsrBuilder builder(numRows, numCols);
+    int colOffset = 0;
+    for (int m=0; m<m_numLevels; m++)
+    {
+        const auto& spatialEvaluation
+                = *spatialEvaluations[getSpatialIndex(m)];
+        builder.addTerm(1., *temporalEvaluations[m], spatialEvaluation,
+                        0, colOffset);
+        colOffset += m_temporalBlockSizes[m]*spatialEvaluation.Width();
+    }
+
+    return builder.build();
+}
+
+void sparseHeat::SensorProbe
+:: probeTemperature (const SolutionHandler& solutionHandler,
+                     DenseMatrix& values) const
+{
+    assert(m_temperatureProbe);
+
+    values.SetSize(m_spatialTemperatureEvaluations[0]->Height(),
+                   getNumTimes());
+    Vector buf(values.Data(), values.Height()*values.Width());
+    m_temperatureProbe->Mult(solutionHandler.getTemperatureData(), buf);
+}
+
+void sparseHeat::SensorProbe
+:: probeHeatFlux (const SolutionHandler& solutionHandler,
+                  DenseMatrix& values) const
+{
+    assert(m_heatFluxProbe);
+
+    values.SetSize(m_spatialHeatFluxEvaluations[0]->Height(),
+                   getNumTimes());
+    Vector buf(values.Data(), values.Height()*values.Width());
+    m_heatFluxProbe->Mult(solutionHandler.getHeatFluxData(), buf);
+}
+
+// End of file
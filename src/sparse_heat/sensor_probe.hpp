@@ -0,0 +1,127 @@
+#ifndef SPARSE_HEAT_SENSOR_PROBE_HPP
+#define SPARSE_HEAT_SENSOR_PROBE_HPP
+
+#include "mfem.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "../mymfem/nested_hierarchy.hpp"
+#include "../mymfem/spatial_probe.hpp"
+#include "solution_handler.hpp"
+
+
+namespace sparseHeat
+{
+
+/**
+ * @brief Evaluates sparse space-time solutions at fixed
+ * sensor locations and a set of times.
+ *
+ * The sensors are located once on every spatial level.
+ * For the given times, the probe matrix of a field sums over
+ * the temporal levels m the Kronecker products of the temporal
+ * evaluation on level m with the spatial evaluation on the level
+ * L-1-m, placed at the block of the level in the solution vector;
+ * so the hierarchical sum is one sparse matrix-vector product.
+ * The probed values are laid out as in heat::SensorProbe.
+ */
+class SensorProbe
+{
+public:
+    /**
+     * @brief Constructor
+     * @param minTemporalLevel coarsest temporal level
+     * @param maxTemporalLevel finest temporal level
+     * @param endTime end time of the uniform temporal meshes
+     * @param spatialNestedFEHierarchyTemperature spatial FE spaces
+     * of temperature, coarse to fine
+     * @param spatialNestedFEHierarchyHeatFlux spatial FE spaces
+     * of heat flux, coarse to fine
+     * @param X sensor locations, one column per sensor
+     */
+    SensorProbe (int minTemporalLevel, int maxTemporalLevel,
+                 double endTime,
+                 const std::shared_ptr<mymfem::NestedFEHierarchy>&
+                 spatialNestedFEHierarchyTemperature,
+                 const std::shared_ptr<mymfem::NestedFEHierarchy>&
+                 spatialNestedFEHierarchyHeatFlux,
+                 const mfem::DenseMatrix& X);
+
+    //! Builds the probe matrices for the given times;
+    //! throws if a time is outside [0, endTime]
+    void setTimes (const mfem::Vector& times);
+
+    int getNumSensors() const {
+        return m_spatialProbes[0]->getNumPoints();
+    }
+
+    int getNumTimes() const {
+        return m_times.Size();
+    }
+
+    //! Returns the number of sensors located on the finest spatial mesh
+    int getNumFound() const {
+        return m_spatialProbes[m_numLevels-1]->getNumFound();
+    }
+
+    //! Returns the indices of the sensors outside the finest spatial
+    //! mesh; their probed values are zero
+    mfem::Array<int> getUnlocatedSensors() const {
+        return m_spatialProbes[m_numLevels-1]->getUnlocatedPoints();
+    }
+
+    const mfem::SparseMatrix& getTemperatureProbe() const {
+        return *m_temperatureProbe;
+    }
+
+    const mfem::SparseMatrix& getHeatFluxProbe() const {
+        return *m_heatFluxProbe;
+    }
+
+    //! Evaluates the temperature, sensors x times
+    void probeTemperature (const SolutionHandler& solutionHandler,
+                           mfem::DenseMatrix& values) const;
+
+    //! Evaluates the heat flux, (sensors * components) x times
+    void probeHeatFlux (const SolutionHandler& solutionHandler,
+                        mfem::DenseMatrix& values) const;
+
+private:
+    inline int getSpatialIndex(int m) const {
+        return m_numLevels - m - 1;
+    }
+
+    //! Builds the evaluation matrix of the hierarchical temporal
+    //! basis on level m, times x temporal dofs of the level
+    std::unique_ptr<mfem::SparseMatrix> buildTemporalEvaluation
+    (int m) const;
+
+    //! Builds the probe matrix of a field from its spatial evaluations
+    mfem::SparseMatrix* buildProbe
+    (const std::vector<std::unique_ptr<mfem::SparseMatrix>>&
+     spatialEvaluations,
+     const std::vector<std::unique_ptr<mfem::SparseMatrix>>&
+     temporalEvaluations) const;
+
+private:
+    int m_minTemporalLevel;
+    int m_numLevels;
+    double m_endTime;
+    mfem::Array<int> m_temporalBlockSizes;
+
+    //! spatial probes and evaluations per spatial level
+    std::vector<std::unique_ptr<mymfem::SpatialProbe>> m_spatialProbes;
+    std::vector<std::unique_ptr<mfem::SparseMatrix>>
+    m_spatialTemperatureEvaluations;
+    std::vector<std::unique_ptr<mfem::SparseMatrix>>
+    m_spatialHeatFluxEvaluations;
+
+    mfem::Vector m_times;
+    std::unique_ptr<mfem::SparseMatrix> m_temperatureProbe;
+    std::unique_ptr<mfem::SparseMatrix> m_heatFluxProbe;
+};
+
+}
+
+#endif // SPARSE_HEAT_SENSOR_PROBE_HPP
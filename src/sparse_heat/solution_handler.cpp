@@ -2,6 +2,8 @@
 
 #include "utilities.hpp"
 
+#include <assert.h>
+
 using namespace mfem;
 
 
@@ -9,7 +11,8 @@ sparseHeat::SolutionHandler
 :: SolutionHandler
 (int minLevel, int maxLevel,
  std::shared_ptr<mymfem::NestedFEHierarchy> &spatialNestedFEHierarchyTemperature,
- std::shared_ptr<mymfem::NestedFEHierarchy> &spatialNestedFEHierarchyHeatFlux)
+ std::shared_ptr<mymfem::NestedFEHierarchy> &spatialNestedFEHierarchyHeatFlux,
+ mymfem::MemoryPolicy memoryPolicy)
 {
     m_numLevels = (maxLevel - minLevel) + 1;
     m_temporalHierarchicalFESizes
@@ -28,19 +31,29 @@ sparseHeat::SolutionHandler
                                            m_temporalHierarchicalFESizes);
     int heatFluxDataSize = tmpBuf2.Sum();
 
+    m_levelOffsetsTemperature.SetSize(m_numLevels+1);
+    m_levelOffsetsHeatFlux.SetSize(m_numLevels+1);
+    m_levelOffsetsTemperature[0] = m_levelOffsetsHeatFlux[0] = 0;
+    for (int m=0; m<m_numLevels; m++) {
+        m_levelOffsetsTemperature[m+1]
+                = m_levelOffsetsTemperature[m] + tmpBuf1[m];
+        m_levelOffsetsHeatFlux[m+1]
+                = m_levelOffsetsHeatFlux[m] + tmpBuf2[m];
+    }
+
     Array<int> blockOffsets(3);
     blockOffsets[0] = 0;
     blockOffsets[1] = temperatureDataSize;
     blockOffsets[2] = blockOffsets[1] + heatFluxDataSize;
 
-    m_data = std::make_shared<BlockVector>(blockOffsets);
-    (*m_data) = 0.;
+    // zero-initialised
+    m_data = mymfem::makeBlockVector(blockOffsets, memoryPolicy);
 }
 
 Vector sparseHeat::SolutionHandler
 :: getTemperatureDataAtInitialTime() const
 {
-    auto temperatureData = getTemperatureData();
+    const auto& temperatureData = getTemperatureData();
 
     int sizeSpatialFinest = m_spatialFESizesTemperature[m_numLevels-1];
     Vector temperatureAtInitialTime(sizeSpatialFinest);
@@ -52,14 +65,14 @@ Vector sparseHeat::SolutionHandler
 Vector sparseHeat::SolutionHandler
 :: getTemperatureDataAtEndTime() const
 {
-    auto temperatureData = getTemperatureData();
+    const auto& temperatureData = getTemperatureData();
 
     int sizeTemporalCoarsest = m_temporalHierarchicalFESizes[0];
     int sizeSpatialFinest = m_spatialFESizesTemperature[m_numLevels-1];
 
     int offsets = (sizeTemporalCoarsest-1)*sizeSpatialFinest;
-    Vector temperatureAtEndTime(temperatureData.GetData() + offsets,
-                                sizeSpatialFinest);
+    Vector temperatureAtEndTime(sizeSpatialFinest);
+    temperatureAtEndTime = temperatureData.GetData() + offsets;
 
     return temperatureAtEndTime;
 }
@@ -67,7 +80,7 @@ Vector sparseHeat::SolutionHandler
 Vector sparseHeat::SolutionHandler
 :: getHeatFluxDataAtInitialTime() const
 {
-    auto heatFluxData = getHeatFluxData();
+    const auto& heatFluxData = getHeatFluxData();
 
     int sizeSpatialFinest = m_spatialFESizesHeatFlux[m_numLevels-1];
     Vector heatFluxAtInitialTime(sizeSpatialFinest);
@@ -79,14 +92,92 @@ Vector sparseHeat::SolutionHandler
 Vector sparseHeat::SolutionHandler
 :: getHeatFluxDataAtEndTime() const
 {
-    auto heatFluxData = getHeatFluxData();
+    const auto& heatFluxData = getHeatFluxData();
 
     int sizeTemporalCoarsest = m_temporalHierarchicalFESizes[0];
     int sizeSpatialFinest = m_spatialFESizesHeatFlux[m_numLevels-1];
 
     int offsets = (sizeTemporalCoarsest-1)*sizeSpatialFinest;
-    Vector heatFluxAtEndTime(heatFluxData.GetData() + offsets,
-                             sizeSpatialFinest);
+    Vector heatFluxAtEndTime(sizeSpatialFinest);
+    heatFluxAtEndTime = heatFluxData.GetData() + offsets;
 
     return heatFluxAtEndTime;
 }
+
+// MFEM has no read-only vector views; the view is returned const
+const Vector sparseHeat::SolutionHandler
+:: makeConstRef(int block, int offset, int size) const
+{
+    const Vector& data = m_data->GetBlock(block);
+    return Vector(const_cast<double*>(data.GetData()) + offset, size);
+}
+
+void sparseHeat::SolutionHandler
+:: makeTemperatureLevelRef(int m, Vector& view)
+{
+    view.MakeRef(m_data->GetBlock(0),
+                 m_levelOffsetsTemperature[m],
+                 m_levelOffsetsTemperature[m+1]
+                 - m_levelOffsetsTemperature[m]);
+}
+
+const Vector sparseHeat::SolutionHandler
+:: makeTemperatureLevelRef(int m) const
+{
+    return makeConstRef(0, m_levelOffsetsTemperature[m],
+                        m_levelOffsetsTemperature[m+1]
+                        - m_levelOffsetsTemperature[m]);
+}
+
+void sparseHeat::SolutionHandler
+:: makeHeatFluxLevelRef(int m, Vector& view)
+{
+    view.MakeRef(m_data->GetBlock(1),
+                 m_levelOffsetsHeatFlux[m],
+                 m_levelOffsetsHeatFlux[m+1]
+                 - m_levelOffsetsHeatFlux[m]);
+}
+
+const Vector sparseHeat::SolutionHandler
+:: makeHeatFluxLevelRef(int m) const
+{
+    return makeConstRef(1, m_levelOffsetsHeatFlux[m],
+                        m_levelOffsetsHeatFlux[m+1]
+                        - m_levelOffsetsHeatFlux[m]);
+}
+
+void sparseHeat::SolutionHandler
+:: makeTemperatureSliceRef(int m, int i, Vector& view)
+{
+    assert(i >= 0 && i < m_temporalHierarchicalFESizes[m]);
+    int size = m_spatialFESizesTemperature[getSpatialIndex(m)];
+    view.MakeRef(m_data->GetBlock(0),
+                 m_levelOffsetsTemperature[m] + i*size, size);
+}
+
+const Vector sparseHeat::SolutionHandler
+:: makeTemperatureSliceRef(int m, int i) const
+{
+    assert(i >= 0 && i < m_temporalHierarchicalFESizes[m]);
+    int size = m_spatialFESizesTemperature[getSpatialIndex(m)];
+    return makeConstRef(0, m_levelOffsetsTemperature[m] + i*size, size);
+}
+
+void sparseHeat::SolutionHandler
+:: makeHeatFluxSliceRef(int m, int i, Vector& view)
+{
+    assert(i >= 0 && i < m_temporalHierarchicalFESizes[m]);
+    int size = m_spatialFESizesHeatFlux[getSpatialIndex(m)];
+    view.MakeRef(m_data->GetBlock(1),
+                 m_levelOffsetsHeatFlux[m] + i*size, size);
+}
+
+const Vector sparseHeat::SolutionHandler
+:: makeHeatFluxSliceRef(int m, int i) const
+{
+    assert(i >= 0 && i < m_temporalHierarchicalFESizes[m]);
+    int size = m_spatialFESizesHeatFlux[getSpatialIndex(m)];
+    return makeConstRef(1, m_levelOffsetsHeatFlux[m] + i*size, size);
+}
+
+// End of file
@@ -4,6 +4,7 @@
 #include "mfem.hpp"
 
 #include "../mymfem/nested_hierarchy.hpp"
+#include "../mymfem/data_buffer.hpp"
 
 
 namespace sparseHeat
@@ -17,7 +18,8 @@ public:
      std::shared_ptr<mymfem::NestedFEHierarchy>&
      spatialNestedFEHierarchyTemperature,
      std::shared_ptr<mymfem::NestedFEHierarchy>&
-     spatialNestedFEHierarchyHeatFlux);
+     spatialNestedFEHierarchyHeatFlux,
+     mymfem::MemoryPolicy memoryPolicy = mymfem::MemoryPolicy::standard);
 
     mfem::Vector getTemperatureDataAtInitialTime() const;
 
@@ -62,6 +64,46 @@ public:
         return blockSizes;
     }
 
+    //! Makes a non-owning view of the temperature data
+    //! on the temporal level m
+    void makeTemperatureLevelRef(int m, mfem::Vector& view);
+
+    //! Returns a read-only view of the temperature data
+    //! on the temporal level m
+    const mfem::Vector makeTemperatureLevelRef(int m) const;
+
+    //! Makes a non-owning view of the heat flux data
+    //! on the temporal level m
+    void makeHeatFluxLevelRef(int m, mfem::Vector& view);
+
+    //! Returns a read-only view of the heat flux data
+    //! on the temporal level m
+    const mfem::Vector makeHeatFluxLevelRef(int m) const;
+
+    //! Makes a non-owning view of the temperature
+    //! at the temporal dof i of the temporal level m
+    void makeTemperatureSliceRef(int m, int i, mfem::Vector& view);
+
+    //! Returns a read-only view of the temperature
+    //! at the temporal dof i of the temporal level m
+    const mfem::Vector makeTemperatureSliceRef(int m, int i) const;
+
+    //! Makes a non-owning view of the heat flux
+    //! at the temporal dof i of the temporal level m
+    void makeHeatFluxSliceRef(int m, int i, mfem::Vector& view);
+
+    //! Returns a read-only view of the heat flux
+    //! at the temporal dof i of the temporal level m
+    const mfem::Vector makeHeatFluxSliceRef(int m, int i) const;
+
+private:
+    inline int getSpatialIndex(int m) const {
+        return m_numLevels - m - 1;
+    }
+
+    //! Returns a const view of a range of a data block
+    const mfem::Vector makeConstRef(int block, int offset, int size) const;
+
 private:
     std::shared_ptr<mfem::BlockVector> m_data;
 
@@ -69,6 +111,10 @@ private:
     mfem::Array<int> m_temporalHierarchicalFESizes;
     mfem::Array<int> m_spatialFESizesTemperature;
     mfem::Array<int> m_spatialFESizesHeatFlux;
+
+    //! offsets of the temporal levels within the blocks
+    mfem::Array<int> m_levelOffsetsTemperature;
+    mfem::Array<int> m_levelOffsetsHeatFlux;
 };
 
 }
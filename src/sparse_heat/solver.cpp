@@ -1,6 +1,8 @@
 #include "solver.hpp"
 #include "utilities.hpp"
+#include "../core/sweep_scheduler.hpp"
 
+#include <fmt/format.h>
 #include <iostream>
 #include <chrono>
 
@@ -48,6 +50,52 @@ void sparseHeat::Solver
 
     READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "linear_solver",
                                         m_linearSolver, "pardiso");
+
+    // symmetric positive definite solve on the upper triangle
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "pardiso_spd",
+                                        m_pardisoSpd, false);
+
+    // single-precision factors, refined in double precision
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "pardiso_mixed_precision",
+                                        m_pardisoMixedPrecision, false);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "pardiso_refinement_tolerance",
+             m_pardisoRefinementTolerance, 1E-12);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "pardiso_max_refinement_steps",
+             m_pardisoMaxRefinementSteps, 20);
+
+    // fill-reducing permutations are cached in this directory,
+    // keyed by the sparsity pattern; no cache if empty
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "pardiso_ordering_cache_dir",
+             m_pardisoOrderingCacheDir, "");
+
+    // "gs" and "jacobi" are the defaults of "cg" and "cg_matrix_free",
+    // "multilevel" is the additive multilevel preconditioner
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "cg_preconditioner",
+                                        m_cgPreconditioner,
+                                        m_linearSolver == "cg" ?
+                                            "gs" : "jacobi");
+    if (m_linearSolver != "pardiso"
+            && m_cgPreconditioner != "multilevel"
+            && m_cgPreconditioner != (m_linearSolver == "cg" ?
+                                      "gs" : "jacobi")) {
+        throw std::runtime_error(fmt::format(
+            "Unknown preconditioner for the linear solver {}. [{}]",
+            m_linearSolver, m_cgPreconditioner));
+    }
+
+    // "standard", "aligned", "huge_pages" or "numa_interleaved"
+    std::string solutionMemory;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "solution_memory",
+                                        solutionMemory, "standard");
+    m_solutionMemoryPolicy = mymfem::parseMemoryPolicy(solutionMemory);
+
+    // hardware counters per phase in the performance measurements,
+    // only timers if the counters are not permitted
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(m_config, "perf_counters",
+                                        m_usePerfCounters, false);
 }
 
 void sparseHeat::Solver
@@ -62,12 +110,12 @@ void sparseHeat::Solver
                 = m_meshDir+"/"+m_meshElemType
                 +"_mesh_l0.mesh";
 #ifndef NDEBUG
-        std::cout << "  Initial mesh file: "
-                  << meshFile << std::endl;
-        std::cout << "  Minimum refinement level: "
-                  << m_minSpatialLevel << std::endl;
-        std::cout << "  Maximum refinement level: "
-                  << m_minSpatialLevel + m_numLevels-1 << std::endl;
+        getJobOutput() << "  Initial mesh file: "
+                       << meshFile << std::endl;
+        getJobOutput() << "  Minimum refinement level: "
+                       << m_minSpatialLevel << std::endl;
+        getJobOutput() << "  Maximum refinement level: "
+                       << m_minSpatialLevel + m_numLevels-1 << std::endl;
 #endif
         // add coarsest spatial mesh to hierarchy
         auto xMesh = std::make_shared<Mesh>(meshFile.c_str());
@@ -76,12 +124,13 @@ void sparseHeat::Solver
         }
         m_spatialMeshHierarchy->addMesh(xMesh);
 
-        // refine and add to spatial mesh hierarchy
+        // refine and add to spatial mesh hierarchy;
+        // the parents of the fine elements are known from the refinement
         auto xMeshOld = xMesh;
         for (int k=1; k<m_numLevels; k++) {
             auto xMeshNew = std::make_shared<Mesh>(*xMeshOld);
             xMeshNew->UniformRefinement();
-            m_spatialMeshHierarchy->addMesh(xMeshNew);
+            m_spatialMeshHierarchy->addUniformlyRefinedMesh(xMeshNew);
             xMeshOld = xMeshNew;
         }
     }
@@ -93,8 +142,8 @@ void sparseHeat::Solver
                     +std::to_string(m_minSpatialLevel + k)
                     +".mesh";
 #ifndef NDEBUG
-            std::cout << "  Mesh file: "
-                      << meshFile << std::endl;
+            getJobOutput() << "  Mesh file: "
+                           << meshFile << std::endl;
 #endif
             // add current mesh to mesh hierarchy
             auto xMesh = std::make_shared<Mesh>(meshFile.c_str());
@@ -138,34 +187,27 @@ std::pair<Vector, int> sparseHeat::Solver
 :: runAndMeasurePerformanceMetrics()
 {
     Vector elapsedTime(4);
-
-    auto start = std::chrono::high_resolution_clock::now();
-    initialize ();
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast
-            <std::chrono::milliseconds>(end - start);
-    elapsedTime(0)
-            = (static_cast<double>(duration.count()))/1000;
-
-    start = std::chrono::high_resolution_clock::now();
-    assembleSystem();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast
-                <std::chrono::milliseconds>(end - start);
-    elapsedTime(1)
-                = (static_cast<double>(duration.count()))/1000;
-
-    start = std::chrono::high_resolution_clock::now();
-    assembleRhs();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast
-                <std::chrono::milliseconds>(end - start);
-    elapsedTime(2)
-                = (static_cast<double>(duration.count()))/1000;
-
+    if (!m_profiler) {
+        m_profiler = std::make_unique<PhaseProfiler>(m_usePerfCounters);
+    }
+    m_profiler->clear();
+
+    elapsedTime(0) = m_profiler->measure("initialization", [this]() {
+        initialize();
+    });
+    elapsedTime(1) = m_profiler->measure("system_assembly", [this]() {
+        assembleSystem();
+    });
+    elapsedTime(2) = m_profiler->measure("rhs_assembly", [this]() {
+        assembleRhs();
+    });
+
+    // the factorization is recorded as a nested phase
     int memoryUsage;
-    std::tie(elapsedTime(3), memoryUsage)
-            = solveAndMeasurePerformanceMetrics();
+    m_profiler->measure("linear_solve", [&]() {
+        std::tie(elapsedTime(3), memoryUsage)
+                = solveAndMeasurePerformanceMetrics();
+    });
 
     return {elapsedTime, memoryUsage};
 }
@@ -184,7 +226,8 @@ void sparseHeat::Solver
             = std::make_shared<sparseHeat::SolutionHandler>
             (m_minTemporalLevel, m_maxTemporalLevel,
              spatialNestedFEHierarchyForTemperature,
-             spatialNestedFEHierarchyForHeatFlux);
+             spatialNestedFEHierarchyForHeatFlux,
+             m_solutionMemoryPolicy);
 
     // variable to store rhs data
     auto dataSize = m_solutionHandler->getDataSize();
@@ -199,13 +242,25 @@ void sparseHeat::Solver
 
     if (m_linearSolver == "pardiso")
     {
-        m_disc->buildSystemMatrix();
+        if (m_pardisoSpd) {
+            m_disc->buildUpperTriangleOfSystemMatrix();
+        } else {
+            m_disc->buildSystemMatrix();
+        }
         m_systemMat = m_disc->getSystemMatrix();
     }
     else if (m_linearSolver == "cg") {
         m_disc->buildSystemMatrix();
         m_systemMat = m_disc->getSystemMatrix();
     }
+    else if (m_linearSolver == "cg_matrix_free") {
+        m_disc->buildSystemOperator();
+    }
+
+    // the preconditioner is used only by the iterative solvers
+    if (m_linearSolver != "pardiso" && m_cgPreconditioner == "multilevel") {
+        m_disc->buildMultilevelPreconditioner();
+    }
 }
 
 void sparseHeat::Solver
@@ -250,34 +305,55 @@ std::pair<double, int> sparseHeat::Solver
     if (m_linearSolver == "pardiso")
     {
         setPardisoSolver();
-        m_systemMat->SortColumnIndices();
+        if (!m_systemMat->ColumnsAreSorted()) {
+            m_systemMat->SortColumnIndices();
+        }
         m_pardisoSolver->initialize(m_systemMat->Size(),
                                     m_systemMat->GetI(),
                                     m_systemMat->GetJ(),
                                     m_systemMat->GetData());
-        m_pardisoSolver->factorize();
+        // a nested phase of the measured runs
+        if (m_profiler) {
+            m_profiler->measure("factorization", [this]() {
+                m_pardisoSolver->factorize();
+            });
+        } else {
+            m_pardisoSolver->factorize();
+        }
         m_pardisoSolver->solve(rhs.GetData(), u.GetData());
         memoryUsage = m_pardisoSolver->getMemoryUsage();
+        m_pardisoStats = m_pardisoSolver->getStats();
         finalizePardisoSolver();
     }
     else if (m_linearSolver == "cg")
     {
-        int verbose, maxIters;
-        double absTol, relTol;
-
-        READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
-                (m_config, "cg_verbose", verbose, 0);
-        READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
-                (m_config, "cg_max_iterations", maxIters, 1000);
-        READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
-                (m_config, "cg_absolute_tolerance", absTol, 0);
-        READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
-                (m_config, "cg_relative_tolerance", relTol, 1E-8);
-
-        auto M = new GSSmoother(*m_systemMat);
         u = 0.;
-        PCG(*m_systemMat, *M, rhs, u, verbose, maxIters, relTol, absTol);
-        delete M;
+        if (m_cgPreconditioner == "multilevel") {
+            runPcg(*m_systemMat, *m_disc->getMultilevelPreconditioner(),
+                   rhs, u);
+        }
+        else {
+            GSSmoother M(*m_systemMat);
+            runPcg(*m_systemMat, M, rhs, u);
+        }
+    }
+    else if (m_linearSolver == "cg_matrix_free")
+    {
+        u = 0.;
+        if (m_cgPreconditioner == "multilevel") {
+            runPcg(*m_disc->getSystemOperator(),
+                   *m_disc->getMultilevelPreconditioner(), rhs, u);
+        }
+        else {
+            // Jacobi preconditioner; the diagonal is
+            // already one at the essential dofs
+            Vector diag;
+            m_disc->assembleSystemOperatorDiagonal(diag);
+            Array<int> essDofs;
+            OperatorJacobiSmoother M(diag, essDofs);
+
+            runPcg(*m_disc->getSystemOperator(), M, rhs, u);
+        }
     }
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast
@@ -288,14 +364,50 @@ std::pair<double, int> sparseHeat::Solver
     return {elapsedTime, memoryUsage};
 }
 
+void sparseHeat::Solver
+:: runPcg (const Operator& A, mfem::Solver& M,
+           const Vector& rhs, Vector& u)
+{
+    int verbose, maxIters;
+    double absTol, relTol;
+
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "cg_verbose", verbose, 0);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "cg_max_iterations", maxIters, 1000);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "cg_absolute_tolerance", absTol, 0);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT
+            (m_config, "cg_relative_tolerance", relTol, 1E-8);
+
+    // as mfem::PCG, which takes the squared tolerances
+    CGSolver pcg;
+    pcg.SetPrintLevel(verbose);
+    pcg.SetMaxIter(maxIters);
+    pcg.SetRelTol(std::sqrt(relTol));
+    pcg.SetAbsTol(std::sqrt(absTol));
+    pcg.SetOperator(A);
+    pcg.SetPreconditioner(M);
+    pcg.Mult(rhs, u);
+
+    m_cgIterations = pcg.GetNumIterations();
+}
+
 void sparseHeat::Solver
 :: setPardisoSolver()
 {
     int mtype = 1; // real structurally symmetric
-//        int mtype = 2; // real symmetric positive definite
+    if (m_pardisoSpd) {
+        mtype = 2; // real symmetric positive definite
+    }
 //        int mtype = -2; // real symmetric indefinite
     m_pardisoSolver
             = std::make_unique<PardisoSolver>(mtype);
+    if (m_pardisoMixedPrecision) {
+        m_pardisoSolver->setMixedPrecision(m_pardisoRefinementTolerance,
+                                           m_pardisoMaxRefinementSteps);
+    }
+    m_pardisoSolver->setOrderingCache(m_pardisoOrderingCacheDir);
 }
 
 void sparseHeat::Solver
@@ -4,6 +4,7 @@
 #include "mfem.hpp"
 
 #include "../core/config.hpp"
+#include "../core/perf_counters.hpp"
 #include "../pardiso/pardiso.hpp"
 
 #include "../heat/test_cases_factory.hpp"
@@ -50,6 +51,11 @@ public:
     void setPardisoSolver();
     void finalizePardisoSolver();
 
+private:
+    //! Runs preconditioned CG with the tolerances of the config
+    void runPcg (const mfem::Operator& A, mfem::Solver& M,
+                 const mfem::Vector& rhs, mfem::Vector& u);
+
 public:
     double getMeshwidthOfFinestTemporalMesh();
 
@@ -68,6 +74,26 @@ public:
         return m_disc;
     }
 
+    //! Returns the metrics of the phases of the last measured run
+    const std::vector<PhaseMetrics>& getPhaseMetrics() const {
+        static const std::vector<PhaseMetrics> noPhases;
+        return m_profiler ? m_profiler->getPhases() : noPhases;
+    }
+
+    bool hasPerfCounters() const {
+        return m_profiler && m_profiler->hasCounters();
+    }
+
+    //! Returns the statistics of the last PARDISO solve
+    const PardisoStats& getPardisoStats() const {
+        return m_pardisoStats;
+    }
+
+    //! Returns the number of iterations of the last CG solve
+    int getNumCgIterations() const {
+        return m_cgIterations;
+    }
+
     std::shared_ptr<sparseHeat::SolutionHandler> getSolutionHandler() const {
         return m_solutionHandler;
     }
@@ -87,6 +113,13 @@ private:
 
     std::string m_discType;
     std::string m_linearSolver;
+    mymfem::MemoryPolicy m_solutionMemoryPolicy;
+    bool m_usePerfCounters;
+    //! created by the first measured run
+    std::unique_ptr<PhaseProfiler> m_profiler;
+    bool m_pardisoSpd;
+    std::string m_cgPreconditioner;
+    int m_cgIterations = 0;
 
     double m_endTime;
 
@@ -100,6 +133,12 @@ private:
     mfem::SparseMatrix *m_systemMat = nullptr;
 //    mfem::BlockOperator *m_systemOp = nullptr;
 
+    bool m_pardisoMixedPrecision;
+    double m_pardisoRefinementTolerance;
+    int m_pardisoMaxRefinementSteps;
+    std::string m_pardisoOrderingCacheDir;
+    PardisoStats m_pardisoStats;
+
 #ifdef PARDISO_HPP
     std::unique_ptr<PardisoSolver> m_pardisoSolver;
 #endif
@@ -38,15 +38,14 @@ void sparseHeat::SpatialMassIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
-    int dim = trialFeCoarse.GetDim();
     int testNdofsFine = testFeFine.GetDof();
     int trialNdofsCoarse = trialFeCoarse.GetDof();
 
     Vector trialShapeCoarse(trialNdofsCoarse);
     Vector testShapeFine(testNdofsFine);
-    Vector coords(dim);
     elmat.SetSize(testNdofsFine, trialNdofsCoarse);
 
     // set integration rule
@@ -63,8 +62,7 @@ void sparseHeat::SpatialMassIntegrator
         testFeFine.CalcShape(ipFine, testShapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialFeCoarse.CalcShape(ipCoarse, trialShapeCoarse);
 
         double weight = ipFine.weight*testElTransFine.Weight();
@@ -126,6 +124,7 @@ void sparseHeat::SpatialStiffnessIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
     int dim = trialFeCoarse.GetDim();
@@ -134,7 +133,6 @@ void sparseHeat::SpatialStiffnessIntegrator
 
     DenseMatrix trialDshapeCoarse(trialNdofsCoarse, dim);
     DenseMatrix testDshapeFine(testNdofsFine, dim);
-    Vector coords(dim);
 
     elmat.SetSize(testNdofsFine, trialNdofsCoarse);
     elmat = 0.0;
@@ -154,8 +152,7 @@ void sparseHeat::SpatialStiffnessIntegrator
         testFeFine.CalcPhysDShape(testElTransFine, testDshapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialElTransCoarse.SetIntPoint(&ipCoarse);
         trialFeCoarse.CalcPhysDShape(trialElTransCoarse, trialDshapeCoarse);
 
@@ -26,6 +26,7 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 };
 
@@ -64,6 +65,7 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 
 private:
@@ -90,6 +92,7 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 };
 
@@ -112,6 +115,7 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 };
 
@@ -150,11 +154,13 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 
     void assembleElementMatrix2
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 
 private:
@@ -181,11 +187,13 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 
     void assembleElementMatrix2
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 };
 
@@ -208,6 +216,7 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 };
 
@@ -230,6 +239,7 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 };
 
@@ -267,11 +277,13 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 
     void assembleElementMatrix2
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 
 private:
@@ -306,11 +318,13 @@ public:
     void assembleElementMatrix
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 
     void assembleElementMatrix2
     (const mfem::FiniteElement &, mfem::ElementTransformation &,
      const mfem::FiniteElement &, mfem::ElementTransformation &,
+     const mymfem::ChildInAncestorMap &,
      mfem::DenseMatrix &) override;
 };
 
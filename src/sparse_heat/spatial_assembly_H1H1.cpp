@@ -44,6 +44,7 @@ void sparseHeat::SpatialVectorMassIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
     int dim = trialFeCoarse.GetDim();
@@ -52,7 +53,6 @@ void sparseHeat::SpatialVectorMassIntegrator
 
     Vector trialShapeCoarse(trialNdofsCoarse);
     Vector testShapeFine(testNdofsFine);
-    Vector coords(dim);
 
     DenseMatrix partialElmat(testNdofsFine, trialNdofsCoarse);
     elmat.SetSize(dim*testNdofsFine, dim*trialNdofsCoarse);
@@ -71,8 +71,7 @@ void sparseHeat::SpatialVectorMassIntegrator
         testFeFine.CalcShape(ipFine, testShapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialFeCoarse.CalcShape(ipCoarse, trialShapeCoarse);
 
         double weight = ipFine.weight*testElTransFine.Weight();
@@ -127,6 +126,7 @@ void sparseHeat::SpatialVectorStiffnessIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
     int dim = trialFeCoarse.GetDim();
@@ -139,7 +139,6 @@ void sparseHeat::SpatialVectorStiffnessIntegrator
     Vector testDivshapeFine(dim*testNdofsFine);
     DenseMatrix testDshapeFine(testNdofsFine, dim);
 
-    Vector coords(dim);
     elmat.SetSize(dim*testNdofsFine, dim*trialNdofsCoarse);
 
     // set integration rule
@@ -157,8 +156,8 @@ void sparseHeat::SpatialVectorStiffnessIntegrator
         testDshapeFine.GradToDiv (testDivshapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
+        trialElTransCoarse.SetIntPoint(&ipCoarse);
         trialFeCoarse.CalcPhysDShape (trialElTransCoarse, trialDshapeCoarse);
         trialDshapeCoarse.GradToDiv (trialDivshapeCoarse);
 
@@ -227,6 +226,7 @@ void sparseHeat::SpatialVectorGradientIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
     int dim = trialFeCoarse.GetDim();
@@ -235,7 +235,6 @@ void sparseHeat::SpatialVectorGradientIntegrator
 
     Vector testShapeFine(testNdofsFine);
     DenseMatrix trialDshapeCoarse(trialNdofsCoarse, dim);
-    Vector coords(dim);
 
     elmat.SetSize(dim*testNdofsFine, trialNdofsCoarse);
 
@@ -254,8 +253,7 @@ void sparseHeat::SpatialVectorGradientIntegrator
         testFeFine.CalcShape(ipFine, testShapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialElTransCoarse.SetIntPoint(&ipCoarse);
         trialFeCoarse.CalcPhysDShape(trialElTransCoarse,
                                      trialDshapeCoarse);
@@ -290,6 +288,7 @@ void sparseHeat::SpatialVectorGradientIntegrator
                            ElementTransformation & testElTransCoarse,
                            const FiniteElement & trialFeFine,
                            ElementTransformation & trialElTransFine,
+                           const mymfem::ChildInAncestorMap & fineToCoarse,
                            DenseMatrix & elmat)
 {
     int dim = trialFeFine.GetDim();
@@ -298,7 +297,6 @@ void sparseHeat::SpatialVectorGradientIntegrator
 
     Vector testShapeCoarse(testNdofsCoarse);
     DenseMatrix trialDshapeFine(trialNdofsFine, dim);
-    Vector coords(dim);
 
     elmat.SetSize(dim*testNdofsCoarse, trialNdofsFine);
 
@@ -318,8 +316,7 @@ void sparseHeat::SpatialVectorGradientIntegrator
                                    trialDshapeFine);
 
         IntegrationPoint ipCoarse;
-        trialElTransFine.Transform(ipFine, coords);
-        testElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         testFeCoarse.CalcShape(ipCoarse, testShapeCoarse);
 
         double weight = ipFine.weight*trialElTransFine.Weight();
@@ -410,6 +407,7 @@ void sparseHeat::SpatialVectorDivergenceIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
     int dim = trialFeCoarse.GetDim();
@@ -419,7 +417,6 @@ void sparseHeat::SpatialVectorDivergenceIntegrator
     Vector testShapeFine(testNdofsFine);
     Vector trialDivshapeCoarse(dim*trialNdofsCoarse);
     DenseMatrix trialDshapeCoarse(trialNdofsCoarse, dim);
-    Vector coords(dim);
 
     elmat.SetSize(testNdofsFine, dim*trialNdofsCoarse);
 
@@ -437,8 +434,7 @@ void sparseHeat::SpatialVectorDivergenceIntegrator
         testFeFine.CalcShape(ipFine, testShapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialElTransCoarse.SetIntPoint(&ipCoarse);
         trialFeCoarse.CalcPhysDShape (trialElTransCoarse,
                                       trialDshapeCoarse);
@@ -454,6 +450,7 @@ void sparseHeat::SpatialVectorDivergenceIntegrator
                            ElementTransformation & testElTransCoarse,
                            const FiniteElement & trialFeFine,
                            ElementTransformation & trialElTransFine,
+                           const mymfem::ChildInAncestorMap & fineToCoarse,
                            DenseMatrix & elmat)
 {
     int dim = trialFeFine.GetDim();
@@ -463,7 +460,6 @@ void sparseHeat::SpatialVectorDivergenceIntegrator
     Vector testShapeCoarse(testNdofsCoarse);
     Vector trialDivshapeFine(dim*trialNdofsFine);
     DenseMatrix trialDshapeFine(trialNdofsFine, dim);
-    Vector coords(dim);
 
     elmat.SetSize(testNdofsCoarse, dim*trialNdofsFine);
 
@@ -483,8 +479,7 @@ void sparseHeat::SpatialVectorDivergenceIntegrator
         trialDshapeFine.GradToDiv (trialDivshapeFine);
 
         IntegrationPoint ipCoarse;
-        trialElTransFine.Transform(ipFine, coords);
-        testElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         testFeCoarse.CalcShape(ipCoarse, testShapeCoarse);
 
         double weight = ipFine.weight * trialElTransFine.Weight();
@@ -38,6 +38,7 @@ void sparseHeat::SpatialVectorFEMassIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
     int dim = trialFeCoarse.GetDim();
@@ -46,7 +47,6 @@ void sparseHeat::SpatialVectorFEMassIntegrator
 
     DenseMatrix trialVshapeCoarse(trialNdofsCoarse, dim);
     DenseMatrix testVshapeFine(testNdofsFine, dim);
-    Vector coords(dim);
     elmat.SetSize(testNdofsFine, trialNdofsCoarse);
 
     // set integration rule
@@ -63,8 +63,7 @@ void sparseHeat::SpatialVectorFEMassIntegrator
         testFeFine.CalcVShape(testElTransFine, testVshapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialElTransCoarse.SetIntPoint(&ipCoarse);
         trialFeCoarse.CalcVShape(trialElTransCoarse, trialVshapeCoarse);
 
@@ -108,15 +107,14 @@ void sparseHeat::SpatialVectorFEStiffnessIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
-    int dim = trialFeCoarse.GetDim();
     int testNdofsFine = testFeFine.GetDof();
     int trialNdofsCoarse = trialFeCoarse.GetDof();
 
     Vector trialDivshapeCoarse(trialNdofsCoarse);
     Vector testDivshapeFine(testNdofsFine);
-    Vector coords(dim);
     elmat.SetSize(testNdofsFine, trialNdofsCoarse);
 
     // set integration rule
@@ -133,8 +131,7 @@ void sparseHeat::SpatialVectorFEStiffnessIntegrator
         testFeFine.CalcPhysDivShape(testElTransFine, testDivshapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialElTransCoarse.SetIntPoint(&ipCoarse);
         trialFeCoarse.CalcPhysDivShape(trialElTransCoarse,
                                        trialDivshapeCoarse);
@@ -202,6 +199,7 @@ void sparseHeat::SpatialVectorFEGradientIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
     int dim = trialFeCoarse.GetDim();
@@ -210,7 +208,6 @@ void sparseHeat::SpatialVectorFEGradientIntegrator
 
     DenseMatrix testVshapeFine(testNdofsFine, dim);
     DenseMatrix trialDshapeCoarse(trialNdofsCoarse, dim);
-    Vector coords(dim);
     elmat.SetSize(testNdofsFine, trialNdofsCoarse);
 
     // set integration rule
@@ -228,8 +225,7 @@ void sparseHeat::SpatialVectorFEGradientIntegrator
         testFeFine.CalcVShape(testElTransFine, testVshapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialElTransCoarse.SetIntPoint(&ipCoarse);
         trialFeCoarse.CalcPhysDShape(trialElTransCoarse,
                                      trialDshapeCoarse);
@@ -262,6 +258,7 @@ void sparseHeat::SpatialVectorFEGradientIntegrator
                            ElementTransformation & testElTransCoarse,
                            const FiniteElement & trialFeFine,
                            ElementTransformation & trialElTransFine,
+                           const mymfem::ChildInAncestorMap & fineToCoarse,
                            DenseMatrix & elmat)
 {
     int dim = trialFeFine.GetDim();
@@ -270,7 +267,6 @@ void sparseHeat::SpatialVectorFEGradientIntegrator
 
     DenseMatrix testVshapeCoarse(testNdofsCoarse, dim);
     DenseMatrix trialDshapeFine(trialNdofsFine, dim);
-    Vector coords(dim);
     elmat.SetSize(testNdofsCoarse, trialNdofsFine);
 
     // set integration rule
@@ -289,8 +285,7 @@ void sparseHeat::SpatialVectorFEGradientIntegrator
                                    trialDshapeFine);
 
         IntegrationPoint ipCoarse;
-        trialElTransFine.Transform(ipFine, coords);
-        testElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         testElTransCoarse.SetIntPoint(&ipCoarse);
         testFeCoarse.CalcVShape(testElTransCoarse,
                                 testVshapeCoarse);
@@ -358,15 +353,14 @@ void sparseHeat::SpatialVectorFEDivergenceIntegrator
                           ElementTransformation & testElTransFine,
                           const FiniteElement & trialFeCoarse,
                           ElementTransformation & trialElTransCoarse,
+                          const mymfem::ChildInAncestorMap & fineToCoarse,
                           DenseMatrix & elmat)
 {
-    int dim = trialFeCoarse.GetDim();
     int testNdofsFine = testFeFine.GetDof();
     int trialNdofsCoarse = trialFeCoarse.GetDof();
 
     Vector testShapeFine(testNdofsFine);
     Vector trialDivshapeCoarse(trialNdofsCoarse);
-    Vector coords(dim);
     elmat.SetSize(testNdofsFine, trialNdofsCoarse);
 
     // set integration rule
@@ -383,8 +377,7 @@ void sparseHeat::SpatialVectorFEDivergenceIntegrator
         testFeFine.CalcShape(ipFine, testShapeFine);
 
         IntegrationPoint ipCoarse;
-        testElTransFine.Transform(ipFine, coords);
-        trialElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         trialElTransCoarse.SetIntPoint(&ipCoarse);
         trialFeCoarse.CalcPhysDivShape(trialElTransCoarse,
                                        trialDivshapeCoarse);
@@ -399,15 +392,14 @@ void sparseHeat::SpatialVectorFEDivergenceIntegrator
                            ElementTransformation & testElTransCoarse,
                            const FiniteElement & trialFeFine,
                            ElementTransformation & trialElTransFine,
+                           const mymfem::ChildInAncestorMap & fineToCoarse,
                            DenseMatrix & elmat)
 {
-    int dim = trialFeFine.GetDim();
     int testNdofsCoarse = testFeCoarse.GetDof();
     int trialNdofsFine = trialFeFine.GetDof();
 
     Vector testShapeCoarse(testNdofsCoarse);
     Vector trialDivshapeFine(trialNdofsFine);
-    Vector coords(dim);
     elmat.SetSize(testNdofsCoarse, trialNdofsFine);
 
     // set integration rule
@@ -424,8 +416,7 @@ void sparseHeat::SpatialVectorFEDivergenceIntegrator
         trialFeFine.CalcDivShape(ipFine, trialDivshapeFine);
 
         IntegrationPoint ipCoarse;
-        trialElTransFine.Transform(ipFine, coords);
-        testElTransCoarse.TransformBack(coords, ipCoarse);
+        fineToCoarse.transform(ipFine, ipCoarse);
         testFeCoarse.CalcShape(ipCoarse, testShapeCoarse);
 
         double weight = ipFine.weight;
@@ -1,5 +1,7 @@
 #include "spatial_error_evaluator.hpp"
 
+#include <algorithm>
+
 using namespace mfem;
 
 
@@ -34,42 +36,185 @@ void sparseHeat::SpatialErrorOfSolution
     m_sourceCoeff->SetTime(t);
 }
 
-void sparseHeat::SpatialErrorOfSolution
-:: initializeSpatialParentElementIds(int k, Array<int> &elIds) const
+sparseHeat::SpatialQuadratureTable
+:: SpatialQuadratureTable
+(const std::shared_ptr<mymfem::NestedMeshHierarchy>& spatialMeshHierarchy,
+ const mymfem::NestedFESpaces& temperatureFESpaces,
+ const mymfem::NestedFESpaces& heatFluxFESpaces)
 {
-    assert(elIds.Size() == m_numLevels+1);
+    m_numLevels = spatialMeshHierarchy->getNumMeshes();
+    auto meshes = spatialMeshHierarchy->getMeshes();
+    auto finestSpatialMesh = meshes[m_numLevels-1];
+    auto finestFesForTemperature = temperatureFESpaces[m_numLevels-1];
+    m_dim = finestSpatialMesh->Dimension();
+
+    int numEls = finestSpatialMesh->GetNE();
+    m_pointOffsets.assign(1, 0);
+    m_temperatureDofOffsets.assign(1, 0);
+    m_heatFluxDofOffsets.assign(1, 0);
+    m_temperatureValOffsets.assign(1, 0);
+    m_heatFluxValOffsets.assign(1, 0);
+
+    Array<int> vdofs;
+    Vector shape, divShape;
+    DenseMatrix dshape, vshape;
+    IntegrationPoint ipCoarse;
+    std::vector<int> ancestorIds(m_numLevels);
+    std::vector<mymfem::ChildInAncestorMap> maps(m_numLevels);
+    for (int k=0; k<numEls; k++)
+    {
+        auto elTransFine = finestSpatialMesh->GetElementTransformation(k);
+        auto feFineForTemperature = finestFesForTemperature->GetFE(k);
+
+        // element vdofs per level, the level j lives on the mesh L-1-j
+        for (int j=0; j<m_numLevels; j++)
+        {
+            int level = m_numLevels-1-j;
+            ancestorIds[j] = spatialMeshHierarchy->getAncestorId
+                    (m_numLevels-1, k, level);
+            maps[j] = spatialMeshHierarchy->getChildInAncestorMap
+                    (m_numLevels-1, k, level);
+
+            temperatureFESpaces[level]->GetElementVDofs(ancestorIds[j],
+                                                        vdofs);
+            m_temperatureDofs.insert(m_temperatureDofs.end(),
+                                     vdofs.begin(), vdofs.end());
+            m_temperatureDofOffsets.push_back
+                    (static_cast<int>(m_temperatureDofs.size()));
+
+            heatFluxFESpaces[level]->GetElementVDofs(ancestorIds[j], vdofs);
+            m_heatFluxDofs.insert(m_heatFluxDofs.end(),
+                                  vdofs.begin(), vdofs.end());
+            m_heatFluxDofOffsets.push_back
+                    (static_cast<int>(m_heatFluxDofs.size()));
+        }
+
+        // integration rules
+        int order = 2*feFineForTemperature->GetOrder()+1;
+        const IntegrationRule *ir
+                = &IntRules.Get(feFineForTemperature->GetGeomType(),
+                                order);
 
-    auto hierMeshTrans = m_spatialMeshHierarchy->getTransformations();
+        for (int i=0; i<ir->GetNPoints(); i++)
+        {
+            const IntegrationPoint &ipFine = ir->IntPoint(i);
+            elTransFine->SetIntPoint(&ipFine);
+            m_ips.push_back(ipFine);
+            m_weights.push_back(ipFine.weight * elTransFine->Weight());
 
-    elIds[0] = k;
-    elIds[1] = k;
+            for (int j=0; j<m_numLevels; j++)
+            {
+                int level = m_numLevels-1-j;
+                maps[j].transform(ipFine, ipCoarse);
+                auto elTransCoarse = meshes[level]
+                        ->GetElementTransformation(ancestorIds[j]);
+                elTransCoarse->SetIntPoint(&ipCoarse);
 
-    for (int i=1; i<m_numLevels; i++) {
-        elIds[i+1]
-                = hierMeshTrans[m_numLevels-1-i]->getParentId(elIds[i]);
+                // temperature
+                const FiniteElement *feT
+                        = temperatureFESpaces[level]->GetFE(ancestorIds[j]);
+                int ndT = feT->GetDof();
+                shape.SetSize(ndT);
+                dshape.SetSize(ndT, m_dim);
+                feT->CalcShape(ipCoarse, shape);
+                feT->CalcPhysDShape(*elTransCoarse, dshape);
+                for (int a=0; a<ndT; a++) {
+                    m_temperatureVals.push_back(shape(a));
+                    for (int d=0; d<m_dim; d++) {
+                        m_temperatureGrads.push_back(dshape(a, d));
+                    }
+                }
+                m_temperatureValOffsets.push_back
+                        (static_cast<int>(m_temperatureVals.size()));
+
+                // heat flux; vector H1 spaces have one scalar
+                // element per component
+                const FiniteElement *feQ
+                        = heatFluxFESpaces[level]->GetFE(ancestorIds[j]);
+                int ndQ = feQ->GetDof();
+                if (feQ->GetRangeType() == FiniteElement::SCALAR)
+                {
+                    int vdim = heatFluxFESpaces[level]->GetVDim();
+                    shape.SetSize(ndQ);
+                    dshape.SetSize(ndQ, m_dim);
+                    feQ->CalcShape(ipCoarse, shape);
+                    feQ->CalcPhysDShape(*elTransCoarse, dshape);
+                    for (int c=0; c<vdim; c++) {
+                        for (int a=0; a<ndQ; a++) {
+                            for (int d=0; d<m_dim; d++) {
+                                m_heatFluxVals.push_back
+                                        (d == c ? shape(a) : 0.);
+                            }
+                            m_heatFluxDivs.push_back(dshape(a, c));
+                        }
+                    }
+                }
+                else
+                {
+                    vshape.SetSize(ndQ, m_dim);
+                    divShape.SetSize(ndQ);
+                    feQ->CalcVShape(*elTransCoarse, vshape);
+                    feQ->CalcDivShape(ipCoarse, divShape);
+                    for (int a=0; a<ndQ; a++) {
+                        for (int d=0; d<m_dim; d++) {
+                            m_heatFluxVals.push_back(vshape(a, d));
+                        }
+                        m_heatFluxDivs.push_back
+                                (divShape(a)/elTransCoarse->Weight());
+                    }
+                }
+                m_heatFluxValOffsets.push_back
+                        (static_cast<int>(m_heatFluxDivs.size()));
+            }
+        }
+        m_pointOffsets.push_back(static_cast<int>(m_weights.size()));
     }
 }
 
-void sparseHeat::SpatialErrorOfSolution
-:: getSpatialParentElementIds(int k, Array<int> &elIds) const
+void sparseHeat::SpatialQuadratureTable
+:: eval(int k, int p, int j,
+        const double *tData, const double *qData,
+        double& u, double *gradu,
+        double *q, double& divq) const
 {
-    assert(elIds.Size() == m_numLevels+1);
-
-    auto hierMeshTrans = m_spatialMeshHierarchy->getTransformations();
-    Array<int> oldElIds(elIds);
-//    oldElIds.Print();
-//    std::cout << "\n\n";
+    auto getValue = [](const double *data, int dof) {
+        return dof >= 0 ? data[dof] : -data[-1-dof];
+    };
+
+    const int *tDofs = m_temperatureDofs.data()
+            + m_temperatureDofOffsets[k*m_numLevels + j];
+    int tBegin = m_temperatureValOffsets[p*m_numLevels + j];
+    int ndT = m_temperatureValOffsets[p*m_numLevels + j + 1] - tBegin;
+    const double *tVals = m_temperatureVals.data() + tBegin;
+    const double *tGrads = m_temperatureGrads.data() + tBegin*m_dim;
+
+    u = 0;
+    for (int d=0; d<m_dim; d++) { gradu[d] = 0; }
+    for (int a=0; a<ndT; a++)
+    {
+        double x = getValue(tData, tDofs[a]);
+        u += tVals[a]*x;
+        for (int d=0; d<m_dim; d++) {
+            gradu[d] += tGrads[a*m_dim + d]*x;
+        }
+    }
 
-    elIds[0] = k;
-    elIds[1] = k;
+    const int *qDofs = m_heatFluxDofs.data()
+            + m_heatFluxDofOffsets[k*m_numLevels + j];
+    int qBegin = m_heatFluxValOffsets[p*m_numLevels + j];
+    int ndQ = m_heatFluxValOffsets[p*m_numLevels + j + 1] - qBegin;
+    const double *qVals = m_heatFluxVals.data() + qBegin*m_dim;
+    const double *qDivs = m_heatFluxDivs.data() + qBegin;
 
-    for (int i=1; i<m_numLevels; i++)
+    divq = 0;
+    for (int d=0; d<m_dim; d++) { q[d] = 0; }
+    for (int a=0; a<ndQ; a++)
     {
-        if (elIds[i] == oldElIds[i]) {
-            break;
+        double x = getValue(qData, qDofs[a]);
+        divq += qDivs[a]*x;
+        for (int d=0; d<m_dim; d++) {
+            q[d] += qVals[a*m_dim + d]*x;
         }
-        elIds[i+1]
-                = hierMeshTrans[m_numLevels-1-i]->getParentId(elIds[i]);
     }
 }
 
@@ -85,21 +230,14 @@ sparseHeat::SpatialErrorOfSolutionInNaturalNorm
     assert(temporalBasisVals.Size() == m_numLevels+1);
     assert(spatialTemperatures.Size() == temporalBasisVals.Size());
     assert(spatialHeatFluxes.Size() == temporalBasisVals.Size());
+    assert(m_quadratureTable);
 
     setCurrentTimeForCoefficients(t);
 
     auto meshes = m_spatialMeshHierarchy->getMeshes();
     auto finestSpatialMesh = meshes[m_numLevels-1];
 
-    auto finestFesForTemperature = spatialTemperatures[0]->FESpace();
-//    auto finestFesForHeatFlux = spatialHeatFluxes[0]->FESpace();
-
     int dim = finestSpatialMesh->Dimension();
-    Vector coords(finestSpatialMesh->Dimension());
-    IntegrationPoint ipCoarse;
-
-    Array<int> parentElIds(m_numLevels+1);
-    initializeSpatialParentElementIds(0, parentElIds);
 
     Vector temperatureRelErrorNormH1(2);
     temperatureRelErrorNormH1 = 0.;
@@ -110,137 +248,60 @@ sparseHeat::SpatialErrorOfSolutionInNaturalNorm
     Vector solDivergenceRelErrorNormL2(2);
     solDivergenceRelErrorNormL2 = 0.;
 
+    Vector gradu(dim), heatFlux(dim);
+    Vector graduBuf(dim), heatFluxBuf(dim);
+    Vector bufErrorGradu(dim), bufErrorHeatFlux(dim);
+    // element transformations are local, so that the evaluation
+    // is reentrant for a given time
+    IsoparametricTransformation elTransFine;
     for (int k=0; k<finestSpatialMesh->GetNE(); k++)
     {
-        auto elTransFine = finestSpatialMesh->GetElementTransformation(k);
-        auto feFineForTemperature = finestFesForTemperature->GetFE(k);
-
-        getSpatialParentElementIds(k, parentElIds);
-
-        // integration rules
-        int order = 2*feFineForTemperature->GetOrder()+1;
-        const IntegrationRule *ir
-                = &IntRules.Get(feFineForTemperature->GetGeomType(),
-                                order);
+        finestSpatialMesh->GetElementTransformation(k, &elTransFine);
 
-        for (int i=0; i<ir->GetNPoints(); i++)
+        for (int p=m_quadratureTable->getPointBegin(k);
+             p<m_quadratureTable->getPointEnd(k); p++)
         {
-            const IntegrationPoint &ipFine = ir->IntPoint(i);
-            elTransFine->SetIntPoint(&ipFine);
-            elTransFine->Transform(ipFine, coords);
-
-            double weight = ipFine.weight * elTransFine->Weight();
-
-            // exact and discrete temperature values
-            double uRef
-                    = m_exactTemperatureCoeff->Eval(*elTransFine, ipFine);
-
-            double u = temporalBasisVals[0]
-                    *spatialTemperatures[0]
-                    ->GetValue(k, ipFine);
-            u += temporalBasisVals[1]
-                    *spatialTemperatures[1]
-                    ->GetValue(k, ipFine);
-            for (int m=2; m<m_numLevels+1; m++)
+            const IntegrationPoint &ipFine
+                    = m_quadratureTable->getIntPoint(p);
+            elTransFine.SetIntPoint(&ipFine);
+
+            double weight = m_quadratureTable->getWeight(p);
+
+            // discrete temperature, its spatial and temporal gradients,
+            // heat flux and its divergence;
+            // the first two temporal basis functions
+            // live on the finest spatial level
+            double u = 0, dudt = 0, divxQ = 0;
+            gradu = 0.;
+            heatFlux = 0.;
+            for (int m=0; m<m_numLevels+1; m++)
             {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-
-                u += temporalBasisVals[m]
-                        *spatialTemperatures[m]
-                        ->GetValue(parentElIds[m], ipCoarse);
+                double uBuf, divxQBuf;
+                m_quadratureTable->eval
+                        (k, p, std::max(m-1, 0),
+                         spatialTemperatures[m]->GetData(),
+                         spatialHeatFluxes[m]->GetData(),
+                         uBuf, graduBuf.GetData(),
+                         heatFluxBuf.GetData(), divxQBuf);
+
+                u += temporalBasisVals[m]*uBuf;
+                dudt += temporalBasisGradientVals[m]*uBuf;
+                gradu.Add(temporalBasisVals[m], graduBuf);
+                heatFlux.Add(temporalBasisVals[m], heatFluxBuf);
+                divxQ += temporalBasisVals[m]*divxQBuf;
             }
-//            std::cout << k << "\t" << i << "\t"
-//                      << uRef << "\t" << u << std::endl;
 
-            // exact and discrete temperature gradient values
-            Vector bufErrorGradu(dim);
+            // exact temperature values and gradients
+            double uRef
+                    = m_exactTemperatureCoeff->Eval(elTransFine, ipFine);
             bufErrorGradu = 0.;
             m_exactSpatialGradientOfTemperatureCoeff
-                    ->Eval(bufErrorGradu, *elTransFine, ipFine);
-
-            Vector gradu(dim); gradu = 0.;
-            Vector graduBuf(dim);
-            spatialTemperatures[0]->GetGradient(*elTransFine, graduBuf);
-            gradu.Add(temporalBasisVals[0], graduBuf);
-            spatialTemperatures[1]->GetGradient(*elTransFine, graduBuf);
-            gradu.Add(temporalBasisVals[1], graduBuf);
-            for (int m=2; m<m_numLevels+1; m++)
-            {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-                elTransCoarse->SetIntPoint(&ipCoarse);
-
-                spatialTemperatures[m]
-                        ->GetGradient(*elTransCoarse, graduBuf);
-                gradu.Add(temporalBasisVals[m], graduBuf);
-            }
-
-            // discrete temperature temporal gradient values
-            double dudt = temporalBasisGradientVals[0]
-                    *spatialTemperatures[0]
-                    ->GetValue(k, ipFine);
-            dudt += temporalBasisGradientVals[1]
-                    *spatialTemperatures[1]
-                    ->GetValue(k, ipFine);
-            for (int m=2; m<m_numLevels+1; m++)
-            {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-
-                dudt += temporalBasisGradientVals[m]
-                        *spatialTemperatures[m]
-                        ->GetValue(parentElIds[m], ipCoarse);
-            }
+                    ->Eval(bufErrorGradu, elTransFine, ipFine);
 
-            // exact and discrete heat flux values
-            Vector bufErrorHeatFlux(dim);
+            // exact heat flux values
             bufErrorHeatFlux = 0.;
             m_exactHeatFluxCoeff
-                    ->Eval(bufErrorHeatFlux, *elTransFine, ipFine);
-
-            Vector heatFlux(dim); heatFlux = 0.;
-            Vector heatFluxBuf(dim);
-            spatialHeatFluxes[0]->GetVectorValue(k, ipFine, heatFluxBuf);
-            heatFlux.Add(temporalBasisVals[0], heatFluxBuf);
-            spatialHeatFluxes[1]->GetVectorValue(k, ipFine, heatFluxBuf);
-            heatFlux.Add(temporalBasisVals[1], heatFluxBuf);
-            for (int m=2; m<m_numLevels+1; m++)
-            {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-
-                spatialHeatFluxes[m]->GetVectorValue(parentElIds[m], ipCoarse, heatFluxBuf);
-                heatFlux.Add(temporalBasisVals[m], heatFluxBuf);
-            }
-
-            // discrete heat flux divergence values
-            double divxQ = temporalBasisVals[0]
-                    *spatialHeatFluxes[0]
-                    ->GetDivergence(*elTransFine);
-            divxQ += temporalBasisVals[1]
-                    *spatialHeatFluxes[1]
-                    ->GetDivergence(*elTransFine);
-            for (int m=2; m<m_numLevels+1; m++)
-            {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-                elTransCoarse->SetIntPoint(&ipCoarse);
-
-                divxQ += temporalBasisVals[m]
-                        *spatialHeatFluxes[m]
-                        ->GetDivergence(*elTransCoarse);
-            }
+                    ->Eval(bufErrorHeatFlux, elTransFine, ipFine);
 
             // temperature error
             temperatureRelErrorNormH1(1) += weight
@@ -258,7 +319,7 @@ sparseHeat::SpatialErrorOfSolutionInNaturalNorm
                     * (bufErrorHeatFlux*bufErrorHeatFlux);
 
             // divergence error
-            double tmp = m_sourceCoeff->Eval(*elTransFine, ipFine);
+            double tmp = m_sourceCoeff->Eval(elTransFine, ipFine);
             solDivergenceRelErrorNormL2(0) += weight
                     * ((tmp - (dudt - divxQ))*(tmp - (dudt - divxQ)));
             solDivergenceRelErrorNormL2(1) += weight * tmp * tmp;
@@ -281,21 +342,14 @@ sparseHeat::SpatialErrorOfSolutionInLeastSquaresNorm
     assert(temporalBasisVals.Size() == m_numLevels+1);
     assert(spatialTemperatures.Size() == temporalBasisVals.Size());
     assert(spatialHeatFluxes.Size() == temporalBasisVals.Size());
+    assert(m_quadratureTable);
 
     setCurrentTimeForCoefficients(t);
 
     auto meshes = m_spatialMeshHierarchy->getMeshes();
     auto finestSpatialMesh = meshes[m_numLevels-1];
 
-    auto finestFesForTemperature = spatialTemperatures[0]->FESpace();
-//    auto finestFesForHeatFlux = spatialHeatFluxes[0]->FESpace();
-
     int dim = finestSpatialMesh->Dimension();
-    Vector coords(finestSpatialMesh->Dimension());
-    IntegrationPoint ipCoarse;
-
-    Array<int> parentElIds(m_numLevels+1);
-    initializeSpatialParentElementIds(0, parentElIds);
 
     Vector pdeErrorNormL2(1);
     pdeErrorNormL2 = 0.;
@@ -303,119 +357,63 @@ sparseHeat::SpatialErrorOfSolutionInLeastSquaresNorm
     Vector heatFluxErrorNormL2(1);
     heatFluxErrorNormL2 = 0.;
 
+    Vector gradu(dim), graduBuf(dim);
+    Vector bufErrorHeatFlux(dim), heatFluxBuf(dim);
+    DenseMatrix material;
+    // element transformations are local, so that the evaluation
+    // is reentrant for a given time
+    IsoparametricTransformation elTransFine;
     for (int k=0; k<finestSpatialMesh->GetNE(); k++)
     {
-        auto elTransFine = finestSpatialMesh->GetElementTransformation(k);
-        auto feFineForTemperature = finestFesForTemperature->GetFE(k);
+        finestSpatialMesh->GetElementTransformation(k, &elTransFine);
 
-        getSpatialParentElementIds(k, parentElIds);
-
-        // integration rules
-        int order = 2*feFineForTemperature->GetOrder()+1;
-        const IntegrationRule *ir
-                = &IntRules.Get(feFineForTemperature->GetGeomType(),
-                                order);
-
-        for (int i=0; i<ir->GetNPoints(); i++)
+        for (int p=m_quadratureTable->getPointBegin(k);
+             p<m_quadratureTable->getPointEnd(k); p++)
         {
-            const IntegrationPoint &ipFine = ir->IntPoint(i);
-            elTransFine->SetIntPoint(&ipFine);
-            elTransFine->Transform(ipFine, coords);
-
-            double weight = ipFine.weight * elTransFine->Weight();
-
-            // discrete temperature temporal gradient values
-            double dudt = temporalBasisGradientVals[0]
-                    *spatialTemperatures[0]
-                    ->GetValue(k, ipFine);
-            dudt += temporalBasisGradientVals[1]
-                    *spatialTemperatures[1]
-                    ->GetValue(k, ipFine);
-            for (int m=2; m<m_numLevels+1; m++)
-            {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-
-                dudt += temporalBasisGradientVals[m]
-                        *spatialTemperatures[m]
-                        ->GetValue(parentElIds[m], ipCoarse);
-            }
+            const IntegrationPoint &ipFine
+                    = m_quadratureTable->getIntPoint(p);
+            elTransFine.SetIntPoint(&ipFine);
 
-            // discrete heat flux divergence values
-            double divxQ = temporalBasisVals[0]
-                    *spatialHeatFluxes[0]
-                    ->GetDivergence(*elTransFine);
-            divxQ += temporalBasisVals[1]
-                    *spatialHeatFluxes[1]
-                    ->GetDivergence(*elTransFine);
-            for (int m=2; m<m_numLevels+1; m++)
-            {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-                elTransCoarse->SetIntPoint(&ipCoarse);
-
-                divxQ += temporalBasisVals[m]
-                        *spatialHeatFluxes[m]
-                        ->GetDivergence(*elTransCoarse);
-            }
+            double weight = m_quadratureTable->getWeight(p);
 
-            // discrete temperature spatial gradient values
-            Vector gradu(dim); gradu = 0.;
-            Vector graduBuf(dim);
-            spatialTemperatures[0]->GetGradient(*elTransFine, graduBuf);
-            gradu.Add(temporalBasisVals[0], graduBuf);
-            spatialTemperatures[1]->GetGradient(*elTransFine, graduBuf);
-            gradu.Add(temporalBasisVals[1], graduBuf);
-            for (int m=2; m<m_numLevels+1; m++)
+            // discrete temperature temporal and spatial gradients,
+            // heat flux and its divergence
+            double dudt = 0, divxQ = 0;
+            gradu = 0.;
+            bufErrorHeatFlux = 0.;
+            for (int m=0; m<m_numLevels+1; m++)
             {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-                elTransCoarse->SetIntPoint(&ipCoarse);
-
-                spatialTemperatures[m]
-                        ->GetGradient(*elTransCoarse, graduBuf);
+                double uBuf, divxQBuf;
+                m_quadratureTable->eval
+                        (k, p, std::max(m-1, 0),
+                         spatialTemperatures[m]->GetData(),
+                         spatialHeatFluxes[m]->GetData(),
+                         uBuf, graduBuf.GetData(),
+                         heatFluxBuf.GetData(), divxQBuf);
+
+                dudt += temporalBasisGradientVals[m]*uBuf;
                 gradu.Add(temporalBasisVals[m], graduBuf);
-            }
-
-            // discrete heat flux values
-            Vector bufErrorHeatFlux(dim); bufErrorHeatFlux = 0.;
-            Vector heatFluxBuf(dim);
-            spatialHeatFluxes[0]->GetVectorValue(k, ipFine, heatFluxBuf);
-            bufErrorHeatFlux.Add(temporalBasisVals[0], heatFluxBuf);
-            spatialHeatFluxes[1]->GetVectorValue(k, ipFine, heatFluxBuf);
-            bufErrorHeatFlux.Add(temporalBasisVals[1], heatFluxBuf);
-            for (int m=2; m<m_numLevels+1; m++)
-            {
-                auto elTransCoarse
-                        = meshes[m_numLevels-m]
-                        ->GetElementTransformation(parentElIds[m]);
-                elTransCoarse->TransformBack(coords, ipCoarse);
-
-                spatialHeatFluxes[m]->GetVectorValue(parentElIds[m], ipCoarse, heatFluxBuf);
                 bufErrorHeatFlux.Add(temporalBasisVals[m], heatFluxBuf);
+                divxQ += temporalBasisVals[m]*divxQBuf;
             }
 
             // pde error
-            double tmp = m_sourceCoeff->Eval(*elTransFine, ipFine);
+            double tmp = m_sourceCoeff->Eval(elTransFine, ipFine);
             pdeErrorNormL2(0) += weight
                     * ((tmp - (dudt - divxQ))*(tmp - (dudt - divxQ)));
 
             // flux error
-            DenseMatrix material;
-            m_materialCoeff->Eval(material, *elTransFine, ipFine);
+            m_materialCoeff->Eval(material, elTransFine, ipFine);
             material.AddMult_a(-1, gradu, bufErrorHeatFlux);
             heatFluxErrorNormL2(0) += weight
                     * (bufErrorHeatFlux*bufErrorHeatFlux);
         }
     }
 
-    return {pdeErrorNormL2, heatFluxErrorNormL2, Vector(1)};
+    Vector unused(1);
+    unused = 0.;
+
+    return {pdeErrorNormL2, heatFluxErrorNormL2, unused};
 }
 
 // End of file
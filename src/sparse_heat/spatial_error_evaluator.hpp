@@ -8,6 +8,78 @@
 namespace sparseHeat
 {
 
+/**
+ * @brief Time-independent spatial data of the sparse error evaluators.
+ *
+ * For every quadrature point of every element of the finest spatial
+ * mesh, and for every spatial level j, counted from the finest,
+ * stores the ancestor element on the level j, and the values and
+ * physical gradients of the temperature shape functions and the
+ * values and divergences of the heat flux shape functions,
+ * evaluated at the point mapped to the ancestor.
+ */
+class SpatialQuadratureTable
+{
+public:
+    SpatialQuadratureTable
+    (const std::shared_ptr<mymfem::NestedMeshHierarchy>&
+     spatialMeshHierarchy,
+     const mymfem::NestedFESpaces& temperatureFESpaces,
+     const mymfem::NestedFESpaces& heatFluxFESpaces);
+
+    //! Returns the number of elements of the finest spatial mesh
+    int getNumElements() const {
+        return static_cast<int>(m_pointOffsets.size())-1;
+    }
+
+    //! Returns the range of quadrature points of the fine element k
+    int getPointBegin(int k) const { return m_pointOffsets[k]; }
+    int getPointEnd(int k) const { return m_pointOffsets[k+1]; }
+
+    //! Returns the quadrature point p on its fine element
+    const mfem::IntegrationPoint& getIntPoint(int p) const {
+        return m_ips[p];
+    }
+
+    //! Returns the quadrature weight times the Jacobian determinant
+    double getWeight(int p) const {
+        return m_weights[p];
+    }
+
+    /**
+     * @brief Evaluates the discrete temperature, its gradient,
+     * heat flux and its divergence at the quadrature point p
+     * of the fine element k, on the level j
+     * @param tData temperature data on the level j
+     * @param qData heat flux data on the level j
+     */
+    void eval(int k, int p, int j,
+              const double *tData, const double *qData,
+              double& u, double *gradu,
+              double *q, double& divq) const;
+
+private:
+    int m_numLevels;
+    int m_dim;
+
+    std::vector<int> m_pointOffsets;
+    std::vector<mfem::IntegrationPoint> m_ips;
+    std::vector<double> m_weights;
+
+    //! per (fine element, level), the element vdofs;
+    //! negative indices encode flipped orientations
+    std::vector<int> m_temperatureDofOffsets, m_temperatureDofs;
+    std::vector<int> m_heatFluxDofOffsets, m_heatFluxDofs;
+
+    //! per (quadrature point, level), the offsets of the shape values;
+    //! gradients and vector values are stored dim-wise
+    std::vector<int> m_temperatureValOffsets;
+    std::vector<double> m_temperatureVals, m_temperatureGrads;
+    std::vector<int> m_heatFluxValOffsets;
+    std::vector<double> m_heatFluxVals, m_heatFluxDivs;
+};
+
+
 class SpatialErrorOfSolution
 {
 public:
@@ -24,15 +96,15 @@ public:
                          std::shared_ptr<mfem::Coefficient> &,
                          std::shared_ptr<mfem::Coefficient> &);
 
+    //! Sets the precomputed spatial quadrature data
+    void setQuadratureTable
+    (const std::shared_ptr<const SpatialQuadratureTable>& table) {
+        m_quadratureTable = table;
+    }
+
 protected:
     void setCurrentTimeForCoefficients(double) const;
 
-    void initializeSpatialParentElementIds
-    (int k, mfem::Array<int>& elIds) const;
-
-    void getSpatialParentElementIds
-    (int k, mfem::Array<int>& elIds) const;
-
 public:
     virtual std::tuple<mfem::Vector, mfem::Vector, mfem::Vector>
     eval (double, mfem::Array<double>&, mfem::Array<double>&,
@@ -42,6 +114,7 @@ public:
 protected:
     int m_numLevels;
     std::shared_ptr<mymfem::NestedMeshHierarchy> m_spatialMeshHierarchy;
+    std::shared_ptr<const SpatialQuadratureTable> m_quadratureTable;
 
     mutable std::shared_ptr<mfem::MatrixCoefficient> m_materialCoeff;
 
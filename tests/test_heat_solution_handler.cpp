@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include "mfem.hpp"
+using namespace mfem;
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include "../src/heat/solution_handler.hpp"
+
+
+/**
+ * @brief Tests the round trip between the two data layouts,
+ * and that the writable and read-only slice and trace views
+ * alias the data
+ */
+TEST(HeatSolutionHandler, layoutRoundTrip)
+{
+    Mesh temporalMesh(5, 1.);
+    auto tFec = std::make_unique<H1_FECollection>(1, 1);
+    FiniteElementSpace temporalFes(&temporalMesh, tFec.get());
+
+    Mesh spatialMesh(3, 2, Element::TRIANGLE, true, 1., 1.);
+    auto xH1Fec = std::make_unique<H1_FECollection>
+            (1, 2, BasisType::GaussLobatto);
+    auto xRTFec = std::make_unique<RT_FECollection>(0, 2);
+    FiniteElementSpace spatialFesH1(&spatialMesh, xH1Fec.get());
+    FiniteElementSpace spatialFesRT(&spatialMesh, xRTFec.get());
+
+    Array<FiniteElementSpace *> spatialFes(2);
+    spatialFes[0] = &spatialFesH1;
+    spatialFes[1] = &spatialFesRT;
+    heat::SolutionHandler solutionHandler(&temporalFes, spatialFes);
+
+    int numTemporalDofs = temporalFes.GetTrueVSize();
+    int numSpatialDofs[2] = {spatialFesH1.GetTrueVSize(),
+                             spatialFesRT.GetTrueVSize()};
+
+    // distinct values, the dof (a, t) of the field f stores f + a + t/100
+    auto value = [](int f, int a, int t) {
+        return f + a + 0.01*t;
+    };
+    Vector* blocks[2] = {&solutionHandler.getTemperatureData(),
+                         &solutionHandler.getHeatFluxData()};
+    for (int f=0; f<2; f++) {
+        for (int t=0; t<numTemporalDofs; t++) {
+            for (int a=0; a<numSpatialDofs[f]; a++) {
+                (*blocks[f])(t*numSpatialDofs[f] + a) = value(f, a, t);
+            }
+        }
+    }
+    const double *storage[2] = {blocks[0]->GetData(),
+                                blocks[1]->GetData()};
+
+    Vector view;
+    ASSERT_THROW(solutionHandler.makeTemperatureTraceRef(0, view),
+                 std::runtime_error);
+    ASSERT_THROW(solutionHandler.makeHeatFluxTraceRef(0, view),
+                 std::runtime_error);
+
+    solutionHandler.setLayout(heat::DataLayout::spaceMajor);
+    ASSERT_EQ(solutionHandler.getLayout(), heat::DataLayout::spaceMajor);
+    ASSERT_THROW(solutionHandler.makeTemperatureSliceRef(0, view),
+                 std::runtime_error);
+    ASSERT_THROW(solutionHandler.getTemperatureDataAtEndTime(),
+                 std::runtime_error);
+
+    // the traces are views into the transposed data in its storage
+    for (int f=0; f<2; f++)
+    {
+        ASSERT_EQ(blocks[f]->GetData(), storage[f]);
+        for (int a=0; a<numSpatialDofs[f]; a++)
+        {
+            if (f == 0) {
+                solutionHandler.makeTemperatureTraceRef(a, view);
+            } else {
+                solutionHandler.makeHeatFluxTraceRef(a, view);
+            }
+            ASSERT_EQ(view.Size(), numTemporalDofs);
+            ASSERT_EQ(view.GetData(), storage[f] + a*numTemporalDofs);
+            for (int t=0; t<numTemporalDofs; t++) {
+                ASSERT_EQ(view(t), value(f, a, t));
+            }
+        }
+    }
+
+    // writes through a trace are seen after the transpose back
+    solutionHandler.makeHeatFluxTraceRef(1, view);
+    view(2) = -1.;
+
+    solutionHandler.setLayout(heat::DataLayout::timeMajor);
+    ASSERT_EQ(solutionHandler.getLayout(), heat::DataLayout::timeMajor);
+    for (int f=0; f<2; f++)
+    {
+        ASSERT_EQ(blocks[f]->GetData(), storage[f]);
+        for (int t=0; t<numTemporalDofs; t++)
+        {
+            if (f == 0) {
+                solutionHandler.makeTemperatureSliceRef(t, view);
+            } else {
+                solutionHandler.makeHeatFluxSliceRef(t, view);
+            }
+            ASSERT_EQ(view.GetData(), storage[f] + t*numSpatialDofs[f]);
+            for (int a=0; a<numSpatialDofs[f]; a++) {
+                double trueValue = (f == 1 && a == 1 && t == 2) ?
+                            -1. : value(f, a, t);
+                ASSERT_EQ(view(a), trueValue);
+            }
+        }
+    }
+
+    // the read-only views of a const handler alias the data as well
+    const heat::SolutionHandler& constHandler = solutionHandler;
+    const Vector slice = constHandler.makeHeatFluxSliceRef(2);
+    ASSERT_EQ(slice.GetData(), storage[1] + 2*numSpatialDofs[1]);
+    ASSERT_EQ(slice(1), -1.);
+}
+
+// End of file
@@ -0,0 +1,338 @@
+#include <gtest/gtest.h>
+
+#include "mfem.hpp"
+using namespace mfem;
+
+#include <iostream>
+
+#include "../src/core/config.hpp"
+#include "../src/mymfem/utilities.hpp"
+#include "../src/pardiso/pardiso.hpp"
+#include "../src/heat/assembly.hpp"
+#include "../src/heat/temporal_operators.hpp"
+#include "../src/heat/kronecker_ordering.hpp"
+
+
+namespace {
+
+//! Returns the max-norm of the difference of A and the banded operator
+double evalDiff (const SparseMatrix& A,
+                 const heat::BandedTemporalOperator& op)
+{
+    double diff = 0;
+    for (int i=0; i<A.Height(); i++)
+        for (int j=0; j<A.Width(); j++) {
+            diff = std::max(diff, std::abs(A.Elem(i,j) - op.elem(i,j)));
+        }
+    return diff;
+}
+
+SparseMatrix* assembleWithBilinearForm (FiniteElementSpace& fes,
+                                        BilinearFormIntegrator *bfi)
+{
+    BilinearForm form(&fes);
+    form.AddDomainIntegrator(bfi);
+    form.Assemble();
+    form.Finalize();
+    return form.LoseMat();
+}
+
+}
+
+/**
+ * @brief Compares the banded temporal matrices
+ * with the BilinearForm assembly, for different degrees
+ */
+TEST(BandedTemporalOperator, compareWithBilinearForms)
+{
+    double endTime = 2.;
+    int Nt = 8;
+    double tol = 1E-12;
+
+    for (int deg=1; deg<=3; deg++)
+    {
+        Mesh mesh(Nt, endTime);
+        H1_FECollection feColl(deg, 1, BasisType::GaussLobatto);
+        FiniteElementSpace fes(&mesh, &feColl);
+
+        auto mass = heat::assembleBandedTemporalMass(fes);
+        auto stiffness = heat::assembleBandedTemporalStiffness(fes);
+        auto gradient = heat::assembleBandedTemporalGradient(fes);
+        ASSERT_EQ(mass->getBandwidth(), deg);
+
+        std::unique_ptr<SparseMatrix> massMat
+                (assembleWithBilinearForm(fes, new MassIntegrator));
+        std::unique_ptr<SparseMatrix> stiffnessMat
+                (assembleWithBilinearForm(fes, new DiffusionIntegrator));
+        std::unique_ptr<SparseMatrix> gradientMat
+                (assembleWithBilinearForm
+                 (fes, new heat::TemporalGradientIntegrator));
+
+        ASSERT_LE(evalDiff(*massMat, *mass), tol);
+        ASSERT_LE(evalDiff(*stiffnessMat, *stiffness), tol);
+        ASSERT_LE(evalDiff(*gradientMat, *gradient), tol);
+
+        // the structural zeros, e.g. the interior diagonal
+        // of the gradient, stay in the pattern
+        SparseMatrix identity(1);
+        identity.Set(0, 0, 1.);
+        identity.Finalize();
+        std::unique_ptr<SparseMatrix> gradientSpMat
+                (gradient->getSparseMatrix());
+        std::unique_ptr<SparseMatrix> gradientKronMat
+                (gradient->kroneckerProduct(identity));
+        ASSERT_EQ(gradientSpMat->NumNonZeroElems(),
+                  gradientKronMat->NumNonZeroElems());
+
+        std::unique_ptr<SparseMatrix> gradientMatT(Transpose(*gradientMat));
+        ASSERT_LE(evalDiff(*gradientMatT, *gradient->transpose()), tol);
+
+        // matvec
+        Vector x(fes.GetVSize()), y1(fes.GetVSize()), y2(fes.GetVSize());
+        x.Randomize(1);
+        gradientMat->Mult(x, y1);
+        gradient->Mult(x, y2);
+        y1 -= y2;
+        ASSERT_LE(y1.Normlinf(), tol);
+
+        gradientMat->MultTranspose(x, y1);
+        gradient->MultTranspose(x, y2);
+        y1 -= y2;
+        ASSERT_LE(y1.Normlinf(), tol);
+    }
+}
+
+/**
+ * @brief Tests the banded LU solve
+ */
+TEST(BandedTemporalOperator, solve)
+{
+    Mesh mesh(16, 1.);
+    H1_FECollection feColl(3, 1, BasisType::GaussLobatto);
+    FiniteElementSpace fes(&mesh, &feColl);
+
+    auto op = heat::assembleBandedTemporalStiffness(fes);
+    op->add(*heat::assembleBandedTemporalInitial(fes));
+    op->factorize();
+
+    Vector xTrue(fes.GetVSize()), b(fes.GetVSize()), x(fes.GetVSize());
+    xTrue.Randomize(1);
+    op->Mult(xTrue, b);
+    op->solve(b, x);
+    x -= xTrue;
+    ASSERT_LE(x.Normlinf(), 1E-10);
+
+    // the stiffness alone is singular
+    auto stiffness = heat::assembleBandedTemporalStiffness(fes);
+    ASSERT_THROW(stiffness->factorize(), std::runtime_error);
+}
+
+/**
+ * @brief Compares the Kronecker construction and application
+ * with MFEM's OuterProduct
+ */
+TEST(BandedTemporalOperator, kroneckerProduct)
+{
+    Mesh tMesh(4, 1.);
+    H1_FECollection tFeColl(2, 1, BasisType::GaussLobatto);
+    FiniteElementSpace tFes(&tMesh, &tFeColl);
+
+    Mesh xMesh(3, 3, Element::TRIANGLE);
+    H1_FECollection xFeColl(1, 2);
+    FiniteElementSpace xFes(&xMesh, &xFeColl);
+    std::unique_ptr<SparseMatrix> xMat
+            (assembleWithBilinearForm(xFes, new DiffusionIntegrator));
+
+    auto gradient = heat::assembleBandedTemporalGradient(tFes);
+    std::unique_ptr<SparseMatrix> tMat(gradient->getSparseMatrix());
+
+    std::unique_ptr<SparseMatrix> kronMatTrue(OuterProduct(*tMat, *xMat));
+    std::unique_ptr<SparseMatrix> kronMat(gradient->kroneckerProduct(*xMat));
+    ASSERT_TRUE(kronMat->ColumnsAreSorted());
+
+    std::unique_ptr<SparseMatrix> diff(Add(1, *kronMat, -1, *kronMatTrue));
+    ASSERT_LE(diff->MaxNorm(), 1E-12);
+
+    heat::BandedKroneckerOperator kronOp(*gradient, *xMat);
+    Vector x(kronOp.Width()), y1(kronOp.Height()), y2(kronOp.Height());
+    x.Randomize(1);
+    kronMatTrue->Mult(x, y1);
+    kronOp.Mult(x, y2);
+    y1 -= y2;
+    ASSERT_LE(y1.Normlinf(), 1E-12);
+}
+
+/**
+ * @brief Tests the nested dissections of the time axis and of the
+ * spatial graph, and their tensor-product combination
+ */
+TEST(BandedTemporalOperator, kroneckerOrdering)
+{
+    int Nt = 5;
+    Mesh tMesh(Nt, 1.);
+    H1_FECollection tFeColl(2, 1, BasisType::GaussLobatto);
+    FiniteElementSpace tFes(&tMesh, &tFeColl);
+
+    // the vertex dofs are the vertices, the middle one separates last
+    auto stiffness = heat::assembleBandedTemporalStiffness(tFes);
+    Array<int> temporalOrdering = stiffness->getNestedDissectionOrdering();
+    int tdim = tFes.GetVSize();
+    ASSERT_EQ(temporalOrdering.Size(), tdim);
+    ASSERT_EQ(temporalOrdering.Last(), Nt/2);
+
+    std::vector<int> temporalRanks(tdim, -1);
+    for (int k=0; k<tdim; k++) {
+        ASSERT_EQ(temporalRanks[temporalOrdering[k]], -1);
+        temporalRanks[temporalOrdering[k]] = k;
+    }
+
+    Mesh xMesh(3, 3, Element::TRIANGLE);
+    H1_FECollection xFeColl(1, 2);
+    FiniteElementSpace xFes(&xMesh, &xFeColl);
+    std::unique_ptr<SparseMatrix> xMat
+            (assembleWithBilinearForm(xFes, new DiffusionIntegrator));
+    int xdim = xMat->Height();
+
+    std::unique_ptr<SparseMatrix> kronMat
+            (stiffness->kroneckerProduct(*xMat));
+    Array<int> blockOffsets(2);
+    blockOffsets[0] = 0;
+    blockOffsets[1] = kronMat->Height();
+
+    // the spatial graph has the pattern of the spatial matrix
+    std::unique_ptr<SparseMatrix> graph
+            (heat::buildSpatialGraph(*kronMat, blockOffsets, tdim));
+    ASSERT_EQ(graph->Height(), xdim);
+    ASSERT_EQ(graph->NumNonZeroElems(),
+              (xMat->NumNonZeroElems() + xdim)/2);
+
+    // the separators of the spatial tree disconnect their subtrees
+    auto spatialTree = heat::dissectGraph(*graph, 2);
+    ASSERT_EQ(spatialTree.getOrdering().Size(), xdim);
+    std::vector<int> side(xdim);
+    for (const auto& node : spatialTree.nodes)
+    {
+        if (node.isLeaf()) { continue; }
+        std::vector<int> leftDofs, rightDofs;
+        spatialTree.gatherDofs(node.left, leftDofs);
+        spatialTree.gatherDofs(node.right, rightDofs);
+        ASSERT_FALSE(leftDofs.empty());
+        ASSERT_FALSE(rightDofs.empty());
+
+        std::fill(side.begin(), side.end(), 0);
+        for (int u : leftDofs) { side[u] = -1; }
+        for (int v : rightDofs) {
+            Array<int> cols;
+            Vector vals;
+            xMat->GetRow(v, cols, vals);
+            for (int k=0; k<cols.Size(); k++) {
+                ASSERT_NE(side[cols[k]], -1);
+            }
+        }
+    }
+
+    auto perm = heat::buildKroneckerOrdering
+            (blockOffsets, stiffness->getNestedDissectionTree(),
+             spatialTree);
+    int numDofs = tdim*xdim;
+    ASSERT_EQ(static_cast<int>(perm.size()), numDofs);
+    std::vector<bool> isTaken(numDofs, false);
+    for (int k : perm) {
+        ASSERT_TRUE(k >= 0 && k < numDofs);
+        ASSERT_FALSE(isTaken[k]);
+        isTaken[k] = true;
+    }
+
+    // the slice of the middle vertex is the top separator, while
+    // the slice of a boundary vertex is split by spatial separators
+    int minRank = numDofs, maxRank = -1;
+    for (int a=0; a<xdim; a++)
+    {
+        ASSERT_GE(perm[(Nt/2)*xdim + a], numDofs - xdim);
+        minRank = std::min(minRank, perm[a]);
+        maxRank = std::max(maxRank, perm[a]);
+    }
+    ASSERT_GT(maxRank - minRank, xdim-1);
+}
+
+/**
+ * @brief Compares the nonzeros in the factors of a space-time matrix
+ * with the tensor-product nested dissection, the METIS ordering
+ * and the elimination of whole time slices
+ */
+TEST(BandedTemporalOperator, kroneckerOrderingFill)
+{
+    int Nt = 32;
+    Mesh tMesh(Nt, 1.);
+    H1_FECollection tFeColl(1, 1);
+    FiniteElementSpace tFes(&tMesh, &tFeColl);
+    auto tMass = heat::assembleBandedTemporalMass(tFes);
+    auto tStiffness = heat::assembleBandedTemporalStiffness(tFes);
+    int tdim = tFes.GetVSize();
+
+    Mesh xMesh(16, 16, Element::QUADRILATERAL);
+    H1_FECollection xFeColl(1, 2);
+    FiniteElementSpace xFes(&xMesh, &xFeColl);
+    std::unique_ptr<SparseMatrix> xMass
+            (assembleWithBilinearForm(xFes, new MassIntegrator));
+    std::unique_ptr<SparseMatrix> xStiffness
+            (assembleWithBilinearForm(xFes, new DiffusionIntegrator));
+    int xdim = xMass->Height();
+
+    // symmetric positive definite space-time matrix
+    std::unique_ptr<SparseMatrix> mat1
+            (tStiffness->kroneckerProduct(*xMass));
+    std::unique_ptr<SparseMatrix> mat2
+            (tMass->kroneckerProduct(*xStiffness));
+    std::unique_ptr<SparseMatrix> mat(Add(*mat1, *mat2));
+    std::unique_ptr<SparseMatrix> upper(&getUpperTriangle(*mat));
+    Array<int> blockOffsets(2);
+    blockOffsets[0] = 0;
+    blockOffsets[1] = upper->Height();
+
+    std::unique_ptr<SparseMatrix> graph
+            (heat::buildSpatialGraph(*upper, blockOffsets, tdim));
+    auto spatialTree = heat::dissectGraph(*graph);
+    auto kronPerm = heat::buildKroneckerOrdering
+            (blockOffsets, tStiffness->getNestedDissectionTree(),
+             spatialTree);
+
+    // whole slices in the temporal ordering,
+    // the dofs within a slice in the spatial one
+    Array<int> temporalOrdering = tStiffness->getNestedDissectionOrdering();
+    Array<int> spatialOrdering = spatialTree.getOrdering();
+    std::vector<int> slicePerm(tdim*xdim);
+    for (int k=0; k<tdim; k++) {
+        for (int l=0; l<xdim; l++) {
+            slicePerm[temporalOrdering[k]*xdim + spatialOrdering[l]]
+                    = k*xdim + l;
+        }
+    }
+
+    // METIS if no permutation is given
+    auto countFactorNonzeros = [&](const std::vector<int> *perm) {
+        int mtype = 2;
+        PardisoSolver pardisoSolver(mtype);
+        if (perm) {
+            pardisoSolver.setPermutation(*perm);
+        }
+        pardisoSolver.initialize(upper->Size(), upper->GetI(),
+                                 upper->GetJ(), upper->GetData());
+        pardisoSolver.computeOrdering();
+        int nnz = pardisoSolver.getStats().factorNonzeros;
+        pardisoSolver.finalize();
+        return nnz;
+    };
+    int metisNnz = countFactorNonzeros(nullptr);
+    int kronNnz = countFactorNonzeros(&kronPerm);
+    int sliceNnz = countFactorNonzeros(&slicePerm);
+    std::cout << "Nonzeros in the factors, METIS: " << metisNnz
+              << ", tensor-product nested dissection: " << kronNnz
+              << ", time slices: " << sliceNnz << std::endl;
+
+    ASSERT_GT(metisNnz, 0);
+    ASSERT_LT(kronNnz, sliceNnz);
+    ASSERT_LE(kronNnz, 1.5*metisNnz);
+}
+
+// End of file
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "mfem.hpp"
+using namespace mfem;
+
+#include <iostream>
+
+#include "../src/heat/utilities.hpp"
+
+
+/**
+ * @brief Compares the batched reconstruction of the time slices
+ * with the reconstruction of one slice at a time
+ */
+TEST(HeatUtilities, buildSolutionsAtSpecifiedTimes)
+{
+    int numTemporalEls = 8;
+    int spatialSize = 37;
+    double endTime = 2.;
+    double tol = 1E-12;
+
+    Mesh temporalMesh(numTemporalEls, endTime);
+    for (int deg=1; deg<=2; deg++)
+    {
+        auto fec = new H1_FECollection(deg, 1);
+        FiniteElementSpace temporalFes(&temporalMesh, fec);
+
+        Vector spaceTimeSolution(spatialSize*temporalFes.GetTrueVSize());
+        spaceTimeSolution.Randomize(deg);
+
+        int order = 2*deg+1;
+        TemporalShapeTable table(&temporalFes, order);
+        int nq = table.getNumPoints();
+
+        DenseMatrix shapesAndGradients;
+        Vector times, weights;
+        Array<int> vdofs;
+        DenseMatrix solutions(spatialSize, 2*nq);
+
+        Vector shape, solution(spatialSize), trueSolution(spatialSize);
+        DenseMatrix dshape;
+        Vector grad;
+        for (int n=0; n<temporalMesh.GetNE(); n++)
+        {
+            temporalFes.GetElementVDofs(n, vdofs);
+            table.evalOnElement(n, shapesAndGradients, times, weights);
+            buildSolutionsAtSpecifiedTimes(spaceTimeSolution,
+                                           shapesAndGradients,
+                                           vdofs, solutions);
+
+            const FiniteElement *fe = temporalFes.GetFE(n);
+            ElementTransformation *trans
+                    = temporalFes.GetElementTransformation(n);
+            const IntegrationRule &ir
+                    = IntRules.Get(fe->GetGeomType(), order);
+            shape.SetSize(fe->GetDof());
+            dshape.SetSize(fe->GetDof(), 1);
+            for (int i=0; i<nq; i++)
+            {
+                const IntegrationPoint &ip = ir.IntPoint(i);
+                trans->SetIntPoint(&ip);
+                EXPECT_NEAR(weights(i), ip.weight*trans->Weight(), tol);
+
+                fe->CalcShape(ip, shape);
+                buildSolutionAtSpecifiedTime(spaceTimeSolution, shape,
+                                             vdofs, trueSolution);
+                solutions.GetColumn(i, solution);
+                solution -= trueSolution;
+                EXPECT_LE(solution.Normlinf(), tol);
+
+                fe->CalcPhysDShape(*trans, dshape);
+                dshape.GetColumnReference(0, grad);
+                buildSolutionAtSpecifiedTime(spaceTimeSolution, grad,
+                                             vdofs, trueSolution);
+                solutions.GetColumn(nq+i, solution);
+                solution -= trueSolution;
+                EXPECT_LE(solution.Normlinf(), tol*numTemporalEls);
+            }
+        }
+    }
+}
+
+// End of file
@@ -196,3 +196,70 @@ TEST(MfemUtil, pointLocator2)
               << "\t slow  " << duration1.count()
               << "\t fast  " << duration2.count() << std::endl;
 }
+
+/** @brief Unit test for point locator algorithm
+ * Test the batched point location of class PointLocator
+ * for meshes with local refinement; the points outside the mesh
+ * are not located.
+ */
+TEST(MfemUtil, pointLocatorBatched)
+{
+    std::string input_dir
+            = "../tests/input/gammaShapedBr/";
+
+    const std::string mesh_file1 = input_dir+"mesh_lx1";
+    const std::string mesh_file2 = input_dir+"mesh_lx6";
+
+    Mesh mesh1(mesh_file1.c_str());
+    Mesh mesh2(mesh_file2.c_str());
+    int dim = mesh1.Dimension();
+
+    // quadrature points of all elements of the coarse mesh,
+    // and one point outside
+    const IntegrationRule *ir = &IntRules.Get(2, 3);
+    int numPoints = mesh1.GetNE()*ir->GetNPoints() + 1;
+    DenseMatrix true_x(dim, numPoints);
+    Vector xk;
+    for (int i=0; i<mesh1.GetNE(); i++)
+    {
+        ElementTransformation *trans1 = mesh1.GetElementTransformation(i);
+        for (int k=0; k<ir->GetNPoints(); k++) {
+            true_x.GetColumnReference(i*ir->GetNPoints() + k, xk);
+            trans1->Transform(ir->IntPoint(k), xk);
+        }
+    }
+    for (int d=0; d<dim; d++) {
+        true_x(d, numPoints-1) = 1E3;
+    }
+
+    Array <int> elIds(numPoints);
+    Array <IntegrationPoint> ips(numPoints);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    PointLocator point_locator(&mesh2);
+    point_locator.locate(true_x, elIds, ips);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    ASSERT_EQ(elIds[numPoints-1], -1);
+
+    Vector x2, x;
+    double TOL = 1E-8;
+    for (int k=0; k < numPoints-1; k++)
+    {
+        ASSERT_GE(elIds[k], 0);
+        ElementTransformation *trans2
+                = mesh2.GetElementTransformation(elIds[k]);
+        trans2->Transform(ips[k], x2);
+
+        true_x.GetColumn(k,x);
+
+        Vector xmx2(x.Size());
+        subtract(x, x2, xmx2);
+        ASSERT_LE(xmx2.Norml1(), TOL);
+    }
+
+    auto duration = std::chrono::duration_cast
+            <std::chrono::microseconds>(end - start);
+    std::cout << "Run time for " << numPoints << " points: "
+              << duration.count() << std::endl;
+}
@@ -9,6 +9,7 @@ using namespace mfem;
 #include "../src/core/config.hpp"
 #include "../src/mymfem/nested_hierarchy.hpp"
 #include "../src/mymfem/my_bilinearForms.hpp"
+#include "../src/sparse_heat/spatial_assembly.hpp"
 
 
 using namespace mymfem;
@@ -174,3 +175,177 @@ TEST(MyBilinearForms, BlockMixedBilinearForm)
             ASSERT_NE(&blockMatrix->GetBlock(i,j), nullptr);
         }
 }
+
+
+//! Loads the nested hierarchy of three 2D meshes
+static std::shared_ptr<NestedMeshHierarchy> loadMeshHierarchy()
+{
+    std::string input_dir
+            = "../tests/input/nested_hierarchy/2d/";
+
+    std::shared_ptr<NestedMeshHierarchy> meshHierarchy
+            = std::make_shared<NestedMeshHierarchy>();
+    for (int i=0; i<3; i++) {
+        const std::string meshFile = input_dir+"mesh_lx"+std::to_string(i);
+        meshHierarchy->addMesh(std::make_shared<Mesh>(meshFile.c_str()));
+    }
+    meshHierarchy->finalize();
+    return meshHierarchy;
+}
+
+//! Checks that the blocks of two block matrices coincide
+static void checkBlocks(BlockMatrix& A, BlockMatrix& B)
+{
+    for(int i=0; i<A.NumRowBlocks(); i++)
+        for (int j=0; j<A.NumColBlocks(); j++)
+        {
+            std::unique_ptr<SparseMatrix> diff
+                    (Add(1, A.GetBlock(i,j), -1, B.GetBlock(i,j)));
+            ASSERT_LE(diff->MaxNorm(), 1E-12);
+        }
+}
+
+/**
+ * @brief Tests that the cross-level blocks formed with prolongations
+ * match the ones assembled with quadrature on the fine elements
+ */
+TEST(MyBilinearForms, crossLevelAssembly)
+{
+    auto meshHierarchy = loadMeshHierarchy();
+    auto meshes = meshHierarchy->getMeshes();
+
+    int dim = meshes[0]->Dimension();
+    auto feCollH1 = std::make_unique<H1_FECollection>
+            (1, dim, BasisType::GaussLobatto);
+    auto feCollRT = std::make_unique<RT_FECollection>(0, dim);
+    std::shared_ptr<NestedFEHierarchy> nestedFEHierarchyH1
+            = std::make_shared<NestedFEHierarchy> (meshHierarchy);
+    std::shared_ptr<NestedFEHierarchy> nestedFEHierarchyRT
+            = std::make_shared<NestedFEHierarchy> (meshHierarchy);
+    for (auto& mesh : meshes) {
+        nestedFEHierarchyH1->addFESpace
+                (std::make_shared<FiniteElementSpace>(mesh.get(),
+                                                      feCollH1.get()));
+        nestedFEHierarchyRT->addFESpace
+                (std::make_shared<FiniteElementSpace>(mesh.get(),
+                                                      feCollRT.get()));
+    }
+
+    // symmetric forms
+    auto assembleMassAndStiffness = [&](CrossLevelAssembly mode)
+    {
+        auto form = std::make_unique<BlockBilinearForm>(nestedFEHierarchyH1);
+        std::shared_ptr<BlockBilinearFormIntegrator> massIntegrator
+                = std::make_shared<sparseHeat::SpatialMassIntegrator>();
+        std::shared_ptr<BlockBilinearFormIntegrator> stiffnessIntegrator
+                = std::make_shared<sparseHeat::SpatialStiffnessIntegrator>();
+        form->addDomainIntegrator(massIntegrator);
+        form->addDomainIntegrator(stiffnessIntegrator);
+        form->setCrossLevelAssembly(mode);
+        form->assemble();
+        return form->getBlockMatrix();
+    };
+    auto A1 = assembleMassAndStiffness(CrossLevelAssembly::quadrature);
+    auto A2 = assembleMassAndStiffness(CrossLevelAssembly::prolongation);
+    checkBlocks(*A1, *A2);
+
+    // mixed forms
+    auto assembleDivergence = [&](CrossLevelAssembly mode)
+    {
+        auto form = std::make_unique<BlockMixedBilinearForm>
+                (nestedFEHierarchyRT, nestedFEHierarchyH1);
+        std::shared_ptr<BlockMixedBilinearFormIntegrator> integrator
+                = std::make_shared
+                <sparseHeat::SpatialVectorFEDivergenceIntegrator>();
+        form->addDomainIntegrator(integrator);
+        form->setCrossLevelAssembly(mode);
+        form->assemble();
+        return form->getBlockMatrix();
+    };
+    auto B1 = assembleDivergence(CrossLevelAssembly::quadrature);
+    auto B2 = assembleDivergence(CrossLevelAssembly::prolongation);
+    checkBlocks(*B1, *B2);
+}
+
+
+/**
+ * @brief Tests the cross-level assembly with prolongations
+ * for vector-valued H1 spaces, as used by the H1H1 formulation
+ */
+TEST(MyBilinearForms, crossLevelAssemblyVectorH1)
+{
+    auto meshHierarchy = loadMeshHierarchy();
+    auto meshes = meshHierarchy->getMeshes();
+
+    int dim = meshes[0]->Dimension();
+    auto feCollH1 = std::make_unique<H1_FECollection>
+            (1, dim, BasisType::GaussLobatto);
+    std::shared_ptr<NestedFEHierarchy> nestedFEHierarchyH1
+            = std::make_shared<NestedFEHierarchy> (meshHierarchy);
+    std::shared_ptr<NestedFEHierarchy> nestedFEHierarchyVectorH1
+            = std::make_shared<NestedFEHierarchy> (meshHierarchy);
+    for (auto& mesh : meshes) {
+        nestedFEHierarchyH1->addFESpace
+                (std::make_shared<FiniteElementSpace>(mesh.get(),
+                                                      feCollH1.get()));
+        nestedFEHierarchyVectorH1->addFESpace
+                (std::make_shared<FiniteElementSpace>(mesh.get(),
+                                                      feCollH1.get(),
+                                                      dim));
+    }
+
+    // symmetric forms
+    auto assembleMassAndStiffness = [&](CrossLevelAssembly mode)
+    {
+        auto form = std::make_unique<BlockBilinearForm>
+                (nestedFEHierarchyVectorH1);
+        std::shared_ptr<BlockBilinearFormIntegrator> massIntegrator
+                = std::make_shared<sparseHeat::SpatialVectorMassIntegrator>();
+        std::shared_ptr<BlockBilinearFormIntegrator> stiffnessIntegrator
+                = std::make_shared
+                <sparseHeat::SpatialVectorStiffnessIntegrator>();
+        form->addDomainIntegrator(massIntegrator);
+        form->addDomainIntegrator(stiffnessIntegrator);
+        form->setCrossLevelAssembly(mode);
+        form->assemble();
+        return form->getBlockMatrix();
+    };
+    auto A1 = assembleMassAndStiffness(CrossLevelAssembly::quadrature);
+    auto A2 = assembleMassAndStiffness(CrossLevelAssembly::prolongation);
+    checkBlocks(*A1, *A2);
+
+    // mixed forms, in both directions
+    auto assembleGradient = [&](CrossLevelAssembly mode)
+    {
+        auto form = std::make_unique<BlockMixedBilinearForm>
+                (nestedFEHierarchyH1, nestedFEHierarchyVectorH1);
+        std::shared_ptr<BlockMixedBilinearFormIntegrator> integrator
+                = std::make_shared
+                <sparseHeat::SpatialVectorGradientIntegrator>();
+        form->addDomainIntegrator(integrator);
+        form->setCrossLevelAssembly(mode);
+        form->assemble();
+        return form->getBlockMatrix();
+    };
+    auto B1 = assembleGradient(CrossLevelAssembly::quadrature);
+    auto B2 = assembleGradient(CrossLevelAssembly::prolongation);
+    checkBlocks(*B1, *B2);
+
+    auto assembleDivergence = [&](CrossLevelAssembly mode)
+    {
+        auto form = std::make_unique<BlockMixedBilinearForm>
+                (nestedFEHierarchyVectorH1, nestedFEHierarchyH1);
+        std::shared_ptr<BlockMixedBilinearFormIntegrator> integrator
+                = std::make_shared
+                <sparseHeat::SpatialVectorDivergenceIntegrator>();
+        form->addDomainIntegrator(integrator);
+        form->setCrossLevelAssembly(mode);
+        form->assemble();
+        return form->getBlockMatrix();
+    };
+    auto C1 = assembleDivergence(CrossLevelAssembly::quadrature);
+    auto C2 = assembleDivergence(CrossLevelAssembly::prolongation);
+    checkBlocks(*C1, *C2);
+}
+
+// End of file
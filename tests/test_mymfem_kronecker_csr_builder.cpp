@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include "mfem.hpp"
+using namespace mfem;
+
+#include <iostream>
+#include <memory>
+
+#include "../src/mymfem/kronecker_csr_builder.hpp"
+#include "../src/mymfem/utilities.hpp"
+
+
+namespace {
+
+SparseMatrix* assembleWithBilinearForm (FiniteElementSpace& fes,
+                                        BilinearFormIntegrator *bfi)
+{
+    BilinearForm form(&fes);
+    form.AddDomainIntegrator(bfi);
+    form.Assemble();
+    form.Finalize();
+    return form.LoseMat();
+}
+
+}
+
+/**
+ * @brief Compares the single-pass build of a 2x2 block matrix
+ * of Kronecker sums with OuterProduct and CreateMonolithic
+ */
+TEST(KroneckerCsrBuilder, compareWithOuterProduct)
+{
+    Mesh tMesh(4, 1.);
+    H1_FECollection tFeColl(1, 1);
+    FiniteElementSpace tFes(&tMesh, &tFeColl);
+    std::unique_ptr<SparseMatrix> tMass
+            (assembleWithBilinearForm(tFes, new MassIntegrator));
+    std::unique_ptr<SparseMatrix> tStiff
+            (assembleWithBilinearForm(tFes, new DiffusionIntegrator));
+
+    Mesh xMesh(3, 3, Element::TRIANGLE);
+    H1_FECollection xFeColl(1, 2);
+    FiniteElementSpace xFes(&xMesh, &xFeColl);
+    std::unique_ptr<SparseMatrix> xMass
+            (assembleWithBilinearForm(xFes, new MassIntegrator));
+    std::unique_ptr<SparseMatrix> xStiff
+            (assembleWithBilinearForm(xFes, new DiffusionIntegrator));
+
+    // A = [tM x xK + tK x xM, 2 tM x xM; 2 tM x xM, tK x xK]
+    std::unique_ptr<SparseMatrix> a1(OuterProduct(*tMass, *xStiff));
+    std::unique_ptr<SparseMatrix> a2(OuterProduct(*tStiff, *xMass));
+    auto block11 = Add(*a1, *a2);
+    auto block12 = OuterProduct(*tMass, *xMass);
+    *block12 *= 2;
+    auto block21 = new SparseMatrix(*block12);
+    auto block22 = OuterProduct(*tStiff, *xStiff);
+
+    int n = block11->NumRows();
+    Array<int> blockOffsets(3);
+    blockOffsets[0] = 0;
+    blockOffsets[1] = n;
+    blockOffsets[2] = 2*n;
+    BlockMatrix blockMat(blockOffsets);
+    blockMat.owns_blocks = true;
+    blockMat.SetBlock(0, 0, block11);
+    blockMat.SetBlock(0, 1, block12);
+    blockMat.SetBlock(1, 0, block21);
+    blockMat.SetBlock(1, 1, block22);
+    std::unique_ptr<SparseMatrix> trueMat(blockMat.CreateMonolithic());
+
+    mymfem::KroneckerCsrBuilder builder(2*n, 2*n);
+    builder.addTerm(1., *tMass, *xStiff);
+    builder.addTerm(1., *tStiff, *xMass);
+    builder.addTerm(2., *tMass, *xMass, 0, n);
+    builder.addTerm(2., *tMass, *xMass, n, 0);
+    builder.addTerm(1., *tStiff, *xStiff, n, n);
+
+    std::unique_ptr<SparseMatrix> mat(builder.build());
+    ASSERT_TRUE(mat->ColumnsAreSorted());
+    ASSERT_EQ(mat->NumNonZeroElems(), trueMat->NumNonZeroElems());
+    std::unique_ptr<SparseMatrix> diff(Add(1, *mat, -1, *trueMat));
+    ASSERT_LE(diff->MaxNorm(), 1E-12);
+
+    // upper triangle
+    std::unique_ptr<SparseMatrix> upperMat(builder.build(true));
+    std::unique_ptr<SparseMatrix> trueUpperMat
+            (&getUpperTriangle(*trueMat));
+    ASSERT_TRUE(upperMat->ColumnsAreSorted());
+    ASSERT_EQ(upperMat->NumNonZeroElems(),
+              trueUpperMat->NumNonZeroElems());
+    diff.reset(Add(1, *upperMat, -1, *trueUpperMat));
+    ASSERT_LE(diff->MaxNorm(), 1E-12);
+}
+
+// End of file
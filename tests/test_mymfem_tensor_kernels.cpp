@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include "mfem.hpp"
+using namespace mfem;
+
+#include <chrono>
+#include <iostream>
+
+#include "../src/core/config.hpp"
+#include "../src/mymfem/tensor_kernels.hpp"
+#include "../src/heat/assembly.hpp"
+
+
+using namespace mymfem;
+
+namespace {
+
+//! Returns the max-norm of A x - op x, for a random x
+double evalMatVecDiff (const SparseMatrix& A, const Operator& op)
+{
+    Vector x(op.Width()), y1(op.Height()), y2(op.Height());
+    x.Randomize(1);
+    A.Mult(x, y1);
+    op.Mult(x, y2);
+    y1 -= y2;
+    return y1.Normlinf();
+}
+
+//! Compares the partially assembled operators with the assembled ones
+void compareWithAssembly (Mesh *mesh, int order)
+{
+    int dim = mesh->Dimension();
+    double TOL = 1E-10;
+
+    H1_FECollection feColl(order, dim, BasisType::GaussLobatto);
+    FiniteElementSpace fes(mesh, &feColl);
+    FiniteElementSpace vfes(mesh, &feColl, dim);
+
+    DenseMatrix matM(dim), matMtM(dim);
+    matM = 0.;
+    for (int i=0; i<dim; i++) {
+        matM(i,i) = 1.+i;
+        if (i+1 < dim) { matM(i,i+1) = 0.25; }
+    }
+    MultAtB(matM, matM, matMtM);
+    MatrixConstantCoefficient mCoeff(matM);
+    MatrixConstantCoefficient mtmCoeff(matMtM);
+
+    // mass
+    BilinearForm massForm(&fes);
+    massForm.AddDomainIntegrator(new MassIntegrator);
+    massForm.Assemble();
+    massForm.Finalize();
+    auto massOp = makeTensorMassOperator(&fes);
+    ASSERT_TRUE(massOp != nullptr);
+    ASSERT_LE(evalMatVecDiff(massForm.SpMat(), *massOp), TOL);
+
+    // stiffness
+    BilinearForm stiffnessForm(&fes);
+    stiffnessForm.AddDomainIntegrator(new DiffusionIntegrator(mtmCoeff));
+    stiffnessForm.Assemble();
+    stiffnessForm.Finalize();
+    auto stiffnessOp = makeTensorStiffnessOperator(&fes, &mCoeff);
+    ASSERT_TRUE(stiffnessOp != nullptr);
+    ASSERT_LE(evalMatVecDiff(stiffnessForm.SpMat(), *stiffnessOp), TOL);
+
+    // gradient
+    MixedBilinearForm gradientForm(&fes, &vfes);
+    gradientForm.AddDomainIntegrator
+            (new heat::SpatialVectorGradientIntegrator(&mCoeff));
+    gradientForm.Assemble();
+    gradientForm.Finalize();
+    auto gradientOp = makeTensorGradientOperator(&fes, &vfes, &mCoeff);
+    ASSERT_TRUE(gradientOp != nullptr);
+    ASSERT_LE(evalMatVecDiff(gradientForm.SpMat(), *gradientOp), TOL);
+}
+
+}
+
+/**
+ * @brief Compares the sum-factorized operators
+ * with the assembled matrices on quad and hex meshes
+ */
+TEST(TensorKernels, compareWithAssembly)
+{
+    Mesh quadMesh(4, 4, Element::QUADRILATERAL);
+    compareWithAssembly(&quadMesh, 1);
+    compareWithAssembly(&quadMesh, 2);
+    compareWithAssembly(&quadMesh, 4);
+
+    Mesh hexMesh(3, 3, 3, Element::HEXAHEDRON);
+    compareWithAssembly(&hexMesh, 1);
+    compareWithAssembly(&hexMesh, 3);
+}
+
+/**
+ * @brief Tests that triangular meshes are not supported
+ */
+TEST(TensorKernels, unsupportedMesh)
+{
+    Mesh triMesh(4, 4, Element::TRIANGLE);
+    H1_FECollection feColl(2, 2, BasisType::GaussLobatto);
+    FiniteElementSpace fes(&triMesh, &feColl);
+
+    ASSERT_FALSE(hasTensorKernelSupport(fes));
+    ASSERT_TRUE(makeTensorMassOperator(&fes) == nullptr);
+}
+
+/**
+ * @brief Tests the Kronecker product operator
+ * against the assembled Kronecker product
+ */
+TEST(TensorKernels, kroneckerOperator)
+{
+    Mesh quadMesh(4, 4, Element::QUADRILATERAL);
+    H1_FECollection feColl(2, 2, BasisType::GaussLobatto);
+    FiniteElementSpace fes(&quadMesh, &feColl);
+
+    BilinearForm massForm(&fes);
+    massForm.AddDomainIntegrator(new MassIntegrator);
+    massForm.Assemble();
+    massForm.Finalize();
+    auto massOp = makeTensorMassOperator(&fes);
+
+    Mesh tMesh(5, 1.);
+    H1_FECollection tFeColl(1, 1);
+    FiniteElementSpace tFes(&tMesh, &tFeColl);
+    BilinearForm tStiffnessForm(&tFes);
+    tStiffnessForm.AddDomainIntegrator(new DiffusionIntegrator);
+    tStiffnessForm.Assemble();
+    tStiffnessForm.Finalize();
+
+    std::unique_ptr<SparseMatrix> kronMat
+            (OuterProduct(tStiffnessForm.SpMat(), massForm.SpMat()));
+    KroneckerOperator kronOp(tStiffnessForm.SpMat(), *massOp);
+
+    ASSERT_LE(evalMatVecDiff(*kronMat, kronOp), 1E-10);
+}
+
+/**
+ * @brief Times the matrix-based against the sum-factorized
+ * stiffness operator, setup and applications;
+ * the timings are only printed, so it is disabled by default,
+ * run it with --gtest_also_run_disabled_tests
+ */
+TEST(TensorKernels, DISABLED_benchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto elapsed = [](Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now()-start).count();
+    };
+
+    int numMatVecs = 20;
+    for (int dim=2; dim<=3; dim++)
+    {
+        std::unique_ptr<Mesh> mesh;
+        if (dim == 2) {
+            mesh = std::make_unique<Mesh>(64, 64, Element::QUADRILATERAL);
+        } else {
+            mesh = std::make_unique<Mesh>(12, 12, 12, Element::HEXAHEDRON);
+        }
+
+        for (int order=1; order<=4; order++)
+        {
+            H1_FECollection feColl(order, dim, BasisType::GaussLobatto);
+            FiniteElementSpace fes(mesh.get(), &feColl);
+            Vector x(fes.GetVSize()), y(fes.GetVSize());
+            x.Randomize(1);
+
+            auto start = Clock::now();
+            BilinearForm stiffnessForm(&fes);
+            stiffnessForm.AddDomainIntegrator(new DiffusionIntegrator);
+            stiffnessForm.Assemble();
+            stiffnessForm.Finalize();
+            double assemblyTime = elapsed(start);
+
+            start = Clock::now();
+            for (int k=0; k<numMatVecs; k++) {
+                stiffnessForm.SpMat().Mult(x, y);
+            }
+            double matVecTime = elapsed(start);
+
+            start = Clock::now();
+            auto stiffnessOp = makeTensorStiffnessOperator(&fes);
+            double setupTime = elapsed(start);
+
+            start = Clock::now();
+            for (int k=0; k<numMatVecs; k++) {
+                stiffnessOp->Mult(x, y);
+            }
+            double paMatVecTime = elapsed(start);
+
+            std::cout << "dim " << dim << ", order " << order
+                      << ", ndofs " << fes.GetVSize()
+                      << "\n\tassembled: setup " << assemblyTime
+                      << " s, " << numMatVecs << " matvecs "
+                      << matVecTime << " s"
+                      << "\n\tsum-factorized: setup " << setupTime
+                      << " s, " << numMatVecs << " matvecs "
+                      << paMatVecTime << " s" << std::endl;
+        }
+    }
+}
+
+// End of file
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include "mfem.hpp"
+using namespace mfem;
+
+#include "../src/core/config.hpp"
+#include "../src/mymfem/threaded_assembly.hpp"
+
+
+using namespace mymfem;
+
+/**
+ * @brief Tests that elements of the same colour share no dofs
+ */
+TEST(ThreadedAssembly, elementColoring)
+{
+    std::string input_dir
+            = "../tests/input/nested_hierarchy/2d/";
+    const std::string meshFile = input_dir+"mesh_lx2";
+    auto mesh = std::make_shared<Mesh>(meshFile.c_str());
+    mesh->UniformRefinement();
+
+    int dim = mesh->Dimension();
+    H1_FECollection feColl(2, dim, BasisType::GaussLobatto);
+    FiniteElementSpace fes(mesh.get(), &feColl);
+
+    ElementColoring coloring(fes);
+
+    int numElements = 0;
+    Array<int> dofMarker(fes.GetVSize());
+    Array<int> vdofs;
+    for (int c=0; c<coloring.getNumColors(); c++)
+    {
+        dofMarker = -1;
+        const int *elIds = coloring.getElements(c);
+        for (int k=0; k<coloring.getNumElements(c); k++)
+        {
+            fes.GetElementVDofs(elIds[k], vdofs);
+            for (int l=0; l<vdofs.Size(); l++) {
+                ASSERT_NE(dofMarker[vdofs[l]], c);
+                dofMarker[vdofs[l]] = c;
+            }
+        }
+        numElements += coloring.getNumElements(c);
+    }
+    ASSERT_EQ(numElements, mesh->GetNE());
+}
+
+/**
+ * @brief Compares the threaded assembly of square and mixed forms
+ * with the serial MFEM assembly
+ */
+TEST(ThreadedAssembly, compareWithBilinearForms)
+{
+    std::string input_dir
+            = "../tests/input/nested_hierarchy/2d/";
+    const std::string meshFile = input_dir+"mesh_lx2";
+    auto mesh = std::make_shared<Mesh>(meshFile.c_str());
+    mesh->UniformRefinement();
+    mesh->UniformRefinement();
+
+    int dim = mesh->Dimension();
+    H1_FECollection h1Coll(2, dim, BasisType::GaussLobatto);
+    RT_FECollection rtColl(1, dim);
+    FiniteElementSpace h1Fes(mesh.get(), &h1Coll);
+    FiniteElementSpace rtFes(mesh.get(), &rtColl);
+
+    double TOL = 1E-12;
+
+    // square form
+    BilinearForm stiffnessForm(&h1Fes);
+    stiffnessForm.AddDomainIntegrator(new DiffusionIntegrator);
+    stiffnessForm.Assemble();
+    stiffnessForm.Finalize();
+
+    ThreadedAssembler stiffnessAssembler(&h1Fes);
+    std::unique_ptr<SparseMatrix> stiffnessMat(stiffnessAssembler.assemble
+            ([]() { return new DiffusionIntegrator; }));
+
+    stiffnessMat->Add(-1, stiffnessForm.SpMat());
+    ASSERT_LE(stiffnessMat->MaxNorm(), TOL);
+
+    // mixed form, with signed Raviart-Thomas dofs
+    MixedBilinearForm divForm(&rtFes, &h1Fes);
+    divForm.AddDomainIntegrator(new VectorFEDivergenceIntegrator);
+    divForm.Assemble();
+    divForm.Finalize();
+
+    ThreadedAssembler divAssembler(&rtFes, &h1Fes);
+    std::unique_ptr<SparseMatrix> divMat(divAssembler.assemble
+            ([]() { return new VectorFEDivergenceIntegrator; }));
+
+    ASSERT_EQ(divMat->Height(), h1Fes.GetVSize());
+    ASSERT_EQ(divMat->Width(), rtFes.GetVSize());
+    divMat->Add(-1, divForm.SpMat());
+    ASSERT_LE(divMat->MaxNorm(), TOL);
+}
@@ -2,6 +2,9 @@
 
 #include "../src/core/config.hpp"
 #include "../src/mymfem/utilities.hpp"
+#include "../src/mymfem/data_buffer.hpp"
+
+#include <cstdint>
 
 using namespace mfem;
 
@@ -50,3 +53,45 @@ TEST(MfemUtil, getUpperTriangle)
     double TOL = 1E-8;
     ASSERT_LE(errDiagA.Normlinf(), TOL);
 }
+
+/**
+ * @brief Tests the allocation policies of the class DataBuffer
+ */
+TEST(MfemUtil, dataBuffer)
+{
+    using namespace mymfem;
+
+    int size = 1 << 20;
+    for (auto name : {"standard", "aligned",
+                      "huge_pages", "numa_interleaved"})
+    {
+        DataBuffer buf(size, parseMemoryPolicy(name));
+        ASSERT_EQ(buf.getSize(), static_cast<std::size_t>(size));
+
+        // the memory is zero-initialised
+        Vector view(buf.getData(), size);
+        ASSERT_EQ(view.Normlinf(), 0.);
+
+        if (buf.getPolicy() != MemoryPolicy::standard) {
+            auto address = reinterpret_cast<std::uintptr_t>(buf.getData());
+            ASSERT_EQ(address % 64, 0u);
+        }
+        if (buf.getPolicy() == MemoryPolicy::hugePages) {
+            auto address = reinterpret_cast<std::uintptr_t>(buf.getData());
+            ASSERT_EQ(address % (2 << 20), 0u);
+        }
+    }
+    ASSERT_THROW(parseMemoryPolicy("unknown"), std::runtime_error);
+
+    // block vectors over the buffer
+    Array<int> offsets(3);
+    offsets[0] = 0;
+    offsets[1] = 10;
+    offsets[2] = 25;
+    auto data = makeBlockVector(offsets, MemoryPolicy::aligned);
+    ASSERT_EQ(data->Size(), 25);
+    ASSERT_EQ(data->GetBlock(1).Size(), 15);
+    ASSERT_EQ(data->Normlinf(), 0.);
+    data->GetBlock(1) = 1.;
+    ASSERT_EQ(data->Sum(), 15.);
+}
@@ -54,6 +54,8 @@ TEST(NestedMeshHierarchy, singleLevel2d)
     trueHierarchicalTransformationBetweenMeshes12->add(1, 1);
     trueHierarchicalTransformationBetweenMeshes12->add(1, 5);
 
+    trueHierarchicalTransformationBetweenMeshes12->finalize();
+
     for (int i=0; i<mesh1->GetNE(); i++) {
         auto buf = (*hierarchicalTransformations[0])(i);
         auto trueBuf = (*trueHierarchicalTransformationBetweenMeshes12)(i);
@@ -83,6 +85,8 @@ TEST(NestedMeshHierarchy, singleLevel2d)
     // children of the element 5 in coarse mesh
     trueHierarchicalTransformationBetweenMeshes23->add(5, 8);
 
+    trueHierarchicalTransformationBetweenMeshes23->finalize();
+
     for (int i=0; i<mesh2->GetNE(); i++) {
         auto buf = (*hierarchicalTransformations[1])(i);
         auto trueBuf = (*trueHierarchicalTransformationBetweenMeshes23)(i);
@@ -256,6 +260,8 @@ TEST(NestedMeshHierarchy, singleLevel3d)
     trueHierarchicalTransformationBetweenMeshes12->add(0, 0);
     trueHierarchicalTransformationBetweenMeshes12->add(0, 1);
 
+    trueHierarchicalTransformationBetweenMeshes12->finalize();
+
     for (int i=0; i<mesh1->GetNE(); i++) {
         auto buf = (*hierarchicalTransformations[0])(i);
         auto trueBuf = (*trueHierarchicalTransformationBetweenMeshes12)(i);
@@ -271,6 +277,8 @@ TEST(NestedMeshHierarchy, singleLevel3d)
     // children of the element 1 in coarse mesh
     trueHierarchicalTransformationBetweenMeshes23->add(1, 0);
 
+    trueHierarchicalTransformationBetweenMeshes23->finalize();
+
     for (int i=0; i<mesh2->GetNE(); i++) {
         auto buf = (*hierarchicalTransformations[1])(i);
         auto trueBuf = (*trueHierarchicalTransformationBetweenMeshes23)(i);
@@ -348,3 +356,181 @@ TEST(NestedMeshHierarchy, multiLevel3d)
         }
     }
 }
+
+/**
+ * @brief Tests the maps of the fine reference elements
+ * into the reference elements of their ancestors,
+ * in physical coordinates, in 2d and 3d.
+ */
+TEST(NestedMeshHierarchy, childInAncestorMaps)
+{
+    for (std::string input_dir : {"../tests/input/nested_hierarchy/2d/",
+                                  "../tests/input/nested_hierarchy/3d/"})
+    {
+        std::unique_ptr<NestedMeshHierarchy> meshHierarchy
+                = std::make_unique<NestedMeshHierarchy>();
+        for (int k=0; k<3; k++) {
+            const std::string meshFile
+                    = input_dir+"mesh_lx"+std::to_string(k);
+            auto mesh = std::make_shared<Mesh>(meshFile.c_str());
+            meshHierarchy->addMesh(mesh);
+        }
+        meshHierarchy->buildHierarchicalTranformations();
+
+        auto meshes = meshHierarchy->getMeshes();
+        int dim = meshes[0]->Dimension();
+        Vector xFine(dim), xCoarse(dim);
+        IntegrationPoint ipCoarse;
+
+        double tol = 1E-12;
+        for (int fineLevel=1; fineLevel<3; fineLevel++)
+            for (int coarseLevel=0; coarseLevel<fineLevel; coarseLevel++)
+            {
+                auto fineMesh = meshes[fineLevel];
+                for (int j=0; j<fineMesh->GetNE(); j++)
+                {
+                    int i = j;
+                    for (int l=fineLevel; l>coarseLevel; l--) {
+                        i = meshHierarchy->getParentId(l, i);
+                    }
+                    auto map = meshHierarchy->getChildInAncestorMap
+                            (fineLevel, j, coarseLevel);
+
+                    auto fineTrans = fineMesh->GetElementTransformation(j);
+                    auto coarseTrans
+                            = meshes[coarseLevel]->GetElementTransformation(i);
+                    const IntegrationRule *ir = &IntRules.Get
+                            (fineMesh->GetElementBaseGeometry(j), 4);
+                    for (int q=0; q<ir->GetNPoints(); q++)
+                    {
+                        const IntegrationPoint& ip = ir->IntPoint(q);
+                        fineTrans->Transform(ip, xFine);
+                        map.transform(ip, ipCoarse);
+                        coarseTrans->Transform(ipCoarse, xCoarse);
+                        xCoarse -= xFine;
+                        ASSERT_LE(xCoarse.Normlinf(), tol);
+                    }
+                }
+            }
+    }
+}
+
+/**
+ * @brief Tests the memoized transformations across multiple levels,
+ * and the parent lookup of the CSR tables.
+ */
+TEST(NestedMeshHierarchy, memoizedTransformations)
+{
+    std::string input_dir
+            = "../tests/input/nested_hierarchy/2d/";
+
+    std::unique_ptr<NestedMeshHierarchy> meshHierarchy
+            = std::make_unique<NestedMeshHierarchy>();
+    for (int k=0; k<3; k++) {
+        const std::string meshFile = input_dir+"mesh_lx"+std::to_string(k);
+        auto mesh = std::make_shared<Mesh>(meshFile.c_str());
+        meshHierarchy->addMesh(mesh);
+    }
+    meshHierarchy->finalize();
+
+    auto hierarchicalTransformations = meshHierarchy->getTransformations();
+    auto trueTransformation
+            = buildMultiLevelMeshHierarchy(hierarchicalTransformations);
+
+    auto transformation = meshHierarchy->getTransformation(0, 2);
+    ASSERT_EQ(transformation, meshHierarchy->getTransformation(0, 2));
+    ASSERT_EQ(transformation->getNumParents(),
+              trueTransformation->getNumParents());
+    for (int i=0; i<transformation->getNumParents(); i++)
+    {
+        ASSERT_EQ((*transformation)(i), (*trueTransformation)(i));
+        for (int j : (*transformation)(i))
+        {
+            ASSERT_EQ(transformation->getParentId(j), i);
+            ASSERT_EQ(meshHierarchy->getAncestorId(2, j, 0), i);
+            ASSERT_EQ(meshHierarchy->getParentId
+                      (1, meshHierarchy->getParentId(2, j)), i);
+        }
+    }
+}
+
+
+/**
+ * @brief Tests that the hierarchy built from the refinement records
+ * matches the one built by geometric point location, in 2d and 3d,
+ * including the maps of the children into their parents.
+ */
+TEST(NestedMeshHierarchy, refinementRecords)
+{
+    for (std::string input_dir : {"../tests/input/nested_hierarchy/2d/",
+                                  "../tests/input/nested_hierarchy/3d/"})
+    {
+        const std::string meshFile = input_dir+"mesh_lx0";
+
+        std::unique_ptr<NestedMeshHierarchy> meshHierarchy
+                = std::make_unique<NestedMeshHierarchy>();
+        std::unique_ptr<NestedMeshHierarchy> trueMeshHierarchy
+                = std::make_unique<NestedMeshHierarchy>();
+
+        auto mesh = std::make_shared<Mesh>(meshFile.c_str());
+        meshHierarchy->addMesh(mesh);
+        trueMeshHierarchy->addMesh(mesh);
+        for (int k=1; k<3; k++) {
+            auto meshNew = std::make_shared<Mesh>(*mesh);
+            meshNew->UniformRefinement();
+            meshHierarchy->addUniformlyRefinedMesh(meshNew);
+            trueMeshHierarchy->addMesh(meshNew);
+            mesh = meshNew;
+        }
+        meshHierarchy->finalize();
+        trueMeshHierarchy->finalize();
+
+        // the parents are read from the records, not located
+        for (int k=1; k<3; k++) {
+            ASSERT_TRUE(meshHierarchy->hasRefinementRecords(k));
+            ASSERT_FALSE(trueMeshHierarchy->hasRefinementRecords(k));
+        }
+
+        auto transformations = meshHierarchy->getTransformations();
+        auto trueTransformations = trueMeshHierarchy->getTransformations();
+        for (int l=0; l<2; l++) {
+            ASSERT_EQ(transformations[l]->getParentIds(),
+                      trueTransformations[l]->getParentIds());
+        }
+
+        // the maps from the point matrices of the records
+        // match the ones from the inverse parent transformations
+        for (int k=1; k<3; k++) {
+            int numEls = meshHierarchy->getMeshes()[k]->GetNE();
+            for (int i=0; i<numEls; i++)
+            {
+                auto map = meshHierarchy->getChildInAncestorMap(k, i, k-1);
+                auto trueMap
+                        = trueMeshHierarchy->getChildInAncestorMap(k, i, k-1);
+                ASSERT_EQ(map.dim, trueMap.dim);
+                for (int j=0; j<9; j++) {
+                    ASSERT_NEAR(map.A[j], trueMap.A[j], 1E-12);
+                }
+                for (int j=0; j<3; j++) {
+                    ASSERT_NEAR(map.b[j], trueMap.b[j], 1E-12);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Tests that meshes which are not nested are rejected
+ */
+TEST(NestedMeshHierarchy, notNested)
+{
+    auto coarseMesh = std::make_shared<Mesh>(2, 2, Element::TRIANGLE);
+    auto fineMesh = std::make_shared<Mesh>(4, 4, Element::TRIANGLE,
+                                           false, 2., 2.);
+
+    std::unique_ptr<NestedMeshHierarchy> meshHierarchy
+            = std::make_unique<NestedMeshHierarchy>();
+    meshHierarchy->addMesh(coarseMesh);
+    meshHierarchy->addMesh(fineMesh);
+    ASSERT_THROW(meshHierarchy->finalize(), std::runtime_error);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../src/core/output_service.hpp"
+
+
+/**
+ * @brief Tests that the jobs run in submission order,
+ * and that submit blocks while the queue is full
+ */
+TEST(OutputService, orderAndBackPressure)
+{
+    int maxQueueSize = 2;
+    OutputService outputService(maxQueueSize);
+    ASSERT_TRUE(outputService.isAsynchronous());
+
+    // the first job holds the writer until released
+    std::atomic<bool> release(false);
+    std::mutex mutex;
+    std::vector<int> order;
+    outputService.submit([&]() {
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(0);
+    });
+
+    int numJobs = 6;
+    std::atomic<int> numSubmitted(1);
+    std::thread producer([&]() {
+        for (int i=1; i<numJobs; i++) {
+            outputService.submit([&, i]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(i);
+            });
+            numSubmitted++;
+        }
+    });
+
+    // the held job and a full queue stop the producer
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_LE(numSubmitted, 1 + maxQueueSize);
+
+    release = true;
+    producer.join();
+    outputService.flush();
+
+    ASSERT_EQ(static_cast<int>(order.size()), numJobs);
+    for (int i=0; i<numJobs; i++) {
+        ASSERT_EQ(order[i], i);
+    }
+}
+
+/**
+ * @brief Tests the file writer and the error propagation
+ */
+TEST(OutputService, writeFileAndErrors)
+{
+    for (int maxQueueSize : {0, 4})
+    {
+        OutputService outputService(maxQueueSize);
+
+        std::string fileName = "output_service_test.txt";
+        outputService.writeFile(fileName, [](std::ostream& file) {
+            file << "snapshot";
+        });
+        outputService.flush();
+
+        std::ifstream file(fileName);
+        std::string contents;
+        file >> contents;
+        ASSERT_EQ(contents, "snapshot");
+        std::remove(fileName.c_str());
+
+        // a failed write is an error, not only a failed open
+        auto writeToFullDisk = [&outputService]() {
+            outputService.writeFile("/dev/full", [](std::ostream& file) {
+                file << "snapshot";
+            });
+            outputService.flush();
+        };
+        std::ifstream fullDisk("/dev/full");
+        if (fullDisk.good()) {
+            ASSERT_THROW(writeToFullDisk(), std::runtime_error);
+        }
+
+        if (outputService.isAsynchronous()) {
+            outputService.submit([]() {
+                throw std::runtime_error("write failed");
+            });
+            ASSERT_THROW(outputService.flush(), std::runtime_error);
+
+            // the error is reported once
+            outputService.flush();
+        }
+        else {
+            ASSERT_THROW(outputService.submit([]() {
+                throw std::runtime_error("write failed");
+            }), std::runtime_error);
+        }
+    }
+}
+
+// End of file
@@ -3,6 +3,10 @@
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 
+#include <filesystem>
+#include <string>
+#include <vector>
+
 #include "../src/pardiso/pardiso.hpp"
 
 /**
@@ -125,3 +129,153 @@ TEST(Pardiso, symmSolver)
     double TOL = 1E-8;
     ASSERT_LE((true_x - x).norm(), TOL);
 }
+
+/**
+ * @brief Unit test for the PARDISO solver with single-precision factors
+ * and double-precision iterative refinement, for a symmetric matrix
+ */
+TEST(Pardiso, mixedPrecisionSolver)
+{
+    // CSR sparse matrix, upper triangle
+    int sizeA = 8;
+    int rowPtrA[9] = { 0, 4, 7, 9, 11, 14, 16, 17, 18 };
+    int colIdA[18] = { 0,    2,       5, 6,
+                          1, 2,    4,
+                             2,             7,
+                               3,       6,
+                                  4, 5, 6,
+                                     5,    7,
+                                        6,
+                                           7 };
+    double dataA[18] = { 7.0,      1.0,           2.0, 7.0,
+                             -4.0, 8.0,           2.0,
+                                   1.0,                     5.0,
+                                        7.0,           9.0,
+                                             5.0, -1.0, 5.0,
+                                                  0.0,      5.0,
+                                                       11.0,
+                                                             5.0 };
+
+    Eigen::SparseMatrix<double> matA(sizeA, sizeA);
+    matA.reserve(28);
+    for (int i=0; i<sizeA; i++) {
+        for (int j=rowPtrA[i]; j<rowPtrA[i+1]; j++) {
+            matA.insert(i,colIdA[j]) = dataA[j];
+            if (i != colIdA[j]) {
+                matA.insert(colIdA[j], i) = dataA[j];
+            }
+        }
+    }
+    matA.makeCompressed();
+
+    Eigen::VectorXd b(sizeA);
+    for (int i=0; i<sizeA; i++) {
+        b(i) = i+1;
+    }
+
+    Eigen::VectorXd true_x(sizeA);
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> sparselu(matA);
+    true_x = sparselu.solve(b);
+
+    int mtype = -2;
+    Eigen::VectorXd x(sizeA);
+    PardisoSolver pardisoSolver(mtype);
+    pardisoSolver.setMixedPrecision(1E-12, 20);
+    pardisoSolver.initialize(sizeA, rowPtrA, colIdA, dataA);
+    pardisoSolver.factorize();
+    pardisoSolver.solve(b.data(), x.data());
+    const PardisoStats& stats = pardisoSolver.getStats();
+    ASSERT_TRUE(stats.isMixedPrecision);
+    ASSERT_FALSE(stats.hasFallenBack);
+    ASSERT_GT(stats.numRefinementSteps, 0);
+    ASSERT_LE(stats.relativeResidual, 1E-12);
+    pardisoSolver.finalize();
+
+    // the matrix is restored
+    ASSERT_EQ(rowPtrA[0], 0);
+    ASSERT_EQ(rowPtrA[sizeA], 18);
+
+    double TOL = 1E-8;
+    ASSERT_LE((true_x - x).norm(), TOL);
+}
+
+/**
+ * @brief Unit test for the reuse of fill-reducing permutations,
+ * from a previous factorization, the file cache and the user
+ */
+TEST(Pardiso, orderingCache)
+{
+    // CSR sparse matrix, upper triangle of a 1D Laplacian
+    int sizeA = 16;
+    std::vector<int> rowPtrA(sizeA+1), colIdA;
+    std::vector<double> dataA;
+    for (int i=0; i<sizeA; i++) {
+        rowPtrA[i] = static_cast<int>(colIdA.size());
+        colIdA.push_back(i);
+        dataA.push_back(2);
+        if (i+1 < sizeA) {
+            colIdA.push_back(i+1);
+            dataA.push_back(-1);
+        }
+    }
+    rowPtrA[sizeA] = static_cast<int>(colIdA.size());
+
+    Eigen::VectorXd b = Eigen::VectorXd::Random(sizeA);
+    std::string cacheDir = testing::TempDir()+"pardiso_ordering_cache";
+    std::filesystem::remove_all(cacheDir);
+
+    int mtype = 2;
+    std::vector<int> perm;
+    Eigen::VectorXd x0(sizeA);
+    {
+        PardisoSolver pardisoSolver(mtype);
+        pardisoSolver.setOrderingCache(cacheDir);
+        pardisoSolver.initialize(sizeA, rowPtrA.data(),
+                                 colIdA.data(), dataA.data());
+        pardisoSolver.factorize();
+        ASSERT_FALSE(pardisoSolver.getStats().isOrderingReused);
+        pardisoSolver.solve(b.data(), x0.data());
+        perm = pardisoSolver.computeOrdering();
+        ASSERT_TRUE(pardisoSolver.getStats().isOrderingReused);
+
+        // kept for the factorizations of the same pattern
+        pardisoSolver.factorize();
+        ASSERT_TRUE(pardisoSolver.getStats().isOrderingReused);
+        pardisoSolver.finalize();
+    }
+    ASSERT_EQ(static_cast<int>(perm.size()), sizeA);
+
+    double TOL = 1E-10;
+    {
+        Eigen::VectorXd x(sizeA);
+        PardisoSolver pardisoSolver(mtype);
+        pardisoSolver.setOrderingCache(cacheDir);
+        pardisoSolver.initialize(sizeA, rowPtrA.data(),
+                                 colIdA.data(), dataA.data());
+        ASSERT_EQ(pardisoSolver.computeOrdering(), perm);
+        pardisoSolver.factorize();
+        ASSERT_TRUE(pardisoSolver.getStats().isOrderingReused);
+        pardisoSolver.solve(b.data(), x.data());
+        pardisoSolver.finalize();
+        ASSERT_LE((x0 - x).norm(), TOL);
+    }
+    {
+        std::vector<int> reversePerm(sizeA);
+        for (int i=0; i<sizeA; i++) {
+            reversePerm[i] = sizeA-1-i;
+        }
+
+        Eigen::VectorXd x(sizeA);
+        PardisoSolver pardisoSolver(mtype);
+        pardisoSolver.setPermutation(reversePerm);
+        pardisoSolver.initialize(sizeA, rowPtrA.data(),
+                                 colIdA.data(), dataA.data());
+        pardisoSolver.factorize();
+        ASSERT_TRUE(pardisoSolver.getStats().isOrderingReused);
+        ASSERT_EQ(pardisoSolver.computeOrdering(), reversePerm);
+        pardisoSolver.solve(b.data(), x.data());
+        pardisoSolver.finalize();
+        ASSERT_LE((x0 - x).norm(), TOL);
+    }
+    std::filesystem::remove_all(cacheDir);
+}
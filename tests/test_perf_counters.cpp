@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "../src/core/perf_counters.hpp"
+
+
+//! Runs a small floating-point loop
+static double work(int n)
+{
+    double sum = 0;
+    for (int i=1; i<=n; i++) {
+        sum += std::sqrt(static_cast<double>(i));
+    }
+    return sum;
+}
+
+/**
+ * @brief Tests that nested phases are recorded when they end,
+ * and that the counters, if permitted, count the work of a phase
+ */
+TEST(PhaseProfiler, nestedPhases)
+{
+    for (bool useCounters : {false, true})
+    {
+        PhaseProfiler profiler(useCounters);
+        if (!useCounters) {
+            ASSERT_FALSE(profiler.hasCounters());
+        }
+
+        volatile double sum = 0;
+        double elapsedTime = profiler.measure("outer", [&]() {
+            sum = sum + work(100000);
+            profiler.measure("inner", [&]() {
+                sum = sum + work(100000);
+            });
+        });
+
+        const auto& phases = profiler.getPhases();
+        ASSERT_EQ(phases.size(), 2u);
+        ASSERT_EQ(phases[0].name, "inner");
+        ASSERT_EQ(phases[1].name, "outer");
+        ASSERT_EQ(phases[1].elapsedTime, elapsedTime);
+        ASSERT_LE(phases[0].elapsedTime, phases[1].elapsedTime);
+
+        for (const auto& phase : phases)
+        {
+            ASSERT_EQ(phase.hasCounters, profiler.hasCounters());
+            if (phase.hasCounters) {
+                ASSERT_GT(phase.counters[PerfCounters::instructions], 0);
+            }
+            else {
+                ASSERT_EQ(phase.counters[PerfCounters::instructions], 0);
+            }
+        }
+        if (profiler.hasCounters()) {
+            ASSERT_LE(phases[0].counters[PerfCounters::instructions],
+                      phases[1].counters[PerfCounters::instructions]);
+        }
+
+        // averages of repetitions
+        std::vector<PhaseMetrics> sum2;
+        addPhaseMetrics(sum2, phases);
+        addPhaseMetrics(sum2, phases);
+        scalePhaseMetrics(sum2, 0.5);
+        for (size_t i=0; i<phases.size(); i++) {
+            ASSERT_DOUBLE_EQ(sum2[i].elapsedTime, phases[i].elapsedTime);
+            ASSERT_DOUBLE_EQ(sum2[i].counters[PerfCounters::cycles],
+                             phases[i].counters[PerfCounters::cycles]);
+        }
+
+        profiler.clear();
+        ASSERT_TRUE(profiler.getPhases().empty());
+    }
+}
+
+// End of file
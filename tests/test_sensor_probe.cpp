@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+
+#include "mfem.hpp"
+using namespace mfem;
+
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "../src/heat/sensor_probe.hpp"
+#include "../src/sparse_heat/sensor_probe.hpp"
+#include "../src/sparse_heat/utilities.hpp"
+
+using namespace mymfem;
+
+
+static double linearFn(const Vector& x) {
+    return x(0) + x(1);
+}
+
+//! Returns sensor locations in the interior of the unit square
+static DenseMatrix randomSensors(int numSensors)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uni(0.05, 0.95);
+
+    DenseMatrix X(2, numSensors);
+    for (int k=0; k<numSensors; k++) {
+        X(0,k) = uni(rng);
+        X(1,k) = uni(rng);
+    }
+    return X;
+}
+
+
+/**
+ * @brief Probes the full-tensor space-time interpolant
+ * of u = t*(x+y), q = t*(1,2), which is exact
+ */
+TEST(SensorProbe, fullTensor)
+{
+    double endTime = 1.;
+    Mesh temporalMesh(4, endTime);
+    auto tFec = new H1_FECollection(1, 1);
+    FiniteElementSpace temporalFes(&temporalMesh, tFec);
+
+    Mesh spatialMesh(3, 3, Element::TRIANGLE, true, 1., 1.);
+    auto xH1Fec = new H1_FECollection(1, 2, BasisType::GaussLobatto);
+    auto xRTFec = new RT_FECollection(0, 2);
+    FiniteElementSpace spatialFesH1(&spatialMesh, xH1Fec);
+    FiniteElementSpace spatialFesRT(&spatialMesh, xRTFec);
+
+    Array<FiniteElementSpace *> spatialFes(2);
+    spatialFes[0] = &spatialFesH1;
+    spatialFes[1] = &spatialFesRT;
+    heat::SolutionHandler solutionHandler(&temporalFes, spatialFes);
+
+    GridFunction temperature(&spatialFesH1), heatFlux(&spatialFesRT);
+    FunctionCoefficient temperatureCoeff(linearFn);
+    Vector flux(2);
+    flux(0) = 1.;
+    flux(1) = 2.;
+    VectorConstantCoefficient heatFluxCoeff(flux);
+    temperature.ProjectCoefficient(temperatureCoeff);
+    heatFlux.ProjectCoefficient(heatFluxCoeff);
+
+    // the temporal dofs are the mesh vertices
+    Vector slice;
+    for (int j=0; j<temporalFes.GetTrueVSize(); j++)
+    {
+        double t = temporalMesh.GetVertex(j)[0];
+        solutionHandler.makeTemperatureSliceRef(j, slice);
+        slice.Set(t, temperature);
+        solutionHandler.makeHeatFluxSliceRef(j, slice);
+        slice.Set(t, heatFlux);
+    }
+
+    int numSensors = 20;
+    auto X = randomSensors(numSensors);
+    heat::SensorProbe probe(&temporalFes, spatialFes, X);
+    ASSERT_EQ(probe.getNumFound(), numSensors);
+
+    double timesData[4] = {0., 0.3, 0.55, 1.};
+    Vector times(timesData, 4);
+    probe.setTimes(times);
+
+    DenseMatrix temperatureValues, heatFluxValues;
+    probe.probeTemperature(solutionHandler, temperatureValues);
+    probe.probeHeatFlux(solutionHandler, heatFluxValues);
+    ASSERT_EQ(temperatureValues.Height(), numSensors);
+    ASSERT_EQ(heatFluxValues.Height(), 2*numSensors);
+    ASSERT_EQ(temperatureValues.Width(), times.Size());
+
+    double tol = 1E-12;
+    for (int i=0; i<times.Size(); i++) {
+        for (int k=0; k<numSensors; k++)
+        {
+            double t = times(i);
+            ASSERT_NEAR(temperatureValues(k,i),
+                        t*(X(0,k) + X(1,k)), tol);
+            ASSERT_NEAR(heatFluxValues(2*k,i), t*flux(0), tol);
+            ASSERT_NEAR(heatFluxValues(2*k+1,i), t*flux(1), tol);
+        }
+    }
+
+    // times outside the temporal mesh are rejected
+    double lateTimesData[2] = {0.5, 1.1};
+    Vector lateTimes(lateTimesData, 2);
+    EXPECT_THROW(probe.setTimes(lateTimes), std::runtime_error);
+    EXPECT_EQ(probe.getNumTimes(), times.Size());
+
+    // sensors outside the spatial mesh are reported and read zero
+    DenseMatrix Y(2, 3);
+    Y(0,0) = 0.5;  Y(1,0) = 0.5;
+    Y(0,1) = 1.5;  Y(1,1) = 0.5;
+    Y(0,2) = 0.25; Y(1,2) = -0.5;
+    heat::SensorProbe outsideProbe(&temporalFes, spatialFes, Y);
+    auto unlocated = outsideProbe.getUnlocatedSensors();
+    ASSERT_EQ(unlocated.Size(), 2);
+    EXPECT_EQ(unlocated[0], 1);
+    EXPECT_EQ(unlocated[1], 2);
+
+    outsideProbe.setTimes(times);
+    outsideProbe.probeTemperature(solutionHandler, temperatureValues);
+    for (int i=0; i<times.Size(); i++) {
+        EXPECT_EQ(temperatureValues(1,i), 0.);
+        EXPECT_EQ(temperatureValues(2,i), 0.);
+    }
+}
+
+/**
+ * @brief Probes a sparse space-time function with contributions
+ * on two temporal levels: t*(x+y) on the coarsest,
+ * and the first hierarchical hat times (x+y) on the next
+ */
+TEST(SensorProbe, sparseGrid)
+{
+    std::string input_dir
+            = "../tests/input/nested_hierarchy/2d/";
+
+    const std::string meshFile1 = input_dir+"mesh_lx0";
+    const std::string meshFile2 = input_dir+"mesh_lx1";
+
+    auto mesh1 = std::make_shared<Mesh>(meshFile1.c_str());
+    auto mesh2 = std::make_shared<Mesh>(meshFile2.c_str());
+
+    std::shared_ptr<NestedMeshHierarchy> meshHierarchy
+            = std::make_shared<NestedMeshHierarchy>();
+    meshHierarchy->addMesh(mesh1);
+    meshHierarchy->addMesh(mesh2);
+    meshHierarchy->finalize();
+
+    FiniteElementCollection *feCollH1
+            = new H1_FECollection(1, 2, BasisType::GaussLobatto);
+    auto fes1H1 = std::make_shared<FiniteElementSpace>(mesh1.get(),
+                                                       feCollH1);
+    auto fes2H1 = std::make_shared<FiniteElementSpace>(mesh2.get(),
+                                                       feCollH1);
+
+    FiniteElementCollection *feCollRT
+            = new RT_FECollection(0, 2);
+    auto fes1RT = std::make_shared<FiniteElementSpace>(mesh1.get(),
+                                                       feCollRT);
+    auto fes2RT = std::make_shared<FiniteElementSpace>(mesh2.get(),
+                                                       feCollRT);
+
+    std::shared_ptr<NestedFEHierarchy> spatialNestedFEHierarchyTemperature
+            = std::make_shared<NestedFEHierarchy> (meshHierarchy);
+    spatialNestedFEHierarchyTemperature->addFESpace(fes1H1);
+    spatialNestedFEHierarchyTemperature->addFESpace(fes2H1);
+
+    std::shared_ptr<NestedFEHierarchy> spatialNestedFEHierarchyHeatFlux
+            = std::make_shared<NestedFEHierarchy> (meshHierarchy);
+    spatialNestedFEHierarchyHeatFlux->addFESpace(fes1RT);
+    spatialNestedFEHierarchyHeatFlux->addFESpace(fes2RT);
+
+    int minLevel = 1;
+    int maxLevel = 2;
+    double endTime = 1.;
+    sparseHeat::SolutionHandler solutionHandler
+            (minLevel, maxLevel,
+             spatialNestedFEHierarchyTemperature,
+             spatialNestedFEHierarchyHeatFlux);
+
+    FunctionCoefficient temperatureCoeff(linearFn);
+    GridFunction temperature1(fes1H1.get()), temperature2(fes2H1.get());
+    temperature1.ProjectCoefficient(temperatureCoeff);
+    temperature2.ProjectCoefficient(temperatureCoeff);
+
+    // coarsest temporal level, finest spatial level
+    auto temporalBlockSizes = evalTemporalBlockSizes(minLevel, maxLevel);
+    double ht0 = endTime/(temporalBlockSizes[0]-1);
+    Vector slice;
+    for (int i=0; i<temporalBlockSizes[0]; i++) {
+        solutionHandler.makeTemperatureSliceRef(0, i, slice);
+        slice.Set(i*ht0, temperature2);
+    }
+
+    // first hierarchical hat, coarsest spatial level
+    double ht1 = ht0/2;
+    solutionHandler.makeTemperatureSliceRef(1, 0, slice);
+    slice = temperature1;
+
+    int numSensors = 20;
+    auto X = randomSensors(numSensors);
+    sparseHeat::SensorProbe probe(minLevel, maxLevel, endTime,
+                                  spatialNestedFEHierarchyTemperature,
+                                  spatialNestedFEHierarchyHeatFlux, X);
+    ASSERT_EQ(probe.getNumFound(), numSensors);
+
+    double timesData[6] = {0., 0.2, 0.25, 0.6, 0.75, 1.};
+    Vector times(timesData, 6);
+    probe.setTimes(times);
+
+    DenseMatrix temperatureValues, heatFluxValues;
+    probe.probeTemperature(solutionHandler, temperatureValues);
+    probe.probeHeatFlux(solutionHandler, heatFluxValues);
+    ASSERT_EQ(heatFluxValues.Height(), 2*numSensors);
+    ASSERT_EQ(heatFluxValues.MaxMaxNorm(), 0.);
+
+    double tol = 1E-12;
+    for (int i=0; i<times.Size(); i++) {
+        for (int k=0; k<numSensors; k++)
+        {
+            double t = times(i);
+            double hat = std::max(0., 1 - std::abs(t - ht1)/ht1);
+            ASSERT_NEAR(temperatureValues(k,i),
+                        (t + hat)*(X(0,k) + X(1,k)), tol);
+        }
+    }
+
+    double earlyTimesData[2] = {-0.1, 0.5};
+    Vector earlyTimes(earlyTimesData, 2);
+    EXPECT_THROW(probe.setTimes(earlyTimes), std::runtime_error);
+    EXPECT_EQ(probe.getUnlocatedSensors().Size(), 0);
+}
+
+// End of file
@@ -1,10 +1,13 @@
 #include <gtest/gtest.h>
 
 #include "mfem.hpp"
+#include <cmath>
 #include <iostream>
+#include <map>
 
 #include "../src/heat/test_cases_factory.hpp"
 #include "../src/heat/discretisation.hpp"
+#include "../src/mymfem/utilities.hpp"
 #include "../src/sparse_heat/discretisation.hpp"
 #include "../src/sparse_heat/solution_handler.hpp"
 #include "../src/sparse_heat/utilities.hpp"
@@ -69,6 +72,7 @@ TEST(SparseDiscretisation, buildH1Hdiv)
     // system assembly
     xtDisc->assembleSystemSubMatrices();
     xtDisc->buildSystemMatrix();
+    xtDisc->buildSystemBlocks();
 
     // rhs assembly
     auto spatialNestedFEHierarchyForTemperature
@@ -170,6 +174,7 @@ TEST(SparseDiscretisation, singleLevelH1HdivUnitSquareTest1)
              spatialMeshHierarchy);
     sparseXtDisc->assembleSystemSubMatrices();
     sparseXtDisc->buildSystemMatrix();
+    sparseXtDisc->buildSystemBlocks();
     auto systemBlock11 = sparseXtDisc->getSystemBlock11();
     auto systemBlock12 = sparseXtDisc->getSystemBlock12();
     auto systemBlock21 = sparseXtDisc->getSystemBlock21();
@@ -296,6 +301,7 @@ TEST(SparseDiscretisation, singleLevelH1HdivUnitSquareTest3)
              spatialMeshHierarchy);
     sparseXtDisc->assembleSystemSubMatrices();
     sparseXtDisc->buildSystemMatrix();
+    sparseXtDisc->buildSystemBlocks();
     auto systemBlock11 = sparseXtDisc->getSystemBlock11();
     auto systemBlock12 = sparseXtDisc->getSystemBlock12();
     auto systemBlock21 = sparseXtDisc->getSystemBlock21();
@@ -418,6 +424,7 @@ TEST(SparseDiscretisation, buildH1H1)
     // system assembly
     xtDisc->assembleSystemSubMatrices();
     xtDisc->buildSystemMatrix();
+    xtDisc->buildSystemBlocks();
 
     // rhs assembly
     auto spatialNestedFEHierarchyForTemperature
@@ -519,6 +526,7 @@ TEST(SparseDiscretisation, singleLevelH1H1UnitSquareTest1)
              spatialMeshHierarchy);
     sparseXtDisc->assembleSystemSubMatrices();
     sparseXtDisc->buildSystemMatrix();
+    sparseXtDisc->buildSystemBlocks();
     auto systemBlock11 = sparseXtDisc->getSystemBlock11();
     auto systemBlock12 = sparseXtDisc->getSystemBlock12();
     auto systemBlock21 = sparseXtDisc->getSystemBlock21();
@@ -583,3 +591,313 @@ TEST(SparseDiscretisation, singleLevelH1H1UnitSquareTest1)
     trueRhs->Add(-1, *rhs);
     ASSERT_LE(trueRhs->Normlinf(), tol);
 }
+
+//! Loads the config with the dummy test case
+static nlohmann::json loadDummyConfig()
+{
+    std::string configFile
+            = "../config_files/unit_tests/"
+              "sparse_heat_discretisation/sparseHeat_dummy.json";
+    return getGlobalConfig(configFile);
+}
+
+//! Loads the nested hierarchy of the three spatial assembly meshes
+static std::shared_ptr<mymfem::NestedMeshHierarchy>
+loadSpatialMeshHierarchy()
+{
+    std::string input_dir
+            = "../tests/input/sparse_heat_assembly/";
+    auto spatialMeshHierarchy
+            = std::make_shared<mymfem::NestedMeshHierarchy>();
+    for (int k=0; k<3; k++) {
+        const std::string meshFile
+                = input_dir+"mesh_lx"+std::to_string(k);
+        spatialMeshHierarchy->addMesh
+                (std::make_shared<Mesh>(meshFile.c_str()));
+    }
+    spatialMeshHierarchy->finalize();
+    return spatialMeshHierarchy;
+}
+
+//! Creates the sparse discretisation of type "H1Hdiv" or "H1H1"
+static std::unique_ptr<sparseHeat::LsqSparseXtFem> makeXtDisc
+(const std::string& discType, const nlohmann::json& config,
+ std::shared_ptr<heat::TestCases>& testCase,
+ int numLevels, int minTemporalLevel)
+{
+    if (discType == "H1Hdiv") {
+        return std::make_unique<sparseHeat::LsqSparseXtFemH1Hdiv>
+                (config, testCase, numLevels, minTemporalLevel);
+    }
+    return std::make_unique<sparseHeat::LsqSparseXtFemH1H1>
+            (config, testCase, numLevels, minTemporalLevel);
+}
+
+/**
+ * @brief Compares the matrix-free sparse space-time operator
+ * with the assembled system matrix, for the H1-Hdiv and
+ * H1-H1 discretisations
+ */
+TEST(SparseDiscretisation, matrixFreeOperator)
+{
+    auto config = loadDummyConfig();
+    auto testCase = heat::makeTestCase(config);
+
+    auto spatialMeshHierarchy = loadSpatialMeshHierarchy();
+    int numLevels = spatialMeshHierarchy->getNumMeshes();
+    int minTemporalLevel = 1;
+
+    std::vector<std::unique_ptr<sparseHeat::LsqSparseXtFem>> xtDiscs;
+    for (const std::string discType : {"H1Hdiv", "H1H1"}) {
+        xtDiscs.push_back(makeXtDisc(discType, config, testCase,
+                                     numLevels, minTemporalLevel));
+    }
+
+    double tol = 1E-10;
+    for (auto& xtDisc : xtDiscs)
+    {
+        xtDisc->setNestedFEHierarchyAndSpatialBoundaryDofs
+                (spatialMeshHierarchy);
+        xtDisc->assembleSystemSubMatrices();
+        xtDisc->buildSystemMatrix();
+        xtDisc->buildSystemOperator();
+
+        auto systemMatrix = xtDisc->getSystemMatrix();
+        auto systemOperator = xtDisc->getSystemOperator();
+        ASSERT_EQ(systemOperator->Height(), systemMatrix->NumRows());
+        ASSERT_EQ(systemOperator->Width(), systemMatrix->NumCols());
+
+        Vector x(systemMatrix->NumCols());
+        Vector y1(systemMatrix->NumRows()), y2(systemMatrix->NumRows());
+        x.Randomize(1);
+        systemMatrix->Mult(x, y1);
+        systemOperator->Mult(x, y2);
+        y1 -= y2;
+        ASSERT_LE(y1.Normlinf(), tol);
+
+        Vector diag, trueDiag;
+        xtDisc->assembleSystemOperatorDiagonal(diag);
+        systemMatrix->GetDiag(trueDiag);
+        diag -= trueDiag;
+        ASSERT_LE(diag.Normlinf(), tol);
+    }
+}
+
+/**
+ * @brief Compares the upper triangle of the system matrix,
+ * with boundary conditions, built in a single pass
+ * with the upper triangle of the full system matrix
+ */
+TEST(SparseDiscretisation, upperTriangleOfSystemMatrix)
+{
+    auto config = loadDummyConfig();
+    auto testCase = heat::makeTestCase(config);
+
+    auto spatialMeshHierarchy = loadSpatialMeshHierarchy();
+    int numLevels = spatialMeshHierarchy->getNumMeshes();
+    int minTemporalLevel = 1;
+
+    double tol = 1E-12;
+    for (const std::string discType : {"H1Hdiv", "H1H1"})
+    {
+        auto fullDisc = makeXtDisc(discType, config, testCase,
+                                   numLevels, minTemporalLevel);
+        auto upperDisc = makeXtDisc(discType, config, testCase,
+                                    numLevels, minTemporalLevel);
+
+        for (auto xtDisc : {fullDisc.get(), upperDisc.get()}) {
+            xtDisc->setNestedFEHierarchyAndSpatialBoundaryDofs
+                    (spatialMeshHierarchy);
+            xtDisc->assembleSystemSubMatrices();
+        }
+        fullDisc->buildSystemMatrix();
+        upperDisc->buildUpperTriangleOfSystemMatrix();
+
+        std::unique_ptr<SparseMatrix> trueMat
+                (&getUpperTriangle(*fullDisc->getSystemMatrix()));
+        auto mat = upperDisc->getSystemMatrix();
+        ASSERT_TRUE(mat->ColumnsAreSorted());
+        ASSERT_EQ(mat->NumNonZeroElems(), trueMat->NumNonZeroElems());
+
+        std::unique_ptr<SparseMatrix> diff(Add(1, *mat, -1, *trueMat));
+        ASSERT_LE(diff->MaxNorm(), tol);
+    }
+}
+
+/**
+ * @brief Tests the spatial prolongations against the mixed mass
+ * matrices, and the symmetry and effectiveness
+ * of the multilevel preconditioner
+ */
+TEST(SparseDiscretisation, multilevelPreconditioner)
+{
+    auto config = loadDummyConfig();
+    auto testCase = heat::makeTestCase(config);
+
+    auto spatialMeshHierarchy = loadSpatialMeshHierarchy();
+    int numLevels = spatialMeshHierarchy->getNumMeshes();
+    int minTemporalLevel = 1;
+
+    std::vector<std::unique_ptr<sparseHeat::LsqSparseXtFem>> xtDiscs;
+    for (const std::string discType : {"H1Hdiv", "H1H1"}) {
+        xtDiscs.push_back(makeXtDisc(discType, config, testCase,
+                                     numLevels, minTemporalLevel));
+    }
+
+    double tol = 1E-10;
+    for (auto& xtDisc : xtDiscs)
+    {
+        xtDisc->setNestedFEHierarchyAndSpatialBoundaryDofs
+                (spatialMeshHierarchy);
+        xtDisc->assembleSystemSubMatrices();
+
+        // M_{k+1,k+1} P_k = M_{k+1,k} for nested spaces
+        std::vector<std::pair<std::shared_ptr<mymfem::NestedFEHierarchy>,
+                std::shared_ptr<BlockMatrix>>> fields
+                = {{xtDisc->getSpatialNestedFEHierarchyForTemperature(),
+                    xtDisc->getSpatialMassForTemperature()},
+                   {xtDisc->getSpatialNestedFEHierarchyForHeatFlux(),
+                    xtDisc->getSpatialMassForHeatFlux()}};
+        for (auto& field : fields) {
+            for (int k=0; k<numLevels-1; k++)
+            {
+                std::unique_ptr<SparseMatrix> P
+                        (field.first->buildProlongation(k));
+                std::unique_ptr<SparseMatrix> MP
+                        (Mult(field.second->GetBlock(k+1, k+1), *P));
+                std::unique_ptr<SparseMatrix> diff
+                        (Add(1, *MP, -1, field.second->GetBlock(k+1, k)));
+                ASSERT_LE(diff->MaxNorm(), tol);
+            }
+        }
+
+        xtDisc->buildSystemMatrix();
+        xtDisc->buildMultilevelPreconditioner();
+        auto systemMatrix = xtDisc->getSystemMatrix();
+        auto precond = xtDisc->getMultilevelPreconditioner();
+        ASSERT_EQ(precond->Height(), systemMatrix->NumRows());
+
+        Vector x1(precond->Width()), x2(precond->Width());
+        Vector y1(precond->Height()), y2(precond->Height());
+        x1.Randomize(1);
+        x2.Randomize(2);
+        precond->Mult(x1, y1);
+        precond->Mult(x2, y2);
+        ASSERT_NEAR(x2*y1, x1*y2, tol*std::max(1., std::abs(x2*y1)));
+        ASSERT_GT(x1*y1, 0);
+
+        // CG iterations with the multilevel preconditioner
+        // against the Jacobi and Gauss-Seidel preconditioners
+        Vector b(systemMatrix->NumRows()), u(systemMatrix->NumRows());
+        b.Randomize(3);
+        auto runCG = [&](Solver& M) {
+            CGSolver cg;
+            cg.SetOperator(*systemMatrix);
+            cg.SetPreconditioner(M);
+            cg.SetRelTol(1E-8);
+            cg.SetAbsTol(0);
+            cg.SetMaxIter(1000);
+            cg.SetPrintLevel(-1);
+            u = 0.;
+            cg.Mult(b, u);
+            EXPECT_TRUE(cg.GetConverged());
+            return cg.GetNumIterations();
+        };
+        DSmoother jacobi(*systemMatrix);
+        GSSmoother gs(*systemMatrix);
+        int numItersMultilevel = runCG(*precond);
+        int numItersJacobi = runCG(jacobi);
+        int numItersGs = runCG(gs);
+        ASSERT_LT(numItersMultilevel, numItersJacobi);
+        ASSERT_LE(numItersMultilevel, numItersGs);
+    }
+}
+
+namespace {
+
+// UnitSquareTest2 with a source that is a polynomial in space,
+// so that the spatial load vectors are integrated exactly
+class PolynomialSourceTestCase : public heat::TestCase<UnitSquareTest2>
+{
+public:
+    explicit PolynomialSourceTestCase(const nlohmann::json& config)
+        : heat::TestCase<UnitSquareTest2>(config) {}
+
+    double source(const Vector& x, const double t) const override {
+        return (1 + x(0)*x(1))*cos(M_PI*t);
+    }
+};
+
+}
+
+/**
+ * @brief Tests that the source assembled once per shared Simpson point,
+ * and restricted to the coarser spatial levels, equals the source
+ * assembled with Simpson's rule per temporal level, up to round-off;
+ * the restriction is exact when the spatial quadrature is exact.
+ * Every source assembly gives the same right-hand side on every run.
+ */
+TEST(SparseDiscretisation, sourceAssemblyByProlongation)
+{
+    auto config = loadDummyConfig();
+    config["problem_type"] = "unitSquare_test2";
+    std::shared_ptr<heat::TestCases> testCase
+            = std::make_shared<PolynomialSourceTestCase>(config);
+
+    auto spatialMeshHierarchy = loadSpatialMeshHierarchy();
+    int numLevels = spatialMeshHierarchy->getNumMeshes();
+    int minTemporalLevel = 1;
+    int maxTemporalLevel = minTemporalLevel + numLevels - 1;
+
+    double tol = 1E-12;
+    for (const std::string discType : {"H1Hdiv", "H1H1"})
+    {
+        auto assembleRhs = [&](const std::string& sourceAssembly)
+        {
+            config["source_assembly"] = sourceAssembly;
+            auto xtDisc = makeXtDisc(discType, config, testCase,
+                                     numLevels, minTemporalLevel);
+            xtDisc->setNestedFEHierarchyAndSpatialBoundaryDofs
+                    (spatialMeshHierarchy);
+
+            auto spatialNestedFEHierarchyForTemperature
+                    = xtDisc->getSpatialNestedFEHierarchyForTemperature();
+            auto spatialNestedFEHierarchyForHeatFlux
+                    = xtDisc->getSpatialNestedFEHierarchyForHeatFlux();
+            sparseHeat::SolutionHandler solutionHandler
+                    (minTemporalLevel, maxTemporalLevel,
+                     spatialNestedFEHierarchyForTemperature,
+                     spatialNestedFEHierarchyForHeatFlux);
+            auto dataOffsets
+                    = evalBlockOffsets(solutionHandler.getDataSize());
+            auto rhs = std::make_shared<BlockVector>(dataOffsets);
+            (*rhs) = 0.;
+            xtDisc->assembleRhs(rhs);
+            return rhs;
+        };
+
+        // the threaded assembly is reproducible bit by bit
+        std::map<std::string, std::shared_ptr<BlockVector>> rhs;
+        for (const std::string sourceAssembly
+             : {"quadrature", "simpson", "prolongation"})
+        {
+            rhs[sourceAssembly] = assembleRhs(sourceAssembly);
+            auto rhsAgain = assembleRhs(sourceAssembly);
+            for (int i=0; i<rhsAgain->Size(); i++) {
+                ASSERT_EQ((*rhsAgain)(i), (*rhs[sourceAssembly])(i));
+            }
+        }
+
+        ASSERT_GT(rhs["simpson"]->Norml2(), 0);
+        Vector diff(*rhs["prolongation"]);
+        diff -= *rhs["simpson"];
+        ASSERT_LE(diff.Normlinf(), tol*rhs["simpson"]->Normlinf());
+    }
+
+    config["source_assembly"] = "unknown";
+    ASSERT_THROW(std::make_unique<sparseHeat::LsqSparseXtFemH1Hdiv>
+                 (config, testCase, numLevels, minTemporalLevel),
+                 std::runtime_error);
+}
+
+// End of file
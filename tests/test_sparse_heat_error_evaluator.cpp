@@ -2,12 +2,90 @@
 
 #include "mfem.hpp"
 #include <iostream>
+#include <omp.h>
 
 #include "../src/sparse_heat/solver.hpp"
 #include "../src/sparse_heat/observer.hpp"
+#include "../src/sparse_heat/utilities.hpp"
 
 using namespace mfem;
 
+
+static double linearFn(const Vector& x) {
+    return x(0) + x(1);
+}
+
+/**
+ * @brief Test case on the unit square with the solution
+ * u = t*(x+y), q = grad u = (t,t), f = x+y, which lies in the
+ * discrete spaces; all error integrands are polynomials
+ * of low degree for discrete approximations
+ */
+class LinearTestCase : public heat::TestCases
+{
+public:
+    explicit LinearTestCase (const nlohmann::json& config)
+        : TestCases(config) {
+        m_dim = 2;
+    }
+
+    double medium(const Vector&) const override {
+        return 1;
+    }
+
+    DenseMatrix mediumTensor(const Vector&) const override
+    {
+        DenseMatrix med(m_dim);
+        med(0,0) = med(1,1) = 1;
+        med(0,1) = med(1,0) = 0;
+        return med;
+    }
+
+    double temperatureSol(const Vector& x,
+                          const double t) const override {
+        return t*(x(0) + x(1));
+    }
+
+    Vector heatFluxSol(const Vector& x,
+                       const double t) const override {
+        return temperatureSpatialGradientSol(x, t);
+    }
+
+    Vector temperatureSpatialGradientSol
+    (const Vector&, const double t) const override
+    {
+        Vector dudx(m_dim);
+        dudx = t;
+        return dudx;
+    }
+
+    double temperatureTemporalGradientSol
+    (const Vector& x, const double) const override {
+        return x(0) + x(1);
+    }
+
+    double initTemperature(const Vector& x) const override {
+        return temperatureSol(x, 0);
+    }
+
+    Vector initHeatFlux(const Vector& x) const override {
+        return heatFluxSol(x, 0);
+    }
+
+    double bdryTemperature(const Vector& x,
+                           const double t) const override {
+        return temperatureSol(x, t);
+    }
+
+    double source(const Vector& x, const double) const override {
+        return x(0) + x(1);
+    }
+
+    void setBdryDirichlet(Array<int>& bdr_marker) const override {
+        bdr_marker = 1;
+    }
+};
+
 std::tuple<int, double, double, Vector>
 runSolverAndEvalError(sparseHeat::Solver& solver,
                       sparseHeat::Observer& observer)
@@ -77,4 +155,291 @@ TEST(SparseHeatObserver, evalErrorUnitSquareTest3)
     solutionError.Print();
 }
 
+/**
+ * @brief Tests that the parallel error evaluation
+ * does not depend on the number of threads
+ */
+TEST(SparseHeatObserver, evalErrorIsThreadIndependent)
+{
+    std::string configFile
+            = "../config_files/unit_tests/"
+              "sparse_heat_observer/sparseHeat_unitSquare_test3.json";
+    auto config = getGlobalConfig(configFile);
+    auto testCase = heat::makeTestCase(config);
+
+    int numLevels, minSpatialLevel, minTemporalLevel;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "num_levels",
+                                        numLevels, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_spatial_level",
+                                        minSpatialLevel, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_temporal_level",
+                                        minTemporalLevel, 1);
+
+    std::string meshDir = "../tests/input/sparse_heat_observer";
+    bool loadInitMesh = true;
+
+    sparseHeat::Solver solver(config,
+                              testCase,
+                              meshDir,
+                              numLevels,
+                              minSpatialLevel,
+                              minTemporalLevel,
+                              loadInitMesh);
+    solver.run();
+    auto solutionHandler = solver.getSolutionHandler();
+    auto disc = solver.getDiscretisation();
+
+    int maxNumThreads = omp_get_max_threads();
+    sparseHeat::Observer observer(config, numLevels, minTemporalLevel);
+
+    omp_set_num_threads(1);
+    observer.set(testCase, disc);
+    auto serialError = observer.evalErrorInNaturalNorm(*solutionHandler);
+    auto serialLsqError
+            = observer.evalErrorInLeastSquaresNorm(*solutionHandler);
+
+    omp_set_num_threads(std::max(maxNumThreads, 3));
+    observer.set(testCase, disc);
+    auto parallelError = observer.evalErrorInNaturalNorm(*solutionHandler);
+    auto parallelLsqError
+            = observer.evalErrorInLeastSquaresNorm(*solutionHandler);
+    omp_set_num_threads(maxNumThreads);
+
+    for (int i=0; i<serialError.Size(); i++) {
+        EXPECT_EQ(serialError(i), parallelError(i));
+    }
+    for (int i=0; i<serialLsqError.Size(); i++) {
+        EXPECT_EQ(serialLsqError(i), parallelLsqError(i));
+    }
+}
+
+/**
+ * @brief Tests the error evaluation on the sparse grid
+ * against the full evaluation; for a polynomial solution,
+ * both quadratures are exact and agree up to roundoff
+ */
+TEST(SparseHeatObserver, evalErrorOnSparseGrid)
+{
+    std::string configFile
+            = "../config_files/unit_tests/"
+              "sparse_heat_observer/sparseHeat_unitSquare_test3.json";
+    auto config = getGlobalConfig(configFile);
+    std::shared_ptr<heat::TestCases> testCase
+            = std::make_shared<LinearTestCase>(config);
+
+    int numLevels, minSpatialLevel, minTemporalLevel;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "num_levels",
+                                        numLevels, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_spatial_level",
+                                        minSpatialLevel, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_temporal_level",
+                                        minTemporalLevel, 1);
+
+    std::string meshDir = "../tests/input/sparse_heat_observer";
+    bool loadInitMesh = true;
+
+    sparseHeat::Solver solver(config,
+                              testCase,
+                              meshDir,
+                              numLevels,
+                              minSpatialLevel,
+                              minTemporalLevel,
+                              loadInitMesh);
+    solver.run();
+    auto solutionHandler = solver.getSolutionHandler();
+    auto disc = solver.getDiscretisation();
+
+    auto fullConfig = config;
+    fullConfig["error_evaluation"] = "full";
+    sparseHeat::Observer fullObserver(fullConfig, numLevels,
+                                      minTemporalLevel);
+    fullObserver.set(testCase, disc);
+    auto fullError = fullObserver.evalError(*solutionHandler);
+
+    auto sparseConfig = config;
+    sparseConfig["error_evaluation"] = "sparse";
+    sparseHeat::Observer sparseObserver(sparseConfig, numLevels,
+                                        minTemporalLevel);
+    sparseObserver.set(testCase, disc);
+    auto sparseError = sparseObserver.evalError(*solutionHandler);
+
+    // the discrete solution violates the boundary values of u
+    ASSERT_EQ(sparseError.Size(), fullError.Size());
+    for (int i=0; i<fullError.Size(); i++) {
+        ASSERT_GT(fullError(i), 0.);
+        EXPECT_NEAR(sparseError(i), fullError(i), 1E-10*fullError(i));
+    }
+}
+
+/**
+ * @brief Tests that the error of a solution in the discrete
+ * spaces vanishes in both error evaluations
+ */
+TEST(SparseHeatObserver, evalErrorOfDiscreteSolution)
+{
+    std::string configFile
+            = "../config_files/unit_tests/"
+              "sparse_heat_observer/sparseHeat_unitSquare_test3.json";
+    auto config = getGlobalConfig(configFile);
+    std::shared_ptr<heat::TestCases> testCase
+            = std::make_shared<LinearTestCase>(config);
+
+    int numLevels, minSpatialLevel, minTemporalLevel;
+    double endTime;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "num_levels",
+                                        numLevels, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_spatial_level",
+                                        minSpatialLevel, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_temporal_level",
+                                        minTemporalLevel, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "end_time",
+                                        endTime, 1.);
+
+    std::string meshDir = "../tests/input/sparse_heat_observer";
+    bool loadInitMesh = true;
+
+    sparseHeat::Solver solver(config,
+                              testCase,
+                              meshDir,
+                              numLevels,
+                              minSpatialLevel,
+                              minTemporalLevel,
+                              loadInitMesh);
+    solver.initialize();
+    auto solutionHandler = solver.getSolutionHandler();
+    auto disc = solver.getDiscretisation();
+
+    // u and q on the coarsest temporal level, finest spatial level
+    auto fesTemperature = disc->getSpatialNestedFEHierarchyForTemperature()
+            ->getFESpaces()[numLevels-1];
+    auto fesHeatFlux = disc->getSpatialNestedFEHierarchyForHeatFlux()
+            ->getFESpaces()[numLevels-1];
+
+    FunctionCoefficient temperatureCoeff(linearFn);
+    Vector gradient(2);
+    gradient = 1.;
+    VectorConstantCoefficient heatFluxCoeff(gradient);
+    GridFunction temperature(fesTemperature.get());
+    GridFunction heatFlux(fesHeatFlux.get());
+    temperature.ProjectCoefficient(temperatureCoeff);
+    heatFlux.ProjectCoefficient(heatFluxCoeff);
+
+    *solutionHandler->getData() = 0.;
+    auto temporalBlockSizes
+            = sparseHeat::evalTemporalBlockSizes(minTemporalLevel,
+                                                 minTemporalLevel
+                                                 + numLevels - 1);
+    double ht = endTime/(temporalBlockSizes[0]-1);
+    Vector slice;
+    for (int i=0; i<temporalBlockSizes[0]; i++)
+    {
+        solutionHandler->makeTemperatureSliceRef(0, i, slice);
+        slice.Set(i*ht, temperature);
+        solutionHandler->makeHeatFluxSliceRef(0, i, slice);
+        slice.Set(i*ht, heatFlux);
+    }
+
+    // the sparse evaluation expands the squared error,
+    // so its roundoff is of the order of the square root
+    // of the machine precision
+    for (std::string errorEvaluation : {"full", "sparse"})
+    {
+        auto observerConfig = config;
+        observerConfig["error_evaluation"] = errorEvaluation;
+        sparseHeat::Observer observer(observerConfig, numLevels,
+                                      minTemporalLevel);
+        observer.set(testCase, disc);
+        auto error = observer.evalError(*solutionHandler);
+        for (int i=0; i<error.Size(); i++) {
+            EXPECT_LE(error(i), 1E-6) << errorEvaluation;
+        }
+    }
+}
+
+/**
+ * @brief Tests the tabulated spatial quadrature data
+ * against the evaluation of grid functions on the coarse elements
+ */
+TEST(SparseHeatObserver, spatialQuadratureTable)
+{
+    std::string input_dir
+            = "../tests/input/nested_hierarchy/2d/";
+
+    auto meshHierarchy = std::make_shared<mymfem::NestedMeshHierarchy>();
+    for (int k=0; k<3; k++) {
+        const std::string meshFile = input_dir+"mesh_lx"+std::to_string(k);
+        auto mesh = std::make_shared<Mesh>(meshFile.c_str());
+        meshHierarchy->addMesh(mesh);
+    }
+    meshHierarchy->finalize();
+    auto meshes = meshHierarchy->getMeshes();
+    int numLevels = meshHierarchy->getNumMeshes();
+    int dim = meshes[0]->Dimension();
+
+    auto feCollH1 = new H1_FECollection(1, dim, BasisType::GaussLobatto);
+    auto feCollRT = new RT_FECollection(0, dim);
+    mymfem::NestedFESpaces fesH1, fesRT;
+    std::vector<std::unique_ptr<GridFunction>> temperatures, heatFluxes;
+    for (int l=0; l<numLevels; l++)
+    {
+        fesH1.push_back(std::make_shared<FiniteElementSpace>
+                        (meshes[l].get(), feCollH1));
+        fesRT.push_back(std::make_shared<FiniteElementSpace>
+                        (meshes[l].get(), feCollRT));
+        temperatures.push_back(std::make_unique<GridFunction>
+                               (fesH1.back().get()));
+        temperatures.back()->Randomize(l);
+        heatFluxes.push_back(std::make_unique<GridFunction>
+                             (fesRT.back().get()));
+        heatFluxes.back()->Randomize(l+numLevels);
+    }
+
+    sparseHeat::SpatialQuadratureTable table(meshHierarchy, fesH1, fesRT);
+
+    auto finestMesh = meshes[numLevels-1];
+    ASSERT_EQ(table.getNumElements(), finestMesh->GetNE());
+
+    double tol = 1E-10;
+    Vector x(dim), gradu(dim), q(dim), graduTrue(dim), qTrue(dim);
+    IntegrationPoint ipCoarse;
+    for (int k=0; k<finestMesh->GetNE(); k++)
+    {
+        auto elTransFine = finestMesh->GetElementTransformation(k);
+        for (int p=table.getPointBegin(k); p<table.getPointEnd(k); p++)
+        {
+            const IntegrationPoint& ipFine = table.getIntPoint(p);
+            elTransFine->Transform(ipFine, x);
+
+            for (int j=0; j<numLevels; j++)
+            {
+                int level = numLevels-1-j;
+                int elId = meshHierarchy->getAncestorId
+                        (numLevels-1, k, level);
+                auto elTransCoarse
+                        = meshes[level]->GetElementTransformation(elId);
+                elTransCoarse->TransformBack(x, ipCoarse);
+                elTransCoarse->SetIntPoint(&ipCoarse);
+
+                double u, divq;
+                table.eval(k, p, j, temperatures[level]->GetData(),
+                           heatFluxes[level]->GetData(),
+                           u, gradu.GetData(), q.GetData(), divq);
+
+                ASSERT_NEAR(u, temperatures[level]
+                            ->GetValue(elId, ipCoarse), tol);
+                temperatures[level]->GetGradient(*elTransCoarse,
+                                                 graduTrue);
+                graduTrue -= gradu;
+                ASSERT_LE(graduTrue.Normlinf(), tol);
+
+                heatFluxes[level]->GetVectorValue(elId, ipCoarse, qTrue);
+                qTrue -= q;
+                ASSERT_LE(qTrue.Normlinf(), tol);
+                ASSERT_NEAR(divq, heatFluxes[level]
+                            ->GetDivergence(*elTransCoarse), tol);
+            }
+        }
+    }
+}
+
 // End of file
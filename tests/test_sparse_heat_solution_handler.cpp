@@ -204,3 +204,101 @@ TEST(SolutionHandler, dataSizes3d)
     ASSERT_EQ((*solutionData).Size(),
               trueTemperatureDataSize + trueHeatFluxDataSize);
 }
+
+/**
+ * @brief Tests the level and slice views of the class SolutionHandler
+ */
+TEST(SolutionHandler, viewsAliasData2d)
+{
+    std::string input_dir
+            = "../tests/input/nested_hierarchy/2d/";
+
+    const std::string meshFile1 = input_dir+"mesh_lx0";
+    const std::string meshFile2 = input_dir+"mesh_lx1";
+
+    auto mesh1 = std::make_shared<Mesh>(meshFile1.c_str());
+    auto mesh2 = std::make_shared<Mesh>(meshFile2.c_str());
+
+    std::shared_ptr<NestedMeshHierarchy> meshHierarchy
+            = std::make_shared<NestedMeshHierarchy>();
+    meshHierarchy->addMesh(mesh1);
+    meshHierarchy->addMesh(mesh2);
+    meshHierarchy->finalize();
+
+    int dim = mesh1->Dimension();
+
+    FiniteElementCollection *feCollH1
+            = new H1_FECollection(1, dim, BasisType::GaussLobatto);
+    auto fes1H1 = std::make_shared<FiniteElementSpace>(mesh1.get(),
+                                                       feCollH1);
+    auto fes2H1 = std::make_shared<FiniteElementSpace>(mesh2.get(),
+                                                       feCollH1);
+
+    FiniteElementCollection *feCollRT
+            = new RT_FECollection(0, dim);
+    auto fes1RT = std::make_shared<FiniteElementSpace>(mesh1.get(),
+                                                       feCollRT);
+    auto fes2RT = std::make_shared<FiniteElementSpace>(mesh2.get(),
+                                                       feCollRT);
+
+    std::shared_ptr<NestedFEHierarchy> spatialNestedFEHierarchyTemperature
+            = std::make_shared<NestedFEHierarchy> (meshHierarchy);
+    spatialNestedFEHierarchyTemperature->addFESpace(fes1H1);
+    spatialNestedFEHierarchyTemperature->addFESpace(fes2H1);
+
+    std::shared_ptr<NestedFEHierarchy> spatialNestedFEHierarchyHeatFlux
+            = std::make_shared<NestedFEHierarchy> (meshHierarchy);
+    spatialNestedFEHierarchyHeatFlux->addFESpace(fes1RT);
+    spatialNestedFEHierarchyHeatFlux->addFESpace(fes2RT);
+
+    int minLevel = 1;
+    int maxLevel = 2;
+
+    auto solutionHandler
+            = std::make_unique<sparseHeat::SolutionHandler>
+            (minLevel, maxLevel,
+             spatialNestedFEHierarchyTemperature,
+             spatialNestedFEHierarchyHeatFlux,
+             MemoryPolicy::aligned);
+
+    auto& temperatureData = solutionHandler->getTemperatureData();
+    auto& heatFluxData = solutionHandler->getHeatFluxData();
+    ASSERT_EQ(temperatureData.Normlinf(), 0.);
+    ASSERT_EQ(heatFluxData.Normlinf(), 0.);
+
+    auto temporalHierarchicalFESizes
+            = evalTemporalBlockSizes(minLevel, maxLevel);
+    int nx2H1 = fes2H1->GetTrueVSize();
+    int nx1H1 = fes1H1->GetTrueVSize();
+    int nx2RT = fes2RT->GetTrueVSize();
+
+    // the levels partition the data
+    Vector level0, level1;
+    solutionHandler->makeTemperatureLevelRef(0, level0);
+    solutionHandler->makeTemperatureLevelRef(1, level1);
+    ASSERT_EQ(level0.GetData(), temperatureData.GetData());
+    ASSERT_EQ(level0.Size(), temporalHierarchicalFESizes[0]*nx2H1);
+    ASSERT_EQ(level1.GetData(), level0.GetData() + level0.Size());
+    ASSERT_EQ(level1.Size(), temporalHierarchicalFESizes[1]*nx1H1);
+
+    // writes through the slice views show up in the data
+    Vector slice;
+    solutionHandler->makeTemperatureSliceRef(1, 1, slice);
+    ASSERT_EQ(slice.Size(), nx1H1);
+    ASSERT_EQ(slice.GetData(), level1.GetData() + nx1H1);
+    slice = 1.;
+    ASSERT_EQ(temperatureData.Sum(), nx1H1);
+
+    int nt0 = temporalHierarchicalFESizes[0];
+    solutionHandler->makeHeatFluxSliceRef(0, nt0-1, slice);
+    ASSERT_EQ(slice.Size(), nx2RT);
+    slice = 2.;
+
+    // the end-time data is a copy
+    Vector heatFluxAtEndTime
+            = solutionHandler->getHeatFluxDataAtEndTime();
+    ASSERT_NE(heatFluxAtEndTime.GetData(), slice.GetData());
+    heatFluxAtEndTime -= slice;
+    ASSERT_EQ(heatFluxAtEndTime.Normlinf(), 0.);
+}
+
@@ -2,8 +2,11 @@
 
 #include "mfem.hpp"
 #include <iostream>
+#include <cmath>
+#include <vector>
 
 #include "../src/sparse_heat/solver.hpp"
+#include "../src/sparse_heat/combination_solver.hpp"
 #include "../src/sparse_heat/observer.hpp"
 
 using namespace mfem;
@@ -181,3 +184,149 @@ TEST(SparseSolver, buildAndRunLShapedTest1)
             ->getSpatialNestedFEHierarchyForHeatFlux()
             ->getNumDims().Print();
 }*/
+
+
+/**
+ * @brief Tests the combination technique; with one level,
+ * it coincides with the coupled sparse solver
+ */
+TEST(SparseSolver, combinationTechnique)
+{
+    std::string configFile
+            = "../config_files/unit_tests/"
+              "sparse_heat_solver/sparseHeat_unitSquare_test1.json";
+    auto config = getGlobalConfig(configFile);
+    config["visualization"] = false;
+    auto testCase = heat::makeTestCase(config);
+
+    int minSpatialLevel, minTemporalLevel;
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_spatial_level",
+                                        minSpatialLevel, 1);
+    READ_CONFIG_PARAM_OR_SET_TO_DEFAULT(config, "min_temporal_level",
+                                        minTemporalLevel, 1);
+
+    std::string meshDir = "../tests/input/sparse_heat_solver";
+    bool loadInitMesh = true;
+
+    for (int numLevels : {1, 3})
+    {
+        sparseHeat::CombinationSolver combiSolver(config,
+                                                  testCase,
+                                                  meshDir,
+                                                  numLevels,
+                                                  minSpatialLevel,
+                                                  minTemporalLevel,
+                                                  loadInitMesh);
+        combiSolver.run();
+        ASSERT_EQ(static_cast<int>(combiSolver.getSubProblems().size()),
+                  2*numLevels-1);
+
+        sparseHeat::Solver solver(config,
+                                  testCase,
+                                  meshDir,
+                                  numLevels,
+                                  minSpatialLevel,
+                                  minTemporalLevel,
+                                  loadInitMesh);
+        solver.run();
+
+        Vector diff(*combiSolver.getSolutionHandler()->getData());
+        diff -= *solver.getSolutionHandler()->getData();
+        if (numLevels == 1) {
+            ASSERT_LE(diff.Normlinf(), 1E-8);
+        }
+
+        sparseHeat::Observer observer(config, numLevels, minTemporalLevel);
+        auto disc = combiSolver.getDiscretisation();
+        observer.set(testCase, disc);
+        auto combiError
+                = observer.evalError(*combiSolver.getSolutionHandler());
+        auto sparseError
+                = observer.evalError(*solver.getSolutionHandler());
+
+        // the combined solution converges like the sparse solution,
+        // its error is of the same order
+        ASSERT_EQ(combiError.Size(), sparseError.Size());
+        for (int i=0; i<combiError.Size(); i++) {
+            ASSERT_TRUE(std::isfinite(combiError(i)));
+            ASSERT_LE(combiError(i), 2*sparseError(i) + 1E-8);
+        }
+        ASSERT_LE(diff.Normlinf(),
+                  solver.getSolutionHandler()->getData()->Normlinf());
+    }
+}
+
+TEST(SparseSolver, combinationTechniqueRejectsUnsupportedSolver)
+{
+    std::string configFile
+            = "../config_files/unit_tests/"
+              "sparse_heat_solver/sparseHeat_unitSquare_test1.json";
+    auto config = getGlobalConfig(configFile);
+    config["visualization"] = false;
+    config["linear_solver"] = "cg_matrix_free";
+    auto testCase = heat::makeTestCase(config);
+
+    std::string meshDir = "../tests/input/sparse_heat_solver";
+    ASSERT_THROW(sparseHeat::CombinationSolver(config, testCase, meshDir,
+                                               2, 1, 1, true),
+                 std::runtime_error);
+}
+
+TEST(SparseSolver, rejectsUnknownPreconditioner)
+{
+    std::string configFile
+            = "../config_files/unit_tests/"
+              "sparse_heat_solver/sparseHeat_unitSquare_test1.json";
+    auto config = getGlobalConfig(configFile);
+    config["visualization"] = false;
+    config["linear_solver"] = "cg_matrix_free";
+    config["cg_preconditioner"] = "gs";
+    auto testCase = heat::makeTestCase(config);
+
+    std::string meshDir = "../tests/input/sparse_heat_solver";
+    ASSERT_THROW(sparseHeat::Solver(config, testCase, meshDir,
+                                    2, 1, 1, true),
+                 std::runtime_error);
+}
+
+/**
+ * @brief Tests that the iteration counts of CG with the
+ * multilevel preconditioner stay bounded as the number
+ * of levels grows
+ */
+TEST(SparseSolver, multilevelPreconditionerIsLevelIndependent)
+{
+    std::string configFile
+            = "../config_files/unit_tests/"
+              "sparse_heat_solver/sparseHeat_unitSquare_test1.json";
+    auto config = getGlobalConfig(configFile);
+    config["visualization"] = false;
+    config["cg_preconditioner"] = "multilevel";
+    config["cg_max_iterations"] = 500;
+    auto testCase = heat::makeTestCase(config);
+
+    std::string meshDir = "../tests/input/sparse_heat_solver";
+    for (std::string linearSolver : {"cg", "cg_matrix_free"})
+    {
+        config["linear_solver"] = linearSolver;
+
+        std::vector<int> numIterations;
+        for (int numLevels=2; numLevels<=5; numLevels++)
+        {
+            sparseHeat::Solver solver(config, testCase, meshDir,
+                                      numLevels, 1, 1, true);
+            solver.run();
+            numIterations.push_back(solver.getNumCgIterations());
+            std::cout << linearSolver << "\t" << numLevels << "\t"
+                      << numIterations.back() << std::endl;
+        }
+
+        for (int iterations : numIterations) {
+            ASSERT_GT(iterations, 0);
+            ASSERT_LT(iterations, 500);
+            ASSERT_LE(iterations, 2*numIterations[0]);
+        }
+    }
+}
+
+// End of file
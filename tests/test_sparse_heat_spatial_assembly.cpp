@@ -5,6 +5,10 @@ using namespace mfem;
 
 #include <iostream>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "../src/core/config.hpp"
 #include "../src/heat/assembly.hpp"
 #include "../src/sparse_heat/spatial_assembly.hpp"
@@ -356,4 +360,167 @@ TEST(SparseSpatialAssembly, stiffnessMatrix)
     delete feColl;
 }
 
+/**
+ * @brief Tests the cross-level vector stiffness on a quadrilateral mesh
+ * against the coarse points located by TransformBack
+ */
+TEST(SparseSpatialAssembly, crossLevelVectorStiffnessQuad)
+{
+    // distorted coarse mesh, so that the element maps are not affine
+    auto coarseMesh = std::make_shared<Mesh>(2, 2, Element::QUADRILATERAL);
+    for (int i=0; i<coarseMesh->GetNV(); i++) {
+        double *v = coarseMesh->GetVertex(i);
+        if (v[0] > 0 && v[0] < 1 && v[1] > 0 && v[1] < 1) {
+            v[0] += 0.1;
+            v[1] -= 0.05;
+        }
+    }
+    auto fineMesh = std::make_shared<Mesh>(*coarseMesh);
+    fineMesh->UniformRefinement();
+
+    auto meshHierarchy = std::make_shared<NestedMeshHierarchy>();
+    meshHierarchy->addMesh(coarseMesh);
+    meshHierarchy->addMesh(fineMesh);
+    meshHierarchy->finalize();
+
+    int dim = coarseMesh->Dimension();
+    sparseHeat::SpatialVectorStiffnessIntegrator integrator;
+
+    double tol = 1E-10;
+    for (int deg : {1, 2})
+    {
+        auto feColl = std::make_unique<H1_FECollection>(deg, dim);
+        FiniteElementSpace fesCoarse(coarseMesh.get(), feColl.get());
+        FiniteElementSpace fesFine(fineMesh.get(), feColl.get());
+
+        DenseMatrix elmat, elmatTrue;
+        IntegrationPoint ipCoarse;
+        for (int j=0; j<fineMesh->GetNE(); j++)
+        {
+            int i = meshHierarchy->getAncestorId(1, j, 0);
+            const FiniteElement *feFine = fesFine.GetFE(j);
+            const FiniteElement *feCoarse = fesCoarse.GetFE(i);
+            auto elTransFine = fineMesh->GetElementTransformation(j);
+            auto elTransCoarse = coarseMesh->GetElementTransformation(i);
+            auto map = meshHierarchy->getChildInAncestorMap(1, j, 0);
+
+            integrator.assembleElementMatrix(*feFine, *elTransFine,
+                                             *feCoarse, *elTransCoarse,
+                                             map, elmat);
+
+            int ndofsFine = feFine->GetDof();
+            int ndofsCoarse = feCoarse->GetDof();
+            DenseMatrix dshapeFine(ndofsFine, dim);
+            DenseMatrix dshapeCoarse(ndofsCoarse, dim);
+            Vector divshapeFine(dim*ndofsFine);
+            Vector divshapeCoarse(dim*ndofsCoarse);
+            Vector x(dim);
+            elmatTrue.SetSize(dim*ndofsFine, dim*ndofsCoarse);
+            elmatTrue = 0.;
+
+            int order = feFine->GetOrder() + feCoarse->GetOrder() - 2;
+            const IntegrationRule *ir
+                    = &IntRules.Get(feFine->GetGeomType(), order);
+            for (int q=0; q<ir->GetNPoints(); q++)
+            {
+                const IntegrationPoint &ipFine = ir->IntPoint(q);
+                elTransFine->SetIntPoint(&ipFine);
+                feFine->CalcPhysDShape(*elTransFine, dshapeFine);
+                dshapeFine.GradToDiv(divshapeFine);
+
+                elTransFine->Transform(ipFine, x);
+                elTransCoarse->TransformBack(x, ipCoarse);
+                elTransCoarse->SetIntPoint(&ipCoarse);
+                feCoarse->CalcPhysDShape(*elTransCoarse, dshapeCoarse);
+                dshapeCoarse.GradToDiv(divshapeCoarse);
+
+                double weight = ipFine.weight*elTransFine->Weight();
+                AddMult_a_VWt(weight, divshapeFine, divshapeCoarse,
+                              elmatTrue);
+            }
+
+            elmatTrue -= elmat;
+            ASSERT_LE(elmatTrue.MaxMaxNorm(), tol);
+        }
+    }
+}
+
+/**
+ * @brief Tests that the threaded assembly of the block forms
+ * is bitwise identical to the assembly with one thread
+ */
+TEST(SparseSpatialAssembly, threadedAssembly)
+{
+    std::string input_dir
+            = "../tests/input/nested_hierarchy/2d/";
+    const std::string meshFile = input_dir+"mesh_lx0";
+
+    auto meshHierarchy
+            = std::make_shared<NestedMeshHierarchy>();
+    auto mesh = std::make_shared<Mesh>(meshFile.c_str());
+    mesh->UniformRefinement();
+    meshHierarchy->addMesh(mesh);
+    for (int k=1; k<4; k++) {
+        auto fineMesh = std::make_shared<Mesh>(*mesh);
+        fineMesh->UniformRefinement();
+        meshHierarchy->addMesh(fineMesh);
+        mesh = fineMesh;
+    }
+    meshHierarchy->finalize();
+
+    auto nestedFEHierarchy
+            = std::make_shared<NestedFEHierarchy>(meshHierarchy);
+    int dim = mesh->Dimension();
+    FiniteElementCollection *feColl
+            = new H1_FECollection(2, dim, BasisType::GaussLobatto);
+    for (auto& levelMesh : meshHierarchy->getMeshes()) {
+        auto fes = std::make_shared<FiniteElementSpace>(levelMesh.get(),
+                                                        feColl);
+        nestedFEHierarchy->addFESpace(fes);
+    }
+
+    auto assemble = [&](int numThreads)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(numThreads);
+#endif
+        auto stiffnessBilinearForm
+                = std::make_unique<BlockBilinearForm>(nestedFEHierarchy);
+        std::shared_ptr<BlockBilinearFormIntegrator> stiffnessIntegator
+                = std::make_shared<sparseHeat::SpatialStiffnessIntegrator>();
+        std::shared_ptr<BlockBilinearFormIntegrator> massIntegator
+                = std::make_shared<sparseHeat::SpatialMassIntegrator>();
+        stiffnessBilinearForm->addDomainIntegrator(stiffnessIntegator);
+        stiffnessBilinearForm->addDomainIntegrator(massIntegator);
+        stiffnessBilinearForm->assemble();
+        return stiffnessBilinearForm->getBlockMatrix();
+    };
+
+    int maxNumThreads = 1;
+#ifdef _OPENMP
+    maxNumThreads = omp_get_max_threads();
+#endif
+    auto serialMatrix = assemble(1);
+    auto threadedMatrix = assemble(std::max(4, maxNumThreads));
+#ifdef _OPENMP
+    omp_set_num_threads(maxNumThreads);
+#endif
+
+    for (int i=0; i<serialMatrix->NumRowBlocks(); i++)
+        for (int j=0; j<serialMatrix->NumColBlocks(); j++)
+        {
+            auto& serialBlock = serialMatrix->GetBlock(i,j);
+            auto& threadedBlock = threadedMatrix->GetBlock(i,j);
+            ASSERT_EQ(serialBlock.NumNonZeroElems(),
+                      threadedBlock.NumNonZeroElems());
+            for (int k=0; k<serialBlock.NumNonZeroElems(); k++) {
+                ASSERT_EQ(serialBlock.GetJ()[k], threadedBlock.GetJ()[k]);
+                ASSERT_EQ(serialBlock.GetData()[k],
+                          threadedBlock.GetData()[k]);
+            }
+        }
+
+    delete feColl;
+}
+
 // End of file
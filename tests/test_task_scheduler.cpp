@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/core/sweep_scheduler.hpp"
+#include "../src/core/task_scheduler.hpp"
+
+
+/**
+ * @brief Tests that all tasks run, and that the memory estimate
+ * of the concurrent tasks respects the budget
+ */
+TEST(MemoryAwareScheduler, budget)
+{
+    int numTasks = 16;
+    double budget = 10;
+
+    std::mutex mutex;
+    double memoryInUse = 0, peakMemory = 0;
+    std::atomic<int> numFinished(0);
+
+    MemoryAwareScheduler scheduler(4, budget);
+    for (int i=0; i<numTasks; i++)
+    {
+        double memory = 1 + (i % 5);
+        scheduler.addTask([&, memory]() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                memoryInUse += memory;
+                peakMemory = std::max(peakMemory, memoryInUse);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                memoryInUse -= memory;
+            }
+            numFinished++;
+        }, memory);
+    }
+    scheduler.run();
+
+    ASSERT_EQ(numFinished, numTasks);
+    ASSERT_LE(peakMemory, budget);
+    ASSERT_LE(scheduler.getPeakMemoryEstimate(), budget);
+}
+
+/**
+ * @brief Tests that a task larger than the budget still runs
+ */
+TEST(MemoryAwareScheduler, oversizedTask)
+{
+    int numFinished = 0;
+    MemoryAwareScheduler scheduler(2, 1);
+    scheduler.addTask([&]() { numFinished++; }, 5);
+    scheduler.run();
+    ASSERT_EQ(numFinished, 1);
+}
+
+/**
+ * @brief Tests that an exclusive task runs alone
+ */
+TEST(MemoryAwareScheduler, exclusiveTask)
+{
+    std::mutex mutex;
+    int numRunning = 0, maxRunningWithExclusive = 0;
+    std::atomic<int> numFinished(0);
+
+    MemoryAwareScheduler scheduler(4);
+    for (int i=0; i<8; i++)
+    {
+        bool exclusive = (i % 4 == 0);
+        scheduler.addTask([&, exclusive]() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                numRunning++;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (exclusive) {
+                    maxRunningWithExclusive
+                            = std::max(maxRunningWithExclusive,
+                                       numRunning);
+                }
+                numRunning--;
+            }
+            numFinished++;
+        }, 1, exclusive);
+    }
+    scheduler.run();
+
+    ASSERT_EQ(numFinished, 8);
+    ASSERT_EQ(maxRunningWithExclusive, 1);
+}
+
+/**
+ * @brief Tests that the exception of a task is rethrown by run,
+ * after the running tasks have finished, and that no further task
+ * is started
+ */
+TEST(MemoryAwareScheduler, failingTask)
+{
+    std::atomic<int> numStarted(0), numFinished(0);
+
+    MemoryAwareScheduler scheduler(2);
+    scheduler.addTask([&]() {
+        numStarted++;
+        throw std::runtime_error("failing task");
+    }, 2);
+    for (int i=0; i<8; i++) {
+        scheduler.addTask([&]() {
+            numStarted++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            numFinished++;
+        }, 1);
+    }
+    ASSERT_THROW(scheduler.run(), std::runtime_error);
+
+    // the failing task is started first
+    ASSERT_LT(numStarted, 9);
+    ASSERT_EQ(numFinished, numStarted-1);
+}
+
+/**
+ * @brief Tests that the outputs of concurrent jobs do not interleave
+ */
+TEST(SweepScheduler, jobOutput)
+{
+    int numJobs = 6;
+    SweepScheduler scheduler(3, 1, 0, 1);
+    for (int k=0; k<numJobs; k++)
+    {
+        scheduler.addJob(k % 2, [k]() {
+            getJobOutput() << "begin " << k << "\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            getJobOutput() << "end " << k << "\n";
+            SweepScheduler::JobStats stats;
+            stats.numDofs = 10;
+            return stats;
+        });
+    }
+    testing::internal::CaptureStdout();
+    scheduler.run();
+    std::string output = testing::internal::GetCapturedStdout();
+
+    for (int k=0; k<numJobs; k++)
+    {
+        std::string block = "begin " + std::to_string(k) + "\n"
+                + "end " + std::to_string(k) + "\n";
+        ASSERT_NE(output.find(block), std::string::npos);
+    }
+}
+
+/**
+ * @brief Tests that the sweep runs all jobs, and that the memory
+ * estimates are refined by the reported usage
+ */
+TEST(SweepScheduler, levels)
+{
+    int numLevels = 4, numReps = 3;
+    double bytesPerDof = 100;
+
+    std::mutex mutex;
+    std::vector<int> numRuns(numLevels, 0);
+
+    SweepScheduler scheduler(3, 1, 0, 1);
+    for (int k=0; k<numLevels; k++) {
+        for (int i=0; i<numReps; i++)
+        {
+            scheduler.addJob(k, [&, k]() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    numRuns[k]++;
+                }
+                SweepScheduler::JobStats stats;
+                stats.numDofs = 10*std::pow(4, k);
+                stats.memoryUsage = bytesPerDof*stats.numDofs;
+                return stats;
+            }, i == 0);
+        }
+    }
+    scheduler.run();
+
+    for (int k=0; k<numLevels; k++) {
+        ASSERT_EQ(numRuns[k], numReps);
+    }
+    ASSERT_DOUBLE_EQ(scheduler.getBytesPerDof(), bytesPerDof);
+
+    // at most the two finest non-exclusive jobs run together
+    ASSERT_LE(scheduler.getPeakMemoryEstimate(),
+              bytesPerDof*10*(std::pow(4, 3) + std::pow(4, 3)));
+    ASSERT_GE(scheduler.getPeakMemoryEstimate(),
+              bytesPerDof*10*std::pow(4, 3));
+}
+
+// End of file